@@ -17,16 +17,32 @@
 
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
-        shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
+        header(block), mapAccumulatorHashes(block.mapAccumulatorHashes),
+        hashMerkleRoot(block.hashMerkleRoot), hashWitnessMerkleRoot(block.hashWitnessMerkleRoot) {
+    header.fProofOfStake = block.IsProofOfStake();
+    if (header.fProofOfStake) {
+        hashPoFN = block.hashPoFN;
+        vchBlockSig = block.vchBlockSig;
+    }
     FillShortTxIDSelector();
-    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
-    prefilledtxn[0] = {0, block.vtx[0]};
-    for (size_t i = 1; i < block.vtx.size(); i++) {
+    //TODO: Use our mempool prior to block acceptance to predictively fill more than the coinbase and coinstake
+    // The coinstake of a stake block is never in anyone's mempool, so send it along with the coinbase
+    size_t nPrefilled = header.fProofOfStake ? std::min<size_t>(2, block.vtx.size()) : 1;
+    prefilledtxn.resize(nPrefilled);
+    shorttxids.resize(block.vtx.size() - nPrefilled);
+    for (size_t i = 0; i < nPrefilled; i++)
+        prefilledtxn[i] = {0, block.vtx[i]};
+    for (size_t i = nPrefilled; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
+        shorttxids[i - nPrefilled] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
     }
 }
 
+bool CBlockHeaderAndShortTxIDs::HasValidVeilData() const {
+    CVeilBlockData veilBlockData(hashMerkleRoot, hashWitnessMerkleRoot, mapAccumulatorHashes, hashPoFN);
+    return SerializeHash(veilBlockData) == header.hashVeilData;
+}
+
 void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const {
     CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
     stream << header << nonce;
@@ -50,9 +66,18 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         return READ_STATUS_INVALID;
     if (cmpctblock.shorttxids.size() + cmpctblock.prefilledtxn.size() > MAX_BLOCK_WEIGHT / MIN_SERIALIZABLE_TRANSACTION_WEIGHT)
         return READ_STATUS_INVALID;
+    // Everything that is not a transaction has to be checked against the header here, as a block
+    // reconstructed from it that fails CheckBlock gets its peer punished
+    if (!cmpctblock.HasValidVeilData())
+        return READ_STATUS_INVALID;
 
     assert(header.IsNull() && txn_available.empty());
     header = cmpctblock.header;
+    mapAccumulatorHashes = cmpctblock.mapAccumulatorHashes;
+    hashMerkleRoot = cmpctblock.hashMerkleRoot;
+    hashWitnessMerkleRoot = cmpctblock.hashWitnessMerkleRoot;
+    hashPoFN = cmpctblock.hashPoFN;
+    vchBlockSig = cmpctblock.vchBlockSig;
     txn_available.resize(cmpctblock.BlockTxCount());
 
     int32_t lastprefilledindex = -1;
@@ -182,6 +207,11 @@ ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<
     assert(!header.IsNull());
     uint256 hash = header.GetHash();
     block = header;
+    block.mapAccumulatorHashes = mapAccumulatorHashes;
+    block.hashMerkleRoot = hashMerkleRoot;
+    block.hashWitnessMerkleRoot = hashWitnessMerkleRoot;
+    block.hashPoFN = hashPoFN;
+    block.vchBlockSig = vchBlockSig;
     block.vtx.resize(txn_available.size());
 
     size_t tx_missing_offset = 0;
@@ -201,6 +231,10 @@ ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<
     if (vtx_missing.size() != tx_missing_offset)
         return READ_STATUS_INVALID;
 
+    // fProofOfStake is not part of the block hash, so a peer could have lied about it
+    if (block.IsProofOfStake() != (bool)block.fProofOfStake)
+        return READ_STATUS_INVALID;
+
     CValidationState state;
     if (!CheckBlock(block, state, Params().GetConsensus())) {
         // TODO: We really want to just check merkle tree manually here,
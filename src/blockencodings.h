@@ -145,6 +145,13 @@ protected:
 public:
     CBlockHeader header;
 
+    // The parts of a Veil block that are not in its header, committed to by header.hashVeilData
+    std::map<libzerocoin::CoinDenomination, uint256> mapAccumulatorHashes;
+    uint256 hashMerkleRoot;
+    uint256 hashWitnessMerkleRoot;
+    uint256 hashPoFN;
+    std::vector<unsigned char> vchBlockSig;
+
     // Dummy for deserialization
     CBlockHeaderAndShortTxIDs() {}
 
@@ -154,12 +161,22 @@ public:
 
     size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
 
+    //! Whether the block data matches the commitment in the header
+    bool HasValidVeilData() const;
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
         READWRITE(header);
         READWRITE(nonce);
+        READWRITE(mapAccumulatorHashes);
+        READWRITE(hashMerkleRoot);
+        READWRITE(hashWitnessMerkleRoot);
+        if (header.fProofOfStake) {
+            READWRITE(hashPoFN);
+            READWRITE(vchBlockSig);
+        }
 
         uint64_t shorttxids_size = (uint64_t)shorttxids.size();
         READWRITE(COMPACTSIZE(shorttxids_size));
@@ -196,10 +213,19 @@ protected:
     std::vector<CTransactionRef> txn_available;
     size_t prefilled_count = 0, mempool_count = 0, extra_count = 0;
     CTxMemPool* pool;
+
+    std::map<libzerocoin::CoinDenomination, uint256> mapAccumulatorHashes;
+    uint256 hashMerkleRoot;
+    uint256 hashWitnessMerkleRoot;
+    uint256 hashPoFN;
+    std::vector<unsigned char> vchBlockSig;
 public:
     CBlockHeader header;
     explicit PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
 
+    size_t GetPrefilledCount() const { return prefilled_count; }
+    size_t GetMempoolCount() const { return mempool_count; }
+
     // extra_txn is a list of extra transactions to look at, in <witness hash, reference> form
     ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn);
     bool IsTxAvailable(size_t index) const;
@@ -0,0 +1,131 @@
+// Copyright (c) 2019 The VEIL developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockperf.h>
+
+#include <logging.h>
+#include <tinyformat.h>
+#include <utiltime.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace {
+
+const char* const PHASE_NAMES[] = {
+    "check_block",
+    "rangeproof",
+    "stake",
+    "connect_block",
+    "inputs",
+    "mlsag",
+    "zerocoin_spend",
+    "zerocoin_mint",
+    "pofn",
+    "accumulator_checkpoint",
+    "script_wait",
+    "rct_index",
+    "undo_write",
+};
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == (size_t)BlockPerfPhase::COUNT, "a phase has no name");
+
+//! The block being validated by this thread
+thread_local CBlockPerf* g_pblockperf = nullptr;
+
+std::mutex g_blockperf_mutex;
+std::map<uint256, CBlockPerf> g_mapBlockPerf;
+//! Hashes of g_mapBlockPerf, oldest first
+std::deque<uint256> g_blockperf_order;
+
+} // namespace
+
+const char* BlockPerfPhaseName(BlockPerfPhase phase)
+{
+    return PHASE_NAMES[(int)phase];
+}
+
+void CBlockPerf::Add(const CBlockPerf& other)
+{
+    if (other.nHeight >= 0)
+        nHeight = other.nHeight;
+    for (int i = 0; i < (int)BlockPerfPhase::COUNT; i++) {
+        vTimeMicros[i] += other.vTimeMicros[i];
+        vCount[i] += other.vCount[i];
+    }
+}
+
+std::string CBlockPerf::ToString() const
+{
+    std::string str;
+    for (int i = 0; i < (int)BlockPerfPhase::COUNT; i++) {
+        if (!vCount[i])
+            continue;
+        str += strprintf("%s%s %.2fms (%u)", str.empty() ? "" : ", ", PHASE_NAMES[i], vTimeMicros[i] * 0.001, vCount[i]);
+    }
+    return str;
+}
+
+CBlockPerfScope::CBlockPerfScope(const uint256& hash, int nHeight) : fActive(g_pblockperf == nullptr)
+{
+    if (!fActive)
+        return;
+    perf.hash = hash;
+    perf.nHeight = nHeight;
+    g_pblockperf = &perf;
+}
+
+CBlockPerfScope::~CBlockPerfScope()
+{
+    if (!fActive)
+        return;
+    g_pblockperf = nullptr;
+    LogPrint(BCLog::BENCH, "  - Phases of block %s: %s\n", perf.hash.ToString(), perf.ToString());
+
+    std::lock_guard<std::mutex> lock(g_blockperf_mutex);
+    auto it = g_mapBlockPerf.find(perf.hash);
+    if (it == g_mapBlockPerf.end()) {
+        if (g_blockperf_order.size() >= MAX_BLOCK_PERF_ENTRIES) {
+            g_mapBlockPerf.erase(g_blockperf_order.front());
+            g_blockperf_order.pop_front();
+        }
+        g_blockperf_order.push_back(perf.hash);
+        g_mapBlockPerf.emplace(perf.hash, perf);
+        return;
+    }
+    it->second.Add(perf);
+}
+
+CBlockPerfSpan::CBlockPerfSpan(BlockPerfPhase phaseIn) : pperf(g_pblockperf), phase(phaseIn), nStart(0)
+{
+    if (pperf)
+        nStart = GetTimeMicros();
+}
+
+CBlockPerfSpan::~CBlockPerfSpan()
+{
+    if (!pperf)
+        return;
+    pperf->vTimeMicros[(int)phase] += GetTimeMicros() - nStart;
+    pperf->vCount[(int)phase]++;
+}
+
+bool GetBlockPerf(const uint256& hash, CBlockPerf& perf)
+{
+    std::lock_guard<std::mutex> lock(g_blockperf_mutex);
+    auto it = g_mapBlockPerf.find(hash);
+    if (it == g_mapBlockPerf.end())
+        return false;
+    perf = it->second;
+    return true;
+}
+
+std::vector<CBlockPerf> GetRecentBlockPerf(size_t nCount)
+{
+    std::lock_guard<std::mutex> lock(g_blockperf_mutex);
+    std::vector<CBlockPerf> vPerf;
+    for (auto it = g_blockperf_order.rbegin(); it != g_blockperf_order.rend() && vPerf.size() < nCount; ++it)
+        vPerf.push_back(g_mapBlockPerf.at(*it));
+    return vPerf;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2019 The VEIL developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VEIL_BLOCKPERF_H
+#define VEIL_BLOCKPERF_H
+
+#include <uint256.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Parts of block validation that are timed for every block, see getblockperf */
+enum class BlockPerfPhase {
+    CHECK_BLOCK,            //!< CheckBlock, including the rangeproofs of its transactions
+    RANGEPROOF,             //!< Rangeproofs that were not in the rangeproof cache
+    STAKE,                  //!< Proof of stake kernel and zerocoin stake checks
+    CONNECT_BLOCK,          //!< ConnectBlock, including everything below
+    INPUTS,                 //!< CheckInputs, including MLSAG but not the queued script checks
+    MLSAG,                  //!< MLSAG signatures of RingCT inputs
+    ZEROCOIN_SPEND,         //!< Contextual checks of zerocoin spends, including their proofs
+    ZEROCOIN_MINT,          //!< Contextual checks of zerocoin mints
+    POFN,                   //!< Proof of full node hash
+    ACCUMULATOR_CHECKPOINT, //!< Accumulator checkpoint validation
+    SCRIPT_WAIT,            //!< Waiting for the script check threads
+    RCT_INDEX,              //!< Indexing RingCT outputs and key images, and writing them
+    UNDO_WRITE,             //!< Writing the undo data
+
+    COUNT
+};
+
+const char* BlockPerfPhaseName(BlockPerfPhase phase);
+
+/** Time spent in the phases of validating one block. Phases nest, so their times overlap. */
+struct CBlockPerf
+{
+    uint256 hash;
+    int nHeight = -1;
+    int64_t vTimeMicros[(int)BlockPerfPhase::COUNT] = {};
+    uint32_t vCount[(int)BlockPerfPhase::COUNT] = {};
+
+    void Add(const CBlockPerf& other);
+    std::string ToString() const;
+};
+
+/** Number of recent blocks whose timings are kept */
+static const size_t MAX_BLOCK_PERF_ENTRIES = 1000;
+
+/**
+ * Collects the spans of the current thread for one block while it exists, and adds them to that
+ * block's record when it goes out of scope. A scope opened while another is active does nothing,
+ * so spans are attributed to the outermost block.
+ */
+class CBlockPerfScope
+{
+private:
+    CBlockPerf perf;
+    bool fActive;
+
+public:
+    explicit CBlockPerfScope(const uint256& hash, int nHeight = -1);
+    ~CBlockPerfScope();
+
+    CBlockPerfScope(const CBlockPerfScope&) = delete;
+    CBlockPerfScope& operator=(const CBlockPerfScope&) = delete;
+};
+
+/** Times one phase for the block of the thread's CBlockPerfScope, if there is one */
+class CBlockPerfSpan
+{
+private:
+    CBlockPerf* pperf;
+    BlockPerfPhase phase;
+    int64_t nStart;
+
+public:
+    explicit CBlockPerfSpan(BlockPerfPhase phaseIn);
+    ~CBlockPerfSpan();
+
+    CBlockPerfSpan(const CBlockPerfSpan&) = delete;
+    CBlockPerfSpan& operator=(const CBlockPerfSpan&) = delete;
+};
+
+/** Get the recorded timings of a block; returns false if there are none */
+bool GetBlockPerf(const uint256& hash, CBlockPerf& perf);
+
+/** Get the recorded timings of the most recent blocks, newest first */
+std::vector<CBlockPerf> GetRecentBlockPerf(size_t nCount);
+
+#endif // VEIL_BLOCKPERF_H
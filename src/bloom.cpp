@@ -322,3 +322,41 @@ void CRollingBloomFilter::reset()
         *it = 0;
     }
 }
+
+CKeySetBloomFilter::CKeySetBloomFilter(const unsigned int nCapacityIn, const double nFPRate) :
+    // Same sizing as CBloomFilter, without its protocol limits
+    vData((unsigned int)(-1  / LN2SQUARED * nCapacityIn * log(nFPRate)) / 8),
+    nHashFuncs((unsigned int)(vData.size() * 8 / nCapacityIn * LN2)),
+    nTweak(GetRand(std::numeric_limits<unsigned int>::max())),
+    nCapacity(nCapacityIn),
+    nElements(0)
+{
+}
+
+inline unsigned int CKeySetBloomFilter::Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const
+{
+    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash) % (vData.size() * 8);
+}
+
+void CKeySetBloomFilter::insert(const std::vector<unsigned char>& vKey)
+{
+    if (vData.empty())
+        return;
+    for (unsigned int i = 0; i < nHashFuncs; i++) {
+        unsigned int nIndex = Hash(i, vKey);
+        vData[nIndex >> 3].fetch_or(1 << (7 & nIndex));
+    }
+    nElements++;
+}
+
+bool CKeySetBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+{
+    if (vData.empty())
+        return true;
+    for (unsigned int i = 0; i < nHashFuncs; i++) {
+        unsigned int nIndex = Hash(i, vKey);
+        if (!(vData[nIndex >> 3].load() & (1 << (7 & nIndex))))
+            return false;
+    }
+    return true;
+}
@@ -7,6 +7,7 @@
 
 #include <serialize.h>
 
+#include <atomic>
 #include <vector>
 
 class COutPoint;
@@ -140,4 +141,59 @@ private:
     int nHashFuncs;
 };
 
+/**
+ * KeySetBloomFilter is a probabilistic "is this key possibly in the set" test for a set of keys kept elsewhere, such
+ * as a database table, to skip looking up keys that are not in it. Unlike CRollingBloomFilter it never forgets an
+ * item, so contains() is true for every key that was inserted. Removing a key from the set leaves it in the filter as
+ * a false positive until the filter is rebuilt.
+ *
+ * It is not bound by the protocol limits of CBloomFilter. Once more than nCapacity keys were inserted the false
+ * positive rate rises above the one asked for, which IsOverCapacity() tells its owner so it can rebuild it larger.
+ *
+ * Its bits are atomic, so contains() may run without a lock while one thread inserts.
+ */
+class CKeySetBloomFilter
+{
+public:
+    //! An unsized filter contains everything
+    CKeySetBloomFilter() : nHashFuncs(0), nTweak(0), nCapacity(0), nElements(0) {}
+    CKeySetBloomFilter(const unsigned int nCapacityIn, const double nFPRate);
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        std::vector<unsigned char> vch(vData.size());
+        for (size_t i = 0; i < vData.size(); i++)
+            vch[i] = vData[i].load();
+        s << vch << nHashFuncs << nTweak << nCapacity << nElements.load();
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        std::vector<unsigned char> vch;
+        unsigned int nElementsIn;
+        s >> vch >> nHashFuncs >> nTweak >> nCapacity >> nElementsIn;
+        std::vector<std::atomic<unsigned char>>(vch.size()).swap(vData);
+        for (size_t i = 0; i < vch.size(); i++)
+            vData[i] = vch[i];
+        nElements = nElementsIn;
+    }
+
+    void insert(const std::vector<unsigned char>& vKey);
+    bool contains(const std::vector<unsigned char>& vKey) const;
+
+    unsigned int GetCapacity() const { return nCapacity; }
+    bool IsOverCapacity() const { return nElements > nCapacity; }
+
+private:
+    unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const;
+
+    std::vector<std::atomic<unsigned char>> vData;
+    unsigned int nHashFuncs;
+    unsigned int nTweak;
+    unsigned int nCapacity;
+    std::atomic<unsigned int> nElements;
+};
+
 #endif // BITCOIN_BLOOM_H
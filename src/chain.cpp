@@ -188,9 +188,30 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
     return pa;
 }
 
+const std::shared_ptr<const CAccumulatorHashes>& EmptyAccumulatorHashes()
+{
+    static const std::shared_ptr<const CAccumulatorHashes> pEmpty = [] {
+        CAccumulatorHashes hashes;
+        for (auto denom : libzerocoin::zerocoinDenomList)
+            hashes[denom] = uint256();
+        return std::make_shared<const CAccumulatorHashes>(hashes);
+    }();
+    return pEmpty;
+}
+
+void CBlockIndex::SetAccumulatorHashes(const CAccumulatorHashes& mapHashes)
+{
+    if (pprev && *pprev->pAccumulatorHashes == mapHashes)
+        pAccumulatorHashes = pprev->pAccumulatorHashes;
+    else if (*pAccumulatorHashes != mapHashes)
+        pAccumulatorHashes = std::make_shared<const CAccumulatorHashes>(mapHashes);
+}
+
 void CBlockIndex::AddAccumulator(libzerocoin::CoinDenomination denom, CBigNum bnAccumulator)
 {
-    mapAccumulatorHashes[denom] = SerializeHash(bnAccumulator);
+    CAccumulatorHashes mapHashes = GetAccumulatorHashes();
+    mapHashes[denom] = SerializeHash(bnAccumulator);
+    SetAccumulatorHashes(mapHashes);
 }
 
 void CBlockIndex::AddAccumulator(AccumulatorMap mapAccumulator)
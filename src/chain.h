@@ -14,6 +14,8 @@
 #include <uint256.h>
 #include <libzerocoin/bignum.h>
 
+#include <array>
+#include <memory>
 #include <vector>
 #include <map>
 
@@ -164,6 +166,8 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    BLOCK_POW_VERIFIED      =   256, //!< x16r hash of the header was checked against nBits, never recomputed
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -171,6 +175,121 @@ enum BlockStatus: uint32_t {
  * candidates to be the next block. A blockindex may have multiple pprev pointing
  * to it, but at most one of them can be part of the currently active branch.
  */
+/**
+ * One value per zerocoin denomination, stored in zerocoinDenomList order. Replaces the std::map members of the block
+ * index, which cost a heap node per denomination for every block.
+ */
+template <typename T>
+class CDenominationArray
+{
+private:
+    std::array<T, libzerocoin::ZEROCOIN_DENOM_COUNT> values;
+
+public:
+    CDenominationArray() { values.fill(T()); }
+
+    //! Throws std::out_of_range for an invalid denomination, like std::map::at()
+    T& at(libzerocoin::CoinDenomination denom) { return values.at(Index(denom)); }
+    const T& at(libzerocoin::CoinDenomination denom) const { return values.at(Index(denom)); }
+
+    static bool IsValid(libzerocoin::CoinDenomination denom) { return libzerocoin::ZerocoinDenominationToIndex(denom) >= 0; }
+
+    friend bool operator==(const CDenominationArray& a, const CDenominationArray& b) { return a.values == b.values; }
+    friend bool operator!=(const CDenominationArray& a, const CDenominationArray& b) { return a.values != b.values; }
+    friend bool operator<(const CDenominationArray& a, const CDenominationArray& b) { return a.values < b.values; }
+
+private:
+    static size_t Index(libzerocoin::CoinDenomination denom)
+    {
+        int nIndex = libzerocoin::ZerocoinDenominationToIndex(denom);
+        return nIndex < 0 ? libzerocoin::ZEROCOIN_DENOM_COUNT : (size_t)nIndex;
+    }
+};
+
+//! Kept as the exact map of the block so that comparisons against block.mapAccumulatorHashes are unchanged
+typedef std::map<libzerocoin::CoinDenomination, uint256> CAccumulatorHashes;
+
+/** Serializes a CDenominationArray in the format of std::map<CoinDenomination, T> */
+template <typename T>
+class CDenominationMapWrapper
+{
+private:
+    CDenominationArray<T>& values;
+
+public:
+    explicit CDenominationMapWrapper(CDenominationArray<T>& valuesIn) : values(valuesIn) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, libzerocoin::zerocoinDenomList.size());
+        for (auto denom : libzerocoin::zerocoinDenomList) {
+            ::Serialize(s, denom);
+            ::Serialize(s, values.at(denom));
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        values = CDenominationArray<T>();
+        uint64_t nSize = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nSize; i++) {
+            libzerocoin::CoinDenomination denom;
+            T value;
+            ::Unserialize(s, denom);
+            ::Unserialize(s, value);
+            if (CDenominationArray<T>::IsValid(denom))
+                values.at(denom) = value;
+        }
+    }
+};
+
+/** Serializes a count per denomination as a std::vector<CoinDenomination> holding each denomination count times */
+class CDenominationListWrapper
+{
+private:
+    CDenominationArray<uint32_t>& counts;
+
+public:
+    explicit CDenominationListWrapper(CDenominationArray<uint32_t>& countsIn) : counts(countsIn) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        uint64_t nSize = 0;
+        for (auto denom : libzerocoin::zerocoinDenomList)
+            nSize += counts.at(denom);
+        WriteCompactSize(s, nSize);
+        for (auto denom : libzerocoin::zerocoinDenomList) {
+            for (uint32_t i = 0; i < counts.at(denom); i++)
+                ::Serialize(s, denom);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        counts = CDenominationArray<uint32_t>();
+        uint64_t nSize = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nSize; i++) {
+            libzerocoin::CoinDenomination denom;
+            ::Unserialize(s, denom);
+            if (CDenominationArray<uint32_t>::IsValid(denom))
+                counts.at(denom)++;
+        }
+    }
+};
+
+template <typename T>
+CDenominationMapWrapper<T> MakeDenominationMapWrapper(CDenominationArray<T>& values) { return CDenominationMapWrapper<T>(values); }
+
+#define DENOMINATION_MAP(obj) MakeDenominationMapWrapper(obj)
+#define DENOMINATION_LIST(obj) CDenominationListWrapper(obj)
+
+//! The accumulator hashes of new block index entries, zero for every denomination
+const std::shared_ptr<const CAccumulatorHashes>& EmptyAccumulatorHashes();
+
 class CBlockIndex
 {
 public:
@@ -235,14 +354,16 @@ public:
     int32_t nSequenceId;
 
     //! zerocoin specific fields
-    std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
-    std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
+    CDenominationArray<int64_t> arrZerocoinSupply;
+    //! Number of mints of each denomination in this block
+    CDenominationArray<uint32_t> arrMintsInBlock;
 
     //! (memory only) Maximum nTime in the chain up to and including this block.
     unsigned int nTimeMax;
 
-    //! Hash value for the accumulator. Can be used to access the zerocoindb for the accumulator value
-    std::map<libzerocoin::CoinDenomination ,uint256> mapAccumulatorHashes;
+    //! Hash value for the accumulator. Can be used to access the zerocoindb for the accumulator value.
+    //! The hashes only change at checkpoints, so consecutive blocks share the same immutable instance.
+    std::shared_ptr<const CAccumulatorHashes> pAccumulatorHashes;
 
     uint256 hashMerkleRoot;
     uint256 hashWitnessMerkleRoot;
@@ -276,20 +397,13 @@ public:
 
         nAnonOutputs = 0;
 
-        mapAccumulatorHashes.clear();
+        pAccumulatorHashes = EmptyAccumulatorHashes();
         hashMerkleRoot = uint256();
         hashWitnessMerkleRoot = uint256();
 
-        for (auto& denom : libzerocoin::zerocoinDenomList) {
-            mapAccumulatorHashes[denom] = uint256();
-        }
-
         // Start supply of each denomination with 0s
-        for (auto& denom : libzerocoin::zerocoinDenomList) {
-            mapZerocoinSupply.insert(std::make_pair(denom, 0));
-        }
-
-        vMintDenominationsInBlock.clear();
+        arrZerocoinSupply = CDenominationArray<int64_t>();
+        arrMintsInBlock = CDenominationArray<uint32_t>();
 
         nVersion       = 0;
         hashVeilData   = uint256();
@@ -375,12 +489,21 @@ public:
     /** Returns the hash of the accumulator for the specified denomination. If it doesn't exist then a new uint256 is returned*/
     uint256 GetAccumulatorHash(libzerocoin::CoinDenomination denom) const
     {
-        if(mapAccumulatorHashes.find(denom) != mapAccumulatorHashes.end()) {
-            return mapAccumulatorHashes.find(denom)->second;
-        }
-        else {
+        auto it = pAccumulatorHashes->find(denom);
+        if (it == pAccumulatorHashes->end())
             return uint256();
-        }
+        return it->second;
+    }
+
+    //! The accumulator hashes exactly as they were set from the block
+    const CAccumulatorHashes& GetAccumulatorHashes() const { return *pAccumulatorHashes; }
+
+    //! Set the accumulator hashes, sharing the instance of the previous block if they did not change
+    void SetAccumulatorHashes(const CAccumulatorHashes& mapHashes);
+
+    bool HasSameAccumulatorHashes(const CBlockIndex& other) const
+    {
+        return pAccumulatorHashes == other.pAccumulatorHashes || *pAccumulatorHashes == *other.pAccumulatorHashes;
     }
 
     static constexpr int nMedianTimeSpan = 11;
@@ -418,7 +541,7 @@ public:
     {
         int64_t nTotal = 0;
         for (auto& denom : libzerocoin::zerocoinDenomList) {
-            nTotal += libzerocoin::ZerocoinDenominationToAmount(denom) * mapZerocoinSupply.at(denom);
+            nTotal += libzerocoin::ZerocoinDenominationToAmount(denom) * arrZerocoinSupply.at(denom);
         }
 
         return nTotal;
@@ -426,8 +549,12 @@ public:
 
     bool MintedDenomination(libzerocoin::CoinDenomination denom) const
     {
-        return std::find(vMintDenominationsInBlock.begin(), vMintDenominationsInBlock.end(), denom)
-                        != vMintDenominationsInBlock.end();
+        return GetMintCount(denom) > 0;
+    }
+
+    int GetMintCount(libzerocoin::CoinDenomination denom) const
+    {
+        return CDenominationArray<uint32_t>::IsValid(denom) ? arrMintsInBlock.at(denom) : 0;
     }
 
     std::string ToString() const
@@ -528,9 +655,16 @@ public:
         READWRITE(nTime);
         READWRITE(nBits);
         READWRITE(nNonce);
-        READWRITE(mapAccumulatorHashes);
-        READWRITE(mapZerocoinSupply);
-        READWRITE(vMintDenominationsInBlock);
+        // zerocoin fields keep the std::map/std::vector layout they had on disk
+        if (ser_action.ForRead()) {
+            CAccumulatorHashes hashes;
+            READWRITE(hashes);
+            pAccumulatorHashes = std::make_shared<const CAccumulatorHashes>(std::move(hashes));
+        } else {
+            READWRITE(const_cast<CAccumulatorHashes&>(*pAccumulatorHashes));
+        }
+        READWRITE(DENOMINATION_MAP(arrZerocoinSupply));
+        READWRITE(DENOMINATION_LIST(arrMintsInBlock));
         READWRITE(fProofOfFullNode);
 
         //Proof of stake
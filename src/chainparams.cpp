@@ -16,6 +16,7 @@
 #include "arith_uint256.h"
 #include "key.h"
 #include "key_io.h"
+#include "libzerocoin/PrecomputedParams.h"
 #include "tinyformat.h"
 
 static CBlock CreateGenesisBlock(const char* pszTimestamp, const CScript& genesisOutputScript, uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const CAmount& genesisReward)
@@ -142,9 +143,15 @@ void CChainParams::UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64
     consensus.vDeployments[d].nTimeout = nTimeout;
 }
 
+//! Parameters read from the precomputation file. When set they are used instead of deriving them from the modulus.
+static std::unique_ptr<libzerocoin::ZerocoinParams> pzcParamsPrecomputed;
+
 libzerocoin::ZerocoinParams* CChainParams::Zerocoin_Params() const
 {
     assert(this);
+    if (pzcParamsPrecomputed)
+        return pzcParamsPrecomputed.get();
+
     static CBigNum bnDecModulus = 0;
     if (!bnDecModulus)
         bnDecModulus.SetDec(zerocoinModulus);
@@ -282,6 +289,7 @@ public:
                           "7259085141865462043576798423387184774447920739934236584823824281198163815010674810451660377306056201619676256133"
                           "8441436038339044149526344321901146575444541784240209246165157233507787077498171257724679629263863563732899121548"
                           "31438167899885040445364023527381951378636564391212010397122822120720357";
+        hashZerocoinPrecomputedParams = uint256S("0x3b37fd5dcf779030b1f15ccfea0f2089f6a5e219fc4af6a4f0a2f471488f03fc");
         nMaxZerocoinSpendsPerTransaction = 20; // Assume about 6.5kb each
         nMinZerocoinMintFee = 1 * CENT; //high fee required for zerocoin mints
         nMintRequiredConfirmations = 20; //the maximum amount of confirmations until accumulated in 19
@@ -425,6 +433,7 @@ public:
                           "7259085141865462043576798423387184774447920739934236584823824281198163815010674810451660377306056201619676256133"
                           "8441436038339044149526344321901146575444541784240209246165157233507787077498171257724679629263863563732899121548"
                           "31438167899885040445364023527381951378636564391212010397122822120720357";
+        hashZerocoinPrecomputedParams = uint256S("0x3b37fd5dcf779030b1f15ccfea0f2089f6a5e219fc4af6a4f0a2f471488f03fc");
         nMaxZerocoinSpendsPerTransaction = 20; // Assume about 6.5kb each
         nMinZerocoinMintFee = 1 * CENT; //high fee required for zerocoin mints
         nMintRequiredConfirmations = 20; //the maximum amount of confirmations until accumulated in 19
@@ -530,6 +539,7 @@ public:
                           "7259085141865462043576798423387184774447920739934236584823824281198163815010674810451660377306056201619676256133"
                           "8441436038339044149526344321901146575444541784240209246165157233507787077498171257724679629263863563732899121548"
                           "31438167899885040445364023527381951378636564391212010397122822120720357";
+        hashZerocoinPrecomputedParams = uint256S("0x3b37fd5dcf779030b1f15ccfea0f2089f6a5e219fc4af6a4f0a2f471488f03fc");
         nMaxZerocoinSpendsPerTransaction = 7; // Assume about 20kb each
         nMinZerocoinMintFee = 1 * CENT; //high fee required for zerocoin mints
         nMintRequiredConfirmations = 20; //the maximum amount of confirmations until accumulated in 19
@@ -563,6 +573,25 @@ void SelectParams(const std::string& network)
     globalChainParams = CreateChainParams(network);
 }
 
+void LoadZerocoinParams(const std::string& strPath)
+{
+    int64_t nStart = GetTimeMillis();
+    std::string strError;
+    std::unique_ptr<libzerocoin::ZerocoinParams> params(new libzerocoin::ZerocoinParams());
+    if (libzerocoin::ReadPrecomputedParams(*params, Params().Zerocoin_PrecomputedParamsHash(), strPath, strError)) {
+        pzcParamsPrecomputed = std::move(params);
+        LogPrintf("%s: loaded precomputed zerocoin parameters from %s in %dms\n", __func__, strPath, GetTimeMillis() - nStart);
+        return;
+    }
+
+    // Derive the parameters from the modulus and store them so that the next startup can read them instead
+    LogPrintf("%s: cannot use precomputed zerocoin parameters from %s: %s\n", __func__, strPath, strError);
+    if (!libzerocoin::WritePrecomputedParams(*Params().Zerocoin_Params(), strPath, strError))
+        LogPrintf("%s: failed to write precomputed zerocoin parameters: %s\n", __func__, strError);
+    else
+        LogPrintf("%s: generated precomputed zerocoin parameters in %dms\n", __func__, GetTimeMillis() - nStart);
+}
+
 void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout)
 {
     globalChainParams->UpdateVersionBitsParameters(d, nStartTime, nTimeout);
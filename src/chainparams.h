@@ -115,6 +115,8 @@ public:
     /** Zerocoin **/
     libzerocoin::ZerocoinParams* Zerocoin_Params() const;
     std::string Zerocoin_Modulus() const { return zerocoinModulus; }
+    //! SHA256d of the parameters derived from the modulus, which a precomputation file has to match
+    const uint256& Zerocoin_PrecomputedParamsHash() const { return hashZerocoinPrecomputedParams; }
     int Zerocoin_MaxSpendsPerTransaction() const { return nMaxZerocoinSpendsPerTransaction; }
     CAmount Zerocoin_MintFee() const { return nMinZerocoinMintFee; }
     int Zerocoin_MintRequiredConfirmations() const { return nMintRequiredConfirmations; }
@@ -164,6 +166,7 @@ protected:
 
     // zerocoin
     std::string zerocoinModulus;
+    uint256 hashZerocoinPrecomputedParams;
     int nMaxZerocoinSpendsPerTransaction;
     CAmount nMinZerocoinMintFee;
     int nMintRequiredConfirmations;
@@ -203,6 +206,13 @@ const CChainParams &Params();
  */
 void SelectParams(const std::string& chain);
 
+/**
+ * Use the zerocoin parameters stored in a precomputation file instead of deriving them from the modulus on first use.
+ * If the file is missing or was generated for other parameters it is (re)written, so the next startup can map it.
+ * Must be called before Params().Zerocoin_Params() is used.
+ */
+void LoadZerocoinParams(const std::string& strPath);
+
 /**
  * Allows modifying the Version Bits regtest parameters.
  */
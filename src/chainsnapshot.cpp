@@ -0,0 +1,396 @@
+// Copyright (c) 2019 The VEIL developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainsnapshot.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <hash.h>
+#include <pow.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <txdb.h>
+#include <ui_interface.h>
+#include <util.h>
+#include <validation.h>
+
+#include <set>
+#include <vector>
+
+namespace {
+
+//! Record types of the snapshot body, which ends with SNAPSHOT_END
+enum SnapshotRecord : uint8_t {
+    SNAPSHOT_END = 0,
+    SNAPSHOT_COIN = 1,
+    SNAPSHOT_BLOCKTREE = 2,
+    SNAPSHOT_ZEROCOIN = 3,
+};
+
+//! Block tree records that are part of a snapshot; block file info and flags are local to a node
+const std::set<char> setBlockTreeSnapshotKeys = {DB_BLOCK_INDEX, DB_RCTOUTPUT, DB_RCTOUTPUT_LINK, DB_RCTKEYIMAGE};
+//! Zerocoin records that are part of a snapshot: mints, spends, accumulator values and the accumulator state. A kept
+//! key filter belongs to the databases it was built from.
+const std::set<char> setZerocoinSnapshotKeys = {'m', DB_COINSPEND, '2', 'A'};
+
+const std::set<char>& SnapshotKeys(uint8_t nType)
+{
+    return nType == SNAPSHOT_BLOCKTREE ? setBlockTreeSnapshotKeys : setZerocoinSnapshotKeys;
+}
+
+//! Coins written to the coins database per batch while loading
+const size_t SNAPSHOT_COINS_PER_BATCH = 100000;
+
+/** Writes to a file and hashes everything written */
+class SnapshotWriter
+{
+private:
+    CAutoFile& file;
+    CHashWriter hasher;
+
+public:
+    explicit SnapshotWriter(CAutoFile& fileIn) : file(fileIn), hasher(SER_DISK, CLIENT_VERSION) {}
+
+    template <typename T>
+    SnapshotWriter& operator<<(const T& obj)
+    {
+        file << obj;
+        hasher << obj;
+        return *this;
+    }
+
+    uint256 GetHash() { return hasher.GetHash(); }
+};
+
+/** A block index record without block and undo file positions, which are meaningless on another node. */
+bool StripBlockIndexRecord(std::vector<unsigned char>& vchValue)
+{
+    CDiskBlockIndex diskindex;
+    try {
+        CDataStream ss(vchValue, SER_DISK, CLIENT_VERSION);
+        ss >> diskindex;
+    } catch (const std::exception&) {
+        return false;
+    }
+    diskindex.nStatus &= ~(BLOCK_HAVE_MASK | BLOCK_POW_VERIFIED);
+    diskindex.nFile = 0;
+    diskindex.nDataPos = 0;
+    diskindex.nUndoPos = 0;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << diskindex;
+    vchValue.assign(ss.begin(), ss.end());
+    return true;
+}
+
+bool DumpDatabase(CDBIterator* pcursor, SnapshotWriter& writer, uint8_t nType, uint64_t& nRecords, std::string& strError)
+{
+    std::vector<unsigned char> vchKey, vchValue;
+    RawBytes key(vchKey), value(vchValue);
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(value)) {
+            strError = "Unable to read a database record";
+            return false;
+        }
+        if (vchKey.empty() || !SnapshotKeys(nType).count(vchKey[0]))
+            continue;
+        if (nType == SNAPSHOT_BLOCKTREE && vchKey[0] == DB_BLOCK_INDEX && !StripBlockIndexRecord(vchValue)) {
+            strError = "Unable to read a block index record";
+            return false;
+        }
+        writer << nType << vchKey << vchValue;
+        nRecords++;
+    }
+    return true;
+}
+
+/**
+ * Read a snapshot file, passing each coin and database record to the handlers, and check the hash at the end.
+ * The handlers return false to stop with an error.
+ */
+template <typename CoinHandler, typename RecordHandler>
+bool ReadSnapshot(const fs::path& path, const CChainParams& chainparams, CChainSnapshotInfo& info, std::string& strError,
+        CoinHandler handleCoin, RecordHandler handleRecord)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        strError = strprintf("Unable to open snapshot file %s", path.string());
+        return false;
+    }
+
+    info = CChainSnapshotInfo();
+    try {
+        CHashVerifier<CAutoFile> verifier(&file);
+        verifier >> info.header;
+        if (info.header.nVersion != CHAINSTATE_SNAPSHOT_VERSION) {
+            strError = strprintf("Unsupported snapshot version %u", info.header.nVersion);
+            return false;
+        }
+        if (memcmp(info.header.pchMessageStart, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0) {
+            strError = "Snapshot is for a different network";
+            return false;
+        }
+
+        std::vector<unsigned char> vchKey, vchValue;
+        while (true) {
+            boost::this_thread::interruption_point();
+            uint8_t nType;
+            verifier >> nType;
+            if (nType == SNAPSHOT_END)
+                break;
+            if (nType == SNAPSHOT_COIN) {
+                COutPoint outpoint;
+                Coin coin;
+                verifier >> outpoint >> coin;
+                info.nCoins++;
+                if (!handleCoin(outpoint, std::move(coin)))
+                    return false;
+            } else if (nType == SNAPSHOT_BLOCKTREE || nType == SNAPSHOT_ZEROCOIN) {
+                verifier >> vchKey >> vchValue;
+                if (vchKey.empty() || !SnapshotKeys(nType).count(vchKey[0])) {
+                    strError = "Snapshot contains an unexpected database record";
+                    return false;
+                }
+                // Block and undo data of a block index record would point into the local block files
+                if (nType == SNAPSHOT_BLOCKTREE && vchKey[0] == DB_BLOCK_INDEX && !StripBlockIndexRecord(vchValue)) {
+                    strError = "Snapshot contains an unreadable block index record";
+                    return false;
+                }
+                if (nType == SNAPSHOT_BLOCKTREE)
+                    info.nBlockTreeRecords++;
+                else
+                    info.nZerocoinRecords++;
+                if (!handleRecord(nType, vchKey, vchValue))
+                    return false;
+            } else {
+                strError = strprintf("Unknown snapshot record type %u", nType);
+                return false;
+            }
+        }
+        info.hash = verifier.GetHash();
+
+        uint256 hashFile;
+        file >> hashFile;
+        if (hashFile != info.hash) {
+            strError = "Snapshot hash mismatch, the file is corrupt";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        strError = strprintf("Unable to read snapshot file: %s", e.what());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool DumpChainstateSnapshot(const fs::path& path, CChainSnapshotInfo& info, std::string& strError)
+{
+    info = CChainSnapshotInfo();
+    std::unique_ptr<CCoinsViewCursor> pcoins;
+    std::unique_ptr<CDBIterator> pblocktreecursor, pzerocoincursor;
+    {
+        // Everything is flushed and the cursors are created under cs_main, so they see one consistent state
+        // while the node carries on
+        LOCK(cs_main);
+        FlushStateToDisk();
+        CBlockIndex* pindexTip = chainActive.Tip();
+        if (!pindexTip || pcoinsdbview->GetBestBlock() != pindexTip->GetBlockHash()) {
+            strError = "The chainstate is not at the active tip";
+            return false;
+        }
+        memcpy(info.header.pchMessageStart, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE);
+        info.header.hashBlock = pindexTip->GetBlockHash();
+        info.header.nHeight = pindexTip->nHeight;
+        pcoins.reset(pcoinsdbview->Cursor());
+        pblocktreecursor.reset(pblocktree->NewIterator());
+        pzerocoincursor.reset(pzerocoinDB->NewIterator());
+    }
+
+    fs::path pathTmp = path;
+    pathTmp += ".tmp";
+    try {
+        CAutoFile file(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            strError = strprintf("Unable to create %s", pathTmp.string());
+            return false;
+        }
+
+        SnapshotWriter writer(file);
+        writer << info.header;
+
+        for (; pcoins->Valid(); pcoins->Next()) {
+            boost::this_thread::interruption_point();
+            COutPoint outpoint;
+            Coin coin;
+            if (!pcoins->GetKey(outpoint) || !pcoins->GetValue(coin)) {
+                strError = "Unable to read the UTXO set";
+                return false;
+            }
+            writer << (uint8_t)SNAPSHOT_COIN << outpoint << coin;
+            info.nCoins++;
+        }
+        if (!DumpDatabase(pblocktreecursor.get(), writer, SNAPSHOT_BLOCKTREE, info.nBlockTreeRecords, strError))
+            return false;
+        // The zerocoin database is not obfuscated, so it has no obfuscation key record to skip
+        if (!DumpDatabase(pzerocoincursor.get(), writer, SNAPSHOT_ZEROCOIN, info.nZerocoinRecords, strError))
+            return false;
+        writer << (uint8_t)SNAPSHOT_END;
+
+        info.hash = writer.GetHash();
+        file << info.hash;
+        if (!FileCommit(file.Get()))
+            throw std::runtime_error("FileCommit failed");
+        file.fclose();
+    } catch (const std::exception& e) {
+        strError = strprintf("Unable to write snapshot: %s", e.what());
+        return false;
+    }
+
+    if (!RenameOver(pathTmp, path)) {
+        strError = strprintf("Unable to rename %s to %s", pathTmp.string(), path.string());
+        return false;
+    }
+    LogPrintf("%s: wrote snapshot of block %s (height %d) to %s: %u coins, %u block tree and %u zerocoin records, hash %s\n",
+        __func__, info.header.hashBlock.ToString(), info.header.nHeight, path.string(), info.nCoins,
+        info.nBlockTreeRecords, info.nZerocoinRecords, info.hash.ToString());
+    return true;
+}
+
+bool VerifyChainstateSnapshot(const fs::path& path, const CChainParams& chainparams, CChainSnapshotInfo& info, std::string& strError)
+{
+    return ReadSnapshot(path, chainparams, info, strError,
+        [](const COutPoint&, Coin&&) { return true; },
+        [](uint8_t, const std::vector<unsigned char>&, const std::vector<unsigned char>&) { return true; });
+}
+
+bool LoadChainstateSnapshot(const fs::path& path, const CChainParams& chainparams, const uint256& hashExpected, size_t nCoinDBCache,
+        CChainSnapshotInfo& info, std::string& strError)
+{
+    LogPrintf("%s: verifying snapshot %s\n", __func__, path.string());
+    if (!VerifyChainstateSnapshot(path, chainparams, info, strError))
+        return false;
+    LogPrintf("%s: snapshot of block %s (height %d) has hash %s\n", __func__, info.header.hashBlock.ToString(),
+        info.header.nHeight, info.hash.ToString());
+    if (info.hash != hashExpected) {
+        strError = strprintf("Snapshot hash %s does not match the expected hash %s", info.hash.ToString(), hashExpected.ToString());
+        return false;
+    }
+
+    CCoinsViewDB coinsdb(nCoinDBCache);
+    {
+        std::unique_ptr<CDBIterator> pcursor(pblocktree->NewIterator());
+        pcursor->SeekToFirst();
+        if (pcursor->Valid() || !coinsdb.GetBestBlock().IsNull() || !coinsdb.GetHeadBlocks().empty()) {
+            strError = "A chainstate snapshot can only be loaded into an empty data directory";
+            return false;
+        }
+    }
+
+    // Marks the databases as unusable until the load completed
+    if (!pblocktree->WriteFlag("chainstatesnapshotloading", true)) {
+        strError = "Unable to write to the block index database";
+        return false;
+    }
+
+    CCoinsMap mapCoins;
+    CDBBatch batchBlockTree(*pblocktree), batchZerocoin(*pzerocoinDB);
+    size_t nBatchSize = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CChainSnapshotInfo infoLoaded;
+    bool fLoaded = ReadSnapshot(path, chainparams, infoLoaded, strError,
+        [&](const COutPoint& outpoint, Coin&& coin) {
+            CCoinsCacheEntry& entry = mapCoins.emplace(outpoint, CCoinsCacheEntry(std::move(coin))).first->second;
+            entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+            if (mapCoins.size() >= SNAPSHOT_COINS_PER_BATCH && !coinsdb.BatchWrite(mapCoins, info.header.hashBlock)) {
+                strError = "Unable to write to the coins database";
+                return false;
+            }
+            return true;
+        },
+        [&](uint8_t nType, std::vector<unsigned char>& vchKey, std::vector<unsigned char>& vchValue) {
+            CDBWrapper& db = nType == SNAPSHOT_BLOCKTREE ? static_cast<CDBWrapper&>(*pblocktree) : *pzerocoinDB;
+            CDBBatch& batch = nType == SNAPSHOT_BLOCKTREE ? batchBlockTree : batchZerocoin;
+            batch.Write(RawBytes(vchKey), RawBytes(vchValue));
+            if (batch.SizeEstimate() > nBatchSize) {
+                db.WriteBatch(batch);
+                batch.Clear();
+            }
+            return true;
+        });
+    if (fLoaded && infoLoaded.hash != info.hash) {
+        strError = "Snapshot file changed while it was loaded";
+        fLoaded = false;
+    }
+    if (fLoaded) {
+        fLoaded = coinsdb.BatchWrite(mapCoins, info.header.hashBlock) && pblocktree->WriteBatch(batchBlockTree, true) &&
+            pzerocoinDB->WriteBatch(batchZerocoin, true) && pblocktree->WriteFlag("chainstatesnapshot", true) &&
+            pblocktree->WriteFlag("prunedblockfiles", true) && pblocktree->WriteFlag("chainstatesnapshotloading", false) &&
+            pblocktree->Sync();
+        if (!fLoaded)
+            strError = "Unable to write to the databases";
+    }
+    // The records were written past the key filters
+    pblocktree->KeyImageFilter().Reset();
+    pzerocoinDB->CoinSpendFilter().Reset();
+    if (!fLoaded) {
+        strError += ". The data directory must be removed before trying again";
+        return false;
+    }
+
+    LogPrintf("%s: loaded %u coins, %u block tree and %u zerocoin records\n", __func__, info.nCoins,
+        info.nBlockTreeRecords, info.nZerocoinRecords);
+    return true;
+}
+
+void ThreadCheckChainstateSnapshotHeaders()
+{
+    RenameThread("veil-snapshothdr");
+
+    const CChainParams& chainparams = Params();
+    std::vector<const CBlockIndex*> vChain;
+    {
+        LOCK(cs_main);
+        vChain.reserve(chainActive.Height() + 1);
+        for (const CBlockIndex* pindex = chainActive.Genesis(); pindex; pindex = chainActive.Next(pindex))
+            vChain.push_back(pindex);
+    }
+    LogPrintf("%s: checking %u headers of the chainstate snapshot\n", __func__, vChain.size());
+
+    // The header fields of a block index entry never change, so they are read without cs_main
+    const MapCheckpoints& mapCheckpoints = chainparams.Checkpoints().mapCheckpoints;
+    std::string strError;
+    for (const CBlockIndex* pindex : vChain) {
+        boost::this_thread::interruption_point();
+        uint256 hash = pindex->GetBlockHash();
+        if (!pindex->pprev) {
+            if (hash != chainparams.GetConsensus().hashGenesisBlock)
+                strError = "wrong genesis block";
+        } else if (pindex->GetBlockHeader().GetHash() != hash || pindex->pprev->nHeight + 1 != pindex->nHeight) {
+            strError = strprintf("block index entry of %s does not match its header", hash.ToString());
+        } else if (pindex->IsProofOfWork() && pindex->fProofOfFullNode) {
+            strError = strprintf("block %s uses both PoW and PoFN", hash.ToString());
+        } else if (pindex->IsProofOfWork() && !CheckProofOfWork(pindex->GetBlockPoWHash(), pindex->nBits, chainparams.GetConsensus())) {
+            strError = strprintf("proof of work of block %s failed", hash.ToString());
+        }
+        auto it = mapCheckpoints.find(pindex->nHeight);
+        if (strError.empty() && it != mapCheckpoints.end() && it->second != hash)
+            strError = strprintf("block %s does not match the checkpoint at height %d", hash.ToString(), pindex->nHeight);
+        if (!strError.empty())
+            break;
+    }
+
+    if (!strError.empty()) {
+        LogPrintf("%s: chainstate snapshot has a bad header chain: %s\n", __func__, strError);
+        uiInterface.ThreadSafeMessageBox(_("The chainstate snapshot this node was started from has a bad header chain. The data directory must be removed."),
+            "", CClientUIInterface::MSG_ERROR);
+        StartShutdown();
+        return;
+    }
+
+    LOCK(cs_main);
+    pblocktree->WriteFlag("chainstatesnapshotheaderschecked", true);
+    LogPrintf("%s: chainstate snapshot header chain checked\n", __func__);
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 The VEIL developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VEIL_CHAINSNAPSHOT_H
+#define VEIL_CHAINSNAPSHOT_H
+
+#include <fs.h>
+#include <protocol.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <cstring>
+#include <string>
+
+class CChainParams;
+
+static const uint32_t CHAINSTATE_SNAPSHOT_VERSION = 1;
+
+/**
+ * A chainstate snapshot holds everything a node needs to continue from a tip without the blocks before it:
+ * the UTXO set, the block index (without block and undo file positions), the RingCT output and key image index
+ * and the zerocoin mint, spend and accumulator tables. It is followed by the double SHA256 of all of its
+ * contents, which is also the hash reported by dumpchainstate.
+ */
+class CChainSnapshotHeader
+{
+public:
+    uint32_t nVersion;
+    CMessageHeader::MessageStartChars pchMessageStart;
+    //! Tip the snapshot was taken at
+    uint256 hashBlock;
+    int nHeight;
+
+    CChainSnapshotHeader() : nVersion(CHAINSTATE_SNAPSHOT_VERSION), nHeight(-1)
+    {
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nVersion);
+        READWRITE(pchMessageStart);
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+    }
+};
+
+/** What was written to or read from a snapshot file */
+struct CChainSnapshotInfo
+{
+    CChainSnapshotHeader header;
+    uint256 hash;
+    uint64_t nCoins = 0;
+    uint64_t nBlockTreeRecords = 0;
+    uint64_t nZerocoinRecords = 0;
+};
+
+/** Write a snapshot of the chainstate at the current tip to path. */
+bool DumpChainstateSnapshot(const fs::path& path, CChainSnapshotInfo& info, std::string& strError);
+
+/** Read a snapshot file and check its hash and network, without loading anything. */
+bool VerifyChainstateSnapshot(const fs::path& path, const CChainParams& chainparams, CChainSnapshotInfo& info, std::string& strError);
+
+/**
+ * Fill the empty block tree, coins and zerocoin databases from a snapshot file. The file is read completely and
+ * its hash must be hashExpected before anything is written. pblocktree and pzerocoinDB must be open and
+ * pcoinsdbview must not be.
+ */
+bool LoadChainstateSnapshot(const fs::path& path, const CChainParams& chainparams, const uint256& hashExpected, size_t nCoinDBCache,
+        CChainSnapshotInfo& info, std::string& strError);
+
+/**
+ * Check the header chain of a chainstate that was loaded from a snapshot: links, checkpoints and the x16r proof
+ * of work of every PoW header. Runs in the background after startup until it succeeded once; a snapshot that
+ * fails shuts the node down. The UTXO set and the other records are not checked, they are trusted through the
+ * snapshot hash.
+ */
+void ThreadCheckChainstateSnapshotHeaders();
+
+#endif // VEIL_CHAINSNAPSHOT_H
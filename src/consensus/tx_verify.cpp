@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <consensus/tx_verify.h>
+#include <blockperf.h>
 
 #include <consensus/consensus.h>
 #include <primitives/transaction.h>
@@ -24,6 +25,132 @@
 #include <tinyformat.h>
 #include <libzerocoin/CoinSpend.h>
 #include <veil/zerocoin/zchain.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <util.h>
+
+#include <boost/thread.hpp>
+
+namespace {
+/**
+ * Cache of proofs that verified, so that the proofs of a transaction that was accepted to the mempool are not
+ * verified again when a block containing it is connected or reconstructed from a compact block, and the proofs
+ * verified before cs_main is taken are not verified again under it.
+ */
+class CProofCache
+{
+private:
+    //! Entries are SHA256(nonce || commitment || rangeproof) or SHA256(nonce || hash of the proof)
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    //! Entries added by the pre-verification of relayed transactions, kept apart from the ones of the mempool
+    map_type setPreVerified;
+    boost::shared_mutex cs_proofcache;
+
+public:
+    CProofCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const secp256k1_pedersen_commitment& commitment, const std::vector<uint8_t>& vRangeproof)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(commitment.data, sizeof(commitment.data)).Write(vRangeproof.data(), vRangeproof.size()).Finalize(entry.begin());
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hashProof)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hashProof.begin(), 32).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry, const ProofCacheMode mode)
+    {
+        const bool erase = mode == ProofCacheMode::BLOCK;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_proofcache);
+            if (setValid.contains(entry, erase))
+                return true;
+            if (!setPreVerified.contains(entry, mode != ProofCacheMode::PREVERIFY))
+                return false;
+        }
+        // The proof of a transaction entering the mempool moves out of reach of the pre-verification
+        if (mode == ProofCacheMode::MEMPOOL)
+            Set(entry, mode);
+        return true;
+    }
+
+    void Set(const uint256& entry, const ProofCacheMode mode)
+    {
+        if (mode == ProofCacheMode::BLOCK)
+            return;
+        boost::unique_lock<boost::shared_mutex> lock(cs_proofcache);
+        if (mode == ProofCacheMode::PREVERIFY)
+            setPreVerified.insert(entry);
+        else
+            setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n, size_t nPreVerified)
+    {
+        setPreVerified.setup_bytes(nPreVerified);
+        return setValid.setup_bytes(n);
+    }
+};
+
+static CProofCache rangeproofCache;
+static CProofCache proofCache;
+} // namespace
+
+void InitRangeproofCache()
+{
+    const size_t nPreVerifyCacheSize = PREVERIFY_PROOF_CACHE_SIZE * ((size_t) 1 << 20);
+    size_t nMaxCacheSize = RANGEPROOF_CACHE_SIZE * ((size_t) 1 << 20);
+    size_t nElems = rangeproofCache.setup_bytes(nMaxCacheSize, nPreVerifyCacheSize);
+    LogPrintf("Using %zu MiB for rangeproof cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nElems);
+
+    nMaxCacheSize = PROOF_CACHE_SIZE * ((size_t) 1 << 20);
+    nElems = proofCache.setup_bytes(nMaxCacheSize, nPreVerifyCacheSize);
+    LogPrintf("Using %zu MiB for MLSAG and zerocoin spend cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nElems);
+    LogPrintf("Using %u MiB for each of the rangeproof and the MLSAG and zerocoin spend pre-verification caches\n",
+            PREVERIFY_PROOF_CACHE_SIZE);
+}
+
+bool GetCachedProof(const uint256& hashProof, ProofCacheMode mode)
+{
+    uint256 entry;
+    proofCache.ComputeEntry(entry, hashProof);
+    return proofCache.Get(entry, mode);
+}
+
+void AddCachedProof(const uint256& hashProof, ProofCacheMode mode)
+{
+    uint256 entry;
+    proofCache.ComputeEntry(entry, hashProof);
+    proofCache.Set(entry, mode);
+}
+
+/** Verify a rangeproof, looking it up in and adding it to the rangeproof cache as cacheMode tells. */
+static bool VerifyRangeproof(const secp256k1_pedersen_commitment& commitment, const std::vector<uint8_t>& vRangeproof, ProofCacheMode cacheMode)
+{
+    uint256 entry;
+    rangeproofCache.ComputeEntry(entry, commitment, vRangeproof);
+    if (rangeproofCache.Get(entry, cacheMode))
+        return true;
+
+    CBlockPerfSpan perfSpan(BlockPerfPhase::RANGEPROOF);
+    uint64_t min_value, max_value;
+    int rv = secp256k1_rangeproof_verify(secp256k1_ctx_blind, &min_value, &max_value, &commitment, vRangeproof.data(),
+            vRangeproof.size(), nullptr, 0, secp256k1_generator_h);
+    if (rv != 1)
+        return false;
+
+    rangeproofCache.Set(entry, cacheMode);
+    return true;
+}
 
 bool IsFinalTx(const CTransaction &tx, int nBlockHeight, int64_t nBlockTime)
 {
@@ -269,7 +396,7 @@ bool CheckStandardOutput(CValidationState &state, const Consensus::Params& conse
     return CheckValue(state, p->nValue, nValueOut);
 }
 
-bool CheckBlindOutput(CValidationState &state, const CTxOutCT *p)
+bool CheckBlindOutput(CValidationState &state, const CTxOutCT *p, ProofCacheMode cacheMode)
 {
     if (p->vData.size() < 33 || p->vData.size() > 33 + 5)
         return state.DoS(100, false, REJECT_INVALID, "bad-ctout-ephem-size");
@@ -282,17 +409,13 @@ bool CheckBlindOutput(CValidationState &state, const CTxOutCT *p)
     if (/*todo: fBusyImporting && */ fSkipRangeproof)
         return true;
 
-    uint64_t min_value, max_value;
-    int rv = secp256k1_rangeproof_verify(secp256k1_ctx_blind, &min_value, &max_value, &p->commitment, p->vRangeproof.data(),
-            p->vRangeproof.size(), nullptr, 0, secp256k1_generator_h);
-
-    if (rv != 1)
+    if (!VerifyRangeproof(p->commitment, p->vRangeproof, cacheMode))
         return state.DoS(100, false, REJECT_INVALID, "bad-ctout-rangeproof-verify");
 
     return true;
 }
 
-bool CheckAnonOutput(CValidationState &state, const CTxOutRingCT *p)
+bool CheckAnonOutput(CValidationState &state, const CTxOutRingCT *p, ProofCacheMode cacheMode)
 {
     if (p->vData.size() < 33 || p->vData.size() > 33 + 5)
         return state.DoS(100, false, REJECT_INVALID, "bad-rctout-ephem-size");
@@ -304,11 +427,7 @@ bool CheckAnonOutput(CValidationState &state, const CTxOutRingCT *p)
     if (/* todo: fBusyImporting && */ fSkipRangeproof)
         return true;
 
-    uint64_t min_value, max_value;
-    int rv = secp256k1_rangeproof_verify(secp256k1_ctx_blind, &min_value, &max_value, &p->commitment, p->vRangeproof.data(),
-            p->vRangeproof.size(), nullptr, 0, secp256k1_generator_h);
-
-    if (rv != 1)
+    if (!VerifyRangeproof(p->commitment, p->vRangeproof, cacheMode))
         return state.DoS(100, false, REJECT_INVALID, "bad-rctout-rangeproof-verify");
 
     return true;
@@ -326,7 +445,7 @@ bool CheckDataOutput(CValidationState &state, const CTxOutData *p)
     return true;
 }
 
-bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fCheckDuplicateInputs)
+bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fCheckDuplicateInputs, ProofCacheMode cacheMode)
 {
     // Basic checks that don't depend on any context
     if (tx.vin.empty())
@@ -367,12 +486,12 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fChe
                 break;
             }
             case OUTPUT_CT:
-                if (!CheckBlindOutput(state, (CTxOutCT*) txout.get()))
+                if (!CheckBlindOutput(state, (CTxOutCT*) txout.get(), cacheMode))
                     return false;
                 nCTOut++;
                 break;
             case OUTPUT_RINGCT:
-                if (!CheckAnonOutput(state, (CTxOutRingCT*) txout.get()))
+                if (!CheckAnonOutput(state, (CTxOutRingCT*) txout.get(), cacheMode))
                     return false;
                 nRingCTOut++;
                 break;
@@ -15,15 +15,47 @@ class CBlockIndex;
 class CCoinsViewCache;
 class CTransaction;
 class CTxOut;
+class uint256;
 class CValidationState;
 
+//! Size of the rangeproof verification cache in MiB
+static const unsigned int RANGEPROOF_CACHE_SIZE = 8;
+//! Size of the MLSAG and zerocoin spend verification cache in MiB
+static const unsigned int PROOF_CACHE_SIZE = 8;
+//! Size of each of the caches of rangeproofs and of MLSAG and zerocoin spends verified by the pre-verification in MiB
+static const unsigned int PREVERIFY_PROOF_CACHE_SIZE = 2;
+
+/** How a verification of rangeproofs, MLSAG signatures or zerocoin spends uses the proof caches */
+enum class ProofCacheMode {
+    //! Evict hits and add nothing, for proofs that are not expected to be checked again (connecting a block)
+    BLOCK,
+    //! Add what verified, and move hits of the pre-verification into the main caches (mempool acceptance)
+    MEMPOOL,
+    //! Add what verified to the pre-verification caches only, so that the proofs of any relayed transaction cannot
+    //! evict the ones of the mempool
+    PREVERIFY,
+};
+
 /** Transaction validation functions */
 
-/** Context-independent validity checks */
-bool CheckTransaction(const CTransaction& tx, CValidationState& state, bool fCheckDuplicateInputs=true);
+/**
+ * Context-independent validity checks. Rangeproofs found in the rangeproof cache are not verified again;
+ * cacheMode tells whether hits are evicted or where the ones that were verified are added.
+ */
+bool CheckTransaction(const CTransaction& tx, CValidationState& state, bool fCheckDuplicateInputs=true, ProofCacheMode cacheMode=ProofCacheMode::BLOCK);
 bool CheckZerocoinMint(const CTxOut& txout, CBigNum& bnValue, CValidationState& state);
 bool CheckZerocoinSpend(const CTransaction& tx, CValidationState& state);
 
+/** To be called once at startup to size the rangeproof cache, the MLSAG and zerocoin spend cache and their pre-verification caches */
+void InitRangeproofCache();
+
+/**
+ * Look up an MLSAG signature or zerocoin spend that verified, by a hash of everything it was verified against.
+ * See ProofCacheMode for what a lookup and an addition in each mode do.
+ */
+bool GetCachedProof(const uint256& hashProof, ProofCacheMode mode);
+void AddCachedProof(const uint256& hashProof, ProofCacheMode mode);
+
 namespace Consensus {
 /**
  * Check whether all inputs of this transaction are valid (no double spends and amounts)
@@ -238,6 +238,25 @@ bool CDBIterator::Valid() const { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::Next() { piter->Next(); }
 
+void CDBIterator::AppendKey(CDataStream& s, size_t nSkip) const
+{
+    leveldb::Slice slKey = piter->key();
+    if (slKey.size() > nSkip)
+        s.write(slKey.data() + nSkip, slKey.size() - nSkip);
+}
+
+void CDBIterator::AppendValue(CDataStream& s) const
+{
+    leveldb::Slice slValue = piter->value();
+    size_t nStart = s.size();
+    s.write(slValue.data(), slValue.size());
+    const std::vector<unsigned char>& obfuscate_key = dbwrapper_private::GetObfuscateKey(parent);
+    if (obfuscate_key.empty())
+        return;
+    for (size_t i = 0; i < slValue.size(); i++)
+        s[nStart + i] ^= obfuscate_key[i % obfuscate_key.size()];
+}
+
 namespace dbwrapper_private {
 
 void HandleError(const leveldb::Status& status)
@@ -114,6 +114,34 @@ public:
     size_t SizeEstimate() const { return size_estimate; }
 };
 
+/** Key or value bytes of a database record as they are, without a length prefix */
+template <typename Bytes>
+class RawBytesRef
+{
+private:
+    Bytes& vch;
+
+public:
+    explicit RawBytesRef(Bytes& vchIn) : vch(vchIn) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        if (!vch.empty())
+            s.write((const char*)vch.data(), vch.size());
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        vch.resize(s.size());
+        if (!vch.empty())
+            s.read((char*)vch.data(), vch.size());
+    }
+};
+
+typedef RawBytesRef<std::vector<unsigned char>> RawBytes;
+
 class CDBIterator
 {
 private:
@@ -171,6 +199,12 @@ public:
         return piter->value().size();
     }
 
+    //! Append the key as stored to s, without its first nSkip bytes
+    void AppendKey(CDataStream& s, size_t nSkip = 0) const;
+
+    //! Append the value as stored to s, without deserializing it
+    void AppendValue(CDataStream& s) const;
+
 };
 
 class CDBWrapper
@@ -9,6 +9,7 @@
 #include <key_io.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <random.h>
 #include <sync.h>
 #include <util.h>
@@ -144,6 +145,16 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
+/** A streamed reply that fails halfway can not carry the error anymore; cut it short so the client sees it is incomplete */
+static bool StreamErrorReply(HTTPRequest* req, const UniValue& objError)
+{
+    if (!req->IsReplyStarted())
+        return false;
+    LogPrintf("ThreadRPCServer streamed reply aborted: %s\n", find_value(objError, "message").getValStr());
+    req->WriteReplyEnd();
+    return true;
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -174,6 +185,9 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
+    // Reply of a single request whose method streams its result, see JSONRPCRequest::StartResultStream
+    std::unique_ptr<CJSONStreamWriter> stream;
+
     try {
         // Parse request
         UniValue valRequest;
@@ -187,9 +201,35 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
+            jreq.startResultStream = [req, &stream]() {
+                if (!stream) {
+                    req->WriteHeader("Content-Type", "application/json");
+                    req->WriteReplyStart(HTTP_OK);
+                    stream.reset(new CJSONStreamWriter([req](const std::string& strChunk) {
+                        if (!req->WriteReplyChunk(strChunk))
+                            throw std::runtime_error("Client disconnected");
+                    }));
+                    stream->BeginObject();
+                    stream->Key("result");
+                }
+                return stream.get();
+            };
 
             UniValue result = tableRPC.execute(jreq);
 
+            if (stream) {
+                // Same members as JSONRPCReplyObj, around the result that was already written
+                stream->Key("error");
+                stream->Value(NullUniValue);
+                stream->Key("id");
+                stream->Value(jreq.id);
+                stream->EndObject();
+                stream->Flush();
+                req->WriteReplyChunk("\n");
+                req->WriteReplyEnd();
+                return true;
+            }
+
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
@@ -202,10 +242,12 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        if (!StreamErrorReply(req, objError))
+            JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        if (!StreamErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what())))
+            JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
     return true;
@@ -21,7 +21,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <future>
+#include <mutex>
 
 #include <event2/thread.h>
 #include <event2/buffer.h>
@@ -41,6 +45,12 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Bytes of a chunked reply that may be on their way to the client before WriteReplyChunk waits for it to read them */
+static const size_t MAX_REPLY_CHUNKS_PENDING = 1024 * 1024;
+
+/** Set when the server is interrupted, so that chunked replies stop waiting for their clients */
+static std::atomic<bool> fReplyStreamsInterrupted(false);
+
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
 {
@@ -450,6 +460,7 @@ void InterruptHTTPServer()
     }
     if (workQueue)
         workQueue->Interrupt();
+    fReplyStreamsInterrupted = true;
 }
 
 void StopHTTPServer()
@@ -523,12 +534,17 @@ void HTTPEvent::trigger(struct timeval* tv)
         evtimer_add(ev, tv); // trigger after timeval passed
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       replyStarted(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (replyStarted && !replySent) {
+        // A started chunked reply can only be cut short, not replaced
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        WriteReplyEnd();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -574,6 +590,22 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+/** Re-enable reading from the socket of a request whose reply was sent. This is
+ * the second part of the libevent workaround in http_request_cb.
+ */
+static void ReenableRequestRead(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -581,7 +613,7 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  */
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
-    assert(!replySent && req);
+    assert(!replySent && !replyStarted && req);
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
@@ -589,17 +621,113 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
+        ReenableRequestRead(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+/** Progress of a chunked reply, shared by the worker that writes it and the http thread that sends it */
+struct HTTPReplyStream
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    //! Bytes given to WriteReplyChunk, and the part of them known to be written to the socket
+    size_t nQueued = 0;
+    size_t nSent = 0;
+    //! The connection was closed, libevent only frees the request once the reply is ended
+    bool fClosed = false;
+    //! Bytes handed to the connection so far. Only used by the http thread.
+    size_t nHandedOff = 0;
+};
+
+/** Called by libevent once the connection has written everything it was handed */
+static void http_reply_chunk_sent_cb(struct evhttp_connection* conn, void* arg)
+{
+    HTTPReplyStream* stream = static_cast<HTTPReplyStream*>(arg);
+    std::lock_guard<std::mutex> lock(stream->cs);
+    stream->nSent = stream->nHandedOff;
+    stream->cond.notify_all();
+}
+
+static void http_reply_close_cb(struct evhttp_connection* conn, void* arg)
+{
+    HTTPReplyStream* stream = static_cast<HTTPReplyStream*>(arg);
+    std::lock_guard<std::mutex> lock(stream->cs);
+    stream->fClosed = true;
+    stream->cond.notify_all();
+}
+
+/* The parts of a chunked reply are sent by separate events. Active events of the
+ * same priority run in the order they were triggered, so the chunks go out in order.
+ * The events hold on to the shared stream state, which libevent's callbacks point to
+ * until WriteReplyEnd replaces them.
+ */
+void HTTPRequest::WriteReplyStart(int nStatus)
+{
+    assert(!replySent && !replyStarted && req);
+    replyStream = std::make_shared<HTTPReplyStream>();
+    auto req_copy = req;
+    auto stream = replyStream;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus, stream]{
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn)
+            evhttp_connection_set_closecb(conn, http_reply_close_cb, stream.get());
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+    replyStarted = true;
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(replyStarted && !replySent && req);
+    if (strChunk.empty())
+        return true; // an empty chunk would end the reply
+
+    // Wait for a slow client rather than buffering the whole reply in memory
+    size_t nQueued;
+    {
+        std::unique_lock<std::mutex> lock(replyStream->cs);
+        while (!replyStream->fClosed && !fReplyStreamsInterrupted &&
+               replyStream->nQueued - replyStream->nSent > MAX_REPLY_CHUNKS_PENDING) {
+            replyStream->cond.wait_for(lock, std::chrono::milliseconds(100));
         }
+        if (replyStream->fClosed || fReplyStreamsInterrupted)
+            return false;
+        replyStream->nQueued += strChunk.size();
+        nQueued = replyStream->nQueued;
+    }
+
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    auto req_copy = req;
+    auto stream = replyStream;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, stream, nQueued]{
+        // The sent callback of a chunk replaces the one of the chunk before, it is only
+        // called once the connection's output is empty, so it stands for all of them
+        stream->nHandedOff = nQueued;
+        evhttp_send_reply_chunk_with_cb(req_copy, evb, http_reply_chunk_sent_cb, stream.get());
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::WriteReplyEnd()
+{
+    assert(replyStarted && !replySent && req);
+    auto req_copy = req;
+    auto stream = replyStream;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, stream]{
+        // The connection may serve further requests, it must not call back into this reply anymore
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn)
+            evhttp_connection_set_closecb(conn, nullptr, nullptr);
+        evhttp_send_reply_end(req_copy);
+        ReenableRequestRead(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
@@ -8,6 +8,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -17,6 +18,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPReplyStream;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -59,6 +61,8 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool replyStarted;
+    std::shared_ptr<HTTPReplyStream> replyStream;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req);
@@ -114,6 +118,33 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, for bodies that are produced piecewise.
+     * nStatus is the HTTP status code to send. The body is sent with
+     * WriteReplyChunk and the reply is completed by WriteReplyEnd.
+     *
+     * @note Use instead of WriteReply, and call WriteHeader before this.
+     */
+    void WriteReplyStart(int nStatus);
+
+    /**
+     * Send a part of the body of a reply started with WriteReplyStart. Waits while
+     * the client has not read a good part of the earlier chunks yet.
+     * Returns false if the client is gone or the server is shutting down, the
+     * reply can then only be completed with WriteReplyEnd.
+     */
+    bool WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Complete a reply started with WriteReplyStart.
+     *
+     * @note Like WriteReply this gives the request back to the main thread.
+     */
+    void WriteReplyEnd();
+
+    /** Whether WriteReplyStart was called and the reply is not complete yet. */
+    bool IsReplyStarted() const { return replyStarted && !replySent; }
 };
 
 /** Event handler closure.
@@ -16,8 +16,10 @@
 #include <veil/ringct/blind.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <chainsnapshot.h>
 #include <checkpoints.h>
 #include <compat/sanity.h>
+#include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <fs.h>
 #include <httpserver.h>
@@ -122,6 +124,7 @@ void DummyWalletInit::AddWalletOptions() const
 #endif
 
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
+static const char* DEFAULT_ZEROCOIN_PARAMS_FILENAME="zerocoinparams.dat";
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -280,6 +283,14 @@ void Shutdown()
         if (pcoinsTip != nullptr) {
             FlushStateToDisk();
         }
+        // Keep the key filters for the next startup instead of scanning the tables again
+        if (pcoinsdbview) {
+            const uint256 hashBestBlock = pcoinsdbview->GetBestBlock();
+            if (pblocktree)
+                pblocktree->KeyImageFilter().Write(hashBestBlock);
+            if (pzerocoinDB)
+                pzerocoinDB->CoinSpendFilter().Write(hashBestBlock);
+        }
         pcoinsTip.reset();
         pcoinscatcher.reset();
         pcoinsdbview.reset();
@@ -393,6 +404,8 @@ void SetupServerArgs()
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-loadchainstate=<file>", "Fill an empty data directory on startup from a chainstate snapshot written by dumpchainstate. Requires -loadchainstatehash. The snapshot is trusted through its hash: only its header chain is checked, in the background, and its UTXO set is not. Blocks before the snapshot are not available, like on a pruned node", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-loadchainstatehash=<hex>", "The hash dumpchainstate reported for the snapshot of -loadchainstate. A snapshot with another hash is refused", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxreorg=<n>", strprintf("Specify the maximum reorganization depth (default: %u)", DEFAULT_MAX_REORG_DEPTH), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), false, OptionsCategory::OPTIONS);
@@ -400,6 +413,8 @@ void SetupServerArgs()
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-txverifythreads=<n>", strprintf("Set the number of threads that check relayed transactions ahead of the message handler (0 to %d, default: %d)",
+        MAX_TXVERIFY_THREADS, DEFAULT_TXVERIFY_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), false, OptionsCategory::OPTIONS);
@@ -418,6 +433,7 @@ void SetupServerArgs()
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-zerocoinparams=<file>", strprintf("Specify the precomputed zerocoin parameter file, created on first startup. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", DEFAULT_ZEROCOIN_PARAMS_FILENAME), false, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addnode=<ip>", "Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info). This option can be specified multiple times to add multiple nodes.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-banscore=<n>", strprintf("Threshold for disconnecting misbehaving peers (default: %u)", DEFAULT_BANSCORE_THRESHOLD), false, OptionsCategory::CONNECTION);
@@ -437,6 +453,7 @@ void SetupServerArgs()
     gArgs.AddArg("-maxreceivebuffer=<n>", strprintf("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXRECEIVEBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-maxvalidationwaste=<n>", strprintf("Delay the transactions of a peer once the ones we did not accept recently took more than <n> milliseconds of validation beyond its accepted ones (0 = no limit, default: %d)", DEFAULT_MAX_VALIDATION_WASTE), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
@@ -469,11 +486,21 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubanonoutputs=<address>", "Enable publish RingCT outputs of connected blocks in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubkeyimages=<address>", "Enable publish key images spent by connected blocks in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubzerocoinmints=<address>", "Enable publish zerocoin mints of connected blocks in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubzerocoinspends=<address>", "Enable publish zerocoin spends of connected blocks in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubaccumulators=<address>", "Enable publish accumulator checkpoints of connected blocks in <address>", false, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
+    hidden_args.emplace_back("-zmqpubanonoutputs=<address>");
+    hidden_args.emplace_back("-zmqpubkeyimages=<address>");
+    hidden_args.emplace_back("-zmqpubzerocoinmints=<address>");
+    hidden_args.emplace_back("-zmqpubzerocoinspends=<address>");
+    hidden_args.emplace_back("-zmqpubaccumulators=<address>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), true, OptionsCategory::DEBUG_TEST);
@@ -497,6 +524,7 @@ void SetupServerArgs()
     gArgs.AddArg("-help-debug", "Show all debugging options (usage: --help -help-debug)", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-lockstats", strprintf("Record how long each LOCK waits for and holds its mutex, see getperfstats (default: %u)", DEFAULT_LOCK_STATS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE), true, OptionsCategory::DEBUG_TEST);
@@ -865,6 +893,7 @@ void InitLogging()
     g_logger->m_print_to_console = gArgs.GetBoolArg("-printtoconsole", false);
     g_logger->m_log_timestamps = gArgs.GetBoolArg("-logtimestamps", DEFAULT_LOGTIMESTAMPS);
     g_logger->m_log_time_micros = gArgs.GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
+    g_lock_stats = gArgs.GetBoolArg("-lockstats", DEFAULT_LOCK_STATS);
 
     fLogIPs = gArgs.GetBoolArg("-logips", DEFAULT_LOGIPS);
 
@@ -966,6 +995,17 @@ bool AppInitParameterInteraction()
             return InitError(_("Prune mode is incompatible with -txindex."));
     }
 
+    // a chainstate snapshot has no blocks to build an index or the chainstate from
+    if (gArgs.IsArgSet("-loadchainstate")) {
+        if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
+            return InitError(_("-loadchainstate is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-reindex", false) || gArgs.GetBoolArg("-reindex-chainstate", false))
+            return InitError(_("-loadchainstate is incompatible with -reindex and -reindex-chainstate."));
+        const std::string strSnapshotHash = gArgs.GetArg("-loadchainstatehash", "");
+        if (strSnapshotHash.size() != 64 || !IsHex(strSnapshotHash))
+            return InitError(_("-loadchainstate requires the hash of the snapshot in -loadchainstatehash."));
+    }
+
     // -bind and -whitebind can't be set when not listening
     size_t nUserBind = gArgs.GetArgs("-bind").size() + gArgs.GetArgs("-whitebind").size();
     if (nUserBind != 0 && !gArgs.GetBoolArg("-listen", DEFAULT_LISTEN)) {
@@ -1081,6 +1121,9 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    nTxVerifyThreads = std::max(0, std::min((int)gArgs.GetArg("-txverifythreads", DEFAULT_TXVERIFY_THREADS), MAX_TXVERIFY_THREADS));
+    nMaxValidationWasteMicros = std::max((int64_t)0, gArgs.GetArg("-maxvalidationwaste", DEFAULT_MAX_VALIDATION_WASTE)) * 1000;
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1290,8 +1333,11 @@ bool AppInitMain()
             gArgs.GetArg("-datadir", ""), fs::current_path().string());
     }
 
+    LoadZerocoinParams(AbsPathForConfigVal(gArgs.GetArg("-zerocoinparams", DEFAULT_ZEROCOIN_PARAMS_FILENAME)).string());
+
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitRangeproofCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
@@ -1299,6 +1345,10 @@ bool AppInitMain()
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    LogPrintf("Using %u threads for transaction verification\n", nTxVerifyThreads);
+    for (int i = 0; i < nTxVerifyThreads; i++)
+        threadGroup.create_thread(&ThreadTxPreVerify);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1511,6 +1561,7 @@ bool AppInitMain()
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
+    std::string strSnapshotFile = gArgs.GetArg("-loadchainstate", "");
     bool fLoaded = false;
     while (!fLoaded && !ShutdownRequested()) {
         bool fReset = fReindex;
@@ -1536,6 +1587,26 @@ bool AppInitMain()
                 pzerocoinDB.reset();
                 pzerocoinDB.reset(new CZerocoinDB(0, false, fReindex));
 
+                bool fSnapshotLoading = false;
+                pblocktree->ReadFlag("chainstatesnapshotloading", fSnapshotLoading);
+                if (fSnapshotLoading) {
+                    return InitError(_("Loading a chainstate snapshot was interrupted. The data directory must be removed."));
+                }
+                bool fSnapshotLoaded = false;
+                pblocktree->ReadFlag("chainstatesnapshot", fSnapshotLoaded);
+                if (!strSnapshotFile.empty() && fSnapshotLoaded) {
+                    LogPrintf("Chainstate snapshot was already loaded, ignoring -loadchainstate\n");
+                } else if (!strSnapshotFile.empty()) {
+                    uiInterface.InitMessage(_("Loading chainstate snapshot..."));
+                    CChainSnapshotInfo info;
+                    std::string strError;
+                    const uint256 hashSnapshot = uint256S(gArgs.GetArg("-loadchainstatehash", ""));
+                    if (!LoadChainstateSnapshot(fs::absolute(strSnapshotFile, GetDataDir()), chainparams, hashSnapshot, nCoinDBCache, info, strError)) {
+                        return InitError(strprintf(_("Unable to load chainstate snapshot: %s"), strError));
+                    }
+                    strSnapshotFile.clear();
+                }
+
                 if (fReset) {
                     pblocktree->WriteReindexing(true);
                     //If we're reindexing in prune mode, wipe away unusable block files and all undo data files
@@ -1562,7 +1633,7 @@ bool AppInitMain()
 
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
-                if (fHavePruned && !fPruneMode) {
+                if (fHavePruned && !fPruneMode && !fHaveSnapshotChainstate) {
                     strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  This will redownload the entire blockchain");
                     break;
                 }
@@ -1582,6 +1653,10 @@ bool AppInitMain()
                 pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState));
                 pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsdbview.get()));
 
+                // Take over the key filters kept on the last clean shutdown if the chainstate is still where it was
+                pblocktree->KeyImageFilter().Load(pcoinsdbview->GetBestBlock());
+                pzerocoinDB->CoinSpendFilter().Load(pcoinsdbview->GetBestBlock());
+
                 // If necessary, upgrade from older database format.
                 // This is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
                 if (!pcoinsdbview->Upgrade()) {
@@ -1699,6 +1774,10 @@ bool AppInitMain()
 
     // if pruning, unset the service bit and perform the initial blockstore prune
     // after any wallet rescanning has taken place.
+    if (fHaveSnapshotChainstate) {
+        LogPrintf("Unsetting NODE_NETWORK, blocks before the chainstate snapshot are not available\n");
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+    }
     if (fPruneMode) {
         LogPrintf("Unsetting NODE_NETWORK on prune mode\n");
         nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
@@ -1746,6 +1825,13 @@ bool AppInitMain()
 
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    if (fHaveSnapshotChainstate) {
+        bool fSnapshotHeadersChecked = false;
+        pblocktree->ReadFlag("chainstatesnapshotheaderschecked", fSnapshotHeadersChecked);
+        if (!fSnapshotHeadersChecked)
+            threadGroup.create_thread(&ThreadCheckChainstateSnapshotHeaders);
+    }
+
     // Wait for genesis block to be processed
     {
         WaitableLock lock(cs_GenesisWait);
@@ -77,9 +77,7 @@ WalletTx MakeWalletTx(CWallet& wallet, const CWalletTx& wtx)
     auto txid = wtx.tx->GetHash();
     if (wtx.tx->HasBlindedValues()) {
         auto panonwallet = wallet.GetAnonWallet();
-        if (panonwallet->mapRecords.count(txid)) {
-            result.rtx = panonwallet->mapRecords.at(txid);
-        }
+        panonwallet->GetRecord(txid, result.rtx);
     }
 
     result.txin_is_mine.reserve(wtx.tx->vin.size());
@@ -609,7 +607,7 @@ public:
         if (result.have_watch_only) {
             result.watch_only_balance = walletBalances.nVeilWatchOnly;
             result.unconfirmed_watch_only_balance = walletBalances.nVeilWatchOnlyUnconf;
-            result.immature_watch_only_balance = m_wallet.GetImmatureWatchOnlyBalance();
+            result.immature_watch_only_balance = walletBalances.nVeilWatchOnlyImmature;
         }
 
         result.total_balance = result.basecoin_balance + result.ct_balance + result.ring_ct_balance + result.zerocoin_balance;
@@ -627,10 +625,6 @@ public:
     {
         TRY_LOCK(cs_main, locked_chain);
         if (!locked_chain) return false;
-        TRY_LOCK(m_wallet.cs_wallet, locked_wallet);
-        if (!locked_wallet) {
-            return false;
-        }
         balances = getBalances();
         num_blocks = ::chainActive.Height();
         return true;
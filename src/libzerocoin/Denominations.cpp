@@ -40,6 +40,20 @@ int64_t ZerocoinDenominationToInt(const CoinDenomination& denomination)
     return Value;
 }
 
+// position of the denomination in zerocoinDenomList, -1 if it is not a valid denomination
+int ZerocoinDenominationToIndex(const CoinDenomination& denomination)
+{
+    switch (denomination) {
+    case CoinDenomination::ZQ_TEN: return 0;
+    case CoinDenomination::ZQ_ONE_HUNDRED: return 1;
+    case CoinDenomination::ZQ_ONE_THOUSAND: return 2;
+    case CoinDenomination::ZQ_TEN_THOUSAND: return 3;
+    default:
+        // Error Case
+        return -1;
+    }
+}
+
 CoinDenomination AmountToZerocoinDenomination(CAmount amount)
 {
     // Check to make sure amount is an exact integer number of COINS
@@ -0,0 +1,89 @@
+/**
+* @file       FixedBaseExp.cpp
+*
+* @brief      Fixed-base windowed exponentiation for the Zerocoin group generators.
+*
+* @copyright  Copyright 2019 The Veil Developers
+* @license    This project is released under the MIT license.
+**/
+
+#include "FixedBaseExp.h"
+
+#include <cstring>
+
+namespace libzerocoin {
+
+FixedBaseExp::FixedBaseExp(const CBigNum& base, const CBigNum& modulusIn, const CBigNum& orderIn,
+        unsigned int nWindowBitsIn) : modulus(modulusIn), order(orderIn), nWindowBits(nWindowBitsIn)
+{
+    if (modulus <= CBigNum(1) || order <= CBigNum(0))
+        throw std::runtime_error("FixedBaseExp: modulus and order must be positive");
+    if (nWindowBits == 0 || nWindowBits > 16)
+        throw std::runtime_error("FixedBaseExp: window size out of range");
+
+    nWindows = (order.bitSize() + nWindowBits - 1) / nWindowBits;
+    nEntries = 1u << nWindowBits;
+
+    // Window i holds windowBase^d with windowBase = base^(2^(nWindowBits * i)). The last entry times windowBase
+    // is the base of the next window.
+    CBigNum windowBase = base % modulus;
+#if defined(USE_NUM_GMP)
+    nLimbs = mpz_size(modulus.bn);
+    vTable.assign((size_t)nWindows * nEntries * nLimbs, 0);
+    for (unsigned int i = 0; i < nWindows; i++) {
+        CBigNum entry(1);
+        for (unsigned int d = 0; d < nEntries; d++) {
+            mp_limb_t* pentry = &vTable[((size_t)i * nEntries + d) * nLimbs];
+            memcpy(pentry, mpz_limbs_read(entry.bn), mpz_size(entry.bn) * sizeof(mp_limb_t));
+            entry = entry.mul_mod(windowBase, modulus);
+        }
+        windowBase = entry;
+    }
+#else
+    vTable.reserve((size_t)nWindows * nEntries);
+    for (unsigned int i = 0; i < nWindows; i++) {
+        CBigNum entry(1);
+        for (unsigned int d = 0; d < nEntries; d++) {
+            vTable.emplace_back(entry);
+            entry = entry.mul_mod(windowBase, modulus);
+        }
+        windowBase = entry;
+    }
+#endif
+}
+
+CBigNum FixedBaseExp::pow_mod(const CBigNum& e) const
+{
+    // base^order = 1, so exponents outside of the table can be reduced
+    CBigNum exp = e;
+    if (exp < CBigNum(0) || (unsigned int)exp.bitSize() > nWindows * nWindowBits)
+        exp = exp % order;
+
+    CBigNum ret(1);
+#if defined(USE_NUM_GMP)
+    CBigNum entry;
+    CBigNum product;
+    for (unsigned int i = 0; i < nWindows; i++) {
+        mp_size_t nDigit = 0;
+        for (unsigned int j = 0; j < nWindowBits; j++)
+            nDigit |= (mp_size_t)mpz_tstbit(exp.bn, i * nWindowBits + j) << j;
+
+        mp_limb_t* pentry = mpz_limbs_write(entry.bn, nLimbs);
+        mpn_sec_tabselect(pentry, &vTable[(size_t)i * nEntries * nLimbs], nLimbs, nEntries, nDigit);
+        mpz_limbs_finish(entry.bn, nLimbs);
+
+        mpz_mul(product.bn, ret.bn, entry.bn);
+        mpz_tdiv_r(ret.bn, product.bn, modulus.bn);
+    }
+#else
+    for (unsigned int i = 0; i < nWindows; i++) {
+        unsigned int nDigit = 0;
+        for (unsigned int j = 0; j < nWindowBits; j++)
+            nDigit |= (unsigned int)BN_is_bit_set(exp.bn, i * nWindowBits + j) << j;
+        ret = ret.mul_mod(vTable[(size_t)i * nEntries + nDigit], modulus);
+    }
+#endif
+    return ret;
+}
+
+} /* namespace libzerocoin */
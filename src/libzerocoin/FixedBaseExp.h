@@ -0,0 +1,55 @@
+/**
+* @file       FixedBaseExp.h
+*
+* @brief      Fixed-base windowed exponentiation for the Zerocoin group generators.
+*
+* @copyright  Copyright 2019 The Veil Developers
+* @license    This project is released under the MIT license.
+**/
+
+#ifndef VEIL_LIBZEROCOIN_FIXEDBASEEXP_H
+#define VEIL_LIBZEROCOIN_FIXEDBASEEXP_H
+
+#include "bignum.h"
+#include "ZerocoinDefines.h"
+
+#include <vector>
+
+namespace libzerocoin {
+
+/**
+ * Exponentiation of a fixed base using a table of precomputed powers. The exponent is split into windows of
+ * nWindowBits bits and the table holds base^(d * 2^(nWindowBits * i)) for every window i and digit d, so that
+ * base^e costs one modular multiplication per window and no squarings.
+ *
+ * The base must have order "order" in the group, which allows exponents that are negative or longer than the
+ * table to be reduced mod order first. The result is always identical to base.pow_mod(e, modulus).
+ *
+ * With the gmp backend every window does the same work and table entries are selected with mpn_sec_tabselect(),
+ * so like mpz_powm_sec() the timing does not depend on the exponent.
+ */
+class FixedBaseExp
+{
+public:
+    FixedBaseExp(const CBigNum& base, const CBigNum& modulus, const CBigNum& order,
+            unsigned int nWindowBits = ZEROCOIN_FIXEDBASE_WINDOW);
+
+    CBigNum pow_mod(const CBigNum& e) const;
+
+private:
+    CBigNum modulus;
+    CBigNum order;
+    unsigned int nWindowBits;
+    unsigned int nWindows;
+    unsigned int nEntries;
+#if defined(USE_NUM_GMP)
+    size_t nLimbs;
+    std::vector<mp_limb_t> vTable;
+#else
+    std::vector<CBigNum> vTable;
+#endif
+};
+
+} /* namespace libzerocoin */
+
+#endif //VEIL_LIBZEROCOIN_FIXEDBASEEXP_H
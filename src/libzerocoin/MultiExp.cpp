@@ -0,0 +1,190 @@
+/**
+* @file       MultiExp.cpp
+*
+* @brief      Simultaneous multi-exponentiation for the Zerocoin proofs.
+*
+* @copyright  Copyright 2019 The Veil Developers
+* @license    This project is released under the MIT license.
+**/
+
+#include "MultiExp.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace libzerocoin {
+
+namespace {
+
+/** Exponent stored as little endian bytes, so that windows of any size can be read from it */
+class CExponentDigits
+{
+private:
+    std::vector<unsigned char> vch;
+
+public:
+    explicit CExponentDigits(const CBigNum& e) : vch(e.getvch()) {}
+
+    unsigned int Get(unsigned int nPos, unsigned int nBits) const
+    {
+        unsigned int nDigit = 0;
+        for (unsigned int j = 0; j < nBits; j++) {
+            unsigned int nBit = nPos + j;
+            if (nBit / 8 < vch.size() && (vch[nBit / 8] >> (nBit % 8)) & 1)
+                nDigit |= 1u << j;
+        }
+        return nDigit;
+    }
+};
+
+/** Multiply into a value that is still empty (1) without doing the multiplication */
+void MulInto(CBigNum& acc, bool& fSet, const CBigNum& factor, const CBigNum& modulus)
+{
+    if (fSet) {
+        acc = acc.mul_mod(factor, modulus);
+    } else {
+        acc = factor;
+        fSet = true;
+    }
+}
+
+void SquareInto(CBigNum& acc, bool fSet, unsigned int nTimes, const CBigNum& modulus)
+{
+    if (!fSet)
+        return;
+    for (unsigned int i = 0; i < nTimes; i++)
+        acc = acc.mul_mod(acc, modulus);
+}
+
+CBigNum Straus(const CBN_vector& bases, const std::vector<CExponentDigits>& digits, unsigned int nBits,
+        unsigned int nWindowBits, const CBigNum& modulus)
+{
+    // tables[i][d - 1] = bases[i]^d
+    const unsigned int nEntries = (1u << nWindowBits) - 1;
+    std::vector<CBN_vector> tables(bases.size());
+    for (unsigned int i = 0; i < bases.size(); i++) {
+        tables[i].reserve(nEntries);
+        tables[i].push_back(bases[i]);
+        for (unsigned int d = 1; d < nEntries; d++)
+            tables[i].push_back(tables[i].back().mul_mod(bases[i], modulus));
+    }
+
+    CBigNum acc;
+    bool fSet = false;
+    unsigned int nWindows = (nBits + nWindowBits - 1) / nWindowBits;
+    for (unsigned int w = nWindows; w-- > 0;) {
+        SquareInto(acc, fSet, nWindowBits, modulus);
+        for (unsigned int i = 0; i < bases.size(); i++) {
+            unsigned int nDigit = digits[i].Get(w * nWindowBits, nWindowBits);
+            if (nDigit)
+                MulInto(acc, fSet, tables[i][nDigit - 1], modulus);
+        }
+    }
+    return fSet ? acc : CBigNum(1);
+}
+
+CBigNum Pippenger(const CBN_vector& bases, const std::vector<CExponentDigits>& digits, unsigned int nBits,
+        unsigned int nWindowBits, const CBigNum& modulus)
+{
+    const unsigned int nBuckets = 1u << nWindowBits;
+    CBN_vector buckets(nBuckets);
+    std::vector<bool> vBucketSet(nBuckets);
+
+    CBigNum acc;
+    bool fSet = false;
+    unsigned int nWindows = (nBits + nWindowBits - 1) / nWindowBits;
+    for (unsigned int w = nWindows; w-- > 0;) {
+        SquareInto(acc, fSet, nWindowBits, modulus);
+
+        std::fill(vBucketSet.begin(), vBucketSet.end(), false);
+        for (unsigned int i = 0; i < bases.size(); i++) {
+            unsigned int nDigit = digits[i].Get(w * nWindowBits, nWindowBits);
+            if (nDigit) {
+                bool fBucketSet = vBucketSet[nDigit];
+                MulInto(buckets[nDigit], fBucketSet, bases[i], modulus);
+                vBucketSet[nDigit] = fBucketSet;
+            }
+        }
+
+        // prod(bucket_d^d) = prod over d of (bucket_top * ... * bucket_d)
+        CBigNum running, window;
+        bool fRunningSet = false, fWindowSet = false;
+        for (unsigned int d = nBuckets - 1; d > 0; d--) {
+            if (vBucketSet[d])
+                MulInto(running, fRunningSet, buckets[d], modulus);
+            if (fRunningSet)
+                MulInto(window, fWindowSet, running, modulus);
+        }
+        if (fWindowSet)
+            MulInto(acc, fSet, window, modulus);
+    }
+    return fSet ? acc : CBigNum(1);
+}
+
+} // namespace
+
+CBigNum MultiExp(const CBN_vector& bases, const CBN_vector& exponents, const CBigNum& modulus)
+{
+    if (bases.size() != exponents.size())
+        throw std::runtime_error("different vector length in MultiExp");
+    if (modulus <= CBigNum(1))
+        throw std::runtime_error("MultiExp: modulus must be greater than 1");
+
+    // Drop zero exponents and move the sign of negative ones to their base
+    CBN_vector vBases, vExponents;
+    vBases.reserve(bases.size());
+    vExponents.reserve(bases.size());
+    unsigned int nBits = 0;
+    for (unsigned int i = 0; i < bases.size(); i++) {
+        if (exponents[i] == CBigNum(0))
+            continue;
+        if (exponents[i] < CBigNum(0)) {
+            vBases.push_back(bases[i].inverse(modulus));
+            vExponents.push_back(-exponents[i]);
+        } else {
+            vBases.push_back(bases[i] % modulus);
+            vExponents.push_back(exponents[i]);
+        }
+        nBits = std::max(nBits, (unsigned int)exponents[i].bitSize());
+    }
+
+    // pow_mod() reduces faster than mul_mod(), so sharing the squarings only pays off from three terms
+    if (vBases.size() < 3) {
+        CBigNum ret(1);
+        for (unsigned int i = 0; i < vBases.size(); i++)
+            ret = ret.mul_mod(vBases[i].pow_mod(vExponents[i], modulus), modulus);
+        return ret;
+    }
+
+    std::vector<CExponentDigits> vDigits(vExponents.begin(), vExponents.end());
+
+    // Estimated number of modular multiplications for each method and window size
+    const uint64_t n = vBases.size();
+    uint64_t nBestCost = std::numeric_limits<uint64_t>::max();
+    unsigned int nBestWindow = 1;
+    bool fPippenger = false;
+    for (unsigned int c = 1; c <= 8; c++) {
+        uint64_t nWindows = (nBits + c - 1) / c;
+        uint64_t nCost = n * ((1u << c) - 2) + nBits + nWindows * n;
+        if (nCost < nBestCost) {
+            nBestCost = nCost;
+            nBestWindow = c;
+            fPippenger = false;
+        }
+    }
+    for (unsigned int c = 2; c <= 16; c++) {
+        uint64_t nWindows = (nBits + c - 1) / c;
+        uint64_t nCost = nBits + nWindows * (n + (2u << c));
+        if (nCost < nBestCost) {
+            nBestCost = nCost;
+            nBestWindow = c;
+            fPippenger = true;
+        }
+    }
+
+    if (fPippenger)
+        return Pippenger(vBases, vDigits, nBits, nBestWindow, modulus);
+    return Straus(vBases, vDigits, nBits, nBestWindow, modulus);
+}
+
+} /* namespace libzerocoin */
@@ -0,0 +1,35 @@
+/**
+* @file       MultiExp.h
+*
+* @brief      Simultaneous multi-exponentiation for the Zerocoin proofs.
+*
+* @copyright  Copyright 2019 The Veil Developers
+* @license    This project is released under the MIT license.
+**/
+
+#ifndef VEIL_LIBZEROCOIN_MULTIEXP_H
+#define VEIL_LIBZEROCOIN_MULTIEXP_H
+
+#include "bignum.h"
+#include "ZerocoinDefines.h"
+
+namespace libzerocoin {
+
+/**
+ * Compute the product of bases[i]^exponents[i] mod modulus. The result is identical to multiplying the separate
+ * pow_mod() results, but the squarings are shared between all terms:
+ *
+ * - Straus (interleaved windows): a small table of powers per base, one multiplication per base and window.
+ * - Pippenger (buckets): for every window the bases are sorted into buckets by their digit and the buckets are
+ *   combined with two running products, so the cost per window is about one multiplication per base.
+ *
+ * The method and window size are picked from the number of terms and the exponent length. Negative exponents use
+ * the inverse of their base, like pow_mod().
+ *
+ * The timing depends on the exponents, so this must only be used with public exponents (proof verification).
+ */
+CBigNum MultiExp(const CBN_vector& bases, const CBN_vector& exponents, const CBigNum& modulus);
+
+} /* namespace libzerocoin */
+
+#endif //VEIL_LIBZEROCOIN_MULTIEXP_H
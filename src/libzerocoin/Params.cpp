@@ -15,6 +15,8 @@
 #include "ParamGeneration.h"
 #include "ArithmeticCircuit.h"
 
+#include <mutex>
+
 namespace libzerocoin {
 
 ZerocoinParams::ZerocoinParams(CBigNum N, uint32_t securityLevel) {
@@ -35,6 +37,12 @@ ZerocoinParams::ZerocoinParams(CBigNum N, uint32_t securityLevel) {
     this->initialized = true;
 }
 
+ZerocoinParams::ZerocoinParams() {
+    this->initialized = false;
+    this->zkp_hash_len = 0;
+    this->zkp_iterations = 0;
+}
+
 AccumulatorAndProofParams::AccumulatorAndProofParams() {
     this->initialized = false;
 }
@@ -49,7 +57,33 @@ CBigNum IntegerGroupParams::randomElement() const {
     // The generator of the group raised
     // to a random number less than the order of the group
     // provides us with a uniformly distributed random number.
-    return this->g.pow_mod(CBigNum::randBignum(this->groupOrder),this->modulus);
+    return pow_g(CBigNum::randBignum(this->groupOrder));
+}
+
+std::shared_ptr<const FixedBaseExp> IntegerGroupParams::GetFixedBase(std::shared_ptr<const FixedBaseExp>& table,
+        const CBigNum& base) const {
+    std::shared_ptr<const FixedBaseExp> ret = std::atomic_load(&table);
+    if (ret || this->modulus <= CBigNum(1) || this->groupOrder <= CBigNum(0))
+        return ret;
+
+    static std::mutex csFixedBase;
+    std::lock_guard<std::mutex> lock(csFixedBase);
+    ret = std::atomic_load(&table);
+    if (!ret) {
+        ret = std::make_shared<const FixedBaseExp>(base, this->modulus, this->groupOrder);
+        std::atomic_store(&table, ret);
+    }
+    return ret;
+}
+
+CBigNum IntegerGroupParams::pow_g(const CBigNum& e) const {
+    std::shared_ptr<const FixedBaseExp> table = GetFixedBase(this->fixedBaseG, this->g);
+    return table ? table->pow_mod(e) : this->g.pow_mod(e, this->modulus);
+}
+
+CBigNum IntegerGroupParams::pow_h(const CBigNum& e) const {
+    std::shared_ptr<const FixedBaseExp> table = GetFixedBase(this->fixedBaseH, this->h);
+    return table ? table->pow_mod(e) : this->h.pow_mod(e, this->modulus);
 }
 
 } /* namespace libzerocoin */
@@ -16,6 +16,9 @@
 
 #include "bignum.h"
 #include "ZerocoinDefines.h"
+#include "FixedBaseExp.h"
+
+#include <memory>
 
 namespace libzerocoin {
 
@@ -32,6 +35,14 @@ public:
 	 * @return a random element in the group.
 	 */
 	CBigNum randomElement() const;
+
+	/**
+	 * Computes g^e and h^e mod modulus with fixed-base tables, which are built on first use.
+	 * The result is identical to g.pow_mod(e, modulus) and h.pow_mod(e, modulus).
+	 */
+	CBigNum pow_g(const CBigNum& e) const;
+	CBigNum pow_h(const CBigNum& e) const;
+
 	bool initialized;
 
 	/**
@@ -77,7 +88,17 @@ public:
 		    READWRITE(u_inner_prod);
 		    READWRITE(modulus);
 		    READWRITE(groupOrder);
+		    if (ser_action.ForRead()) {
+		        fixedBaseG.reset();
+		        fixedBaseH.reset();
+		    }
 	}	
+
+private:
+	std::shared_ptr<const FixedBaseExp> GetFixedBase(std::shared_ptr<const FixedBaseExp>& table, const CBigNum& base) const;
+
+	mutable std::shared_ptr<const FixedBaseExp> fixedBaseG;
+	mutable std::shared_ptr<const FixedBaseExp> fixedBaseH;
 };
 
 class AccumulatorAndProofParams {
@@ -189,6 +210,9 @@ public:
 	**/
 	ZerocoinParams(CBigNum accumulatorModulus, uint32_t securityLevel = ZEROCOIN_DEFAULT_SECURITYLEVEL);
 
+	/** @brief Construct an empty set of parameters, to be filled by ReadPrecomputedParams() */
+	ZerocoinParams();
+
 	bool initialized;
 
 	AccumulatorAndProofParams accumulatorParams;
@@ -10,6 +10,7 @@
 * @license    This project is released under the MIT license.
 **/
 
+#include "MultiExp.h"
 #include "PolynomialCommitment.h"
 
 using namespace libzerocoin;
@@ -149,21 +150,22 @@ bool PolynomialCommitment::Verify(CBigNum& value)
     CBigNum C = pedersenCommitment(params, tbar, taubar);
 
     // Find powers of commitments to Tf, Trho and U
-    CBigNum test = CBigNum(1);
-    CBigNum T;
+    CBN_vector bases, exps;
 
     for(int i=0; i<m1; i++) {
-        T = Tf[i].pow_mod(xPowersNeg[(m1-i)*n],p);
-        test = test.mul_mod(T,p);
+        bases.push_back(Tf[i]);
+        exps.push_back(xPowersNeg[(m1-i)*n]);
     }
 
     for(int i=0; i<m2; i++) {
-        T = Trho[i].pow_mod(xPowersPos[i*n+1],p);
-        test = test.mul_mod(T,p);
+        bases.push_back(Trho[i]);
+        exps.push_back(xPowersPos[i*n+1]);
     }
 
-    T = U.pow_mod(xPowersPos[2],p);
-    test = test.mul_mod(T,p);
+    bases.push_back(U);
+    exps.push_back(xPowersPos[2]);
+
+    CBigNum test = MultiExp(bases, exps, p);
 
     // Perform the test
     if( C != test ) {
@@ -0,0 +1,155 @@
+/**
+* @file       PrecomputedParams.cpp
+*
+* @brief      Reading and writing of precomputed Zerocoin parameter files.
+*
+* @copyright  Copyright 2019 The Veil Developers
+* @license    This project is released under the MIT license.
+**/
+
+#include "PrecomputedParams.h"
+#include "hash.h"
+#include "streams.h"
+#include "version.h"
+
+#include <cstdio>
+
+namespace libzerocoin {
+
+namespace {
+
+template <typename Stream, typename Operation>
+void SerializePrecomputed(Stream& s, ZerocoinParams& params, Operation ser_action)
+{
+    READWRITE(params);
+    READWRITE(params.ZKP_wA);
+    READWRITE(params.ZKP_wB);
+    READWRITE(params.ZKP_wC);
+    READWRITE(params.ZKP_K);
+    READWRITE(params.S_POLY_A1);
+    READWRITE(params.S_POLY_A2);
+    READWRITE(params.S_POLY_B1);
+    READWRITE(params.S_POLY_B2);
+    READWRITE(params.S_POLY_C1);
+    READWRITE(params.S_POLY_C2);
+}
+
+} // namespace
+
+uint256 GetPrecomputedParamsHash(const ZerocoinParams& params)
+{
+    CHashWriter ss(SER_DISK, PROTOCOL_VERSION);
+    SerializePrecomputed(ss, const_cast<ZerocoinParams&>(params), CSerActionSerialize());
+    return ss.GetHash();
+}
+
+bool WritePrecomputedParams(const ZerocoinParams& params, const std::string& strPath, std::string& strError)
+{
+    if (!params.initialized) {
+        strError = "parameters are not initialized";
+        return false;
+    }
+
+    CDataStream ssPayload(SER_DISK, PROTOCOL_VERSION);
+    SerializePrecomputed(ssPayload, const_cast<ZerocoinParams&>(params), CSerActionSerialize());
+    uint256 hashPayload = Hash(ssPayload.begin(), ssPayload.end());
+
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << PRECOMPUTED_PARAMS_MAGIC << PRECOMPUTED_PARAMS_VERSION;
+    ss.write(ssPayload.data(), ssPayload.size());
+    ss << hashPayload;
+
+    std::string strPathTmp = strPath + ".new";
+    FILE* file = fopen(strPathTmp.c_str(), "wb");
+    if (!file) {
+        strError = "failed to open " + strPathTmp + " for writing";
+        return false;
+    }
+    bool fWritten = fwrite(ss.data(), 1, ss.size(), file) == ss.size();
+    fWritten &= fflush(file) == 0;
+    fWritten &= fclose(file) == 0;
+    if (!fWritten) {
+        remove(strPathTmp.c_str());
+        strError = "failed to write " + strPathTmp;
+        return false;
+    }
+
+#ifdef WIN32
+    // rename() does not replace an existing file on Windows
+    remove(strPath.c_str());
+#endif
+    if (rename(strPathTmp.c_str(), strPath.c_str()) != 0) {
+        remove(strPathTmp.c_str());
+        strError = "failed to rename " + strPathTmp + " to " + strPath;
+        return false;
+    }
+
+    return true;
+}
+
+bool ReadPrecomputedParams(ZerocoinParams& params, const uint256& hashExpected, const std::string& strPath,
+        std::string& strError)
+{
+    FILE* file = fopen(strPath.c_str(), "rb");
+    if (!file) {
+        strError = "failed to open " + strPath;
+        return false;
+    }
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    long nFileSize = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (nFileSize = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        ss.resize(nFileSize);
+        if (fread(ss.data(), 1, ss.size(), file) != ss.size())
+            nFileSize = -1;
+    }
+    fclose(file);
+    if (nFileSize < 0) {
+        strError = "failed to read " + strPath;
+        return false;
+    }
+
+    static const size_t nHeaderSize = sizeof(PRECOMPUTED_PARAMS_MAGIC) + sizeof(PRECOMPUTED_PARAMS_VERSION);
+    if (ss.size() < nHeaderSize + sizeof(uint256)) {
+        strError = "file is truncated";
+        return false;
+    }
+
+    // The file is only trusted if it holds exactly the parameters that deriving them would produce
+    uint256 hashPayload = Hash(ss.data() + nHeaderSize, ss.data() + ss.size() - sizeof(uint256));
+    if (hashPayload != hashExpected) {
+        strError = "parameters do not match the expected hash " + hashExpected.GetHex();
+        return false;
+    }
+
+    try {
+        uint32_t nMagic, nVersion;
+        ss >> nMagic >> nVersion;
+        if (nMagic != PRECOMPUTED_PARAMS_MAGIC) {
+            strError = "file is not a precomputed parameter file";
+            return false;
+        }
+        if (nVersion != PRECOMPUTED_PARAMS_VERSION) {
+            strError = "unsupported file version " + std::to_string(nVersion);
+            return false;
+        }
+
+        SerializePrecomputed(ss, params, CSerActionUnserialize());
+        uint256 hashChecksum;
+        ss >> hashChecksum;
+        if (!ss.empty()) {
+            strError = "unexpected data after parameters";
+            return false;
+        }
+        if (hashChecksum != hashPayload) {
+            strError = "checksum mismatch";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        strError = std::string("failed to deserialize: ") + e.what();
+        return false;
+    }
+
+    return true;
+}
+
+} /* namespace libzerocoin */
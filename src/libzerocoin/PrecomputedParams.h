@@ -0,0 +1,46 @@
+/**
+* @file       PrecomputedParams.h
+*
+* @brief      Reading and writing of precomputed Zerocoin parameter files.
+*
+* @copyright  Copyright 2019 The Veil Developers
+* @license    This project is released under the MIT license.
+**/
+
+#ifndef VEIL_LIBZEROCOIN_PRECOMPUTEDPARAMS_H
+#define VEIL_LIBZEROCOIN_PRECOMPUTEDPARAMS_H
+
+#include "Params.h"
+#include "uint256.h"
+
+#include <string>
+
+namespace libzerocoin {
+
+//! Magic bytes at the start of a precomputed parameter file ("zcpp")
+static const uint32_t PRECOMPUTED_PARAMS_MAGIC = 0x7070637a;
+//! Format version of the precomputed parameter file, bump when the layout of ZerocoinParams changes
+static const uint32_t PRECOMPUTED_PARAMS_VERSION = 1;
+
+/**
+ * Write the complete parameter set, including the arithmetic circuit constraints (wA, wB, wC, K) and the s-polynomials,
+ * to a precomputation file. The file is written to a temporary path and renamed so that a reader never sees a partial
+ * file.
+ *
+ * Layout: magic | version | serialized parameters | SHA256d of the serialized parameters
+ */
+bool WritePrecomputedParams(const ZerocoinParams& params, const std::string& strPath, std::string& strError);
+
+/** SHA256d of the serialized parameter set, as stored at the end of a precomputation file */
+uint256 GetPrecomputedParamsHash(const ZerocoinParams& params);
+
+/**
+ * Read a precomputation file into params. The file is only accepted if its parameters hash to hashExpected, the
+ * hash of the parameters derived from the network's modulus, so a modified file cannot replace them.
+ */
+bool ReadPrecomputedParams(ZerocoinParams& params, const uint256& hashExpected, const std::string& strPath,
+        std::string& strError);
+
+} /* namespace libzerocoin */
+
+#endif //VEIL_LIBZEROCOIN_PRECOMPUTEDPARAMS_H
@@ -11,6 +11,7 @@
 **/
 #include <streams.h>
 #include "ArithmeticCircuit.h"
+#include "MultiExp.h"
 #include "SerialNumberSoK_small.h"
 //#include <time.h>
 
@@ -62,12 +63,12 @@ SerialNumberSoK_small::SerialNumberSoK_small(const ZerocoinParams* ZCp, const Pr
     const int ndash = ZKP_NDASH;
     const int pads = ZKP_PADS;
 
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_a1(params->S_POLY_A1);
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_a2(params->S_POLY_A2);
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_b1(params->S_POLY_B1);
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_b2(params->S_POLY_B2);
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_c1(params->S_POLY_C1);
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_c2(params->S_POLY_C2);
+    const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_a1 = params->S_POLY_A1;
+    const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_a2 = params->S_POLY_A2;
+    const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_b1 = params->S_POLY_B1;
+    const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_b2 = params->S_POLY_B2;
+    const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_c1 = params->S_POLY_C1;
+    const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_c2 = params->S_POLY_C2;
 
 
     // ****************************************************************************
@@ -589,19 +590,13 @@ bool SerialNumberSoKProof::BatchVerify(std::vector<SerialNumberSoKProof> &proofs
 
     const ZerocoinParams *params;
 
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_a1;
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_a2;
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_b1;
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_b2;
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_c1;
-    std::vector< std::vector< std::pair<int, CBigNum> > > s_poly_c2;
 
     int duo0;
     CBigNum duo1;
     CBN_vector xPowersPositive, xPowersNegative, yPowers;
 
     CBN_vector test_vec(n, CBigNum(0));
-    CBigNum comTest = CBigNum(1);
+    CBN_vector comTestBases, comTestExps;
     CBigNum gamma;
 
     for(unsigned int w=0; w<proofs2.size(); w++)
@@ -656,13 +651,18 @@ bool SerialNumberSoKProof::BatchVerify(std::vector<SerialNumberSoKProof> &proofs
         rho = proofs2[w].signature.rho;
 
         CBigNum ComR = pedersenCommitment(params, CBN_vector(1, CBigNum(0)), -rho);
-        ComR = ComR.mul_mod(ComD.pow_mod(proofs2[w].xPowersPos[2*m+1],p),p);
 
+        CBN_vector ComRBases(1, ComD);
+        CBN_vector ComRExps(1, proofs2[w].xPowersPos[2*m+1]);
         for(int i=1; i<m+1; i++) {
-            ComR = ComR.mul_mod(ComA[i-1].pow_mod(proofs2[w].xPowersPos[i].mul_mod(proofs2[w].yPowers[i],q),p),p);
-            ComR = ComR.mul_mod(ComB[i-1].pow_mod(proofs2[w].xPowersNeg[i],p),p);
-            ComR = ComR.mul_mod(ComC_[i-1].pow_mod(proofs2[w].xPowersPos[m+i],p),p);
+            ComRBases.push_back(ComA[i-1]);
+            ComRExps.push_back(proofs2[w].xPowersPos[i].mul_mod(proofs2[w].yPowers[i],q));
+            ComRBases.push_back(ComB[i-1]);
+            ComRExps.push_back(proofs2[w].xPowersNeg[i]);
+            ComRBases.push_back(ComC_[i-1]);
+            ComRExps.push_back(proofs2[w].xPowersPos[m+i]);
         }
+        ComR = ComR.mul_mod(MultiExp(ComRBases, ComRExps, p),p);
 
         // append proof4
         proofs2[w].ComR = ComR;
@@ -672,12 +672,12 @@ bool SerialNumberSoKProof::BatchVerify(std::vector<SerialNumberSoKProof> &proofs
         // *************************** STEP 5: Find s_vec_2 ***************************
         // ****************************************************************************
 
-        s_poly_a1 = params->S_POLY_A1;
-        s_poly_a2 = params->S_POLY_A2;
-        s_poly_b1 = params->S_POLY_B1;
-        s_poly_b2 = params->S_POLY_B2;
-        s_poly_c1 = params->S_POLY_C1;
-        s_poly_c2 = params->S_POLY_C2;
+        const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_a1 = params->S_POLY_A1;
+        const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_a2 = params->S_POLY_A2;
+        const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_b1 = params->S_POLY_B1;
+        const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_b2 = params->S_POLY_B2;
+        const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_c1 = params->S_POLY_C1;
+        const std::vector< std::vector< std::pair<int, CBigNum> > >& s_poly_c2 = params->S_POLY_C2;
         xPowersPositive = proofs2[w].xPowersPos;
         xPowersNegative = proofs2[w].xPowersNeg;
         yPowers = proofs2[w].yPowers;
@@ -744,14 +744,17 @@ bool SerialNumberSoKProof::BatchVerify(std::vector<SerialNumberSoKProof> &proofs
 
         addVectors_mod(test_vec, temp_v, test_vec, q);
 
-        comTest = comTest.mul_mod(
-                        ((ComR.pow_mod(-1,p)).mul_mod(comRdash,p)).pow_mod(gamma,p),p);
+        comTestBases.push_back((ComR.pow_mod(-1,p)).mul_mod(comRdash,p));
+        comTestExps.push_back(gamma);
 
 
     }
 
+    // all proofs are combined in one multi-exponentiation on each side
+    CBigNum comTest = MultiExp(comTestBases, comTestExps, p);
 
-    CBigNum test = pedersenCommitment(proofs2[0].signature.params, test_vec, CBigNum(0));
+    const CBN_vector& gis = proofs2[0].signature.params->serialNumberSoKCommitmentGroup.gis;
+    CBigNum test = MultiExp(CBN_vector(gis.begin(), gis.begin() + test_vec.size()), test_vec, p);
 
     if(test != comTest) {
         LogPrintf("BatchVerify failed: different test and comTest\n");
@@ -780,13 +783,12 @@ bool SerialNumberSoKProof::BatchBulletproofs(const CBN_matrix ck_inner_g, std::v
     const CBigNum p = params->serialNumberSoKCommitmentGroup.modulus;
     const CBigNum u_inner_prod = params->serialNumberSoKCommitmentGroup.u_inner_prod;
 
-    CBigNum Ptest = CBigNum(1);
+    CBN_vector PtestBases, PtestExps;
 
     std::vector<fBE> forBigExpo;
     CBigNum gamma, x1, u_inner, P_inner;
     CBigNum x, Ak, Bk;
     CBN_vector xlist;
-    CBigNum pt1, pt2;
     CBigNum A, B, z;
     for(unsigned int w=0; w<proofs.size(); w++)
     {
@@ -809,6 +811,7 @@ bool SerialNumberSoKProof::BatchBulletproofs(const CBN_matrix ck_inner_g, std::v
 
         // Starting the actual protocol
         xlist.clear();
+        CBN_vector PinnerBases, PinnerExps;
 
         for(int i=0; i<N1; i++) {
             Ak = dp.signature.innerProduct.pi[0][i];
@@ -820,16 +823,19 @@ bool SerialNumberSoKProof::BatchBulletproofs(const CBN_matrix ck_inner_g, std::v
 
             xlist.push_back(x);
 
-            P_inner = P_inner.mul_mod(
-                    (Ak.pow_mod(x.pow_mod(2,q),p)).mul_mod(Bk.pow_mod(x.pow_mod(-2,q),p),p),p);
+            PinnerBases.push_back(Ak);
+            PinnerExps.push_back(x.pow_mod(2,q));
+            PinnerBases.push_back(Bk);
+            PinnerExps.push_back(x.pow_mod(-2,q));
         }
+        P_inner = P_inner.mul_mod(MultiExp(PinnerBases, PinnerExps, p),p);
 
         z = dp.signature.innerProduct.final_a[0][0].mul_mod(dp.signature.innerProduct.final_b[0][0],q);
 
-        pt1 = P_inner.pow_mod(gamma,p);
-        pt2 = u_inner.pow_mod(z.mul_mod(-gamma,q),p);
-
-        Ptest = Ptest.mul_mod( pt1.mul_mod(pt2,p) ,p);
+        PtestBases.push_back(P_inner);
+        PtestExps.push_back(gamma);
+        PtestBases.push_back(u_inner);
+        PtestExps.push_back(z.mul_mod(-gamma,q));
 
         fBE new_element;
         new_element.gamma = gamma;
@@ -842,6 +848,7 @@ bool SerialNumberSoKProof::BatchBulletproofs(const CBN_matrix ck_inner_g, std::v
         forBigExpo.push_back(new_element);
     }
 
+    CBigNum Ptest = MultiExp(PtestBases, PtestExps, p);
     CBN_vector gh_final = getFinal_gh(params, ck_inner_g[0], forBigExpo);
 
     return (gh_final[0].mul_mod(gh_final[1],p) == Ptest);
@@ -896,12 +903,9 @@ CBN_vector SerialNumberSoKProof::getFinal_gh(const ZerocoinParams* ZCp, CBN_vect
         }
     }
 
-    CBN_vector gh_final(2, CBigNum(1));
-
-    for(int i=0; i<n; i++) {
-        gh_final[0] = gh_final[0].mul_mod(gs[i].pow_mod(sg_expo[i],p),p);
-        gh_final[1] = gh_final[1].mul_mod(gs[i].pow_mod(sh_expo[i],p),p);
-    }
+    CBN_vector gh_final(2);
+    gh_final[0] = MultiExp(gs, sg_expo, p);
+    gh_final[1] = MultiExp(gs, sh_expo, p);
 
     return gh_final;
 }
@@ -30,6 +30,7 @@
 #define ZEROCOIN_COMMITMENT_EQUALITY_PROOF  "COMMITMENT_EQUALITY_PROOF"
 #define ZEROCOIN_ACCUMULATOR_PROOF          "ACCUMULATOR_PROOF"
 #define ZEROCOIN_SERIALNUMBER_PROOF         "SERIALNUMBER_PROOF"
+#define ZEROCOIN_FIXEDBASE_WINDOW           4
 
 // Activate multithreaded mode for proof verification
 #define ZEROCOIN_THREADING 1
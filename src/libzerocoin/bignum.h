@@ -10,6 +10,7 @@
 #include "veil-config.h"
 #endif
 
+#include <memory>
 #include <stdexcept>
 #include <vector>
 #if defined(USE_NUM_GMP)
@@ -25,6 +26,10 @@
 #include "version.h"
 #include "random.h"
 
+namespace libzerocoin {
+class FixedBaseExp;
+}
+
 /** Errors thrown by the bignum class */
 class bignum_error : public std::runtime_error
 {
@@ -35,37 +40,85 @@ public:
 #if defined(USE_NUM_OPENSSL)
 
 
-/** RAII encapsulated BN_CTX (OpenSSL bignum context) */
+/**
+ * Access to this thread's BN_CTX (OpenSSL bignum context). The context is created once per thread and reused by
+ * every operation, instead of being allocated and freed for each one.
+ */
 class CAutoBN_CTX
 {
 protected:
     BN_CTX* pctx;
-    BN_CTX* operator=(BN_CTX* pnew) { return pctx = pnew; }
 
 public:
     CAutoBN_CTX()
     {
-        pctx = BN_CTX_new();
+        static thread_local std::unique_ptr<BN_CTX, decltype(&BN_CTX_free)> ctx(BN_CTX_new(), &BN_CTX_free);
+        pctx = ctx.get();
         if (pctx == NULL)
             throw bignum_error("CAutoBN_CTX : BN_CTX_new() returned NULL");
     }
 
-    ~CAutoBN_CTX()
-    {
-        if (pctx != NULL)
-            BN_CTX_free(pctx);
-    }
-
     operator BN_CTX*() { return pctx; }
     BN_CTX& operator*() { return *pctx; }
-    BN_CTX** operator&() { return &pctx; }
     bool operator!() { return (pctx == NULL); }
 };
 
+/**
+ * Per-thread cache of Montgomery contexts. The zerocoin code exponentiates against a handful of fixed moduli, so
+ * the Montgomery setup for each of them is done once per thread instead of on every BN_mod_exp().
+ */
+class CMontCtxCache
+{
+private:
+    static const size_t MAX_ENTRIES = 8;
+    std::vector<std::pair<BIGNUM*, BN_MONT_CTX*> > vEntries;
+
+public:
+    ~CMontCtxCache()
+    {
+        for (auto& entry : vEntries) {
+            BN_free(entry.first);
+            BN_MONT_CTX_free(entry.second);
+        }
+    }
+
+    /** The Montgomery context of an odd modulus, or NULL if it could not be created */
+    BN_MONT_CTX* Get(const BIGNUM* m, BN_CTX* pctx)
+    {
+        for (auto& entry : vEntries) {
+            if (BN_cmp(entry.first, m) == 0)
+                return entry.second;
+        }
+
+        BN_MONT_CTX* mont = BN_MONT_CTX_new();
+        BIGNUM* mcopy = BN_dup(m);
+        if (mont == NULL || mcopy == NULL || !BN_MONT_CTX_set(mont, m, pctx)) {
+            BN_MONT_CTX_free(mont);
+            BN_free(mcopy);
+            return NULL;
+        }
+
+        if (vEntries.size() >= MAX_ENTRIES) {
+            BN_free(vEntries.front().first);
+            BN_MONT_CTX_free(vEntries.front().second);
+            vEntries.erase(vEntries.begin());
+        }
+        vEntries.emplace_back(mcopy, mont);
+        return mont;
+    }
+
+    static CMontCtxCache& ThreadCache()
+    {
+        static thread_local CMontCtxCache cache;
+        return cache;
+    }
+};
+
 /** C++ wrapper for BIGNUM (OpenSSL bignum) */
 class CBigNum
 {
     BIGNUM* bn;
+    friend class libzerocoin::FixedBaseExp;
 public:
     CBigNum()
     {
@@ -465,15 +518,16 @@ public:
      */
     CBigNum pow_mod(const CBigNum& e, const CBigNum& m) const {
         CAutoBN_CTX pctx;
+        BN_MONT_CTX* mont = BN_is_odd(m.bn) ? CMontCtxCache::ThreadCache().Get(m.bn, pctx) : NULL;
         CBigNum ret;
-        if( e < 0){
+        if (BN_is_negative(e.bn)) {
             // g^-x = (g^-1)^x
             CBigNum inv = this->inverse(m);
             CBigNum posE = e * -1;
-            if (!BN_mod_exp(ret.bn, inv.bn, posE.bn, m.bn, pctx))
+            if (!(mont ? BN_mod_exp_mont(ret.bn, inv.bn, posE.bn, m.bn, pctx, mont) : BN_mod_exp(ret.bn, inv.bn, posE.bn, m.bn, pctx)))
                 throw bignum_error("CBigNum::pow_mod: BN_mod_exp failed on negative exponent");
         }else
-            if (!BN_mod_exp(ret.bn, bn, e.bn, m.bn, pctx))
+            if (!(mont ? BN_mod_exp_mont(ret.bn, bn, e.bn, m.bn, pctx, mont) : BN_mod_exp(ret.bn, bn, e.bn, m.bn, pctx)))
                 throw bignum_error("CBigNum::pow_mod : BN_mod_exp failed");
 
         return ret;
@@ -732,6 +786,7 @@ inline std::ostream& operator<<(std::ostream &strm, const CBigNum &b) { return s
 class CBigNum
 {
     mpz_t bn;
+    friend class libzerocoin::FixedBaseExp;
 public:
     CBigNum()
     {
@@ -1000,7 +1055,7 @@ public:
      */
     CBigNum pow_mod(const CBigNum& e, const CBigNum& m) const {
         CBigNum ret;
-        if (e > CBigNum(0) && mpz_odd_p(m.bn))
+        if (mpz_sgn(e.bn) > 0 && mpz_odd_p(m.bn))
             mpz_powm_sec (ret.bn, bn, e.bn, m.bn);
         else
             mpz_powm (ret.bn, bn, e.bn, m.bn);
@@ -16,7 +16,8 @@
 #include <fstream>
 //#include <curses.h>
 #include <exception>
-#include "Zerocoin.h"
+#include "Params.h"
+#include "PrecomputedParams.h"
 
 #define DEFAULT_MODULUS_SIZE    3072
 #define MIN_MODULUS_SIZE        1026
@@ -46,6 +47,7 @@ void usage()
 	printf("Usage:\n");
 	printf(" -b <numbits>\n");
 	printf(" -o <output file>\n");
+	printf(" -m <decimal modulus> -p <precomputed params file>\n");
 
 	exit (8);
 }
@@ -57,6 +59,8 @@ int main(int argc, char **argv)
 	ofstream outfile;
 	char* outfileName;
 	bool writeToFile = false;
+	char* modulusDec = nullptr;
+	char* precomputedFileName = nullptr;
 
 	while ((argc > 1) && (argv[1][0] == '-'))
 	{
@@ -73,6 +77,18 @@ int main(int argc, char **argv)
 			writeToFile = true;
 			break;
 
+		case 'm':
+			modulusDec = argv[2];
+			++argv;
+			--argc;
+			break;
+
+		case 'p':
+			precomputedFileName = argv[2];
+			++argv;
+			--argc;
+			break;
+
 		case 'h':
 			usage();
 			break;
@@ -87,6 +103,25 @@ int main(int argc, char **argv)
 		--argc;
 	}
 
+	// Precompute the full parameter set of an existing modulus, to be memory-mapped by the node at startup
+	if (precomputedFileName) {
+		if (!modulusDec)
+			usage();
+
+		CBigNum modulus;
+		modulus.SetDec(modulusDec);
+		cout << "Precomputing parameters. This may take a few minutes..." << endl;
+		ZerocoinParams params(modulus);
+
+		std::string strError;
+		if (!WritePrecomputedParams(params, precomputedFileName, strError)) {
+			cout << "Unable to write precomputed parameters: " << strError << endl;
+			return(1);
+		}
+		cout << "Precomputed parameters have been written to file '" << precomputedFileName << "'." << endl;
+		return(0);
+	}
+
 	if (numBits < MIN_MODULUS_SIZE) {
 		cout << "Modulus is below minimum length (" << MIN_MODULUS_SIZE << ") bits" << endl;
 		return(0);
@@ -18,7 +18,7 @@ inline void vectorTimesConstant(CBN_vector& kV,
         CBN_vector& V, const CBigNum& k, const CBigNum& modulus)
 {
     transform(V.begin(), V.end(), kV.begin(),
-            [=] (CBigNum Vi) {
+            [&] (const CBigNum& Vi) {
         return Vi.mul_mod(k,modulus);} );
 }
 
@@ -39,7 +39,7 @@ inline void addVectors_mod(CBN_vector& sum,
     sum.resize(v1.size());
 
     transform(v1.begin(), v1.end(), v2.begin(), sum.begin(),
-            [=] (CBigNum v1_i, CBigNum v2_i) {
+            [&] (const CBigNum& v1_i, const CBigNum& v2_i) {
         return (v1_i + v2_i) % modulus;} );
 }
 
@@ -54,10 +54,11 @@ inline CBigNum dotProduct(const CBN_vector& u, const CBN_vector& v,
 {
     CBigNum dot = CBigNum(0);
 
+    // accumulate the full products and reduce once at the end
     for(unsigned int i=0; i<size; i++)
-        dot = (dot + u[i].mul_mod(v[i], modulus)) % modulus;
+        dot += u[i] * v[i];
 
-    return dot;
+    return dot % modulus;
 }
 
 inline CBigNum dotProduct(const CBN_vector& u, const CBN_vector& v, const CBigNum& modulus)
@@ -87,7 +88,7 @@ inline CBigNum pedersenCommitment(const ZerocoinParams* ZCparams,
     CBigNum C = CBigNum(1);
     for(unsigned int i=0; i<g_blinders.size(); i++)
         C = C.mul_mod((SoKgroup->gis[i]).pow_mod(g_blinders[i],p),p);
-    C = C.mul_mod((SoKgroup->h).pow_mod(h_blinder,p),p);
+    C = C.mul_mod(SoKgroup->pow_h(h_blinder),p);
 
     return C;
 }
@@ -145,7 +146,7 @@ inline void hadamard(CBN_vector& had,
     had.resize(u.size());
 
     transform(u.begin(), u.end(), v.begin(), had.begin(),
-            [=] (CBigNum u_i, CBigNum v_i) {
+            [&] (const CBigNum& u_i, const CBigNum& v_i) {
         return u_i.mul_mod(v_i, modulus);} );
 }
 
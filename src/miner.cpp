@@ -347,7 +347,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
             LogPrintf("%s: failed to get accumulator checkpoints\n", __func__);
         pblock->mapAccumulatorHashes = mapAccumulators.GetCheckpoints(true);
     } else {
-        pblock->mapAccumulatorHashes = pindexPrev->mapAccumulatorHashes;
+        pblock->mapAccumulatorHashes = pindexPrev->GetAccumulatorHashes();
     }
 
     //Proof of full node
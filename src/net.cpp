@@ -709,13 +709,23 @@ void CNode::copyStats(CNodeStats &stats)
     {
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
+        X(mapSendMsgsPerMsgCmd);
         X(nSendBytes);
     }
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
+        X(mapRecvMsgsPerMsgCmd);
         X(nRecvBytes);
     }
+    {
+        LOCK(cs_msgCost);
+        DecayValidationCost(GetTimeMicros());
+        X(mapRecvCPUMicrosPerMsgCmd);
+        stats.dValidationWasted = dValidationWasted / 1e6;
+        stats.dValidationUseful = dValidationUseful / 1e6;
+        X(fValidationThrottled);
+    }
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -783,6 +793,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
                 i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
             assert(i != mapRecvBytesPerMsgCmd.end());
             i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+            mapRecvMsgsPerMsgCmd[i->first]++;
 
             msg.nTime = nTimeMicros;
             complete = true;
@@ -792,6 +803,54 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+void CNode::DecayValidationCost(int64_t nNow)
+{
+    if (nNow <= nValidationCostTime)
+        return;
+    double dDecay = exp2(-(double)(nNow - nValidationCostTime) / (VALIDATION_COST_HALF_LIFE * 1000000));
+    dValidationWasted *= dDecay;
+    dValidationUseful *= dDecay;
+    nValidationCostTime = nNow;
+}
+
+void CNode::RecordMessageCost(const std::string& strCommand, int64_t nCPUMicros, bool fValidation, bool fUseful)
+{
+    LOCK(cs_msgCost);
+    // Only count known commands, as for mapRecvBytesPerMsgCmd
+    auto i = mapRecvCPUMicrosPerMsgCmd.find(strCommand);
+    if (i == mapRecvCPUMicrosPerMsgCmd.end())
+        i = mapRecvCPUMicrosPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapRecvCPUMicrosPerMsgCmd.end());
+    i->second += nCPUMicros;
+
+    if (!fValidation)
+        return;
+    DecayValidationCost(GetTimeMicros());
+    if (fUseful)
+        dValidationUseful += nCPUMicros;
+    else
+        dValidationWasted += nCPUMicros;
+}
+
+bool CNode::IsValidationThrottled(int64_t nMaxWastedMicros)
+{
+    LOCK(cs_msgCost);
+    DecayValidationCost(GetTimeMicros());
+    bool fThrottled = nMaxWastedMicros > 0 && dValidationWasted > nMaxWastedMicros + dValidationUseful;
+    if (fThrottled != fValidationThrottled)
+        LogPrint(BCLog::NET, "%s transactions of peer=%d, validation time wasted %.3fs, useful %.3fs\n",
+                 fThrottled ? "Delaying" : "No longer delaying", id, dValidationWasted / 1e6, dValidationUseful / 1e6);
+    fValidationThrottled = fThrottled;
+    return fThrottled;
+}
+
+void CNode::CreditValidationCost(int64_t nCPUMicros)
+{
+    LOCK(cs_msgCost);
+    DecayValidationCost(GetTimeMicros());
+    dValidationUseful += nCPUMicros;
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -2774,9 +2833,18 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fPauseSend = false;
     nProcessQueueSize = 0;
 
-    for (const std::string &msg : getAllNetMessageTypes())
+    fLastTxUseful = false;
+    dValidationWasted = 0;
+    dValidationUseful = 0;
+    nValidationCostTime = 0;
+    fValidationThrottled = false;
+
+    for (const std::string &msg : getAllNetMessageTypes()) {
         mapRecvBytesPerMsgCmd[msg] = 0;
+        mapRecvCPUMicrosPerMsgCmd[msg] = 0;
+    }
     mapRecvBytesPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
+    mapRecvCPUMicrosPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
 
     if (fLogIPs) {
         LogPrint(BCLog::NET, "Added connection to %s peer=%d\n", addrName, id);
@@ -2850,6 +2918,7 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->mapSendMsgsPerMsgCmd[msg.command]++;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
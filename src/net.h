@@ -36,6 +36,7 @@
 
 class CScheduler;
 class CNode;
+struct CTxPreVerifyJob;
 
 /** Time between pings automatically sent out for latency probing and keepalive (in seconds). */
 static const int PING_INTERVAL = 2 * 60;
@@ -84,6 +85,8 @@ static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
+/** Half-life of the validation cost recorded per peer, in seconds */
+static const int64_t VALIDATION_COST_HALF_LIFE = 60;
 
 typedef int64_t NodeId;
 
@@ -554,6 +557,13 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapSendMsgsPerMsgCmd;
+    mapMsgCmdSize mapRecvMsgsPerMsgCmd;
+    mapMsgCmdSize mapRecvCPUMicrosPerMsgCmd;
+    // Recent validation time of the peer's transactions, in seconds
+    double dValidationWasted;
+    double dValidationUseful;
+    bool fValidationThrottled;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -633,6 +643,16 @@ public:
     std::list<CNetMessage> vProcessMsg;
     size_t nProcessQueueSize;
 
+    // A tx message that is being checked on the tx verify threads, and holds up the
+    // node's later messages until it is done. Only used by the message handler thread.
+    std::shared_ptr<CTxPreVerifyJob> pTxPreVerify;
+    std::list<CNetMessage> vTxPreVerifyMsg;
+    // Whether the last tx message was accepted. Only used by the message handler thread.
+    bool fLastTxUseful;
+    // The last tx message if it was kept as an orphan, its cost is only credited to the node once
+    // the orphan gets accepted. Only used by the message handler thread.
+    uint256 hashLastTxOrphan;
+
     CCriticalSection cs_sendProcessing;
 
     std::deque<CInv> vRecvGetData;
@@ -681,6 +701,18 @@ protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapSendMsgsPerMsgCmd;
+    mapMsgCmdSize mapRecvMsgsPerMsgCmd;
+
+    // Cost of processing this peer's messages, see RecordMessageCost
+    CCriticalSection cs_msgCost;
+    mapMsgCmdSize mapRecvCPUMicrosPerMsgCmd;
+    double dValidationWasted;
+    double dValidationUseful;
+    int64_t nValidationCostTime;
+    bool fValidationThrottled;
+
+    void DecayValidationCost(int64_t nNow);
 
 public:
     uint256 hashContinue;
@@ -859,6 +891,20 @@ public:
 
     void copyStats(CNodeStats &stats);
 
+    /**
+     * Account for the CPU time spent processing a message of this peer. The time spent on its
+     * transactions is also added to a recent cost that decays with VALIDATION_COST_HALF_LIFE,
+     * split by whether the transaction was useful to us.
+     */
+    void RecordMessageCost(const std::string& strCommand, int64_t nCPUMicros, bool fValidation, bool fUseful);
+    /**
+     * Whether the transactions of this peer that were of no use to us recently cost more than
+     * nMaxWastedMicros of validation time beyond the ones that were.
+     */
+    bool IsValidationThrottled(int64_t nMaxWastedMicros);
+    /** Count validation time spent earlier on a transaction of this peer as useful after all, e.g. an accepted orphan */
+    void CreditValidationCost(int64_t nCPUMicros);
+
     ServiceFlags GetLocalServices() const
     {
         return nLocalServices;
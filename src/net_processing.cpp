@@ -31,8 +31,11 @@
 #include <utilstrencodings.h>
 
 #include <veil/dandelioninventory.h>
+#include <veil/ringct/anon.h>
 
 #include <memory>
+
+#include <boost/thread.hpp>
 #include <veil/zerocoin/zchain.h>
 
 #if defined(NDEBUG)
@@ -43,6 +46,8 @@
 static constexpr int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
 /** Minimum time between orphan transactions expire time checks in seconds */
 static constexpr int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
+/** How many anon outputs beyond the chain tip the ring members of a kept anon orphan may reference */
+static constexpr int64_t MAX_ANON_ORPHAN_INDEX_AHEAD = 5000;
 /** Headers download timeout expressed in microseconds
  *  Timeout = base + per_header * (expected number of headers) */
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
@@ -73,9 +78,21 @@ struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
+    int64_t nCPUMicros; // Validation time of the tx message, credited to fromPeer once the orphan is accepted
 };
 static CCriticalSection g_cs_orphans;
 std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
+/** A tx with ring members that are not in our chain yet, see AddAnonOrphanTx */
+struct CAnonOrphanTx {
+    CTransactionRef tx;
+    NodeId fromPeer;
+    int64_t nTimeExpire;
+    int64_t nMaxIndex;
+    int64_t nCPUMicros;
+};
+std::map<uint256, CAnonOrphanTx> mapAnonOrphanTransactions GUARDED_BY(g_cs_orphans);
+//! Anon orphans by the highest ring member index they reference
+std::multimap<int64_t, uint256> mapAnonOrphansByIndex GUARDED_BY(g_cs_orphans);
 std::map<int, CBlock> mapStagedBlocks;
 static int nStagedCacheSize = 0;
 static constexpr int STAGING_CACHE_SIZE = 1000000 * 100; //100mb cache
@@ -83,6 +100,7 @@ static constexpr int ASK_FOR_BLOCKS = 50; //How many blocks to ask for at once
 static CCriticalSection cs_staging;
 
 void EraseOrphansFor(NodeId peer);
+static void ProcessAnonOrphanTxs(CConnman* connman);
 
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="") EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -265,6 +283,13 @@ struct CNodeState {
      */
     bool fSupportsDesiredCmpctVersion;
 
+    //! Compact blocks from this peer that we reconstructed, and those we had to download in full
+    uint64_t nCmpctBlocksReconstructed;
+    uint64_t nCmpctBlocksFailed;
+    //! Transactions of compact blocks from this peer that we found locally, and those we had to request
+    uint64_t nCmpctTxFromMempool;
+    uint64_t nCmpctTxRequested;
+
     /** State used to enforce CHAIN_SYNC_TIMEOUT
       * Only in effect for outbound, non-manual connections, with
       * m_protect == false
@@ -317,6 +342,10 @@ struct CNodeState {
         fHaveWitness = false;
         fWantsCmpctWitness = false;
         fSupportsDesiredCmpctVersion = false;
+        nCmpctBlocksReconstructed = 0;
+        nCmpctBlocksFailed = 0;
+        nCmpctTxFromMempool = 0;
+        nCmpctTxRequested = 0;
         m_chain_sync = { 0, nullptr, false, false };
         m_last_block_announcement = 0;
     }
@@ -704,6 +733,10 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->nHeight);
     }
+    stats.nCmpctBlocksReconstructed = state->nCmpctBlocksReconstructed;
+    stats.nCmpctBlocksFailed = state->nCmpctBlocksFailed;
+    stats.nCmpctTxFromMempool = state->nCmpctTxFromMempool;
+    stats.nCmpctTxRequested = state->nCmpctTxRequested;
     return true;
 }
 
@@ -743,7 +776,7 @@ bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRE
         return false;
     }
 
-    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME});
+    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, 0});
     assert(ret.second);
     for (const CTxIn& txin : tx->vin) {
         mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first);
@@ -774,6 +807,92 @@ int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
     return 1;
 }
 
+/**
+ * Keep a tx that was rejected because ring members of its anon inputs are beyond our chain tip, typically
+ * outputs of a block that is still on its way. It is checked again once the chain has nMaxIndex anon outputs.
+ */
+bool AddAnonOrphanTx(const CTransactionRef& tx, NodeId peer, int64_t nMaxIndex) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    const uint256& hash = tx->GetHash();
+    if (mapAnonOrphanTransactions.count(hash))
+        return false;
+
+    // Same size limit as AddOrphanTx
+    unsigned int sz = GetTransactionWeight(*tx);
+    if (sz > MAX_STANDARD_TX_WEIGHT) {
+        LogPrint(BCLog::MEMPOOL, "ignoring large anon orphan tx (size: %u, hash: %s)\n", sz, hash.ToString());
+        return false;
+    }
+
+    mapAnonOrphanTransactions.emplace(hash, CAnonOrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, nMaxIndex, 0});
+    mapAnonOrphansByIndex.emplace(nMaxIndex, hash);
+
+    LogPrint(BCLog::MEMPOOL, "stored anon orphan tx %s waiting for anon output %d (mapsz %u)\n", hash.ToString(),
+             nMaxIndex, mapAnonOrphanTransactions.size());
+    return true;
+}
+
+/** Remember the validation time of the tx message that was kept as orphan hash */
+static void SetOrphanTxCost(const uint256& hash, int64_t nCPUMicros)
+{
+    LOCK(g_cs_orphans);
+    auto it = mapOrphanTransactions.find(hash);
+    if (it != mapOrphanTransactions.end())
+        it->second.nCPUMicros = nCPUMicros;
+    auto itAnon = mapAnonOrphanTransactions.find(hash);
+    if (itAnon != mapAnonOrphanTransactions.end())
+        itAnon->second.nCPUMicros = nCPUMicros;
+}
+
+/** The time spent on a tx kept as orphan was of use after all once it is accepted */
+static void CreditOrphanTxCost(CConnman* connman, NodeId peer, int64_t nCPUMicros)
+{
+    if (nCPUMicros <= 0)
+        return;
+    connman->ForNode(peer, [nCPUMicros](CNode* pnode) {
+        pnode->CreditValidationCost(nCPUMicros);
+        return true;
+    });
+}
+
+static int EraseAnonOrphanTx(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    auto it = mapAnonOrphanTransactions.find(hash);
+    if (it == mapAnonOrphanTransactions.end())
+        return 0;
+    auto range = mapAnonOrphansByIndex.equal_range(it->second.nMaxIndex);
+    for (auto itIndex = range.first; itIndex != range.second; ++itIndex) {
+        if (itIndex->second == hash) {
+            mapAnonOrphansByIndex.erase(itIndex);
+            break;
+        }
+    }
+    mapAnonOrphanTransactions.erase(it);
+    return 1;
+}
+
+/** Limit the anon orphans like LimitOrphanTxSize does the orphans, by expiry and random eviction */
+unsigned int LimitAnonOrphanTxSize(unsigned int nMaxOrphans)
+{
+    LOCK(g_cs_orphans);
+
+    unsigned int nEvicted = 0;
+    int64_t nNow = GetTime();
+    for (auto iter = mapAnonOrphanTransactions.begin(); iter != mapAnonOrphanTransactions.end(); ) {
+        auto maybeErase = iter++;
+        if (maybeErase->second.nTimeExpire <= nNow)
+            nEvicted += EraseAnonOrphanTx(maybeErase->first);
+    }
+    while (mapAnonOrphanTransactions.size() > nMaxOrphans) {
+        auto it = mapAnonOrphanTransactions.lower_bound(GetRandHash());
+        if (it == mapAnonOrphanTransactions.end())
+            it = mapAnonOrphanTransactions.begin();
+        EraseAnonOrphanTx(it->first);
+        ++nEvicted;
+    }
+    return nEvicted;
+}
+
 void EraseOrphansFor(NodeId peer)
 {
     LOCK(g_cs_orphans);
@@ -787,6 +906,11 @@ void EraseOrphansFor(NodeId peer)
             nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
         }
     }
+    for (auto iterAnon = mapAnonOrphanTransactions.begin(); iterAnon != mapAnonOrphanTransactions.end(); ) {
+        auto maybeErase = iterAnon++;
+        if (maybeErase->second.fromPeer == peer)
+            nErased += EraseAnonOrphanTx(maybeErase->first);
+    }
     if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
 
@@ -904,6 +1028,9 @@ void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pb
     for (const CTransactionRef& ptx : pblock->vtx) {
         const CTransaction& tx = *ptx;
 
+        if (mapAnonOrphanTransactions.count(tx.GetHash()))
+            vOrphanErase.push_back(tx.GetHash());
+
         // Which orphan pool entries must we evict?
         for (const auto& txin : tx.vin) {
             auto itByPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
@@ -920,7 +1047,7 @@ void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pb
     if (vOrphanErase.size()) {
         int nErased = 0;
         for (uint256 &orphanHash : vOrphanErase) {
-            nErased += EraseOrphanTx(orphanHash);
+            nErased += EraseOrphanTx(orphanHash) + EraseAnonOrphanTx(orphanHash);
         }
         LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx included or conflicted by block\n", nErased);
     }
@@ -1013,6 +1140,9 @@ void PeerLogicValidation::UpdatedBlockTip(const CBlockIndex *pindexNew, const CB
             }
         });
         connman->WakeMessageHandler();
+
+        // The new blocks may have brought the ring members of anon orphans
+        ProcessAnonOrphanTxs(connman);
     }
 
     nTimeBestReceived = GetTime();
@@ -1081,7 +1211,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 
             {
                 LOCK(g_cs_orphans);
-                if (mapOrphanTransactions.count(inv.hash)) return true;
+                if (mapOrphanTransactions.count(inv.hash) || mapAnonOrphanTransactions.count(inv.hash)) return true;
             }
 
             return recentRejects->contains(inv.hash) ||
@@ -1106,6 +1236,49 @@ static void RelayTransaction(const CTransaction& tx, CConnman* connman)
     });
 }
 
+/** Check the anon orphans again whose ring members are all in our chain by now */
+static void ProcessAnonOrphanTxs(CConnman* connman)
+{
+    LOCK2(cs_main, g_cs_orphans);
+    if (mapAnonOrphanTransactions.empty())
+        return;
+
+    const int64_t nAnonOutputs = chainActive.Tip()->nAnonOutputs;
+    std::vector<uint256> vReady;
+    for (auto it = mapAnonOrphansByIndex.begin(); it != mapAnonOrphansByIndex.end() && it->first <= nAnonOutputs; ++it)
+        vReady.push_back(it->second);
+
+    std::set<NodeId> setMisbehaving;
+    for (const uint256& hash : vReady) {
+        const CAnonOrphanTx orphan = mapAnonOrphanTransactions.at(hash);
+        EraseAnonOrphanTx(hash);
+        if (setMisbehaving.count(orphan.fromPeer))
+            continue;
+
+        // As for orphans, a dummy state keeps peers from being blamed for what another relayed
+        CValidationState stateDummy;
+        bool fMissingInputs = false;
+        std::list<CTransactionRef> lRemovedTxn;
+        if (AcceptToMemoryPool(mempool, stateDummy, orphan.tx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
+            LogPrint(BCLog::MEMPOOL, "   accepted anon orphan tx %s\n", hash.ToString());
+            if (!veil::dandelion.IsInStemPhase(hash))
+                RelayTransaction(*orphan.tx, connman);
+            CreditOrphanTxCost(connman, orphan.fromPeer, orphan.nCPUMicros);
+        } else {
+            int nDos = 0;
+            if (stateDummy.IsInvalid(nDos) && nDos > 0) {
+                // Punish peer that gave us an invalid anon orphan tx
+                Misbehaving(orphan.fromPeer, nDos);
+                setMisbehaving.insert(orphan.fromPeer);
+                LogPrint(BCLog::MEMPOOL, "   invalid anon orphan tx %s\n", hash.ToString());
+            }
+            LogPrint(BCLog::MEMPOOL, "   removed anon orphan tx %s\n", hash.ToString());
+        }
+        for (const CTransactionRef& removedTx : lRemovedTxn)
+            AddToCompactExtraTransactions(removedTx);
+    }
+}
+
 static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connman)
 {
     unsigned int nRelayNodes = fReachable ? 2 : 1; // limited relaying of addresses outside our network(s)
@@ -1270,7 +1443,7 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                 // instead we respond with the full, non-compact block.
                 bool fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
                 int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-                if (CanDirectFetch(consensusParams) && pindex->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
+                if (pfrom->nVersion >= VEIL_CMPCTBLOCK_VERSION && CanDirectFetch(consensusParams) && pindex->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
                     if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
                         connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
                     } else {
@@ -2086,8 +2259,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // nodes)
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDHEADERS));
         }
-        /*Compact blocks broken
-        if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
+        if (pfrom->nVersion >= VEIL_CMPCTBLOCK_VERSION) {
             // Tell our peer we are willing to provide version 1 or 2 cmpctblocks
             // However, we do not request new block announcements using
             // cmpctblock messages.
@@ -2100,7 +2272,6 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             nCMPCTBLOCKVersion = 1;
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion));
         }
-         */
         pfrom->fSuccessfullyConnected = true;
     }
 
@@ -2173,6 +2344,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         bool fAnnounceUsingCMPCTBLOCK = false;
         uint64_t nCMPCTBLOCKVersion = 0;
         vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        // Older peers use compact blocks without the Veil block data, which can't be reconstructed
+        if (pfrom->nVersion < VEIL_CMPCTBLOCK_VERSION)
+            return true;
         if (nCMPCTBLOCKVersion == 1 || ((pfrom->GetLocalServices() & NODE_WITNESS) && nCMPCTBLOCKVersion == 2)) {
             LOCK(cs_main);
             // fProvidesHeaderAndIDs is used to "lock in" version of compact blocks we send (fWantsCmpctWitness)
@@ -2499,6 +2673,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         LOCK2(cs_main, g_cs_orphans);
 
         bool fMissingInputs = false;
+        int64_t nMaxAnonIndex = -1;
         CValidationState state;
 
         pfrom->setAskFor.erase(inv.hash);
@@ -2521,6 +2696,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             }
 
             pfrom->nLastTXTime = GetTime();
+            pfrom->fLastTxUseful = true;
 
             LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
                 pfrom->GetId(),
@@ -2542,6 +2718,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     const CTransaction& orphanTx = *porphanTx;
                     const uint256& orphanHash = orphanTx.GetHash();
                     NodeId fromPeer = (*mi)->second.fromPeer;
+                    const int64_t nOrphanCPUMicros = (*mi)->second.nCPUMicros;
                     bool fMissingInputs2 = false;
                     // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
                     // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
@@ -2555,6 +2732,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                         LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
                         if (!veil::dandelion.IsInStemPhase(orphanHash))
                             RelayTransaction(orphanTx, connman);
+                        CreditOrphanTxCost(connman, fromPeer, nOrphanCPUMicros);
                         for (unsigned int i = 0; i < orphanTx.vpout.size(); i++) {
                             vWorkQueue.emplace_back(orphanHash, i);
                         }
@@ -2591,6 +2769,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
         else if (tx.IsZerocoinSpend() && AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs, &lRemovedTxn, false, 0)) {
             RelayTransaction(tx, connman);
+            pfrom->fLastTxUseful = true;
         }
         else if (fMissingInputs)
         {
@@ -2608,7 +2787,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     pfrom->AddInventoryKnown(_inv);
                     if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
                 }
-                AddOrphanTx(ptx, pfrom->GetId());
+                if (AddOrphanTx(ptx, pfrom->GetId()))
+                    pfrom->hashLastTxOrphan = ptx->GetHash();
 
                 // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
                 unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
@@ -2622,6 +2802,19 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // parents so avoid re-requesting it from other peers.
                 recentRejects->insert(tx.GetHash());
             }
+        } else if (state.GetRejectReason() == "bad-anonin-unknown-i" && !IsInitialBlockDownload() &&
+                   GetMaxAnonInputIndex(tx, nMaxAnonIndex) &&
+                   nMaxAnonIndex <= chainActive.Tip()->nAnonOutputs + MAX_ANON_ORPHAN_INDEX_AHEAD) {
+            // Ring members that are not in our chain yet are most likely outputs of a block we are about
+            // to receive, so keep the tx until they are instead of rejecting it and blaming the peer
+            if (AddAnonOrphanTx(ptx, pfrom->GetId(), nMaxAnonIndex))
+                pfrom->hashLastTxOrphan = ptx->GetHash();
+            unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+            unsigned int nEvicted = LimitAnonOrphanTxSize(nMaxOrphanTx);
+            if (nEvicted > 0) {
+                LogPrint(BCLog::MEMPOOL, "mapAnonOrphan overflow, removed %u tx\n", nEvicted);
+            }
+            state = CValidationState();
         } else {
             if (!tx.HasWitness() && !state.CorruptionPossible()) {
                 // Do not use rejection cache for witness transactions or
@@ -2680,6 +2873,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     else if (strCommand == NetMsgType::CMPCTBLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
     {
+        if (pfrom->nVersion < VEIL_CMPCTBLOCK_VERSION) {
+            LogPrint(BCLog::NET, "Ignoring cmpctblock of old format from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+
         CBlockHeaderAndShortTxIDs cmpctblock;
         vRecv >> cmpctblock;
 
@@ -2775,8 +2973,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         // We want to be a bit conservative just to be extra careful about DoS
         // possibilities in compact block processing...
-        if (pindex->nHeight <= chainActive.Height() + 2 && /**Compactblocks broken**/false) {
-            /*
+        if (pindex->nHeight <= chainActive.Height() + 2) {
             if ((!fAlreadyInFlight && nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) ||
                  (fAlreadyInFlight && blockInFlightIt->second.first == pfrom->GetId())) {
                 std::list<QueuedBlock>::iterator* queuedBlockIt = nullptr;
@@ -2798,6 +2995,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     return true;
                 } else if (status == READ_STATUS_FAILED) {
                     // Duplicate txindexes, the block is now in-flight, so just request it
+                    nodestate->nCmpctBlocksFailed++;
                     std::vector<CInv> vInv(1);
                     vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(pfrom), cmpctblock.header.GetHash());
                     connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
@@ -2835,9 +3033,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 status = tempBlock.FillBlock(*pblock, dummy);
                 if (status == READ_STATUS_OK) {
                     fBlockReconstructed = true;
+                    nodestate->nCmpctBlocksReconstructed++;
+                    nodestate->nCmpctTxFromMempool += tempBlock.GetMempoolCount();
                 }
             }
-             */
         } else {
             if (fAlreadyInFlight) {
                 // We requested this block, but its far into the future, so our
@@ -2920,6 +3119,14 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
             PartiallyDownloadedBlock& partialBlock = *it->second.second->partialBlock;
             ReadStatus status = partialBlock.FillBlock(*pblock, resp.txn);
+            CNodeState* nodestate = State(pfrom->GetId());
+            if (status == READ_STATUS_OK) {
+                nodestate->nCmpctBlocksReconstructed++;
+                nodestate->nCmpctTxFromMempool += partialBlock.GetMempoolCount();
+                nodestate->nCmpctTxRequested += resp.txn.size();
+            } else if (status == READ_STATUS_FAILED) {
+                nodestate->nCmpctBlocksFailed++;
+            }
             if (status == READ_STATUS_INVALID) {
                 MarkBlockAsReceived(resp.blockhash); // Reset in-flight state in case of whitelist
                 Misbehaving(pfrom->GetId(), 100, strprintf("Peer %d sent us invalid compact block/non-matching block transactions\n", pfrom->GetId()));
@@ -3317,6 +3524,59 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman* connman, bool en
     return false;
 }
 
+int nTxVerifyThreads = 0;
+int64_t nMaxValidationWasteMicros = DEFAULT_MAX_VALIDATION_WASTE * 1000;
+
+static boost::mutex g_txverify_mutex;
+static boost::condition_variable g_txverify_cond;
+static std::deque<std::shared_ptr<CTxPreVerifyJob>> g_txverify_queue;
+
+static void QueueTxPreVerify(const std::shared_ptr<CTxPreVerifyJob>& job)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(g_txverify_mutex);
+        g_txverify_queue.push_back(job);
+    }
+    g_txverify_cond.notify_one();
+}
+
+void ThreadTxPreVerify()
+{
+    RenameThread("veil-txverify");
+    while (true) {
+        std::shared_ptr<CTxPreVerifyJob> job;
+        {
+            boost::unique_lock<boost::mutex> lock(g_txverify_mutex);
+            while (g_txverify_queue.empty())
+                g_txverify_cond.wait(lock);
+            job = std::move(g_txverify_queue.front());
+            g_txverify_queue.pop_front();
+        }
+
+        const int64_t nCPUStart = GetThreadCPUTimeMicros();
+        try {
+            CTransactionRef ptx;
+            job->vRecv >> ptx;
+            // Only warms the proof caches; AcceptToMemoryPool reaches the verdict
+            CValidationState state;
+            if (!mempool.exists(ptx->GetHash()))
+                VerifyTxProofs(*ptx, state);
+        } catch (const std::exception& e) {
+            // Malformed messages are reported by the message handler
+        }
+
+        job->nCPUMicros = GetThreadCPUTimeMicros() - nCPUStart;
+        job->fDone = true;
+        if (g_connman)
+            g_connman->WakeMessageHandler();
+    }
+}
+
+static bool IsTxCommand(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::TX || strCommand == NetMsgType::TX_DAND;
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3343,11 +3603,33 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     if (pfrom->fPauseSend)
         return false;
 
+    // A tx still on the tx verify threads holds up this peer only, messages
+    // of the other peers are processed meanwhile
+    bool fPreVerified = false;
+    int64_t nPreVerifyMicros = 0;
+    if (pfrom->pTxPreVerify) {
+        if (!pfrom->pTxPreVerify->fDone)
+            return false;
+        nPreVerifyMicros = pfrom->pTxPreVerify->nCPUMicros;
+        pfrom->pTxPreVerify.reset();
+        fPreVerified = true;
+    }
+
     std::list<CNetMessage> msgs;
-    {
+    if (fPreVerified) {
+        msgs.swap(pfrom->vTxPreVerifyMsg);
+        LOCK(pfrom->cs_vProcessMsg);
+        fMoreWork = !pfrom->vProcessMsg.empty();
+    } else {
         LOCK(pfrom->cs_vProcessMsg);
         if (pfrom->vProcessMsg.empty())
             return false;
+        // Delay a peer that keeps costing us validation time for nothing. Its whole queue waits behind the tx,
+        // so that its messages are still processed in the order they were sent, and once the queue is full
+        // fPauseRecv stops reading from the peer until it is no longer throttled.
+        if (IsTxCommand(pfrom->vProcessMsg.front().hdr.GetCommand()) && !pfrom->fWhitelisted &&
+            pfrom->IsValidationThrottled(nMaxValidationWasteMicros))
+            return false;
         // Just take one message
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
@@ -3388,8 +3670,21 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return fMoreWork;
     }
 
+    // Hand relayed transactions to the tx verify threads first, so that their
+    // proofs do not hold up blocks and headers from the other peers
+    if (!fPreVerified && nTxVerifyThreads > 0 && IsTxCommand(strCommand)) {
+        pfrom->pTxPreVerify = std::make_shared<CTxPreVerifyJob>(vRecv);
+        pfrom->vTxPreVerifyMsg.swap(msgs);
+        QueueTxPreVerify(pfrom->pTxPreVerify);
+        return fMoreWork;
+    }
+
     // Process message
     bool fRet = false;
+    const bool fTxMessage = IsTxCommand(strCommand);
+    pfrom->fLastTxUseful = false;
+    pfrom->hashLastTxOrphan.SetNull();
+    const int64_t nCPUStart = GetThreadCPUTimeMicros();
     try
     {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
@@ -3428,6 +3723,12 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     } catch (...) {
         PrintExceptionContinue(nullptr, "ProcessMessages()");
     }
+    // A tx kept as orphan is neither useful nor wasted until we know whether it gets accepted
+    const int64_t nCPUMicros = GetThreadCPUTimeMicros() - nCPUStart + nPreVerifyMicros;
+    const bool fOrphaned = !pfrom->hashLastTxOrphan.IsNull();
+    pfrom->RecordMessageCost(strCommand, nCPUMicros, fTxMessage && !fOrphaned, pfrom->fLastTxUseful);
+    if (fOrphaned)
+        SetOrphanTxCost(pfrom->hashLastTxOrphan, nCPUMicros);
 
     if (!fRet) {
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
@@ -4217,5 +4518,7 @@ public:
         // orphan transactions
         mapOrphanTransactions.clear();
         mapOrphanTransactionsByPrev.clear();
+        mapAnonOrphanTransactions.clear();
+        mapAnonOrphansByIndex.clear();
     }
 } instance_of_cnetprocessingcleanup;
@@ -16,6 +16,39 @@ static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
 /** Default for BIP61 (sending reject messages) */
 static constexpr bool DEFAULT_ENABLE_BIP61 = true;
+/** Maximum number of threads checking relayed transactions ahead of the message handler */
+static const int MAX_TXVERIFY_THREADS = 16;
+/** -txverifythreads default (0 = leave the checks to the message handler) */
+static const int DEFAULT_TXVERIFY_THREADS = 2;
+
+/** Number of threads started for -txverifythreads; set before they start */
+extern int nTxVerifyThreads;
+/** -maxvalidationwaste default, in milliseconds */
+static const int64_t DEFAULT_MAX_VALIDATION_WASTE = 2000;
+/**
+ * Validation time a peer's transactions may recently have wasted, beyond the time its useful
+ * transactions took, before its further transactions are delayed; 0 disables the limit
+ */
+extern int64_t nMaxValidationWasteMicros;
+
+/**
+ * A tx message whose expensive, context-free checks run on a tx verify thread, so
+ * that the message handler goes on with the other peers meanwhile. The message
+ * itself is processed as usual once the job is done, and finds the proofs
+ * verified in the caches (see VerifyTxProofs).
+ */
+struct CTxPreVerifyJob
+{
+    CDataStream vRecv;
+    //! CPU time the checks took, set before fDone
+    int64_t nCPUMicros;
+    std::atomic<bool> fDone;
+
+    explicit CTxPreVerifyJob(const CDataStream& vRecvIn) : vRecv(vRecvIn), nCPUMicros(0), fDone(false) {}
+};
+
+/** Run the checks of queued tx messages; one per -txverifythreads */
+void ThreadTxPreVerify();
 
 class PeerLogicValidation final : public CValidationInterface, public NetEventsInterface {
 private:
@@ -79,6 +112,10 @@ struct CNodeStateStats {
     int nSyncHeight = -1;
     int nCommonHeight = -1;
     std::vector<int> vHeightInFlight;
+    uint64_t nCmpctBlocksReconstructed = 0;
+    uint64_t nCmpctBlocksFailed = 0;
+    uint64_t nCmpctTxFromMempool = 0;
+    uint64_t nCmpctTxRequested = 0;
 };
 
 /** Get statistics from node state */
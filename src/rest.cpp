@@ -7,6 +7,7 @@
 #include <chainparams.h>
 #include <core_io.h>
 #include <index/txindex.h>
+#include <libzerocoin/bignum.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <validation.h>
@@ -15,15 +16,19 @@
 #include <rpc/server.h>
 #include <streams.h>
 #include <sync.h>
+#include <txdb.h>
 #include <txmempool.h>
 #include <utilstrencodings.h>
 #include <version.h>
 
+#include <limits>
+
 #include <boost/algorithm/string.hpp>
 
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const int MAX_REST_DB_RECORDS = 2000; //allow a max of 2000 database records to be queried at once
 
 enum class RetFormat {
     UNDEF,
@@ -577,6 +582,267 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     }
 }
 
+/** Reply with a binary response in the requested format, .bin or .hex */
+static bool WriteBinaryReply(HTTPRequest* req, RetFormat rf, const CDataStream& ss)
+{
+    switch (rf) {
+    case RetFormat::BINARY: {
+        std::string strBinary = ss.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, strBinary);
+        return true;
+    }
+    case RetFormat::HEX: {
+        std::string strHex = HexStr(ss.begin(), ss.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+    }
+    }
+}
+
+/**
+ * Append up to nCount records of table chTable to ss, starting at the current position of pcursor. Every record is
+ * written as it is stored, its key without the table prefix followed by its value.
+ */
+static void AppendDBRecords(CDBIterator* pcursor, char chTable, int nCount, CDataStream& ss)
+{
+    for (int n = 0; n < nCount && pcursor->Valid(); n++, pcursor->Next()) {
+        char chType;
+        if (!pcursor->GetKey(chType) || chType != chTable)
+            break;
+        pcursor->AppendKey(ss, 1);
+        pcursor->AppendValue(ss);
+    }
+}
+
+static bool ParseRecordCount(const std::string& str, int& nCount)
+{
+    return ParseInt32(str, &nCount) && nCount >= 1 && nCount <= MAX_REST_DB_RECORDS;
+}
+
+static bool rest_anonoutputs(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No index or count specified. Use /rest/anonoutputs/<index>/<count>.<ext>.");
+
+    int64_t nStart;
+    if (!ParseInt64(path[0], &nStart) || nStart < 0 || nStart > std::numeric_limits<int64_t>::max() - MAX_REST_DB_RECORDS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid index: " + path[0]);
+    int nCount;
+    if (!ParseRecordCount(path[1], nCount))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Count out of range: " + path[1]);
+
+    // The keys are little endian, so consecutive indexes are not next to each other in the database
+    CDataStream ssOutputs(SER_NETWORK, PROTOCOL_VERSION);
+    std::unique_ptr<CDBIterator> pcursor(pblocktree->NewIterator());
+    for (int n = 0; n < nCount; n++) {
+        const int64_t i = nStart + n;
+        const std::pair<char, int64_t> key(DB_RCTOUTPUT, i);
+        pcursor->Seek(key);
+        std::pair<char, int64_t> keyFound;
+        if (!pcursor->Valid() || !pcursor->GetKey(keyFound) || keyFound != key)
+            break;
+        ssOutputs << i;
+        pcursor->AppendValue(ssOutputs);
+    }
+
+    return WriteBinaryReply(req, rf, ssOutputs);
+}
+
+static bool rest_keyimages(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() < 1 || path.size() > 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No count specified. Use /rest/keyimages/<count>[/<keyimage>].<ext>.");
+
+    int nCount;
+    if (!ParseRecordCount(path[0], nCount))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Count out of range: " + path[0]);
+
+    std::unique_ptr<CDBIterator> pcursor(pblocktree->NewIterator());
+    if (path.size() == 2) {
+        if (!IsHex(path[1]) || path[1].size() != 66)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid key image: " + path[1]);
+        pcursor->Seek(std::make_pair(DB_RCTKEYIMAGE, CCmpPubKey(ParseHex(path[1]))));
+    } else {
+        pcursor->Seek(DB_RCTKEYIMAGE);
+    }
+
+    CDataStream ssKeyImages(SER_NETWORK, PROTOCOL_VERSION);
+    AppendDBRecords(pcursor.get(), DB_RCTKEYIMAGE, nCount, ssKeyImages);
+    return WriteBinaryReply(req, rf, ssKeyImages);
+}
+
+static bool rest_zerocoin_records(HTTPRequest* req, const std::string& strURIPart, char chTable)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() < 1 || path.size() > 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No count specified. Use /rest/zerocoin<mints|spends>/<count>[/<hash>].<ext>.");
+
+    int nCount;
+    if (!ParseRecordCount(path[0], nCount))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Count out of range: " + path[0]);
+
+    uint256 hashStart;
+    if (path.size() == 2 && !ParseHashStr(path[1], hashStart))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + path[1]);
+
+    std::unique_ptr<CDBIterator> pcursor(pzerocoinDB->NewIterator());
+    pcursor->Seek(std::make_pair(chTable, hashStart));
+
+    CDataStream ssRecords(SER_NETWORK, PROTOCOL_VERSION);
+    AppendDBRecords(pcursor.get(), chTable, nCount, ssRecords);
+    return WriteBinaryReply(req, rf, ssRecords);
+}
+
+static bool rest_zerocoinmints(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_zerocoin_records(req, strURIPart, 'm');
+}
+
+static bool rest_zerocoinspends(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_zerocoin_records(req, strURIPart, DB_COINSPEND);
+}
+
+static bool rest_accumulators(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No height or count specified. Use /rest/accumulators/<height>/<count>.<ext>.");
+
+    int nStart;
+    if (!ParseInt32(path[0], &nStart) || nStart < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + path[0]);
+    int nCount;
+    if (!ParseRecordCount(path[1], nCount))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Count out of range: " + path[1]);
+
+    std::vector<std::pair<uint256, std::map<libzerocoin::CoinDenomination, uint256>>> vCheckpoints;
+    {
+        LOCK(cs_main);
+        for (int n = 0; n < nCount && n <= chainActive.Height() - nStart; n++) {
+            const CBlockIndex* pindex = chainActive[nStart + n];
+            vCheckpoints.emplace_back(pindex->GetBlockHash(), pindex->GetAccumulatorHashes());
+        }
+    }
+
+    CDataStream ssCheckpoints(SER_NETWORK, PROTOCOL_VERSION);
+    std::unique_ptr<CDBIterator> pcursor(pzerocoinDB->NewIterator());
+    for (size_t i = 0; i < vCheckpoints.size(); i++) {
+        ssCheckpoints << (int32_t)(nStart + i) << vCheckpoints[i].first;
+        for (const auto& denom : vCheckpoints[i].second) {
+            ssCheckpoints << (int32_t)denom.first << denom.second;
+            const std::pair<char, uint256> key('2', denom.second);
+            pcursor->Seek(key);
+            std::pair<char, uint256> keyFound;
+            if (pcursor->Valid() && pcursor->GetKey(keyFound) && keyFound == key)
+                pcursor->AppendValue(ssCheckpoints);
+            else
+                ssCheckpoints << CBigNum(0);
+        }
+    }
+
+    return WriteBinaryReply(req, rf, ssCheckpoints);
+}
+
+/** Escape a Prometheus label value */
+static std::string PrometheusLabel(const std::string& str)
+{
+    std::string ret;
+    for (char c : str) {
+        if (c == '\\' || c == '"')
+            ret += '\\';
+        if (c == '\n') {
+            ret += "\\n";
+            continue;
+        }
+        ret += c;
+    }
+    return ret;
+}
+
+/** The getperfstats counters in the Prometheus text format, times in seconds */
+static bool rest_metrics(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!strURIPart.empty())
+        return RESTERR(req, HTTP_NOT_FOUND, "metrics take no arguments");
+
+    std::string strMetrics;
+    strMetrics += "# HELP veil_rpc_duration_seconds Duration of RPC calls\n";
+    strMetrics += "# TYPE veil_rpc_duration_seconds histogram\n";
+    std::string strErrors = "# HELP veil_rpc_errors_total RPC calls that returned an error\n"
+                            "# TYPE veil_rpc_errors_total counter\n";
+    for (const auto& method : GetRPCStats()) {
+        const std::string strMethod = PrometheusLabel(method.first);
+        const CRPCMethodStats& stats = method.second;
+        uint64_t nCumulative = 0;
+        for (size_t i = 0; i < RPC_LATENCY_BUCKET_COUNT; i++) {
+            nCumulative += stats.vBuckets[i];
+            std::string strBound = i + 1 < RPC_LATENCY_BUCKET_COUNT ? strprintf("%g", RPC_LATENCY_BUCKETS[i] / 1e6) : "+Inf";
+            strMetrics += strprintf("veil_rpc_duration_seconds_bucket{method=\"%s\",le=\"%s\"} %u\n", strMethod, strBound, nCumulative);
+        }
+        strMetrics += strprintf("veil_rpc_duration_seconds_sum{method=\"%s\"} %f\n", strMethod, stats.nTotalMicros / 1e6);
+        strMetrics += strprintf("veil_rpc_duration_seconds_count{method=\"%s\"} %u\n", strMethod, stats.nCalls);
+        strErrors += strprintf("veil_rpc_errors_total{method=\"%s\"} %u\n", strMethod, stats.nErrors);
+    }
+    strMetrics += strErrors;
+
+    // Lock sites only appear while -lockstats is on; label them like getperfstats groups them
+    std::string strCount = "# HELP veil_lock_acquired_total Times a LOCK site took its mutex\n"
+                           "# TYPE veil_lock_acquired_total counter\n";
+    std::string strContended = "# HELP veil_lock_contended_total Times a LOCK site found its mutex held by another thread\n"
+                               "# TYPE veil_lock_contended_total counter\n";
+    std::string strWait = "# HELP veil_lock_wait_seconds_total Time a LOCK site waited for its mutex\n"
+                          "# TYPE veil_lock_wait_seconds_total counter\n";
+    std::string strHold = "# HELP veil_lock_hold_seconds_total Time a LOCK site held its mutex\n"
+                          "# TYPE veil_lock_hold_seconds_total counter\n";
+    for (const CLockSiteStats& site : GetLockStats()) {
+        std::string strName = site.strName;
+        if (strName.compare(0, 2, "::") == 0)
+            strName = strName.substr(2);
+        const std::string strLabels = strprintf("lock=\"%s\",site=\"%s:%d\"", PrometheusLabel(strName), PrometheusLabel(site.strFile), site.nLine);
+        strCount += strprintf("veil_lock_acquired_total{%s} %u\n", strLabels, site.nCount);
+        strContended += strprintf("veil_lock_contended_total{%s} %u\n", strLabels, site.nContended);
+        strWait += strprintf("veil_lock_wait_seconds_total{%s} %f\n", strLabels, site.nWaitMicros / 1e6);
+        strHold += strprintf("veil_lock_hold_seconds_total{%s} %f\n", strLabels, site.nHoldMicros / 1e6);
+    }
+    strMetrics += strCount + strContended + strWait + strHold;
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, strMetrics);
+    return true;
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -589,6 +855,12 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/anonoutputs/", rest_anonoutputs},
+      {"/rest/keyimages/", rest_keyimages},
+      {"/rest/zerocoinmints/", rest_zerocoinmints},
+      {"/rest/zerocoinspends/", rest_zerocoinspends},
+      {"/rest/accumulators/", rest_accumulators},
+      {"/rest/metrics", rest_metrics},
 };
 
 bool StartREST()
@@ -9,8 +9,10 @@
 
 #include <amount.h>
 #include <base58.h>
+#include <blockperf.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <chainsnapshot.h>
 #include <checkpoints.h>
 #include <coins.h>
 #include <consensus/validation.h>
@@ -22,6 +24,7 @@
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <script/descriptor.h>
 #include <streams.h>
 #include <sync.h>
@@ -160,6 +163,27 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     return result;
 }
 
+void blockToJSONStream(const UniValue& objBlock, const CBlock& block, CJSONStreamWriter& stream)
+{
+    const std::vector<std::string>& keys = objBlock.getKeys();
+    stream.BeginObject();
+    for (size_t i = 0; i < keys.size(); i++) {
+        stream.Key(keys[i]);
+        if (keys[i] != "tx") {
+            stream.Value(objBlock[i]);
+            continue;
+        }
+        stream.BeginArray();
+        for (const auto& tx : block.vtx) {
+            UniValue objTx(UniValue::VOBJ);
+            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
+            stream.Value(objTx);
+        }
+        stream.EndArray();
+    }
+    stream.EndObject();
+}
+
 static UniValue getblockcount(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -435,9 +459,31 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCK
     info.pushKV("spentby", spent);
 }
 
-UniValue mempoolToJSON(bool fVerbose)
+UniValue mempoolToJSON(bool fVerbose, CJSONStreamWriter* stream)
 {
-    if (fVerbose)
+    if (fVerbose && stream)
+    {
+        // The mempool must not wait for the client to read, so the entries are looked up one at a time
+        std::vector<uint256> vtxid;
+        mempool.queryHashes(vtxid);
+        stream->BeginObject();
+        for (const uint256& hash : vtxid)
+        {
+            UniValue info(UniValue::VOBJ);
+            {
+                LOCK(mempool.cs);
+                auto it = mempool.mapTx.find(hash);
+                if (it == mempool.mapTx.end())
+                    continue;
+                entryToJSON(info, *it);
+            }
+            stream->Key(hash.ToString());
+            stream->Value(info);
+        }
+        stream->EndObject();
+        return NullUniValue;
+    }
+    else if (fVerbose)
     {
         LOCK(mempool.cs);
         UniValue o(UniValue::VOBJ);
@@ -492,7 +538,8 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
-    return mempoolToJSON(fVerbose);
+    // The verbose result grows with the mempool, so it is sent while it is produced
+    return mempoolToJSON(fVerbose, fVerbose ? request.StartResultStream() : nullptr);
 }
 
 static UniValue getmempoolancestors(const JSONRPCRequest& request)
@@ -811,35 +858,48 @@ static UniValue getblock(const JSONRPCRequest& request)
             + HelpExampleRpc("getblock", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
+    CBlock block;
+    CJSONStreamWriter* stream;
+    UniValue objBlock;
+    {
+        LOCK(cs_main);
 
-    std::string strHash = request.params[0].get_str();
-    uint256 hash(uint256S(strHash));
+        std::string strHash = request.params[0].get_str();
+        uint256 hash(uint256S(strHash));
 
-    int verbosity = 1;
-    if (!request.params[1].isNull()) {
-        if(request.params[1].isNum())
-            verbosity = request.params[1].get_int();
-        else
-            verbosity = request.params[1].get_bool() ? 1 : 0;
-    }
+        int verbosity = 1;
+        if (!request.params[1].isNull()) {
+            if(request.params[1].isNum())
+                verbosity = request.params[1].get_int();
+            else
+                verbosity = request.params[1].get_bool() ? 1 : 0;
+        }
 
-    const CBlockIndex* pblockindex = LookupBlockIndex(hash);
-    if (!pblockindex) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-    }
+        const CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
 
-    const CBlock block = GetBlockChecked(pblockindex);
+        block = GetBlockChecked(pblockindex);
 
-    if (verbosity <= 0)
-    {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        if (verbosity <= 0)
+        {
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+            ssBlock << block;
+            std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+            return strHex;
+        }
+
+        // With all transactions decoded the result is many times the size of the block, send it while it is produced
+        stream = verbosity >= 2 ? request.StartResultStream() : nullptr;
+        if (!stream)
+            return blockToJSON(block, pblockindex, verbosity >= 2);
+        objBlock = blockToJSON(block, pblockindex);
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    // The client may read slowly, so the transactions are written without cs_main
+    blockToJSONStream(objBlock, block, *stream);
+    return NullUniValue;
 }
 
 struct CCoinsStats
@@ -1953,6 +2013,82 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue BlockPerfToJSON(const CBlockPerf& perf)
+{
+    UniValue phases(UniValue::VOBJ);
+    for (int i = 0; i < (int)BlockPerfPhase::COUNT; i++) {
+        if (!perf.vCount[i])
+            continue;
+        UniValue phase(UniValue::VOBJ);
+        phase.pushKV("time_us", perf.vTimeMicros[i]);
+        phase.pushKV("count", (uint64_t)perf.vCount[i]);
+        phases.pushKV(BlockPerfPhaseName((BlockPerfPhase)i), phase);
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("hash", perf.hash.GetHex());
+    ret.pushKV("height", perf.nHeight);
+    ret.pushKV("phases", phases);
+    return ret;
+}
+
+static UniValue getblockperf(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2) {
+        throw std::runtime_error(
+            "getblockperf ( hash_or_height count )\n"
+            "\nReturns the time spent in the phases of validating a block, for the last " + std::to_string(MAX_BLOCK_PERF_ENTRIES) + " blocks\n"
+            "this node validated. Phases nest, e.g. mlsag is part of inputs which is part of connect_block.\n"
+            "\nArguments:\n"
+            "1. \"hash_or_height\"     (string or numeric, optional) The block hash, or height in the active chain. Without it\n"
+            "                         the most recently validated blocks are returned.\n"
+            "2. count                (numeric, optional, default=10) The number of recent blocks to return\n"
+            "\nResult:\n"
+            "{                           (json object, or array of them for the recent blocks)\n"
+            "  \"hash\": \"hash\",          (string) The block hash\n"
+            "  \"height\": xxxxx,         (numeric) The height of the block, -1 if it was not connected\n"
+            "  \"phases\": {\n"
+            "    \"phase\": {             (json object) One of check_block, rangeproof, stake, connect_block, inputs, mlsag,\n"
+            "                              zerocoin_spend, zerocoin_mint, pofn, accumulator_checkpoint, script_wait,\n"
+            "                              rct_index, undo_write; only the phases the block went through\n"
+            "      \"time_us\": xxxxx,     (numeric) Time spent in the phase\n"
+            "      \"count\": xxxxx        (numeric) Number of times the phase ran, e.g. the number of MLSAG signatures\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockperf", "1000")
+            + HelpExampleCli("getblockperf", "")
+            + HelpExampleRpc("getblockperf", "1000")
+        );
+    }
+
+    if (request.params[0].isNull()) {
+        int nCount = request.params[1].isNull() ? 10 : request.params[1].get_int();
+        if (nCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+        UniValue ret(UniValue::VARR);
+        for (const CBlockPerf& perf : GetRecentBlockPerf(nCount))
+            ret.push_back(BlockPerfToJSON(perf));
+        return ret;
+    }
+
+    uint256 hash;
+    if (request.params[0].isNum()) {
+        LOCK(cs_main);
+        const int height = request.params[0].get_int();
+        if (height < 0 || height > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        hash = chainActive[height]->GetBlockHash();
+    } else {
+        hash = ParseHashV(request.params[0], "hash_or_height");
+    }
+
+    CBlockPerf perf;
+    if (!GetBlockPerf(hash, perf))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No timings recorded for this block");
+    return BlockPerfToJSON(perf);
+}
+
 static UniValue savemempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0) {
@@ -1976,6 +2112,56 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue dumpchainstate(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        throw std::runtime_error(
+            "dumpchainstate \"filename\"\n"
+            "\nWrites a snapshot of the chainstate at the current tip: the UTXO set, the block index, the RingCT\n"
+            "output and key image index and the zerocoin database. Start a node with an empty data directory and\n"
+            "-loadchainstate=<filename> -loadchainstatehash=<hash> to continue from it without the initial block download.\n"
+            "That node checks the header chain of the snapshot but trusts its UTXO set through the hash.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"filename\"    (string, required) The snapshot file, relative to the data directory if not absolute\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filename\": \"path\",         (string) The absolute path of the snapshot\n"
+            "  \"height\": n,                (numeric) The height of the block the snapshot was taken at\n"
+            "  \"bestblock\": \"hex\",         (string) The hash of that block\n"
+            "  \"coins\": n,                 (numeric) The number of unspent transaction outputs\n"
+            "  \"blocktree_records\": n,     (numeric) The number of block index and RingCT records\n"
+            "  \"zerocoin_records\": n,      (numeric) The number of zerocoin records\n"
+            "  \"hash\": \"hex\"               (string) The hash of the snapshot, which the loading node checks\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumpchainstate", "\"chainstate.snapshot\"")
+            + HelpExampleRpc("dumpchainstate", "\"chainstate.snapshot\"")
+        );
+    }
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+
+    CChainSnapshotInfo info;
+    std::string strError;
+    if (!DumpChainstateSnapshot(path, info, strError)) {
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filename", path.string());
+    ret.pushKV("height", info.header.nHeight);
+    ret.pushKV("bestblock", info.header.hashBlock.GetHex());
+    ret.pushKV("coins", (uint64_t)info.nCoins);
+    ret.pushKV("blocktree_records", (uint64_t)info.nBlockTreeRecords);
+    ret.pushKV("zerocoin_records", (uint64_t)info.nZerocoinRecords);
+    ret.pushKV("hash", info.hash.GetHex());
+    return ret;
+}
+
 //! Search for a given set of pubkey scripts
 bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
     scan_progress = 0;
@@ -2229,6 +2415,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
     { "blockchain",         "getblockstats",          &getblockstats,          {"hash_or_height", "stats"} },
+    { "blockchain",         "getblockperf",           &getblockperf,           {"hash_or_height", "count"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
@@ -2243,6 +2430,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "dumpchainstate",         &dumpchainstate,         {"filename"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
@@ -11,6 +11,7 @@
 
 class CBlock;
 class CBlockIndex;
+class CJSONStreamWriter;
 class UniValue;
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
@@ -30,11 +31,20 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 
+/**
+ * Write the description of a block with its transactions decoded to stream, one transaction at a
+ * time. objBlock is the blockToJSON result without txDetails. Does not need cs_main.
+ */
+void blockToJSONStream(const UniValue& objBlock, const CBlock& block, CJSONStreamWriter& stream);
+
 /** Mempool information to JSON */
 UniValue mempoolInfoToJSON();
 
-/** Mempool to JSON */
-UniValue mempoolToJSON(bool fVerbose = false);
+/**
+ * Mempool to JSON. With a stream the entries are written there and NullUniValue is returned,
+ * mempool.cs is then only held while an entry is looked up.
+ */
+UniValue mempoolToJSON(bool fVerbose = false, CJSONStreamWriter* stream = nullptr);
 
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
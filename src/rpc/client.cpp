@@ -144,6 +144,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "verifychain", 1, "nblocks" },
     { "getblockstats", 0, "hash_or_height" },
     { "getblockstats", 1, "stats" },
+    { "getblockperf", 0, "hash_or_height" },
+    { "getblockperf", 1, "count" },
     { "pruneblockchain", 0, "height" },
     { "keypoolrefill", 0, "newsize" },
     { "getrawmempool", 0, "verbose" },
@@ -160,6 +162,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "bumpfee", 1, "options" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
+    { "getperfstats", 0, "reset" },
+    { "getperfstats", 1, "lockstats" },
     { "disconnectnode", 1, "nodeid" },
     { "addwitnessaddress", 1, "p2sh" },
     // Echo with conversion (For testing only)
@@ -196,6 +200,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "searchdeterministiczerocoin", 2, "threads"},
     { "spendzerocoinmints", 0, "mints_list"},
     { "abandontransaction", 1, "remove_mempool"},
+    { "compactanonwallet", 0, "mindepth"},
 };
 
 class CRPCConvertTable
@@ -356,6 +356,136 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+static UniValue getperfstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        throw std::runtime_error(
+            "getperfstats ( reset lockstats )\n"
+            "Returns the latency of the RPC methods called since startup, and how long locks were\n"
+            "waited for and held while lock statistics were recorded (-lockstats).\n"
+            "\nArguments:\n"
+            "1. reset        (boolean, optional, default=false) Clear the statistics after returning them\n"
+            "2. lockstats    (boolean, optional) Start or stop recording lock statistics\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"latency_buckets_us\": [n,...], (array) Upper bounds of the histogram buckets, the last bucket has none\n"
+            "  \"rpc\": {\n"
+            "    \"method\": {\n"
+            "      \"calls\": n,                (numeric) Number of calls\n"
+            "      \"errors\": n,               (numeric) Number of calls that returned an error\n"
+            "      \"total_us\": n,             (numeric) Time spent in the method\n"
+            "      \"max_us\": n,               (numeric) Longest call\n"
+            "      \"histogram\": [n,...]       (array) Calls per latency bucket\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"lockstats\": true|false,       (boolean) Whether lock statistics are being recorded\n"
+            "  \"locks\": {\n"
+            "    \"name\": {                    (json object) All sites locking the same expression, e.g. cs_main\n"
+            "      \"count\": n,                (numeric) Number of times the lock was taken\n"
+            "      \"contended\": n,            (numeric) Number of times another thread held it\n"
+            "      \"wait_us\": n,              (numeric) Time spent waiting for it\n"
+            "      \"max_wait_us\": n,          (numeric) Longest wait\n"
+            "      \"hold_us\": n,              (numeric) Time it was held\n"
+            "      \"max_hold_us\": n,          (numeric) Longest hold\n"
+            "      \"holders\": [               (array) The sites that held it longest\n"
+            "        {\n"
+            "          \"site\": \"file:line\",   (string) The LOCK or TRY_LOCK\n"
+            "          \"count\": n, \"contended\": n, \"wait_us\": n, \"hold_us\": n, \"max_hold_us\": n\n"
+            "        }, ...\n"
+            "      ]\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getperfstats", "")
+            + HelpExampleCli("getperfstats", "true true")
+            + HelpExampleRpc("getperfstats", "")
+        );
+
+    bool fReset = !request.params[0].isNull() && request.params[0].get_bool();
+
+    UniValue buckets(UniValue::VARR);
+    for (size_t i = 0; i < RPC_LATENCY_BUCKET_COUNT - 1; i++)
+        buckets.push_back(RPC_LATENCY_BUCKETS[i]);
+
+    UniValue rpc(UniValue::VOBJ);
+    for (const auto& method : GetRPCStats()) {
+        const CRPCMethodStats& stats = method.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("calls", stats.nCalls);
+        obj.pushKV("errors", stats.nErrors);
+        obj.pushKV("total_us", stats.nTotalMicros);
+        obj.pushKV("max_us", stats.nMaxMicros);
+        UniValue histogram(UniValue::VARR);
+        for (size_t i = 0; i < RPC_LATENCY_BUCKET_COUNT; i++)
+            histogram.push_back(stats.vBuckets[i]);
+        obj.pushKV("histogram", histogram);
+        rpc.pushKV(method.first, obj);
+    }
+
+    // Group the sites by the locked expression, leaving out the scope so that ::cs_main and cs_main are one
+    std::map<std::string, std::vector<CLockSiteStats>> mapLocks;
+    for (const CLockSiteStats& site : GetLockStats()) {
+        std::string strName = site.strName;
+        if (strName.compare(0, 2, "::") == 0)
+            strName = strName.substr(2);
+        mapLocks[strName].push_back(site);
+    }
+
+    static const size_t MAX_LOCK_HOLDERS = 5;
+    UniValue locks(UniValue::VOBJ);
+    for (auto& lock : mapLocks) {
+        std::vector<CLockSiteStats>& vSites = lock.second;
+        std::sort(vSites.begin(), vSites.end(), [](const CLockSiteStats& a, const CLockSiteStats& b) {
+            return a.nHoldMicros > b.nHoldMicros;
+        });
+        uint64_t nCount = 0, nContended = 0;
+        int64_t nWait = 0, nMaxWait = 0, nHold = 0, nMaxHold = 0;
+        UniValue holders(UniValue::VARR);
+        for (const CLockSiteStats& site : vSites) {
+            nCount += site.nCount;
+            nContended += site.nContended;
+            nWait += site.nWaitMicros;
+            nMaxWait = std::max(nMaxWait, site.nMaxWaitMicros);
+            nHold += site.nHoldMicros;
+            nMaxHold = std::max(nMaxHold, site.nMaxHoldMicros);
+            if (holders.size() < MAX_LOCK_HOLDERS) {
+                UniValue holder(UniValue::VOBJ);
+                holder.pushKV("site", strprintf("%s:%d", site.strFile, site.nLine));
+                holder.pushKV("count", site.nCount);
+                holder.pushKV("contended", site.nContended);
+                holder.pushKV("wait_us", site.nWaitMicros);
+                holder.pushKV("hold_us", site.nHoldMicros);
+                holder.pushKV("max_hold_us", site.nMaxHoldMicros);
+                holders.push_back(holder);
+            }
+        }
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("count", nCount);
+        obj.pushKV("contended", nContended);
+        obj.pushKV("wait_us", nWait);
+        obj.pushKV("max_wait_us", nMaxWait);
+        obj.pushKV("hold_us", nHold);
+        obj.pushKV("max_hold_us", nMaxHold);
+        obj.pushKV("holders", holders);
+        locks.pushKV(lock.first, obj);
+    }
+
+    if (!request.params[1].isNull())
+        g_lock_stats = request.params[1].get_bool();
+    if (fReset) {
+        ResetRPCStats();
+        ResetLockStats();
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("latency_buckets_us", buckets);
+    result.pushKV("rpc", rpc);
+    result.pushKV("lockstats", g_lock_stats.load());
+    result.pushKV("locks", locks);
+    return result;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -473,6 +603,7 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "getperfstats",           &getperfstats,           {"reset", "lockstats"} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
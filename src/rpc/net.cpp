@@ -101,6 +101,12 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
             "    ],\n"
+            "    \"cmpctblocks\": {\n"
+            "       \"reconstructed\": n,       (numeric) Compact blocks from this peer that were reconstructed\n"
+            "       \"failed\": n,              (numeric) Compact blocks from this peer that had to be downloaded in full\n"
+            "       \"tx_from_mempool\": n,     (numeric) Transactions of reconstructed blocks found in the mempool\n"
+            "       \"tx_requested\": n         (numeric) Transactions of reconstructed blocks requested from the peer\n"
+            "    },\n"
             "    \"whitelisted\": true|false, (boolean) Whether the peer is whitelisted\n"
             "    \"bytessent_per_msg\": {\n"
             "       \"addr\": n,              (numeric) The total bytes sent aggregated by message type\n"
@@ -109,6 +115,23 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"bytesrecv_per_msg\": {\n"
             "       \"addr\": n,              (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
+            "    },\n"
+            "    \"msgssent_per_msg\": {\n"
+            "       \"addr\": n,              (numeric) The number of messages sent aggregated by message type\n"
+            "       ...\n"
+            "    },\n"
+            "    \"msgsrecv_per_msg\": {\n"
+            "       \"addr\": n,              (numeric) The number of messages received aggregated by message type\n"
+            "       ...\n"
+            "    },\n"
+            "    \"cputime_per_msg\": {\n"
+            "       \"addr\": n,              (numeric) The CPU time in seconds spent processing received messages aggregated by message type\n"
+            "       ...\n"
+            "    },\n"
+            "    \"validation\": {\n"
+            "       \"wasted\": n,            (numeric) Recent validation time in seconds of transactions we did not accept, decaying with a half-life of " + std::to_string(VALIDATION_COST_HALF_LIFE) + " seconds\n"
+            "       \"useful\": n,            (numeric) The same for transactions we accepted or kept as orphans\n"
+            "       \"throttled\": true|false (boolean) Whether transactions from this peer are being delayed, see -maxvalidationwaste\n"
             "    }\n"
             "  }\n"
             "  ,...\n"
@@ -167,6 +190,12 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
                 heights.push_back(height);
             }
             obj.pushKV("inflight", heights);
+            UniValue cmpctblocks(UniValue::VOBJ);
+            cmpctblocks.pushKV("reconstructed", statestats.nCmpctBlocksReconstructed);
+            cmpctblocks.pushKV("failed", statestats.nCmpctBlocksFailed);
+            cmpctblocks.pushKV("tx_from_mempool", statestats.nCmpctTxFromMempool);
+            cmpctblocks.pushKV("tx_requested", statestats.nCmpctTxRequested);
+            obj.pushKV("cmpctblocks", cmpctblocks);
         }
         obj.pushKV("whitelisted", stats.fWhitelisted);
 
@@ -184,6 +213,33 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.pushKV("bytesrecv_per_msg", recvPerMsgCmd);
 
+        UniValue sendMsgsPerMsgCmd(UniValue::VOBJ);
+        for (const mapMsgCmdSize::value_type &i : stats.mapSendMsgsPerMsgCmd) {
+            if (i.second > 0)
+                sendMsgsPerMsgCmd.pushKV(i.first, i.second);
+        }
+        obj.pushKV("msgssent_per_msg", sendMsgsPerMsgCmd);
+
+        UniValue recvMsgsPerMsgCmd(UniValue::VOBJ);
+        for (const mapMsgCmdSize::value_type &i : stats.mapRecvMsgsPerMsgCmd) {
+            if (i.second > 0)
+                recvMsgsPerMsgCmd.pushKV(i.first, i.second);
+        }
+        obj.pushKV("msgsrecv_per_msg", recvMsgsPerMsgCmd);
+
+        UniValue cpuPerMsgCmd(UniValue::VOBJ);
+        for (const mapMsgCmdSize::value_type &i : stats.mapRecvCPUMicrosPerMsgCmd) {
+            if (i.second > 0)
+                cpuPerMsgCmd.pushKV(i.first, i.second / 1e6);
+        }
+        obj.pushKV("cputime_per_msg", cpuPerMsgCmd);
+
+        UniValue validation(UniValue::VOBJ);
+        validation.pushKV("wasted", stats.dValidationWasted);
+        validation.pushKV("useful", stats.dValidationUseful);
+        validation.pushKV("throttled", stats.fValidationThrottled);
+        obj.pushKV("validation", validation);
+
         ret.push_back(obj);
     }
 
@@ -1145,6 +1145,12 @@ static UniValue sendrawtransaction(const JSONRPCRequest& request)
         nMaxRawTxFee = 0;
     bool fDandelion = request.params[2].isNull() ? true : request.params[2].get_bool();
 
+    // Verify the proofs before taking cs_main, AcceptToMemoryPool then finds them cached
+    if (!mempool.exists(hashTx)) {
+        CValidationState stateProofs;
+        VerifyTxProofs(*tx, stateProofs);
+    }
+
     { // cs_main scope
     LOCK(cs_main);
     CCoinsViewCache &view = *pcoinsTip;
@@ -1266,6 +1272,11 @@ static UniValue testmempoolaccept(const JSONRPCRequest& request)
     CValidationState state;
     bool missing_inputs;
     bool test_accept_res;
+    {
+        // Verify the proofs before taking cs_main, AcceptToMemoryPool then finds them cached
+        CValidationState stateProofs;
+        VerifyTxProofs(*tx, stateProofs);
+    }
     {
         LOCK(cs_main);
         test_accept_res = AcceptToMemoryPool(mempool, state, std::move(tx), &missing_inputs,
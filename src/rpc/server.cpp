@@ -471,6 +471,51 @@ static inline JSONRPCRequest transformNamedArguments(const JSONRPCRequest& in, c
     return out;
 }
 
+static CCriticalSection cs_rpcStats;
+static std::map<std::string, CRPCMethodStats> mapRPCStats GUARDED_BY(cs_rpcStats);
+
+/** Records the duration of an RPC call when it goes out of scope */
+class CRPCCallTimer
+{
+private:
+    const std::string& strMethod;
+    int64_t nStart;
+
+public:
+    bool fSuccess;
+
+    explicit CRPCCallTimer(const std::string& strMethodIn) : strMethod(strMethodIn), nStart(GetTimeMicros()), fSuccess(false) {}
+
+    ~CRPCCallTimer()
+    {
+        int64_t nMicros = GetTimeMicros() - nStart;
+        size_t nBucket = 0;
+        while (nBucket < RPC_LATENCY_BUCKET_COUNT - 1 && nMicros > RPC_LATENCY_BUCKETS[nBucket])
+            nBucket++;
+
+        LOCK(cs_rpcStats);
+        CRPCMethodStats& stats = mapRPCStats[strMethod];
+        stats.nCalls++;
+        if (!fSuccess)
+            stats.nErrors++;
+        stats.nTotalMicros += nMicros;
+        stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+        stats.vBuckets[nBucket]++;
+    }
+};
+
+std::map<std::string, CRPCMethodStats> GetRPCStats()
+{
+    LOCK(cs_rpcStats);
+    return mapRPCStats;
+}
+
+void ResetRPCStats()
+{
+    LOCK(cs_rpcStats);
+    mapRPCStats.clear();
+}
+
 UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 {
     // Return immediately if in warmup
@@ -487,14 +532,19 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    // Only registered methods are timed, so the table can not be filled with made up names
+    CRPCCallTimer timer(pcmd->name);
     try
     {
         // Execute, convert arguments to array if necessary
+        UniValue result;
         if (request.params.isObject()) {
-            return pcmd->actor(transformNamedArguments(request, pcmd->argNames));
+            result = pcmd->actor(transformNamedArguments(request, pcmd->argNames));
         } else {
-            return pcmd->actor(request);
+            result = pcmd->actor(request);
         }
+        timer.fSuccess = true;
+        return result;
     }
     catch (const std::exception& e)
     {
@@ -10,6 +10,7 @@
 #include <rpc/protocol.h>
 #include <uint256.h>
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
@@ -19,6 +20,7 @@
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
 
+class CJSONStreamWriter;
 class CRPCCommand;
 
 namespace RPCServer
@@ -46,9 +48,20 @@ public:
     std::string URI;
     std::string authUser;
     std::string peerAddr;
+    //! Set by callers that can send the result of the request as it is produced
+    std::function<CJSONStreamWriter*()> startResultStream;
 
     JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false) {}
     void parse(const UniValue& valRequest);
+
+    /**
+     * Start writing the result of the request to the caller. Returns nullptr if the
+     * caller cannot stream it, in which case the method returns the result as usual.
+     * Otherwise the method writes exactly one JSON value and returns NullUniValue.
+     * Nothing can be reported after this anymore, so all arguments must be checked
+     * before.
+     */
+    CJSONStreamWriter* StartResultStream() const { return startResultStream ? startResultStream() : nullptr; }
 };
 
 /** Query whether RPC is running */
@@ -185,6 +198,24 @@ bool IsDeprecatedRPCEnabled(const std::string& method);
 
 extern CRPCTable tableRPC;
 
+/** Upper bounds of the buckets of the RPC latency histograms, in microseconds; a last bucket takes the rest */
+static const int64_t RPC_LATENCY_BUCKETS[] = {1000, 10000, 100000, 1000000, 10000000};
+static const size_t RPC_LATENCY_BUCKET_COUNT = sizeof(RPC_LATENCY_BUCKETS) / sizeof(RPC_LATENCY_BUCKETS[0]) + 1;
+
+/** Calls of one RPC method, as recorded by CRPCTable::execute */
+struct CRPCMethodStats
+{
+    uint64_t nCalls = 0;
+    uint64_t nErrors = 0;
+    int64_t nTotalMicros = 0;
+    int64_t nMaxMicros = 0;
+    //! Calls per latency bucket, not cumulative
+    uint64_t vBuckets[RPC_LATENCY_BUCKET_COUNT] = {};
+};
+
+std::map<std::string, CRPCMethodStats> GetRPCStats();
+void ResetRPCStats();
+
 /**
  * Utilities: convert hex-encoded Values
  * (throws error if not hex).
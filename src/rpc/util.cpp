@@ -153,3 +153,77 @@ UniValue DescribeAddress(const CTxDestination& dest)
 {
     return boost::apply_visitor(DescribeAddressVisitor(), dest);
 }
+
+CJSONStreamWriter::CJSONStreamWriter(Sink sinkIn, size_t nFlushSizeIn) : sink(std::move(sinkIn)), nFlushSize(nFlushSizeIn), fAfterKey(false)
+{
+}
+
+void CJSONStreamWriter::Separator()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (vEmpty.empty())
+        return;
+    if (!vEmpty.back())
+        Append(",");
+    vEmpty.back() = false;
+}
+
+void CJSONStreamWriter::Append(const std::string& str)
+{
+    strBuffer += str;
+    if (strBuffer.size() >= nFlushSize)
+        Flush();
+}
+
+void CJSONStreamWriter::BeginObject()
+{
+    Separator();
+    vEmpty.push_back(true);
+    Append("{");
+}
+
+void CJSONStreamWriter::EndObject()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    Append("}");
+}
+
+void CJSONStreamWriter::BeginArray()
+{
+    Separator();
+    vEmpty.push_back(true);
+    Append("[");
+}
+
+void CJSONStreamWriter::EndArray()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    Append("]");
+}
+
+void CJSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    Separator();
+    Append(UniValue(key).write() + ":");
+    fAfterKey = true;
+}
+
+void CJSONStreamWriter::Value(const UniValue& value)
+{
+    Separator();
+    Append(value.write());
+}
+
+void CJSONStreamWriter::Flush()
+{
+    if (strBuffer.empty())
+        return;
+    sink(strBuffer);
+    strBuffer.clear();
+}
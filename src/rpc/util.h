@@ -11,6 +11,7 @@
 
 #include <boost/variant/static_visitor.hpp>
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -24,4 +25,41 @@ CScript CreateMultisigRedeemscript(const int required, const std::vector<CPubKey
 
 UniValue DescribeAddress(const CTxDestination& dest);
 
+/** Size the buffer of a CJSONStreamWriter grows to before it is handed to the sink */
+static const size_t JSON_STREAM_FLUSH_SIZE = 64 * 1024;
+
+/**
+ * Writes a JSON document piecewise, so that large RPC results do not have to be
+ * built as one UniValue. The text is collected in a buffer that is passed to the
+ * sink whenever it grows past nFlushSize, and on Flush.
+ */
+class CJSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+    explicit CJSONStreamWriter(Sink sinkIn, size_t nFlushSizeIn = JSON_STREAM_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    //! Write the key of the next object member, to be followed by its value
+    void Key(const std::string& key);
+    //! Write a complete value: an array element, an object member after Key or the whole document
+    void Value(const UniValue& value);
+    void Flush();
+
+private:
+    Sink sink;
+    size_t nFlushSize;
+    std::string strBuffer;
+    //! For every open object or array, whether nothing was written into it yet
+    std::vector<bool> vEmpty;
+    bool fAfterKey;
+
+    void Separator();
+    void Append(const std::string& str);
+};
+
 #endif // BITCOIN_RPC_UTIL_H
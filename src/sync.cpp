@@ -9,10 +9,73 @@
 
 #include <stdio.h>
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
 
+std::atomic<bool> g_lock_stats(DEFAULT_LOCK_STATS);
+
+namespace {
+/**
+ * Keyed by site rather than by mutex, as per-peer and per-wallet mutexes come and go.
+ * __FILE__ is the same literal every time a site locks.
+ */
+typedef std::pair<const char*, int> LockSiteKey;
+
+struct LockStatsData {
+    std::mutex mutex;
+    std::map<LockSiteKey, CLockSiteStats> sites;
+};
+
+LockStatsData& GetLockStatsData()
+{
+    // Never destroyed: locks can still be released by global destructors
+    static LockStatsData* data = new LockStatsData();
+    return *data;
+}
+} // namespace
+
+void RecordLockUsage(const char* pszName, const char* pszFile, int nLine, bool fContended, int64_t nWaitMicros, int64_t nHoldMicros)
+{
+    LockStatsData& data = GetLockStatsData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    auto it = data.sites.find(LockSiteKey(pszFile, nLine));
+    if (it == data.sites.end()) {
+        CLockSiteStats site;
+        site.strName = pszName;
+        site.strFile = pszFile;
+        site.nLine = nLine;
+        it = data.sites.emplace(LockSiteKey(pszFile, nLine), site).first;
+    }
+    CLockSiteStats& site = it->second;
+    site.nCount++;
+    if (fContended)
+        site.nContended++;
+    site.nWaitMicros += nWaitMicros;
+    site.nMaxWaitMicros = std::max(site.nMaxWaitMicros, nWaitMicros);
+    site.nHoldMicros += nHoldMicros;
+    site.nMaxHoldMicros = std::max(site.nMaxHoldMicros, nHoldMicros);
+}
+
+std::vector<CLockSiteStats> GetLockStats()
+{
+    LockStatsData& data = GetLockStatsData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    std::vector<CLockSiteStats> vSites;
+    vSites.reserve(data.sites.size());
+    for (const auto& entry : data.sites)
+        vSites.push_back(entry.second);
+    return vSites;
+}
+
+void ResetLockStats()
+{
+    LockStatsData& data = GetLockStatsData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    data.sites.clear();
+}
+
 #ifdef DEBUG_LOCKCONTENTION
 #if !defined(HAVE_THREAD_LOCAL)
 static_assert(false, "thread_local is not supported");
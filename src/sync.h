@@ -8,9 +8,14 @@
 
 #include <threadsafety.h>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <stdint.h>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 
 ////////////////////////////////////////////////
@@ -112,15 +117,57 @@ typedef std::unique_lock<std::mutex> WaitableLock;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+static const bool DEFAULT_LOCK_STATS = false;
+
+/** Whether LOCK records how long it waits for and holds its mutex (-lockstats) */
+extern std::atomic<bool> g_lock_stats;
+
+/** What was recorded for one LOCK or TRY_LOCK site while g_lock_stats was set */
+struct CLockSiteStats
+{
+    //! The locked expression, e.g. cs_main or pwallet->cs_wallet
+    std::string strName;
+    std::string strFile;
+    int nLine = 0;
+    uint64_t nCount = 0;
+    //! Times the mutex was held by another thread when the site tried to take it
+    uint64_t nContended = 0;
+    int64_t nWaitMicros = 0;
+    int64_t nMaxWaitMicros = 0;
+    int64_t nHoldMicros = 0;
+    int64_t nMaxHoldMicros = 0;
+};
+
+void RecordLockUsage(const char* pszName, const char* pszFile, int nLine, bool fContended, int64_t nWaitMicros, int64_t nHoldMicros);
+std::vector<CLockSiteStats> GetLockStats();
+void ResetLockStats();
+
+static inline int64_t LockStatsMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /** Wrapper around std::unique_lock<CCriticalSection> */
 class SCOPED_LOCKABLE CCriticalBlock
 {
 private:
     std::unique_lock<CCriticalSection> lock;
 
+    // Only used while g_lock_stats is set; nLockedMicros stays negative otherwise
+    const char* pszLockName = nullptr;
+    const char* pszLockFile = nullptr;
+    int nLockLine = 0;
+    bool fContended = false;
+    int64_t nWaitMicros = 0;
+    int64_t nLockedMicros = -1;
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        if (g_lock_stats.load(std::memory_order_relaxed)) {
+            EnterTimed(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -131,12 +178,35 @@ private:
 #endif
     }
 
+    void EnterTimed(const char* pszName, const char* pszFile, int nLine)
+    {
+        pszLockName = pszName;
+        pszLockFile = pszFile;
+        nLockLine = nLine;
+        int64_t nStart = LockStatsMicros();
+        if (!lock.try_lock()) {
+            fContended = true;
+#ifdef DEBUG_LOCKCONTENTION
+            PrintLockContention(pszName, pszFile, nLine);
+#endif
+            lock.lock();
+        }
+        nLockedMicros = LockStatsMicros();
+        nWaitMicros = nLockedMicros - nStart;
+    }
+
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()), true);
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+        else if (g_lock_stats.load(std::memory_order_relaxed)) {
+            pszLockName = pszName;
+            pszLockFile = pszFile;
+            nLockLine = nLine;
+            nLockedMicros = LockStatsMicros();
+        }
         return lock.owns_lock();
     }
 
@@ -164,6 +234,12 @@ public:
     {
         if (lock.owns_lock())
             LeaveCritical();
+        if (lock.owns_lock() && nLockedMicros >= 0) {
+            // Record after unlocking, so the bookkeeping does not count as holding the mutex
+            int64_t nHoldMicros = LockStatsMicros() - nLockedMicros;
+            lock.unlock();
+            RecordLockUsage(pszLockName, pszLockFile, nLockLine, fContended, nWaitMicros, nHoldMicros);
+        }
     }
 
     operator bool()
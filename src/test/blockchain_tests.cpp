@@ -2,7 +2,9 @@
 
 #include <stdlib.h>
 
+#include <chain.h>
 #include <rpc/blockchain.h>
+#include <streams.h>
 #include <test/test_veil.h>
 
 /* Equality between doubles is imprecise. Comparison should be done
@@ -75,4 +77,65 @@ BOOST_AUTO_TEST_CASE(get_difficulty_for_null_tip)
     RejectDifficultyMismatch(difficulty, 1.0);
 }
 
+BOOST_AUTO_TEST_CASE(block_index_denomination_arrays)
+{
+    for (unsigned int i = 0; i < libzerocoin::zerocoinDenomList.size(); i++)
+        BOOST_CHECK_EQUAL(libzerocoin::ZerocoinDenominationToIndex(libzerocoin::zerocoinDenomList[i]), (int)i);
+    BOOST_CHECK_EQUAL(libzerocoin::zerocoinDenomList.size(), libzerocoin::ZEROCOIN_DENOM_COUNT);
+
+    std::map<libzerocoin::CoinDenomination, uint256> mapHashes;
+    std::map<libzerocoin::CoinDenomination, int64_t> mapSupply;
+    std::vector<libzerocoin::CoinDenomination> vMints;
+    CDenominationArray<int64_t> supply;
+    CDenominationArray<uint32_t> mints;
+    for (auto denom : libzerocoin::zerocoinDenomList) {
+        mapHashes[denom] = InsecureRand256();
+        mapSupply[denom] = supply.at(denom) = InsecureRandRange(1000);
+        mints.at(denom) = denom == libzerocoin::ZQ_ONE_HUNDRED ? 0 : InsecureRandRange(3) + 1;
+        vMints.insert(vMints.end(), mints.at(denom), denom);
+    }
+
+    // The arrays are written in the layout of the std::map and std::vector members they replaced
+    CDataStream ssOld(SER_DISK, CLIENT_VERSION);
+    ssOld << mapSupply << vMints;
+    CDataStream ssNew(SER_DISK, CLIENT_VERSION);
+    ssNew << DENOMINATION_MAP(supply) << DENOMINATION_LIST(mints);
+    BOOST_CHECK(ssOld.str() == ssNew.str());
+
+    CDenominationArray<int64_t> supplyRead;
+    CDenominationArray<uint32_t> mintsRead;
+    ssOld >> DENOMINATION_MAP(supplyRead) >> DENOMINATION_LIST(mintsRead);
+    BOOST_CHECK(supplyRead == supply);
+    BOOST_CHECK(mintsRead == mints);
+
+    // Unchanged accumulator hashes share the instance of the previous block
+    CBlockIndex indexPrev, index;
+    index.pprev = &indexPrev;
+    indexPrev.SetAccumulatorHashes(mapHashes);
+    index.SetAccumulatorHashes(mapHashes);
+    BOOST_CHECK(index.pAccumulatorHashes == indexPrev.pAccumulatorHashes);
+    BOOST_CHECK(index.GetAccumulatorHashes() == mapHashes);
+    mapHashes[libzerocoin::ZQ_TEN] = InsecureRand256();
+    index.SetAccumulatorHashes(mapHashes);
+    BOOST_CHECK(index.pAccumulatorHashes != indexPrev.pAccumulatorHashes);
+    BOOST_CHECK(!index.HasSameAccumulatorHashes(indexPrev));
+    BOOST_CHECK(index.GetAccumulatorHash(libzerocoin::ZQ_TEN) == mapHashes[libzerocoin::ZQ_TEN]);
+    BOOST_CHECK(index.GetAccumulatorHash(libzerocoin::ZQ_ERROR) == uint256());
+
+    // The exact map of the block is kept, so it still compares equal to the block after a round trip
+    BOOST_CHECK(CBlockIndex().GetAccumulatorHashes().size() == libzerocoin::zerocoinDenomList.size());
+    std::map<libzerocoin::CoinDenomination, uint256> mapPartial;
+    mapPartial[libzerocoin::ZQ_TEN] = InsecureRand256();
+    mapPartial[libzerocoin::ZQ_ERROR] = InsecureRand256();
+    CBlockIndex indexPartial;
+    indexPartial.SetAccumulatorHashes(mapPartial);
+    BOOST_CHECK(indexPartial.GetAccumulatorHashes() == mapPartial);
+    CDataStream ssIndex(SER_DISK, CLIENT_VERSION);
+    ssIndex << CDiskBlockIndex(&indexPartial);
+    CDiskBlockIndex diskindex;
+    ssIndex >> diskindex;
+    BOOST_CHECK(diskindex.GetAccumulatorHashes() == mapPartial);
+    BOOST_CHECK(diskindex.GetAccumulatorHash(libzerocoin::ZQ_ONE_HUNDRED) == uint256());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
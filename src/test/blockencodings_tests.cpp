@@ -56,6 +56,7 @@ static CBlock BuildBlockTestCase() {
     bool mutated;
     block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
     assert(!mutated);
+    block.hashVeilData = block.GetVeilDataHash();
     while (!CheckProofOfWork(block.GetPoWHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
     return block;
 }
@@ -125,6 +126,9 @@ class TestHeaderAndShortIDs {
 public:
     CBlockHeader header;
     uint64_t nonce;
+    std::map<libzerocoin::CoinDenomination, uint256> mapAccumulatorHashes;
+    uint256 hashMerkleRoot;
+    uint256 hashWitnessMerkleRoot;
     std::vector<uint64_t> shorttxids;
     std::vector<PrefilledTransaction> prefilledtxn;
 
@@ -150,6 +154,9 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action) {
         READWRITE(header);
         READWRITE(nonce);
+        READWRITE(mapAccumulatorHashes);
+        READWRITE(hashMerkleRoot);
+        READWRITE(hashWitnessMerkleRoot);
         size_t shorttxids_size = shorttxids.size();
         READWRITE(VARINT(shorttxids_size));
         shorttxids.resize(shorttxids_size);
@@ -309,6 +316,7 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     bool mutated;
     block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
     assert(!mutated);
+    block.hashVeilData = block.GetVeilDataHash();
     while (!CheckProofOfWork(block.GetPoWHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
 
     // Test simple header round-trip with only coinbase
@@ -334,6 +342,73 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(VeilBlockDataRoundTripTest)
+{
+    CTxMemPool pool;
+    CBlock block(BuildBlockTestCase());
+    for (auto denom : libzerocoin::zerocoinDenomList)
+        block.mapAccumulatorHashes[denom] = InsecureRand256();
+    block.hashWitnessMerkleRoot = InsecureRand256();
+    block.hashVeilData = block.GetVeilDataHash();
+    while (!CheckProofOfWork(block.GetPoWHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
+
+    // The block data not in the header survives the round trip
+    {
+        CBlockHeaderAndShortTxIDs shortIDs(block, true);
+
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << shortIDs;
+
+        CBlockHeaderAndShortTxIDs shortIDs2;
+        stream >> shortIDs2;
+        BOOST_CHECK(shortIDs2.HasValidVeilData());
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_OK);
+        BOOST_CHECK_EQUAL(partialBlock.GetPrefilledCount(), 1U);
+
+        CBlock block2;
+        BOOST_CHECK(partialBlock.FillBlock(block2, {block.vtx[1], block.vtx[2]}) == READ_STATUS_OK);
+        BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+        BOOST_CHECK(block.mapAccumulatorHashes == block2.mapAccumulatorHashes);
+        BOOST_CHECK(block.hashWitnessMerkleRoot == block2.hashWitnessMerkleRoot);
+        BOOST_CHECK(block.GetVeilDataHash() == block2.GetVeilDataHash());
+    }
+
+    // Block data that does not match the header is rejected
+    {
+        CBlockHeaderAndShortTxIDs shortIDs(block, true);
+        shortIDs.mapAccumulatorHashes[libzerocoin::ZQ_TEN] = InsecureRand256();
+        BOOST_CHECK(!shortIDs.HasValidVeilData());
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs, extra_txn) == READ_STATUS_INVALID);
+    }
+
+    // The PoFN hash and block signature are only sent for stake blocks
+    {
+        CBlockHeaderAndShortTxIDs shortIDs(block, true);
+        shortIDs.header.fProofOfStake = true;
+        shortIDs.hashPoFN = InsecureRand256();
+        shortIDs.vchBlockSig = {1, 2, 3};
+
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << shortIDs;
+        CBlockHeaderAndShortTxIDs shortIDs2;
+        stream >> shortIDs2;
+        BOOST_CHECK(shortIDs2.hashPoFN == shortIDs.hashPoFN);
+        BOOST_CHECK(shortIDs2.vchBlockSig == shortIDs.vchBlockSig);
+
+        shortIDs.header.fProofOfStake = false;
+        CDataStream stream2(SER_NETWORK, PROTOCOL_VERSION);
+        stream2 << shortIDs;
+        CBlockHeaderAndShortTxIDs shortIDs3;
+        stream2 >> shortIDs3;
+        BOOST_CHECK(shortIDs3.hashPoFN.IsNull());
+        BOOST_CHECK(shortIDs3.vchBlockSig.empty());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
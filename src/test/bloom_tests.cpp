@@ -533,4 +533,41 @@ BOOST_AUTO_TEST_CASE(rolling_bloom)
     }
 }
 
+BOOST_AUTO_TEST_CASE(keyset_bloom)
+{
+    CKeySetBloomFilter unsized;
+    BOOST_CHECK(unsized.contains(RandomData()));
+
+    CKeySetBloomFilter filter(1000, 0.001);
+    static const int DATASIZE=1000;
+    std::vector<unsigned char> data[DATASIZE];
+    for (int i = 0; i < DATASIZE; i++) {
+        data[i] = RandomData();
+        filter.insert(data[i]);
+    }
+    BOOST_CHECK(!filter.IsOverCapacity());
+
+    // Nothing is forgotten, also not after a round trip through serialization
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << filter;
+    CKeySetBloomFilter filter2;
+    stream >> filter2;
+    for (int i = 0; i < DATASIZE; i++) {
+        BOOST_CHECK(filter.contains(data[i]));
+        BOOST_CHECK(filter2.contains(data[i]));
+    }
+
+    // About 10 false positives expected
+    unsigned int nHits = 0;
+    for (int i = 0; i < 10000; i++) {
+        if (filter2.contains(RandomData()))
+            ++nHits;
+    }
+    BOOST_TEST_MESSAGE("KeySetBloomFilter got " << nHits << " false positives (~10 expected)");
+    BOOST_CHECK(nHits < 50);
+
+    filter2.insert(RandomData());
+    BOOST_CHECK(filter2.IsOverCapacity());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
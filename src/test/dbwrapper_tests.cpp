@@ -6,6 +6,7 @@
 #include <uint256.h>
 #include <random.h>
 #include <test/test_veil.h>
+#include <txdb.h>
 
 #include <memory>
 
@@ -119,6 +120,40 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_iterator_append)
+{
+    // Perform tests both obfuscated and non-obfuscated.
+    for (bool obfuscate : {false, true}) {
+        fs::path ph = SetDataDir(std::string("dbwrapper_iterator_append").append(obfuscate ? "_true" : "_false"));
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        uint256 key = InsecureRand256();
+        std::vector<unsigned char> in(100);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = InsecureRandBits(8);
+        BOOST_CHECK(dbw.Write(std::make_pair('r', key), in));
+
+        std::unique_ptr<CDBIterator> it(const_cast<CDBWrapper&>(dbw).NewIterator());
+        it->Seek(std::make_pair('r', key));
+        BOOST_CHECK(it->Valid());
+
+        // Key without its prefix and value as they were written, in a stream that already holds data
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << 'x';
+        it->AppendKey(ss, 1);
+        it->AppendValue(ss);
+
+        char prefix_res;
+        uint256 key_res;
+        std::vector<unsigned char> val_res;
+        ss >> prefix_res >> key_res >> val_res;
+        BOOST_CHECK_EQUAL(prefix_res, 'x');
+        BOOST_CHECK_EQUAL(key_res.ToString(), key.ToString());
+        BOOST_CHECK(val_res == in);
+        BOOST_CHECK(ss.empty());
+    }
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
@@ -319,4 +354,94 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_key_filter)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_key_filter"));
+    CDBWrapper dbw(ph, (1 << 20), false, true);
+    const char table = 's', persisted = 'S';
+
+    // Keys written before the filter is first used are found by scanning the table
+    uint256 before = InsecureRand256(), txhash = InsecureRand256();
+    BOOST_CHECK(dbw.Write(std::make_pair(table, before), txhash));
+
+    std::unique_ptr<CDBKeyFilter> filter(new CDBKeyFilter(dbw, table, persisted));
+    BOOST_CHECK(filter->MayContain(before));
+
+    uint256 after = InsecureRand256();
+    filter->Insert(after);
+    BOOST_CHECK(dbw.Write(std::make_pair(table, after), txhash));
+    BOOST_CHECK(filter->MayContain(after));
+
+    // Almost no key that was never written passes
+    unsigned int nHits = 0;
+    for (int i = 0; i < 1000; i++) {
+        if (filter->MayContain(InsecureRand256()))
+            ++nHits;
+    }
+    BOOST_CHECK(nHits < 20);
+
+    // A kept copy is taken over by a filter loaded at the same chain tip, and erased when it is loaded
+    const uint256 tip = InsecureRand256();
+    BOOST_CHECK(filter->Write(tip));
+    BOOST_CHECK(dbw.Exists(persisted));
+    filter.reset(new CDBKeyFilter(dbw, table, persisted));
+    filter->Load(tip);
+    BOOST_CHECK(!dbw.Exists(persisted));
+    BOOST_CHECK(filter->MayContain(before) && filter->MayContain(after));
+
+    // The table changes behind a kept copy, the next filter is loaded at another tip and scans the table instead
+    BOOST_CHECK(filter->Write(tip));
+    uint256 behind = InsecureRand256();
+    BOOST_CHECK(dbw.Write(std::make_pair(table, behind), txhash));
+    filter.reset(new CDBKeyFilter(dbw, table, persisted));
+    filter->Load(InsecureRand256());
+    BOOST_CHECK(!dbw.Exists(persisted));
+    BOOST_CHECK(filter->MayContain(before) && filter->MayContain(after) && filter->MayContain(behind));
+
+    // A filter used without being loaded never trusts a kept copy
+    BOOST_CHECK(filter->Write(tip));
+    uint256 unloaded = InsecureRand256();
+    BOOST_CHECK(dbw.Write(std::make_pair(table, unloaded), txhash));
+    filter.reset(new CDBKeyFilter(dbw, table, persisted));
+    BOOST_CHECK(filter->MayContain(unloaded));
+    BOOST_CHECK(!dbw.Exists(persisted));
+
+    // Inserting after it was kept drops the copy again
+    BOOST_CHECK(filter->Write(tip));
+    filter->Insert(InsecureRand256());
+    BOOST_CHECK(!dbw.Exists(persisted));
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_key_filter_rebuild_in_batch)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_key_filter_rebuild_in_batch"));
+    CDBWrapper dbw(ph, (1 << 20), false, true);
+    const char table = 's', persisted = 'S';
+    const uint256 txhash = InsecureRand256();
+
+    // The filter outgrows its capacity several times while the keys are only in a batch, as for the key images of
+    // a block, and every key must still be found before the batch is written
+    CDBKeyFilter filter(dbw, table, persisted, 16);
+    std::vector<uint256> vKeys;
+    CDBBatch batch(dbw);
+    for (int i = 0; i < 100; i++) {
+        vKeys.push_back(InsecureRand256());
+        filter.Insert(vKeys.back());
+        batch.Write(std::make_pair(table, vKeys.back()), txhash);
+        for (const uint256& key : vKeys)
+            BOOST_CHECK(filter.MayContain(key));
+    }
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    for (const uint256& key : vKeys)
+        BOOST_CHECK(filter.MayContain(key));
+
+    // The kept copy is built from the table alone and still has every key
+    const uint256 tip = InsecureRand256();
+    BOOST_CHECK(filter.Write(tip));
+    CDBKeyFilter loaded(dbw, table, persisted, 16);
+    loaded.Load(tip);
+    for (const uint256& key : vKeys)
+        BOOST_CHECK(loaded.MayContain(key));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
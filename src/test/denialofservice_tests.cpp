@@ -21,20 +21,33 @@
 #include <boost/test/unit_test.hpp>
 #include <veil/ringct/stealth.h>
 #include <veil/ringct/extkey.h>
+#include <veil/ringct/anon.h>
 
 // Tests these internal-to-net_processing.cpp methods:
 extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer);
 extern void EraseOrphansFor(NodeId peer);
 extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern bool AddAnonOrphanTx(const CTransactionRef& tx, NodeId peer, int64_t nMaxIndex);
+extern unsigned int LimitAnonOrphanTxSize(unsigned int nMaxOrphans);
 extern void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="");
 
 struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
+    int64_t nCPUMicros;
 };
 extern std::map<uint256, COrphanTx> mapOrphanTransactions;
 
+struct CAnonOrphanTx {
+    CTransactionRef tx;
+    NodeId fromPeer;
+    int64_t nTimeExpire;
+    int64_t nMaxIndex;
+    int64_t nCPUMicros;
+};
+extern std::map<uint256, CAnonOrphanTx> mapAnonOrphanTransactions;
+
 static CService ip(uint32_t i)
 {
     struct in_addr s;
@@ -323,6 +336,53 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
     peerLogic->FinalizeNode(dummyNode.GetId(), dummy);
 }
 
+BOOST_AUTO_TEST_CASE(throttled_peer_keeps_message_order)
+{
+    CAddress addr(ip(0xa0b0c002), NODE_NONE);
+    CNode dummyNode(id++, NODE_NETWORK, 0, INVALID_SOCKET, addr, 5, 5, CAddress(), "", true);
+    dummyNode.SetSendVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode);
+    dummyNode.nVersion = 1;
+    dummyNode.fSuccessfullyConnected = true;
+
+    // The peer relayed transactions that cost more validation time than we allow
+    dummyNode.RecordMessageCost(NetMsgType::TX, nMaxValidationWasteMicros * 2, true, false);
+    BOOST_CHECK(dummyNode.IsValidationThrottled(nMaxValidationWasteMicros));
+
+    {
+        LOCK(dummyNode.cs_vProcessMsg);
+        for (const char* pszCommand : {NetMsgType::TX, NetMsgType::HEADERS}) {
+            CNetMessage msg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+            msg.hdr = CMessageHeader(Params().MessageStart(), pszCommand, 0);
+            dummyNode.vProcessMsg.push_back(msg);
+            dummyNode.nProcessQueueSize += CMessageHeader::HEADER_SIZE;
+        }
+    }
+
+    // The headers message does not overtake the delayed tx
+    std::atomic<bool> interruptDummy(false);
+    BOOST_CHECK(!peerLogic->ProcessMessages(&dummyNode, interruptDummy));
+    {
+        LOCK(dummyNode.cs_vProcessMsg);
+        BOOST_CHECK_EQUAL(dummyNode.vProcessMsg.size(), 2U);
+        BOOST_CHECK_EQUAL(dummyNode.vProcessMsg.front().hdr.GetCommand(), NetMsgType::TX);
+        BOOST_CHECK_EQUAL(dummyNode.nProcessQueueSize, 2 * CMessageHeader::HEADER_SIZE);
+    }
+
+    // Once the peer is no longer throttled its messages are taken in order
+    dummyNode.CreditValidationCost(nMaxValidationWasteMicros * 2);
+    BOOST_CHECK(!dummyNode.IsValidationThrottled(nMaxValidationWasteMicros));
+    peerLogic->ProcessMessages(&dummyNode, interruptDummy);
+    {
+        LOCK(dummyNode.cs_vProcessMsg);
+        BOOST_CHECK_EQUAL(dummyNode.vProcessMsg.size(), 1U);
+        BOOST_CHECK_EQUAL(dummyNode.vProcessMsg.front().hdr.GetCommand(), NetMsgType::HEADERS);
+    }
+
+    bool dummy;
+    peerLogic->FinalizeNode(dummyNode.GetId(), dummy);
+}
+
 static CTransactionRef RandomOrphan()
 {
     std::map<uint256, COrphanTx>::iterator it;
@@ -414,4 +474,55 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.empty());
 }
 
+BOOST_AUTO_TEST_CASE(DoS_mapAnonOrphans)
+{
+    // Anon inputs of 1 input with a ring of MIN_RINGSIZE members each
+    std::vector<CTransactionRef> vtx;
+    for (int i = 0; i < 20; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        for (auto& txin : tx.vin) {
+            txin.prevout.n = COutPoint::ANON_MARKER;
+            txin.SetAnonInfo(1, MIN_RINGSIZE);
+            std::vector<uint8_t> vMI;
+            for (size_t k = 0; k < MIN_RINGSIZE; k++)
+                PutVarInt(vMI, InsecureRandRange(1000));
+            txin.scriptWitness.stack.push_back(vMI);
+        }
+        PutVarInt(tx.vin[1].scriptWitness.stack[0], 1000 + i);
+        tx.vin[1].SetAnonInfo(1, MIN_RINGSIZE + 1);
+        vtx.push_back(MakeTransactionRef(tx));
+
+        int64_t nMaxIndex;
+        BOOST_CHECK(GetMaxAnonInputIndex(*vtx.back(), nMaxIndex));
+        BOOST_CHECK_EQUAL(nMaxIndex, 1000 + i);
+    }
+
+    // Malformed ring member indices
+    CMutableTransaction txBad(*vtx[0]);
+    txBad.vin[0].scriptWitness.stack[0].resize(1);
+    int64_t nMaxIndex;
+    BOOST_CHECK(!GetMaxAnonInputIndex(CTransaction(txBad), nMaxIndex));
+
+    LOCK(cs_main);
+    for (int i = 0; i < 20; i++)
+        BOOST_CHECK(AddAnonOrphanTx(vtx[i], i % 4, 1000 + i));
+    BOOST_CHECK(!AddAnonOrphanTx(vtx[0], 1, 1000));
+    BOOST_CHECK_EQUAL(mapAnonOrphanTransactions.size(), 20U);
+
+    // Test EraseOrphansFor:
+    EraseOrphansFor(0);
+    BOOST_CHECK_EQUAL(mapAnonOrphanTransactions.size(), 15U);
+    for (const auto& entry : mapAnonOrphanTransactions)
+        BOOST_CHECK(entry.second.fromPeer != 0);
+
+    // Test LimitAnonOrphanTxSize() function:
+    LimitAnonOrphanTxSize(10);
+    BOOST_CHECK_EQUAL(mapAnonOrphanTransactions.size(), 10U);
+    SetMockTime(GetTime() + 60 * 60);
+    LimitAnonOrphanTxSize(10);
+    BOOST_CHECK(mapAnonOrphanTransactions.empty());
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -189,4 +189,44 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(cnode_validation_cost)
+{
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode(new CNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true));
+
+    // Messages that are not validation work only show up per message type
+    pnode->RecordMessageCost(NetMsgType::PING, 500, false, false);
+    pnode->RecordMessageCost("unknowncmd", 700, false, false);
+    BOOST_CHECK(!pnode->IsValidationThrottled(2000000));
+
+    // Transactions that were no use to us count against the peer...
+    pnode->RecordMessageCost(NetMsgType::TX, 3000000, true, false);
+    BOOST_CHECK(pnode->IsValidationThrottled(2000000));
+    BOOST_CHECK(!pnode->IsValidationThrottled(4000000));
+    BOOST_CHECK(!pnode->IsValidationThrottled(0));
+
+    // ... but less so when it also relayed useful ones
+    pnode->RecordMessageCost(NetMsgType::TX, 2000000, true, true);
+    BOOST_CHECK(!pnode->IsValidationThrottled(2000000));
+
+    // A tx kept as orphan is only counted per message type, and credited once the orphan is accepted
+    pnode->RecordMessageCost(NetMsgType::TX, 2000000, true, false);
+    BOOST_CHECK(pnode->IsValidationThrottled(2000000));
+    pnode->RecordMessageCost(NetMsgType::TX, 1000000, false, false);
+    BOOST_CHECK(pnode->IsValidationThrottled(2000000));
+    pnode->CreditValidationCost(1000000);
+    BOOST_CHECK(!pnode->IsValidationThrottled(2000000));
+
+    CNodeStats stats;
+    pnode->copyStats(stats);
+    BOOST_CHECK_EQUAL(stats.mapRecvCPUMicrosPerMsgCmd[NetMsgType::PING], 500U);
+    BOOST_CHECK_EQUAL(stats.mapRecvCPUMicrosPerMsgCmd["*other*"], 700U);
+    BOOST_CHECK_EQUAL(stats.mapRecvCPUMicrosPerMsgCmd[NetMsgType::TX], 8000000U);
+    BOOST_CHECK(stats.dValidationWasted > 4.9 && stats.dValidationWasted <= 5.0);
+    BOOST_CHECK(stats.dValidationUseful > 2.9 && stats.dValidationUseful <= 3.0);
+    BOOST_CHECK(!stats.fValidationThrottled);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
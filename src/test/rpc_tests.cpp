@@ -8,6 +8,7 @@
 #include <core_io.h>
 #include <key_io.h>
 #include <netbase.h>
+#include <validation.h>
 
 #include <test/test_veil.h>
 
@@ -17,6 +18,7 @@
 #include <univalue.h>
 
 #include <rpc/blockchain.h>
+#include <rpc/util.h>
 
 UniValue CallRPC(std::string args)
 {
@@ -416,4 +418,98 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
     }
 }
 
+BOOST_AUTO_TEST_CASE(rpc_perfstats)
+{
+    if (RPCIsInWarmup(nullptr))
+        SetRPCWarmupFinished();
+    ResetRPCStats();
+    JSONRPCRequest request;
+    request.strMethod = "getblockcount";
+    request.params = UniValue(UniValue::VARR);
+    tableRPC.execute(request);
+    request.params.push_back(1);
+    BOOST_CHECK_THROW(tableRPC.execute(request), UniValue);
+
+    std::map<std::string, CRPCMethodStats> mapStats = GetRPCStats();
+    BOOST_CHECK_EQUAL(mapStats.size(), 1U);
+    const CRPCMethodStats& stats = mapStats["getblockcount"];
+    BOOST_CHECK_EQUAL(stats.nCalls, 2U);
+    BOOST_CHECK_EQUAL(stats.nErrors, 1U);
+    uint64_t nBucketed = 0;
+    for (size_t i = 0; i < RPC_LATENCY_BUCKET_COUNT; i++)
+        nBucketed += stats.vBuckets[i];
+    BOOST_CHECK_EQUAL(nBucketed, 2U);
+
+    // Lock statistics are recorded only while switched on
+    CallRPC("getperfstats true true");
+    BOOST_CHECK(g_lock_stats);
+    {
+        LOCK(cs_main);
+    }
+    UniValue r = CallRPC("getperfstats true false");
+    BOOST_CHECK(!g_lock_stats);
+    const UniValue& lock = find_value(find_value(r, "locks"), "cs_main");
+    BOOST_CHECK(lock.isObject());
+    BOOST_CHECK(find_value(lock, "count").get_int() >= 1);
+    BOOST_CHECK(!find_value(lock, "holders").empty());
+    {
+        LOCK(cs_main);
+    }
+    r = CallRPC("getperfstats");
+    BOOST_CHECK(find_value(r, "locks").empty());
+    BOOST_CHECK(find_value(r, "rpc").empty());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_json_stream_writer)
+{
+    UniValue tx(UniValue::VOBJ);
+    tx.pushKV("txid", "ab\"cd");
+    tx.pushKV("vout", UniValue(UniValue::VARR));
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("hash", "00ff");
+    expected.pushKV("empty", UniValue(UniValue::VOBJ));
+    UniValue txs(UniValue::VARR);
+    txs.push_back(tx);
+    txs.push_back(tx);
+    txs.push_back(1.5);
+    expected.pushKV("tx", txs);
+    expected.pushKV("nTx", 3);
+
+    // A small flush size makes the writer hand out many chunks
+    std::vector<std::string> chunks;
+    CJSONStreamWriter stream([&chunks](const std::string& str) { chunks.push_back(str); }, 8);
+    stream.BeginObject();
+    stream.Key("hash");
+    stream.Value("00ff");
+    stream.Key("empty");
+    stream.BeginObject();
+    stream.EndObject();
+    stream.Key("tx");
+    stream.BeginArray();
+    stream.Value(tx);
+    stream.Value(tx);
+    stream.Value(1.5);
+    stream.EndArray();
+    stream.Key("nTx");
+    stream.Value(3);
+    stream.EndObject();
+    stream.Flush();
+
+    BOOST_CHECK(chunks.size() > 1);
+    std::string strStreamed;
+    for (const std::string& chunk : chunks)
+        strStreamed += chunk;
+    BOOST_CHECK_EQUAL(strStreamed, expected.write());
+
+    // Nothing is written before the buffer is full or flushed
+    chunks.clear();
+    CJSONStreamWriter stream2([&chunks](const std::string& str) { chunks.push_back(str); });
+    stream2.BeginArray();
+    stream2.EndArray();
+    BOOST_CHECK(chunks.empty());
+    stream2.Flush();
+    BOOST_CHECK_EQUAL(chunks.size(), 1U);
+    BOOST_CHECK_EQUAL(chunks[0], "[]");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 
 #include <chainparams.h>
 #include <consensus/consensus.h>
+#include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
 #include <validation.h>
@@ -55,6 +56,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitRangeproofCache();
     fCheckBlockIndex = true;
     SelectParams(chainName);
     noui_connect();
@@ -792,4 +792,37 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     BOOST_CHECK(!IsStandardTx(t, reason));
 }
 
+BOOST_AUTO_TEST_CASE(test_proof_cache)
+{
+    uint256 hashProof = InsecureRand256();
+    BOOST_CHECK(!GetCachedProof(hashProof, ProofCacheMode::MEMPOOL));
+
+    AddCachedProof(hashProof, ProofCacheMode::MEMPOOL);
+    BOOST_CHECK(GetCachedProof(hashProof, ProofCacheMode::MEMPOOL));
+    // A lookup for a block still hits, but only once
+    BOOST_CHECK(GetCachedProof(hashProof, ProofCacheMode::BLOCK));
+    BOOST_CHECK(!GetCachedProof(hashProof, ProofCacheMode::MEMPOOL));
+
+    // Nothing is added for a block
+    AddCachedProof(hashProof, ProofCacheMode::BLOCK);
+    BOOST_CHECK(!GetCachedProof(hashProof, ProofCacheMode::PREVERIFY));
+
+    // A pre-verified proof stays in the pre-verification cache until the mempool lookup moves it out
+    AddCachedProof(hashProof, ProofCacheMode::PREVERIFY);
+    BOOST_CHECK(GetCachedProof(hashProof, ProofCacheMode::PREVERIFY));
+    BOOST_CHECK(GetCachedProof(hashProof, ProofCacheMode::PREVERIFY));
+    BOOST_CHECK(GetCachedProof(hashProof, ProofCacheMode::MEMPOOL));
+    BOOST_CHECK(GetCachedProof(hashProof, ProofCacheMode::MEMPOOL));
+    BOOST_CHECK(GetCachedProof(hashProof, ProofCacheMode::BLOCK));
+    BOOST_CHECK(!GetCachedProof(hashProof, ProofCacheMode::BLOCK));
+
+    // A transaction without proofs passes the proof stage like CheckTransaction
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    mtx.vpout.emplace_back(CTxOut(1 * COIN, CScript() << OP_TRUE).GetSharedPtr());
+    CValidationState state;
+    BOOST_CHECK(VerifyTxProofs(CTransaction(mtx), state));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
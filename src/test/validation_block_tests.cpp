@@ -4,13 +4,16 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <blockperf.h>
 #include <chainparams.h>
+#include <chainsnapshot.h>
 #include <consensus/merkle.h>
 #include <consensus/validation.h>
 #include <miner.h>
 #include <pow.h>
 #include <random.h>
 #include <test/test_veil.h>
+#include <txdb.h>
 #include <validation.h>
 #include <validationinterface.h>
 #include <veil/budget.h>
@@ -179,4 +182,208 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, chainActive.Tip()->GetBlockHash());
 }
 
+BOOST_AUTO_TEST_CASE(processnewblockheaders_pow_verified)
+{
+    // Two separate chains, so that the valid headers are not already known from the bad ones
+    std::vector<std::shared_ptr<const CBlock>> bad_blocks, blocks;
+    BuildChain(Params().GenesisBlock().GetHash(), 20, 0, 0, 20, bad_blocks);
+    BuildChain(Params().GenesisBlock().GetHash(), 20, 0, 0, 20, blocks);
+
+    CValidationState state;
+    auto ToHeader = [](std::shared_ptr<const CBlock> b) { return b->GetBlockHeader(); };
+    std::vector<CBlockHeader> bad_headers, headers;
+    std::transform(bad_blocks.begin(), bad_blocks.end(), std::back_inserter(bad_headers), ToHeader);
+    std::transform(blocks.begin(), blocks.end(), std::back_inserter(headers), ToHeader);
+
+    // A header with a bad PoW rejects the message, also when it is checked on the header check queue
+    do {
+        ++bad_headers.back().nNonce;
+    } while (CheckProofOfWork(bad_headers.back().GetPoWHash(), bad_headers.back().nBits, Params().GetConsensus()));
+    CBlockHeader first_invalid;
+    BOOST_CHECK(!ProcessNewBlockHeaders(bad_headers, state, Params(), nullptr, &first_invalid));
+    BOOST_CHECK(first_invalid.GetHash() == bad_headers.back().GetHash());
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(!LookupBlockIndex(bad_headers.back().GetHash()));
+        for (const CBlockHeader& header : headers) {
+            BOOST_CHECK(!LookupBlockIndex(header.GetHash()));
+        }
+    }
+
+    // The valid headers remember that their PoW was checked
+    state = CValidationState();
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state, Params()));
+    {
+        LOCK(cs_main);
+        for (const CBlockHeader& header : headers) {
+            const CBlockIndex* pindex = LookupBlockIndex(header.GetHash());
+            BOOST_REQUIRE(pindex);
+            BOOST_CHECK(pindex->nStatus & BLOCK_POW_VERIFIED);
+        }
+    }
+
+    // Also in the block index on disk, which is loaded without checking the PoW again
+    FlushStateToDisk();
+    std::map<uint256, std::unique_ptr<CBlockIndex>> mapReloaded;
+    BOOST_CHECK(pblocktree->LoadBlockIndexGuts(Params().GetConsensus(), [&mapReloaded](const uint256& hash) -> CBlockIndex* {
+        if (hash.IsNull())
+            return nullptr;
+        auto it = mapReloaded.emplace(hash, nullptr).first;
+        if (!it->second) {
+            it->second.reset(new CBlockIndex());
+            it->second->phashBlock = &it->first;
+        }
+        return it->second.get();
+    }));
+    for (const CBlockHeader& header : headers) {
+        auto it = mapReloaded.find(header.GetHash());
+        BOOST_REQUIRE(it != mapReloaded.end());
+        BOOST_CHECK(it->second->nStatus & BLOCK_POW_VERIFIED);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(loadblock_preverify)
+{
+    // More blocks than are read ahead at a time
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    BuildChain(Params().GenesisBlock().GetHash(), 40, 0, 0, 40, blocks);
+
+    fs::path path = GetDataDir() / "bootstrap.dat";
+    {
+        CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!fileout.IsNull());
+        for (const auto& block : blocks) {
+            fileout << Params().MessageStart() << (unsigned int)GetSerializeSize(fileout, *block) << *block;
+        }
+    }
+
+    FILE* file = fsbridge::fopen(path, "rb");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK(LoadExternalBlockFile(Params(), file));
+
+    fImporting = true;
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    fImporting = false;
+
+    LOCK(cs_main);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == blocks.back()->GetHash());
+    // The blocks were checked before AcceptBlock, which remembers their PoW
+    for (const auto& block : blocks) {
+        BOOST_CHECK(LookupBlockIndex(block->GetHash())->nStatus & BLOCK_POW_VERIFIED);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chainstate_snapshot)
+{
+    pzerocoinDB.reset(new CZerocoinDB(0, true));
+    BOOST_CHECK(pzerocoinDB->WriteAccumulatorValue(uint256S("01"), CBigNum(7)));
+
+    fs::path path = GetDataDir() / "chainstate.snapshot";
+    CChainSnapshotInfo info;
+    std::string strError;
+    BOOST_REQUIRE(DumpChainstateSnapshot(path, info, strError));
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(info.header.hashBlock == chainActive.Tip()->GetBlockHash());
+        BOOST_CHECK_EQUAL(info.header.nHeight, chainActive.Height());
+    }
+    BOOST_CHECK(info.nBlockTreeRecords > 0);
+    BOOST_CHECK_EQUAL(info.nZerocoinRecords, 1U);
+
+    CChainSnapshotInfo infoVerified;
+    BOOST_CHECK(VerifyChainstateSnapshot(path, Params(), infoVerified, strError));
+    BOOST_CHECK(infoVerified.hash == info.hash);
+    BOOST_CHECK_EQUAL(infoVerified.nCoins, info.nCoins);
+    BOOST_CHECK_EQUAL(infoVerified.nBlockTreeRecords, info.nBlockTreeRecords);
+
+    // Load into empty databases
+    std::unique_ptr<CBlockTreeDB> blocktree = std::move(pblocktree);
+    std::unique_ptr<CZerocoinDB> zerocoindb = std::move(pzerocoinDB);
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    pzerocoinDB.reset(new CZerocoinDB(0, true));
+    CChainSnapshotInfo infoLoaded;
+    // A snapshot that is not the expected one is refused before anything is written
+    BOOST_CHECK(!LoadChainstateSnapshot(path, Params(), GetRandHash(), 1 << 20, infoLoaded, strError));
+    bool fLoading = false;
+    BOOST_CHECK(!pblocktree->ReadFlag("chainstatesnapshotloading", fLoading));
+    {
+        std::unique_ptr<CDBIterator> pcursor(pblocktree->NewIterator());
+        pcursor->SeekToFirst();
+        BOOST_CHECK(!pcursor->Valid());
+    }
+    BOOST_CHECK(LoadChainstateSnapshot(path, Params(), info.hash, 1 << 20, infoLoaded, strError));
+    BOOST_CHECK(infoLoaded.hash == info.hash);
+
+    bool fSnapshot = false;
+    BOOST_CHECK(pblocktree->ReadFlag("chainstatesnapshot", fSnapshot) && fSnapshot);
+    BOOST_CHECK(pblocktree->ReadFlag("chainstatesnapshotloading", fLoading) && !fLoading);
+    CBigNum bnValue;
+    BOOST_CHECK(pzerocoinDB->ReadAccumulatorValue(uint256S("01"), bnValue));
+    BOOST_CHECK(bnValue == CBigNum(7));
+    {
+        CCoinsViewDB coinsdb(1 << 20);
+        BOOST_CHECK(coinsdb.GetBestBlock() == info.header.hashBlock);
+    }
+
+    // Only an empty data directory can be filled
+    BOOST_CHECK(!LoadChainstateSnapshot(path, Params(), info.hash, 1 << 20, infoLoaded, strError));
+
+    pblocktree = std::move(blocktree);
+    pzerocoinDB = std::move(zerocoindb);
+
+    // A changed byte is detected
+    FILE* file = fsbridge::fopen(path, "r+b");
+    BOOST_REQUIRE(file);
+    fseek(file, 50, SEEK_SET);
+    int ch = fgetc(file);
+    fseek(file, 50, SEEK_SET);
+    fputc(ch ^ 1, file);
+    fclose(file);
+    BOOST_CHECK(!VerifyChainstateSnapshot(path, Params(), infoVerified, strError));
+}
+
+BOOST_AUTO_TEST_CASE(blockperf_scopes)
+{
+    const uint256 hash = GetRandHash();
+    const uint256 hashOther = GetRandHash();
+
+    // Spans outside of a scope are not recorded anywhere
+    {
+        CBlockPerfSpan span(BlockPerfPhase::MLSAG);
+    }
+    CBlockPerf perf;
+    BOOST_CHECK(!GetBlockPerf(hash, perf));
+
+    {
+        CBlockPerfScope scope(hash);
+        CBlockPerfSpan span(BlockPerfPhase::CHECK_BLOCK);
+        {
+            // A nested scope does not take over the spans
+            CBlockPerfScope scopeOther(hashOther);
+            CBlockPerfSpan spanMLSAG(BlockPerfPhase::MLSAG);
+            CBlockPerfSpan spanMLSAG2(BlockPerfPhase::MLSAG);
+        }
+    }
+    BOOST_CHECK(!GetBlockPerf(hashOther, perf));
+    BOOST_CHECK(GetBlockPerf(hash, perf));
+    BOOST_CHECK_EQUAL(perf.nHeight, -1);
+    BOOST_CHECK_EQUAL(perf.vCount[(int)BlockPerfPhase::CHECK_BLOCK], 1U);
+    BOOST_CHECK_EQUAL(perf.vCount[(int)BlockPerfPhase::MLSAG], 2U);
+    BOOST_CHECK_EQUAL(perf.vCount[(int)BlockPerfPhase::STAKE], 0U);
+
+    // Later scopes of the same block add to its record
+    {
+        CBlockPerfScope scope(hash, 5);
+        CBlockPerfSpan span(BlockPerfPhase::CHECK_BLOCK);
+    }
+    BOOST_CHECK(GetBlockPerf(hash, perf));
+    BOOST_CHECK_EQUAL(perf.nHeight, 5);
+    BOOST_CHECK_EQUAL(perf.vCount[(int)BlockPerfPhase::CHECK_BLOCK], 2U);
+
+    std::vector<CBlockPerf> vRecent = GetRecentBlockPerf(1);
+    BOOST_CHECK_EQUAL(vRecent.size(), 1U);
+    BOOST_CHECK(vRecent[0].hash == hash);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
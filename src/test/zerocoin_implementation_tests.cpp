@@ -11,11 +11,15 @@
 #include "key.h"
 //#include "accumulatorcheckpoints.h"
 #include "libzerocoin/bignum.h"
+#include "libzerocoin/FixedBaseExp.h"
+#include "libzerocoin/MultiExp.h"
+#include "libzerocoin/PrecomputedParams.h"
 #include <boost/test/unit_test.hpp>
 #include <iostream>
 #include <wallet/deterministicmint.h>
 #include <veil/zerocoin/zwallet.h>
 #include <veil/zerocoin/accumulators.h>
+#include <veil/zerocoin/accumulatorstate.h>
 #include "wallet/wallet.h"
 #include "veil/zerocoin/zchain.h"
 #include "consensus/tx_verify.h"
@@ -46,6 +50,54 @@ BOOST_AUTO_TEST_CASE(zcparams_test)
     BOOST_CHECK(fPassed);
 }
 
+BOOST_AUTO_TEST_CASE(precomputed_params_test)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinParams* params = Params().Zerocoin_Params();
+    uint256 hashParams = Params().Zerocoin_PrecomputedParamsHash();
+
+    //The hardcoded hash matches the parameters derived from the modulus on every network
+    BOOST_CHECK(GetPrecomputedParamsHash(*params) == hashParams);
+    for (const std::string& strNetwork : {CBaseChainParams::TESTNET, CBaseChainParams::REGTEST}) {
+        std::unique_ptr<CChainParams> chainParams = CreateChainParams(strNetwork);
+        BOOST_CHECK(chainParams->Zerocoin_Modulus() == Params().Zerocoin_Modulus());
+        BOOST_CHECK(chainParams->Zerocoin_PrecomputedParamsHash() == hashParams);
+    }
+
+    fs::path path = fs::temp_directory_path() / fs::unique_path("zerocoinparams-%%%%-%%%%.dat");
+    std::string strError;
+    BOOST_CHECK_MESSAGE(WritePrecomputedParams(*params, path.string(), strError), strError);
+
+    ZerocoinParams paramsRead;
+    BOOST_CHECK_MESSAGE(ReadPrecomputedParams(paramsRead, hashParams, path.string(), strError), strError);
+    BOOST_CHECK(paramsRead.coinCommitmentGroup.gis == params->coinCommitmentGroup.gis);
+    BOOST_CHECK(paramsRead.serialNumberSoKCommitmentGroup.modulus == params->serialNumberSoKCommitmentGroup.modulus);
+    BOOST_CHECK(paramsRead.ZKP_wA == params->ZKP_wA);
+    BOOST_CHECK(paramsRead.ZKP_K == params->ZKP_K);
+    BOOST_CHECK(paramsRead.S_POLY_C2 == params->S_POLY_C2);
+
+    //A file with a valid checksum over other parameters is rejected
+    paramsRead.zkp_iterations++;
+    BOOST_CHECK_MESSAGE(WritePrecomputedParams(paramsRead, path.string(), strError), strError);
+    ZerocoinParams paramsOther;
+    BOOST_CHECK(!ReadPrecomputedParams(paramsOther, hashParams, path.string(), strError));
+    BOOST_CHECK_MESSAGE(WritePrecomputedParams(*params, path.string(), strError), strError);
+
+    //A corrupted file is rejected
+    {
+        FILE* file = fopen(path.string().c_str(), "r+b");
+        BOOST_REQUIRE(file);
+        fseek(file, 100, SEEK_SET);
+        int c = fgetc(file);
+        fseek(file, 100, SEEK_SET);
+        fputc(~c & 0xff, file);
+        fclose(file);
+    }
+    ZerocoinParams paramsCorrupt;
+    BOOST_CHECK(!ReadPrecomputedParams(paramsCorrupt, hashParams, path.string(), strError));
+    fs::remove(path);
+}
+
 std::string zerocoinModulus = "25195908475657893494027183240048398571429282126204032027777137836043662020707595556264018525880784"
 "4069182906412495150821892985591491761845028084891200728449926873928072877767359714183472702618963750149718246911"
 "6507761337985909570009733045974880842840179742910064245869181719511874612151517265463228221686998754918242243363"
@@ -94,6 +146,57 @@ BOOST_AUTO_TEST_CASE(bignum_basic_tests)
     BOOST_CHECK_MESSAGE(bn2 == bn, "CBigNum.setvch() or CBigNum.getvch() does not work correctly");
 }
 
+BOOST_AUTO_TEST_CASE(fixedbase_exp_tests)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinParams* params = Params().Zerocoin_Params();
+
+    for (const IntegerGroupParams* group : {&params->coinCommitmentGroup, &params->serialNumberSoKCommitmentGroup,
+            &params->accumulatorParams.accumulatorPoKCommitmentGroup}) {
+        FixedBaseExp fixedBase(group->g, group->modulus, group->groupOrder);
+        BOOST_CHECK(fixedBase.pow_mod(CBigNum(0)) == CBigNum(1));
+        BOOST_CHECK(fixedBase.pow_mod(group->groupOrder) == CBigNum(1));
+
+        for (int i = 0; i < 10; i++) {
+            CBigNum e = CBigNum::randBignum(group->groupOrder);
+            BOOST_CHECK(fixedBase.pow_mod(e) == group->g.pow_mod(e, group->modulus));
+            BOOST_CHECK(group->pow_h(e) == group->h.pow_mod(e, group->modulus));
+
+            //Exponents outside of the table are reduced by the order of the base
+            BOOST_CHECK(fixedBase.pow_mod(-e) == group->g.pow_mod(-e, group->modulus));
+            CBigNum eLarge = e * group->modulus + CBigNum(i);
+            BOOST_CHECK(group->pow_g(eLarge) == group->g.pow_mod(eLarge, group->modulus));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(multiexp_tests)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinParams* params = Params().Zerocoin_Params();
+    const IntegerGroupParams& group = params->serialNumberSoKCommitmentGroup;
+
+    BOOST_CHECK(MultiExp(CBN_vector(), CBN_vector(), group.modulus) == CBigNum(1));
+    BOOST_CHECK_THROW(MultiExp(CBN_vector(2, group.g), CBN_vector(1, CBigNum(1)), group.modulus), std::runtime_error);
+
+    //Small sets use Straus, larger ones Pippenger
+    for (unsigned int n : {1, 2, 3, 8, 40, 200}) {
+        CBN_vector bases, exponents;
+        CBigNum expected(1);
+        for (unsigned int i = 0; i < n; i++) {
+            CBigNum e = CBigNum::randBignum(group.groupOrder);
+            if (i % 5 == 1)
+                e = -e;
+            else if (i % 7 == 2)
+                e = CBigNum(0);
+            bases.push_back(group.gis[i]);
+            exponents.push_back(e);
+            expected = expected.mul_mod(group.gis[i].pow_mod(e, group.modulus), group.modulus);
+        }
+        BOOST_CHECK_MESSAGE(MultiExp(bases, exponents, group.modulus) == expected, "MultiExp failed for " << n << " terms");
+    }
+}
+
 //ZQ_TEN mints
 std::string rawTx1 = "0100000001983d5fd91685bb726c0ebc3676f89101b16e663fd896fea53e19972b95054c49000000006a473044022010fbec3e78f9c46e58193d481caff715ceb984df44671d30a2c0bde95c54055f0220446a97d9340da690eaf2658e5b2bf6a0add06f1ae3f1b40f37614c7079ce450d012103cb666bd0f32b71cbf4f32e95fa58e05cd83869ac101435fcb8acee99123ccd1dffffffff0200e1f5050000000086c10280004c80c3a01f94e71662f2ae8bfcd88dfc5b5e717136facd6538829db0c7f01e5fd793cccae7aa1958564518e0223d6d9ce15b1e38e757583546e3b9a3f85bd14408120cd5192a901bb52152e8759fdd194df230d78477706d0e412a66398f330be38a23540d12ab147e9fb19224913f3fe552ae6a587fb30a68743e52577150ff73042c0f0d8f000000001976a914d6042025bd1fff4da5da5c432d85d82b3f26a01688ac00000000";
 std::string rawTxpub1 = "473ff507157523e74680ab37f586aae52e53f3f912492b19f7e14ab120d54238ae30b338f39662a410e6d707784d730f24d19dd9f75e85221b51b902a19d50c120844d15bf8a3b9e346355857e7381e5be19c6d3d22e01845565819aae7cacc93d75f1ef0c7b09d823865cdfa3671715e5bfc8dd8fc8baef26216e7941fa0c3";
@@ -472,6 +575,53 @@ BOOST_AUTO_TEST_CASE(setup_exceptions_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(accumulator_state_tests)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinParams* params = Params().Zerocoin_Params();
+
+    //Mint one coin every third block for the first 25 blocks
+    std::map<int, PublicCoin> mapMints;
+    for (int i = 0; i < 25; i += 3) {
+        PrivateCoin coin(params, CoinDenomination::ZQ_TEN, true);
+        mapMints.emplace(i, coin.getPublicCoin());
+    }
+
+    AccumulatorState state;
+    for (int nHeight = 0; nHeight < 25; nHeight++) {
+        std::list<PublicCoin> listPubcoins;
+        if (mapMints.count(nHeight))
+            listPubcoins.emplace_back(mapMints.at(nHeight));
+        BOOST_CHECK(state.ConnectMints(listPubcoins, ArithToUint256(arith_uint256(nHeight + 1)), nHeight));
+    }
+    BOOST_CHECK_MESSAGE(!state.ConnectMints({}, uint256(), 30), "state must only connect the next height");
+
+    //The checkpoint at 30 accumulates blocks 10 through 19 on top of the checkpoint at 20 (blocks 0 through 9)
+    AccumulatorMap mapExpected(params);
+    for (auto& mint : mapMints) {
+        if (mint.first < 20)
+            mapExpected.Accumulate(mint.second, true);
+    }
+    AccumulatorMap mapCheckpoint(params);
+    int nMints = 0;
+    BOOST_CHECK(!state.GetCheckpoint(20, mapCheckpoint, nMints));
+    BOOST_CHECK(state.GetCheckpoint(30, mapCheckpoint, nMints));
+    BOOST_CHECK_EQUAL(nMints, 3);
+    BOOST_CHECK(mapCheckpoint.GetCheckpoints(true) == mapExpected.GetCheckpoints(true));
+    BOOST_CHECK(mapCheckpoint.GetUnusedDenominations().size() == zerocoinDenomList.size() - 1);
+
+    //The state survives a round trip to disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << state;
+    AccumulatorState stateRead;
+    ss >> stateRead;
+    BOOST_CHECK(stateRead.hashBlock == state.hashBlock);
+    BOOST_CHECK(stateRead.window.mapValues == state.window.mapValues);
+    AccumulatorMap mapCheckpointRead(params);
+    BOOST_CHECK(stateRead.GetCheckpoint(30, mapCheckpointRead, nMints));
+    BOOST_CHECK(mapCheckpointRead.GetCheckpoints(true) == mapCheckpoint.GetCheckpoints(true));
+}
+
 BOOST_AUTO_TEST_CASE(deterministic_tests)
 {
     SelectParams(CBaseChainParams::TESTNET);
@@ -18,6 +18,7 @@
 
 #include <boost/thread.hpp>
 #include <primitives/zerocoin.h>
+#include <veil/zerocoin/accumulatorstate.h>
 
 static const char DB_COIN = 'C';
 static const char DB_ADDRESSINDEX = 'a';
@@ -28,7 +29,6 @@ static const char DB_SPENTINDEX = 'p';
 
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -153,7 +153,139 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe) {
+//! The false positive rate a key filter is built for
+static const double DB_KEY_FILTER_FP_RATE = 0.001;
+
+/** A key filter as kept in the database, with the chain tip the table was at when it was written */
+struct CPersistedKeyFilter
+{
+    uint256 hashBestBlock;
+    CKeySetBloomFilter& filter;
+
+    explicit CPersistedKeyFilter(CKeySetBloomFilter& filterIn) : filter(filterIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBestBlock);
+        READWRITE(filter);
+    }
+};
+
+void CDBKeyFilter::Load(const uint256* phashBestBlock)
+{
+    AssertLockHeld(cs);
+    std::unique_ptr<CKeySetBloomFilter> pfilterPersisted(new CKeySetBloomFilter());
+    CPersistedKeyFilter persisted(*pfilterPersisted);
+    bool fRead = db.Read(chPersisted, persisted);
+    // The kept copy is only current until the table is written to, so it must be gone before the filter is used
+    if (db.Erase(chPersisted, true) && fRead && phashBestBlock && persisted.hashBestBlock == *phashBestBlock) {
+        LogPrint(BCLog::DB, "%s: Loaded filter of table '%c'\n", __func__, chTable);
+        Publish(std::move(pfilterPersisted), false);
+        return;
+    }
+    if (fRead)
+        LogPrint(BCLog::DB, "%s: Dropped filter of table '%c' kept at %s\n", __func__, chTable, persisted.hashBestBlock.ToString());
+    Rebuild(false);
+}
+
+/** Build a filter of the keys in the table. With fKeepCurrent the current filter stays in use under it, for the keys
+ * inserted into it that are not written yet. */
+void CDBKeyFilter::Rebuild(bool fKeepCurrent)
+{
+    AssertLockHeld(cs);
+    int64_t nStart = GetTimeMillis();
+    std::vector<unsigned char> vchKey;
+    RawBytes key(vchKey);
+
+    unsigned int nKeys = 0;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    for (pcursor->Seek(chTable); pcursor->Valid() && pcursor->GetKey(key) && !vchKey.empty() && vchKey[0] == chTable; pcursor->Next())
+        nKeys++;
+
+    // The keys that are not written yet count too, the current filter outgrew its capacity with them
+    unsigned int nCapacity = std::max(nMinCapacity, 2 * nKeys);
+    if (fKeepCurrent)
+        nCapacity = std::max(nCapacity, 2 * pfilter.load()->pfilter->GetCapacity());
+    std::unique_ptr<CKeySetBloomFilter> pfilterNew(new CKeySetBloomFilter(nCapacity, DB_KEY_FILTER_FP_RATE));
+    for (pcursor->Seek(chTable); pcursor->Valid() && pcursor->GetKey(key) && !vchKey.empty() && vchKey[0] == chTable; pcursor->Next())
+        pfilterNew->insert(vchKey);
+    Publish(std::move(pfilterNew), fKeepCurrent);
+
+    LogPrint(BCLog::DB, "%s: Built filter of table '%c' for %u keys in %dms\n", __func__, chTable, nKeys, GetTimeMillis() - nStart);
+}
+
+void CDBKeyFilter::Publish(std::unique_ptr<CKeySetBloomFilter> pfilterNew, bool fKeepCurrent)
+{
+    AssertLockHeld(cs);
+    std::unique_ptr<CFilterLayer> player(new CFilterLayer{std::move(pfilterNew), fKeepCurrent ? pfilter.load() : nullptr});
+    pfilter = player.get();
+    vFilters.push_back(std::move(player));
+}
+
+bool CDBKeyFilter::MayContain(const std::vector<unsigned char>& vKey)
+{
+    const CFilterLayer* player = pfilter;
+    if (!player) {
+        LOCK(cs);
+        if (!pfilter)
+            Load(nullptr);
+        player = pfilter;
+    }
+    for (; player; player = player->pprev) {
+        if (player->pfilter->contains(vKey))
+            return true;
+    }
+    return false;
+}
+
+void CDBKeyFilter::Insert(const std::vector<unsigned char>& vKey)
+{
+    LOCK(cs);
+    if (!pfilter)
+        Load(nullptr);
+    if (fPersisted) {
+        db.Erase(chPersisted, true);
+        fPersisted = false;
+    }
+    // Keys inserted so far may not be in the table yet, so the full filter stays in use under the larger one
+    if (pfilter.load()->pfilter->IsOverCapacity())
+        Rebuild(true);
+    pfilter.load()->pfilter->insert(vKey);
+}
+
+void CDBKeyFilter::Load(const uint256& hashBestBlock)
+{
+    LOCK(cs);
+    if (!pfilter)
+        Load(&hashBestBlock);
+}
+
+bool CDBKeyFilter::Write(const uint256& hashBestBlock)
+{
+    LOCK(cs);
+    if (!pfilter)
+        return true;
+    // Everything is written now, so a filter of the table alone covers the keys of the replaced ones
+    if (pfilter.load()->pprev)
+        Rebuild(false);
+    CPersistedKeyFilter persisted(*pfilter.load()->pfilter);
+    persisted.hashBestBlock = hashBestBlock;
+    fPersisted = db.Write(chPersisted, persisted, true);
+    return fPersisted;
+}
+
+void CDBKeyFilter::Reset()
+{
+    LOCK(cs);
+    pfilter = nullptr;
+    fPersisted = false;
+    db.Erase(chPersisted, true);
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe),
+    keyImageFilter(*this, DB_RCTKEYIMAGE, DB_RCTKEYIMAGE_FILTER) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -259,6 +391,8 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    std::map<CAccumulatorHashes, std::shared_ptr<const CAccumulatorHashes>> mapAccumulatorHashes;
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -297,12 +431,14 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nAnonOutputs             = diskindex.nAnonOutputs;
 
                 // zerocoin
-                pindexNew->mapAccumulatorHashes = diskindex.mapAccumulatorHashes;
-                pindexNew->mapZerocoinSupply = diskindex.mapZerocoinSupply;
-                pindexNew->vMintDenominationsInBlock = diskindex.vMintDenominationsInBlock;
+                // Blocks between checkpoints share one instance of the accumulator hashes
+                auto itHashes = mapAccumulatorHashes.emplace(*diskindex.pAccumulatorHashes, diskindex.pAccumulatorHashes).first;
+                pindexNew->pAccumulatorHashes = itHashes->second;
+                pindexNew->arrZerocoinSupply = diskindex.arrZerocoinSupply;
+                pindexNew->arrMintsInBlock = diskindex.arrMintsInBlock;
 
-//                if (pindexNew->IsProofOfWork() && !CheckProofOfWork(pindexNew->GetBlockPoWHash(), pindexNew->nBits, consensusParams))
-//                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+                // No CheckProofOfWork() here: the x16r hash of every PoW header is checked once when the header is
+                // accepted, and that is remembered as BLOCK_POW_VERIFIED in nStatus loaded above.
 
                 pcursor->Next();
             } else {
@@ -357,16 +493,24 @@ bool CBlockTreeDB::EraseRCTOutputLink(const CCmpPubKey &pk)
 
 bool CBlockTreeDB::ReadRCTKeyImage(const CCmpPubKey &ki, uint256 &txhash)
 {
+    if (!keyImageFilter.MayContain(ki))
+        return false;
     return Read(std::make_pair(DB_RCTKEYIMAGE, ki), txhash);
 };
 
 bool CBlockTreeDB::WriteRCTKeyImage(const CCmpPubKey &ki, const uint256 &txhash)
 {
     CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_RCTKEYIMAGE, ki), txhash);
+    WriteRCTKeyImage(batch, ki, txhash);
     return WriteBatch(batch);
 };
 
+void CBlockTreeDB::WriteRCTKeyImage(CDBBatch &batch, const CCmpPubKey &ki, const uint256 &txhash)
+{
+    keyImageFilter.Insert(ki);
+    batch.Write(std::make_pair(DB_RCTKEYIMAGE, ki), txhash);
+};
+
 bool CBlockTreeDB::EraseRCTKeyImage(const CCmpPubKey &ki)
 {
     CDBBatch batch(*this);
@@ -497,7 +641,8 @@ bool CCoinsViewDB::Upgrade() {
     return !ShutdownRequested();
 }
 
-CZerocoinDB::CZerocoinDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "zerocoin", nCacheSize, fMemory, fWipe)
+CZerocoinDB::CZerocoinDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "zerocoin", nCacheSize, fMemory, fWipe),
+    coinSpendFilter(*this, DB_COINSPEND, DB_COINSPEND_FILTER)
 {
 }
 
@@ -542,7 +687,8 @@ bool CZerocoinDB::WriteCoinSpendBatch(const std::map<libzerocoin::CoinSpend, uin
         CDataStream ss(SER_GETHASH, 0);
         ss << bnSerial;
         uint256 hash = Hash(ss.begin(), ss.end());
-        batch.Write(std::make_pair('s', hash), it->second);
+        coinSpendFilter.Insert(hash);
+        batch.Write(std::make_pair(DB_COINSPEND, hash), it->second);
         ++count;
     }
 
@@ -556,12 +702,14 @@ bool CZerocoinDB::ReadCoinSpend(const CBigNum& bnSerial, uint256& txHash)
     ss << bnSerial;
     uint256 hash = Hash(ss.begin(), ss.end());
 
-    return Read(std::make_pair('s', hash), txHash);
+    return ReadCoinSpend(hash, txHash);
 }
 
 bool CZerocoinDB::ReadCoinSpend(const uint256& hashSerial, uint256 &txHash)
 {
-    return Read(std::make_pair('s', hashSerial), txHash);
+    if (!coinSpendFilter.MayContain(hashSerial))
+        return false;
+    return Read(std::make_pair(DB_COINSPEND, hashSerial), txHash);
 }
 
 bool CZerocoinDB::EraseCoinSpend(const CBigNum& bnSerial)
@@ -570,7 +718,7 @@ bool CZerocoinDB::EraseCoinSpend(const CBigNum& bnSerial)
     ss << bnSerial;
     uint256 hash = Hash(ss.begin(), ss.end());
 
-    return Erase(std::make_pair('s', hash));
+    return Erase(std::make_pair(DB_COINSPEND, hash));
 }
 
 bool CZerocoinDB::WipeCoins(std::string strType)
@@ -580,7 +728,7 @@ bool CZerocoinDB::WipeCoins(std::string strType)
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    char type = (strType == "spends" ? 's' : 'm');
+    char type = (strType == "spends" ? DB_COINSPEND : 'm');
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
     ssKeySet << std::make_pair(type, uint256());
     pcursor->Seek(ssKeySet.str());
@@ -629,3 +777,14 @@ bool CZerocoinDB::EraseAccumulatorValue(const uint256& hashChecksum)
     LogPrint(BCLog::ZEROCOINDB, "%s : checksum:%d\n", __func__, hashChecksum.GetHex());
     return Erase(std::make_pair('2', hashChecksum));
 }
+
+bool CZerocoinDB::WriteAccumulatorState(const AccumulatorState& accumulatorState)
+{
+    LogPrint(BCLog::ZEROCOINDB, "%s : block:%s height:%d\n", __func__, accumulatorState.hashBlock.GetHex(), accumulatorState.nHeight);
+    return Write('A', accumulatorState);
+}
+
+bool CZerocoinDB::ReadAccumulatorState(AccumulatorState& accumulatorState)
+{
+    return Read('A', accumulatorState);
+}
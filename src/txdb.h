@@ -6,27 +6,35 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include <bloom.h>
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
+#include <sync.h>
 #include <veil/ringct/rctindex.h>
 #include <primitives/block.h>
 #include <libzerocoin/Coin.h>
 #include <libzerocoin/CoinSpend.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+class AccumulatorState;
 class CBlockIndex;
 class CCoinsViewDBCursor;
 class uint256;
 
+const char DB_BLOCK_INDEX = 'b';
 const char DB_RCTOUTPUT = 'A';
 const char DB_RCTOUTPUT_LINK = 'L';
 const char DB_RCTKEYIMAGE = 'K';
+const char DB_RCTKEYIMAGE_FILTER = 'k';
+const char DB_COINSPEND = 's';
+const char DB_COINSPEND_FILTER = 'S';
 
 //! No need to periodic flush if at least this much space still available.
 static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
@@ -89,12 +97,91 @@ private:
     friend class CCoinsViewDB;
 };
 
+//! Keys a key filter is sized for at least
+static const unsigned int MIN_DB_KEY_FILTER_CAPACITY = 1 << 20;
+
+/**
+ * Bloom pre-filter over the keys of one table of a database, so that lookups of keys that are not in it (nearly all
+ * key image and serial lookups) do not reach LevelDB. Every key is inserted before it is written, so a negative
+ * answer is always right. It is built by scanning the table, or taken over from the copy written on the last clean
+ * shutdown if that was kept at the chain tip the database is at now, and is rebuilt larger when it outgrows its
+ * capacity. Keys inserted before such a rebuild may still be in a batch that is not written, so the replaced filter
+ * stays in use under the new one until the next scan of the whole table. Lookups do not take a lock.
+ */
+class CDBKeyFilter
+{
+private:
+    CDBWrapper& db;
+    const char chTable;
+    //! Key the filter is kept under from a clean shutdown until it is loaded at the next startup
+    const char chPersisted;
+
+    const unsigned int nMinCapacity;
+
+    //! A filter, on top of the filter it replaced while keys of that one may still be on their way to the table
+    struct CFilterLayer
+    {
+        std::unique_ptr<CKeySetBloomFilter> pfilter;
+        const CFilterLayer* pprev;
+    };
+
+    CCriticalSection cs;
+    //! The filters lookups use, replaced under cs
+    std::atomic<CFilterLayer*> pfilter;
+    //! Owns every filter built. Replaced ones are kept since a lookup may still be reading them, and are together
+    //! smaller than the current one as each rebuild doubles the capacity.
+    std::vector<std::unique_ptr<CFilterLayer>> vFilters GUARDED_BY(cs);
+    bool fPersisted GUARDED_BY(cs);
+
+    template <typename K>
+    std::vector<unsigned char> KeyBytes(const K& key) const
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << std::make_pair(chTable, key);
+        return std::vector<unsigned char>(ssKey.begin(), ssKey.end());
+    }
+
+    void Load(const uint256* phashBestBlock) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void Rebuild(bool fKeepCurrent) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void Publish(std::unique_ptr<CKeySetBloomFilter> pfilterNew, bool fKeepCurrent) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    bool MayContain(const std::vector<unsigned char>& vKey);
+    void Insert(const std::vector<unsigned char>& vKey);
+
+public:
+    CDBKeyFilter(CDBWrapper& dbIn, char chTableIn, char chPersistedIn, unsigned int nMinCapacityIn = MIN_DB_KEY_FILTER_CAPACITY) :
+        db(dbIn), chTable(chTableIn), chPersisted(chPersistedIn), nMinCapacity(nMinCapacityIn), pfilter(nullptr), fPersisted(false) {}
+
+    //! False if the table certainly does not have key
+    template <typename K>
+    bool MayContain(const K& key) { return MayContain(KeyBytes(key)); }
+
+    //! Must be called before key is written to the table
+    template <typename K>
+    void Insert(const K& key) { Insert(KeyBytes(key)); }
+
+    //! Build the filter at startup, taking over the kept copy only if it was written at hashBestBlock. Any kept
+    //! copy is erased. A filter first used without this drops the kept copy and scans the table.
+    void Load(const uint256& hashBestBlock);
+
+    //! Keep the filter for the next startup, with the chain tip the table is at. Every inserted key must be written
+    //! by then. Keys inserted afterwards drop the kept copy again.
+    bool Write(const uint256& hashBestBlock);
+
+    //! Forget the filter and any kept copy, after the table was written to without Insert
+    void Reset();
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
+private:
+    CDBKeyFilter keyImageFilter;
+
+public:
+
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info);
     bool ReadLastBlockFile(int &nFile);
@@ -114,7 +201,9 @@ public:
 
     bool ReadRCTKeyImage(const CCmpPubKey &ki, uint256 &txhash);
     bool WriteRCTKeyImage(const CCmpPubKey &ki, const uint256 &txhash);
+    void WriteRCTKeyImage(CDBBatch &batch, const CCmpPubKey &ki, const uint256 &txhash);
     bool EraseRCTKeyImage(const CCmpPubKey &ki);
+    CDBKeyFilter& KeyImageFilter() { return keyImageFilter; }
 };
 
 /** Zerocoin database (zerocoin/) */
@@ -127,6 +216,8 @@ private:
     CZerocoinDB(const CZerocoinDB&);
     void operator=(const CZerocoinDB&);
 
+    CDBKeyFilter coinSpendFilter;
+
 public:
     /** Write zPIV mints to the zerocoinDB in a batch */
     bool WriteCoinMintBatch(const std::map<libzerocoin::PublicCoin, uint256>& mintInfo);
@@ -138,10 +229,13 @@ public:
     bool ReadCoinSpend(const uint256& hashSerial, uint256 &txHash);
     bool EraseCoinMint(const CBigNum& bnPubcoin);
     bool EraseCoinSpend(const CBigNum& bnSerial);
+    CDBKeyFilter& CoinSpendFilter() { return coinSpendFilter; }
     bool WipeCoins(std::string strType);
     bool WriteAccumulatorValue(const uint256& nChecksum, const CBigNum& bnValue);
     bool ReadAccumulatorValue(const uint256& nChecksum, CBigNum& bnValue);
     bool EraseAccumulatorValue(const uint256& nChecksum);
+    bool WriteAccumulatorState(const AccumulatorState& accumulatorState);
+    bool ReadAccumulatorState(AccumulatorState& accumulatorState);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -23,6 +23,7 @@ int64_t GetTime();
 int64_t GetTimeMillis();
 int64_t GetTimeMicros();
 int64_t GetSystemTimeInSeconds(); // Like GetTime(), but not mockable
+int64_t GetThreadCPUTimeMicros(); // CPU time of the calling thread, or the system time where that is not available
 void SetMockTime(int64_t nMockTimeIn);
 int64_t GetMockTime();
 void MilliSleep(int64_t n);
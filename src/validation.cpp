@@ -10,6 +10,7 @@
 #include <veil/zerocoin/accumulatormap.h>
 #include <veil/ringct/anon.h>
 #include <arith_uint256.h>
+#include <blockperf.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -62,6 +63,7 @@
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
+#include <boost/variant.hpp>
 #include "veil/zerocoin/accumulators.h"
 
 #if defined(NDEBUG)
@@ -180,8 +182,9 @@ public:
     /**
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to mapBlockIndex.
+     * fPoWVerified means the caller has already checked the PoW of the header.
      */
-    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake, bool fProofOfFullNode) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake, bool fProofOfFullNode, bool fPoWVerified = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool ContextualCheckZerocoinStake(CBlockIndex* pindex, CStakeInput* stake);
 
@@ -209,6 +212,7 @@ public:
 private:
     bool ActivateBestChainStep(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace);
     bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool);
+    void PreVerifyBlocksToConnect(const CChainParams& chainparams, const std::shared_ptr<const CBlock>& pblock);
 
     CBlockIndex* AddToBlockIndex(const CBlockHeader& block, bool fProofOfStake = false, bool fProofOfFullNode = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
@@ -245,6 +249,7 @@ std::atomic_bool fReindex(false);
 std::atomic_bool fVerifying(false);
 bool fSkipRangeproof = false;
 bool fHavePruned = false;
+bool fHaveSnapshotChainstate = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
@@ -337,6 +342,7 @@ static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfte
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks,
         unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata,
         std::vector<CScriptCheck> *pvChecks = nullptr, bool fAnonChecks = true);
+static bool VerifyZerocoinSpendProof(const libzerocoin::CoinSpend& spend, ProofCacheMode cacheMode);
 static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 
 bool CheckFinalTx(const CTransaction &tx, int flags)
@@ -612,7 +618,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         *pfMissingInputs = false;
     }
 
-    if (!CheckTransaction(tx, state))
+    if (!CheckTransaction(tx, state, true, ProofCacheMode::MEMPOOL))
         return false; // state filled in by CheckTransaction
 
     // Coinbase is only valid in a block, not as a loose transaction
@@ -1110,6 +1116,51 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee, test_accept);
 }
 
+bool VerifyTxProofs(const CTransaction& tx, CValidationState& state)
+{
+    if (!CheckTransaction(tx, state, true, ProofCacheMode::PREVERIFY))
+        return false;
+
+    // Only these are accepted as loose transactions
+    if (tx.IsCoinBase() || tx.IsCoinStake())
+        return true;
+
+    bool fHasAnonInputs = false;
+    std::set<CBigNum> setSerials;
+    for (const CTxIn& txin : tx.vin) {
+        if (txin.IsAnonInput()) {
+            fHasAnonInputs = true;
+            continue;
+        }
+        if (!txin.scriptSig.IsZerocoinSpend())
+            continue;
+
+        auto spend = TxInToZerocoinSpend(txin);
+        if (!spend)
+            return state.DoS(100, false, REJECT_INVALID, "bad-zcspend");
+
+        // A spend of a serial that is spent already is rejected by AcceptToMemoryPool without its proof, so its
+        // proof is not worth verifying. A serial in the zerocoin database is taken as spent here without looking
+        // for its transaction in the chain, which needs cs_main.
+        const CBigNum& bnSerial = spend->getCoinSerialNumber();
+        if (!setSerials.emplace(bnSerial).second)
+            return state.Invalid(false, REJECT_INVALID, "zcspend-tx-dupl-serials");
+        uint256 txidSpend;
+        if (pzerocoinDB->ReadCoinSpend(bnSerial, txidSpend))
+            return state.Invalid(false, REJECT_DUPLICATE, "zcspend-already-known");
+        if (mempool.HasZerocoinSerial(GetSerialHash(bnSerial)))
+            return state.Invalid(false, REJECT_DUPLICATE, "zcspend-already-in-mempool");
+
+        if (!spend->HasValidSignature() || !VerifyZerocoinSpendProof(*spend, ProofCacheMode::PREVERIFY))
+            return state.DoS(100, false, REJECT_INVALID, "bad-zcspend-proof");
+    }
+
+    if (fHasAnonInputs && !VerifyMLSAG(tx, state, ProofCacheMode::PREVERIFY))
+        return false;
+
+    return true;
+}
+
 /**
  * Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock.
  * If blockIndex is provided, the transaction is fetched from the corresponding block.
@@ -1637,8 +1688,11 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 }
             }
 
-            if (fHasAnonInput && fAnonChecks && !VerifyMLSAG(tx, state))
-                return false;
+            if (fHasAnonInput && fAnonChecks) {
+                CBlockPerfSpan perfSpan(BlockPerfPhase::MLSAG);
+                if (!VerifyMLSAG(tx, state, cacheSigStore ? ProofCacheMode::MEMPOOL : ProofCacheMode::BLOCK))
+                    return false;
+            }
 
             if (cacheFullScriptStore && !pvChecks) {
                 // We executed all of the provided scripts, and were told to
@@ -1972,11 +2026,209 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+/** Check of the x16r proof of work of one header, run on the validation check queue. */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader* pheader;
+    const Consensus::Params* pparams;
+
+public:
+    CHeaderPoWCheck() : pheader(nullptr), pparams(nullptr) {}
+    CHeaderPoWCheck(const CBlockHeader& header, const Consensus::Params& params) : pheader(&header), pparams(&params) {}
+
+    bool operator()()
+    {
+        return CheckProofOfWork(pheader->GetPoWHash(), pheader->nBits, *pparams);
+    }
+
+    void swap(CHeaderPoWCheck& check)
+    {
+        std::swap(pheader, check.pheader);
+        std::swap(pparams, check.pparams);
+    }
+};
+
+/** A block going through the context-free checks ahead of being accepted or connected while importing. */
+struct CBlockPreVerifyEntry
+{
+    //! Read from pos when not given, and dropped if it does not hash to hash
+    std::shared_ptr<CBlock> pblock;
+    uint256 hash;
+    CDiskBlockPos pos;
+    bool fPoWVerified = false;
+    //! Set when the accumulator proofs of all zerocoin spends verified and their SoK proofs are in vSpendProofs
+    bool fHaveSpendProofs = false;
+    std::vector<libzerocoin::SerialNumberSoKProof> vSpendProofs;
+};
+
+/**
+ * Collect the SoK proofs of all zerocoin spends in a block for batch verification, checking their accumulator
+ * proofs on the way. Does not take cs_main, the connect thread holds it while waiting for these checks.
+ */
+static bool GetBlockZerocoinSpendProofs(const CBlock& block, std::vector<libzerocoin::SerialNumberSoKProof>& vProofs)
+{
+    for (const auto& tx : block.vtx) {
+        if (!tx->IsZerocoinSpend())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!txin.scriptSig.IsZerocoinSpend())
+                continue;
+            auto spend = TxInToZerocoinSpend(txin);
+            if (!spend)
+                return false;
+
+            // The checkpoint may only be written once an earlier block of this batch is connected
+            CBigNum bnAccumulatorValue = 0;
+            if (!pzerocoinDB->ReadAccumulatorValue(spend->getAccumulatorChecksum(), bnAccumulatorValue))
+                return false;
+            libzerocoin::Accumulator accumulator(Params().Zerocoin_Params(), spend->getDenomination(), bnAccumulatorValue);
+
+            std::string strError;
+            if (!spend->Verify(accumulator, strError, false))
+                return false;
+            vProofs.emplace_back(spend->getSmallSoK(), spend->getCoinSerialNumber(), spend->getSerialComm(),
+                                 spend->getHashSig());
+        }
+    }
+    return true;
+}
+
+/**
+ * Closure representing the context-free checks of one block: CheckBlock (x16r PoW, PoS block signature,
+ * rangeproofs) and optionally collecting its spend proofs. A block that fails is left unchecked rather than failing
+ * the batch, so that it is rejected with the usual state by whoever accepts or connects it.
+ */
+class CBlockPreVerify
+{
+private:
+    CBlockPreVerifyEntry* pentry;
+    const Consensus::Params* pparams;
+    bool fCollectSpendProofs;
+
+public:
+    CBlockPreVerify() : pentry(nullptr), pparams(nullptr), fCollectSpendProofs(false) {}
+    CBlockPreVerify(CBlockPreVerifyEntry& entry, const Consensus::Params& params, bool fCollectSpendProofsIn) :
+        pentry(&entry), pparams(&params), fCollectSpendProofs(fCollectSpendProofsIn) {}
+
+    bool operator()()
+    {
+        if (!pentry->pblock) {
+            std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockRead, pentry->pos, *pparams) || pblockRead->GetHash() != pentry->hash)
+                return true;
+            pentry->pblock = pblockRead;
+        }
+
+        CBlockPerfScope perfScope(pentry->hash);
+        CValidationState state;
+        if (!CheckBlock(*pentry->pblock, state, *pparams, true, true, pentry->fPoWVerified))
+            return true;
+
+        if (fCollectSpendProofs)
+            pentry->fHaveSpendProofs = GetBlockZerocoinSpendProofs(*pentry->pblock, pentry->vSpendProofs);
+        return true;
+    }
+
+    void swap(CBlockPreVerify& check)
+    {
+        std::swap(pentry, check.pentry);
+        std::swap(pparams, check.pparams);
+        std::swap(fCollectSpendProofs, check.fCollectSpendProofs);
+    }
+};
+
+/**
+ * One check on the validation check queue. Script checks, header PoW checks and block pre-verification share the
+ * same worker threads; the queue divides each batch by its size, so a few blocks spread as well as many scripts.
+ */
+class CValidationCheck
+{
+private:
+    boost::variant<CScriptCheck, CHeaderPoWCheck, CBlockPreVerify> check;
+
+    struct RunCheck : public boost::static_visitor<bool>
+    {
+        template <typename T>
+        bool operator()(T& checkIn) const { return checkIn(); }
+    };
+
+public:
+    CValidationCheck() {}
+    explicit CValidationCheck(CScriptCheck&& checkIn) : check(std::move(checkIn)) {}
+    explicit CValidationCheck(CHeaderPoWCheck&& checkIn) : check(std::move(checkIn)) {}
+    explicit CValidationCheck(CBlockPreVerify&& checkIn) : check(std::move(checkIn)) {}
+
+    bool operator()()
+    {
+        return boost::apply_visitor(RunCheck(), check);
+    }
+
+    void swap(CValidationCheck& checkIn)
+    {
+        check.swap(checkIn.check);
+    }
+};
+
+static CCheckQueue<CValidationCheck> validationcheckqueue(128);
 
 void ThreadScriptCheck() {
     RenameThread("veil-scriptch");
-    scriptcheckqueue.Thread();
+    validationcheckqueue.Thread();
+}
+
+/** Add checks of one of the kinds held by CValidationCheck to the validation check queue */
+template <typename T>
+static void AddValidationChecks(CCheckQueueControl<CValidationCheck>& control, std::vector<T>& vChecks)
+{
+    std::vector<CValidationCheck> vQueued;
+    vQueued.reserve(vChecks.size());
+    for (T& check : vChecks)
+        vQueued.emplace_back(std::move(check));
+    control.Add(vQueued);
+}
+
+/** Blocks read ahead and checked at a time while importing */
+static const unsigned int MAX_BLOCKS_PREVERIFY = 32;
+
+/**
+ * Run the context-free checks of a batch of blocks in parallel. With fCollectSpendProofs the SoK proofs of all
+ * blocks are batch verified afterwards, and the blocks whose spends were covered get fSignaturesVerified so that
+ * ConnectBlock does not verify them again.
+ */
+static void PreVerifyBlocks(std::vector<CBlockPreVerifyEntry>& vEntries, const Consensus::Params& consensusParams,
+        bool fCollectSpendProofs)
+{
+    if (vEntries.empty())
+        return;
+
+    std::vector<CBlockPreVerify> vChecks;
+    vChecks.reserve(vEntries.size());
+    for (CBlockPreVerifyEntry& entry : vEntries)
+        vChecks.emplace_back(entry, consensusParams, fCollectSpendProofs);
+
+    CCheckQueueControl<CValidationCheck> control(&validationcheckqueue);
+    AddValidationChecks(control, vChecks);
+    control.Wait();
+
+    if (!fCollectSpendProofs)
+        return;
+
+    std::vector<libzerocoin::SerialNumberSoKProof> vProofs;
+    for (const CBlockPreVerifyEntry& entry : vEntries) {
+        if (entry.fHaveSpendProofs)
+            vProofs.insert(vProofs.end(), entry.vSpendProofs.begin(), entry.vSpendProofs.end());
+    }
+    if (!vProofs.empty()) {
+        LogPrint(BCLog::REINDEX, "%s: Batch verifying %d zeroknowledge proofs\n", __func__, vProofs.size());
+        if (!libzerocoin::SerialNumberSoKProof::BatchVerify(vProofs))
+            return;
+    }
+
+    for (const CBlockPreVerifyEntry& entry : vEntries) {
+        if (entry.fHaveSpendProofs)
+            entry.pblock->fSignaturesVerified = true;
+    }
 }
 
 // Protected by cs_main
@@ -2068,6 +2320,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     assert(pindex);
     assert(*pindex->phashBlock == block.GetHash());
     int64_t nTimeStart = GetTimeMicros();
+    CBlockPerfSpan perfSpan(BlockPerfPhase::CONNECT_BLOCK);
 
     // Check it again in case a previous version let a bad block in
     // NOTE: We don't currently (re-)invoke ContextualCheckBlock() or
@@ -2082,7 +2335,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // is enforced in ContextualCheckBlockHeader(); we wouldn't want to
     // re-enforce that rule here (at least until we make it impossible for
     // GetAdjustedTime() to go backward).
-    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck)) {
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck, pindex->nStatus & BLOCK_POW_VERIFIED)) {
         if (state.CorruptionPossible()) {
             // We don't write down blocks to disk if they may have been
             // corrupted, so this should be impossible unless we're having hardware
@@ -2242,7 +2495,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     CBlockUndo blockundo;
 
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    CCheckQueueControl<CValidationCheck> control(fScriptChecks && nScriptCheckThreads ? &validationcheckqueue : nullptr);
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -2351,6 +2604,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
                     setSerialsInBlock.emplace(spend->getCoinSerialNumber());
                     mapSpends.emplace(*spend, tx.GetHash());
+                    CBlockPerfSpan perfSpanSpend(BlockPerfPhase::ZEROCOIN_SPEND);
                     if (!ContextualCheckZerocoinSpend(tx, *spend.get(), block.GetHash(), pindex, fSkipSigVerify))
                         return state.DoS(100, error("%s: failed to add block %s with invalid zerocoinspend", __func__,
                                                     tx.GetHash().GetHex()), REJECT_INVALID);
@@ -2388,6 +2642,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                     if (!pOut->IsZerocoinMint())
                         continue;
 
+                    CBlockPerfSpan perfSpanMint(BlockPerfPhase::ZEROCOIN_MINT);
                     libzerocoin::PublicCoin coin(Params().Zerocoin_Params());
                     if (!OutputToPublicCoin(pOut.get(), coin))
                         return state.DoS(100, error("%s: failed final check of zerocoinmint for tx %s", __func__, tx.GetHash().GetHex()), REJECT_INVALID);
@@ -2415,11 +2670,14 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         if (!tx.IsCoinBase()) {
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
-                return error("ConnectBlock(): CheckInputs on %s failed with %s",
-                    tx.GetHash().ToString(), FormatStateMessage(state));
+            {
+                CBlockPerfSpan perfSpanInputs(BlockPerfPhase::INPUTS);
+                if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
+                    return error("ConnectBlock(): CheckInputs on %s failed with %s",
+                        tx.GetHash().ToString(), FormatStateMessage(state));
+            }
 
-            control.Add(vChecks);
+            AddValidationChecks(control, vChecks);
 
             blockundo.vtxundo.push_back(CTxUndo());
             UpdateCoins(tx, view, blockundo.vtxundo.back(), pindex->nHeight);
@@ -2434,6 +2692,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
         // Index rct outputs and keyimages
         if (state.fHasAnonOutput || state.fHasAnonInput) {
+            CBlockPerfSpan perfSpanIndex(BlockPerfPhase::RCT_INDEX);
             COutPoint op(txhash, 0);
             for (const auto &txin : tx.vin) {
                 if (txin.IsAnonInput()) {
@@ -2498,7 +2757,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (!AddZerocoinsToIndex(pindex, block, mapSpends, mapMints, fJustCheck))
         return state.DoS(100, error("%s: Failed to calculate new zerocoin supply for block=%s height=%d", __func__,
                                     block.GetHash().GetHex(), pindex->nHeight), REJECT_INVALID);
-    pindex->mapAccumulatorHashes = block.mapAccumulatorHashes;
+    pindex->SetAccumulatorHashes(block.mapAccumulatorHashes);
 
     // track money supply and mint amount info
     CAmount nMoneySupplyPrev = pindex->pprev ? pindex->pprev->nMoneySupply : 0;
@@ -2525,7 +2784,11 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         if (!block.IsProofOfStake())
             return state.DoS(100, error("%s: block marked as proof of full node that is not proof of stake", __func__));
 
-        uint256 hashRequired = veil::GetFullNodeHash(block, pindex->pprev);
+        uint256 hashRequired;
+        {
+            CBlockPerfSpan perfSpanPoFN(BlockPerfPhase::POFN);
+            hashRequired = veil::GetFullNodeHash(block, pindex->pprev);
+        }
         if (block.hashPoFN != hashRequired)
             return state.DoS(100, error("%s: block's Proof of Full node hash is invalid. Block=%s Required=%s",
                     __func__, block.hashPoFN.GetHex(), hashRequired.GetHex()), REJECT_INVALID, "bad-fullnode-hash");
@@ -2583,12 +2846,18 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     // Ensure that accumulator checkpoints are valid and in the same state as this instance of the chain
     AccumulatorMap mapAccumulators(Params().Zerocoin_Params());
-    if (!ValidateAccumulatorCheckpoint(block, pindex, mapAccumulators))
-        return state.DoS(100, error("%s: Failed to validate accumulator checkpoint for block=%s height=%d", __func__,
-                                    block.GetHash().GetHex(), pindex->nHeight), REJECT_INVALID, "bad-acc-checkpoint");
+    {
+        CBlockPerfSpan perfSpanAccumulator(BlockPerfPhase::ACCUMULATOR_CHECKPOINT);
+        if (!ValidateAccumulatorCheckpoint(block, pindex, mapAccumulators))
+            return state.DoS(100, error("%s: Failed to validate accumulator checkpoint for block=%s height=%d", __func__,
+                                        block.GetHash().GetHex(), pindex->nHeight), REJECT_INVALID, "bad-acc-checkpoint");
+    }
 
-    if (!control.Wait())
-        return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+    {
+        CBlockPerfSpan perfSpanWait(BlockPerfPhase::SCRIPT_WAIT);
+        if (!control.Wait())
+            return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+    }
 
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
@@ -2646,8 +2915,11 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (pindex->nHeight > 10 && pindex->nHeight % 10 == 0)
         DatabaseChecksums(mapAccumulators);
 
-    if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
-        return false;
+    {
+        CBlockPerfSpan perfSpanUndo(BlockPerfPhase::UNDO_WRITE);
+        if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
+            return false;
+    }
 
     if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
@@ -2768,6 +3040,8 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // The accumulator state is keyed by its block, so a failed write only costs a rebuild on startup
+            FlushAccumulatorState();
             nLastFlush = nNow;
             full_flush_completed = true;
         }
@@ -2832,7 +3106,7 @@ bool FlushView(CCoinsViewCache *view, CValidationState& state, bool fDisconnecti
         CDBBatch batch(*pblocktree);
 
         for (auto &it : view->keyImages)
-            batch.Write(std::make_pair(DB_RCTKEYIMAGE, it.first), it.second);
+            pblocktree->WriteRCTKeyImage(batch, it.first, it.second);
 
         for (auto &it : view->anonOutputs)
             batch.Write(std::make_pair(DB_RCTOUTPUT, it.first), it.second);
@@ -2953,6 +3227,7 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
         bool flushed = FlushView(&view, state, true);
         assert(flushed);
     }
+    DisconnectAccumulatorState(pindexDelete);
 
     LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * MILLI);
 
@@ -3054,6 +3329,52 @@ public:
     }
 };
 
+/** Blocks read and checked ahead of ConnectTip while importing, by hash. Protected by cs_main */
+static std::map<uint256, std::shared_ptr<const CBlock>> mapBlocksPreVerified;
+
+/**
+ * Read the next blocks towards the most-work chain while importing and run their context-free checks and spend proof
+ * batch verification in parallel, leaving ConnectBlock only the contextual work. cs_main is only held to pick the
+ * blocks and to hand them over, not while they are checked. Only refills once the next block is no longer cached,
+ * so that every refill is a full batch.
+ */
+void CChainState::PreVerifyBlocksToConnect(const CChainParams& chainparams, const std::shared_ptr<const CBlock>& pblock)
+{
+    AssertLockNotHeld(cs_main);
+    std::vector<CBlockPreVerifyEntry> vEntries;
+    {
+        LOCK(cs_main);
+        CBlockIndex* pindexMostWork = FindMostWorkChain();
+        if (!pindexMostWork || pindexMostWork == chainActive.Tip())
+            return;
+        const CBlockIndex* pindexFork = chainActive.FindFork(pindexMostWork);
+        const int nForkHeight = pindexFork ? pindexFork->nHeight : -1;
+        if (mapBlocksPreVerified.count(pindexMostWork->GetAncestor(nForkHeight + 1)->GetBlockHash()))
+            return;
+        mapBlocksPreVerified.clear();
+
+        int nTargetHeight = std::min(nForkHeight + (int)MAX_BLOCKS_PREVERIFY, pindexMostWork->nHeight);
+        for (const CBlockIndex* pindex = pindexMostWork->GetAncestor(nTargetHeight); pindex && pindex != pindexFork; pindex = pindex->pprev) {
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA) || (pblock && pblock->GetHash() == pindex->GetBlockHash()))
+                continue;
+            vEntries.emplace_back();
+            vEntries.back().hash = pindex->GetBlockHash();
+            vEntries.back().pos = pindex->GetBlockPos();
+            vEntries.back().fPoWVerified = pindex->nStatus & BLOCK_POW_VERIFIED;
+        }
+    }
+    std::reverse(vEntries.begin(), vEntries.end());
+
+    int64_t nStart = GetTimeMicros();
+    PreVerifyBlocks(vEntries, chainparams.GetConsensus(), true);
+    LOCK(cs_main);
+    for (const CBlockPreVerifyEntry& entry : vEntries) {
+        if (entry.pblock)
+            mapBlocksPreVerified.emplace(entry.hash, entry.pblock);
+    }
+    LogPrint(BCLog::BENCH, "  - Pre-verify %u blocks: %.2fms\n", vEntries.size(), (GetTimeMicros() - nStart) * MILLI);
+}
+
 /**
  * Connect a new block to chainActive. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -3063,10 +3384,15 @@ public:
 bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool)
 {
     assert(pindexNew->pprev == chainActive.Tip());
-    // Read block from disk.
+    CBlockPerfScope perfScope(pindexNew->GetBlockHash(), pindexNew->nHeight);
+    // Read block from disk, unless it was read ahead while importing.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
-    if (!pblock) {
+    auto itPreVerified = mapBlocksPreVerified.find(pindexNew->GetBlockHash());
+    if (!pblock && itPreVerified != mapBlocksPreVerified.end()) {
+        pthisBlock = itPreVerified->second;
+        mapBlocksPreVerified.erase(itPreVerified);
+    } else if (!pblock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus())) {
             return AbortNode(state, "Failed to read block");
@@ -3095,10 +3421,14 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
 
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
+        CBlockPerfSpan perfSpanIndex(BlockPerfPhase::RCT_INDEX);
         bool flushed = FlushView(&view, state, false);
         assert(flushed);
     }
 
+    // Keep the rolling accumulator state in step with the chain. A failure only means it is rebuilt when next needed.
+    ConnectAccumulatorState(blockConnecting, pindexNew);
+
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
 
@@ -3236,6 +3566,9 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
         }
         nHeight = nTargetHeight;
 
+        if (!fImporting && !mapBlocksPreVerified.empty())
+            mapBlocksPreVerified.clear();
+
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
@@ -3341,6 +3674,9 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
             SyncWithValidationInterfaceQueue();
         }
 
+        if (fImporting)
+            PreVerifyBlocksToConnect(chainparams, pblock);
+
         {
             LOCK(cs_main);
             CBlockIndex* starting_tip = chainActive.Tip();
@@ -3735,27 +4071,28 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckProofOfFullNode = false)
+static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckProofOfFullNode = false, bool fPoWVerified = false)
 {
     //Prevent Proof of full node and proof of work existing together
     if (fCheckPOW && fCheckProofOfFullNode)
         return state.DoS(50, false, REJECT_INVALID, "PoW and PoFN conflict", false, "Block attempted to use both PoW and PoFN");
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+    if (fCheckPOW && !fPoWVerified && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fPoWVerified)
 {
     // These are checks that are independent of context.
     if (block.fChecked)
         return true;
+    CBlockPerfSpan perfSpan(BlockPerfPhase::CHECK_BLOCK);
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, (fCheckPOW && block.IsProofOfWork()), block.fProofOfFullNode))
+    if (!CheckBlockHeader(block, state, consensusParams, (fCheckPOW && block.IsProofOfWork()), block.fProofOfFullNode, fPoWVerified))
         return false;
 
     // Check the block signature if it is a proof of stake block
@@ -3868,21 +4205,21 @@ bool AddZerocoinsToIndex(CBlockIndex* pindex, const CBlock& block, const std::ma
     // Initialize zerocoin supply to the supply from previous block
     if (pindex->pprev) {
         for (auto& denom : libzerocoin::zerocoinDenomList) {
-            pindex->mapZerocoinSupply.at(denom) = pindex->pprev->mapZerocoinSupply.at(denom);
+            pindex->arrZerocoinSupply.at(denom) = pindex->pprev->arrZerocoinSupply.at(denom);
         }
     }
 
     // Track zerocoin money supply
     CAmount nAmountZerocoinSpent = 0;
-    pindex->vMintDenominationsInBlock.clear();
+    pindex->arrMintsInBlock = CDenominationArray<uint32_t>();
     if (pindex->pprev) {
         std::set<uint256> setAddedToWallet;
         for (auto& pMint : mapMints) {
             const auto& coin = pMint.first;
             const auto& txid = pMint.second;
             libzerocoin::CoinDenomination denom = coin.getDenomination();
-            pindex->vMintDenominationsInBlock.push_back(denom);
-            pindex->mapZerocoinSupply.at(denom)++;
+            pindex->arrMintsInBlock.at(denom)++;
+            pindex->arrZerocoinSupply.at(denom)++;
 
             //Remove any of our own mints from the mintpool
             if (!pwalletMain || fJustCheck)
@@ -3907,11 +4244,11 @@ bool AddZerocoinsToIndex(CBlockIndex* pindex, const CBlock& block, const std::ma
 
         for (auto& pSpend : mapSpends) {
             auto denom = pSpend.first.getDenomination();
-            pindex->mapZerocoinSupply.at(denom)--;
+            pindex->arrZerocoinSupply.at(denom)--;
             nAmountZerocoinSpent += libzerocoin::ZerocoinDenominationToAmount(denom);
 
             // zerocoin failsafe
-            if (pindex->mapZerocoinSupply.at(denom) < 0)
+            if (pindex->arrZerocoinSupply.at(denom) < 0)
                 return error("Block contains zerocoins that spend more than are in the available supply to spend");
         }
     }
@@ -3931,6 +4268,31 @@ bool ContextualCheckZerocoinMint(const CTransaction& tx, const libzerocoin::Publ
     return true;
 }
 
+/**
+ * Check that a zerocoin spend proves a coin of its accumulator checkpoint. Spends found in the proof cache are not
+ * verified again; cacheMode tells whether hits are evicted or where the ones that were verified are added.
+ */
+static bool VerifyZerocoinSpendProof(const libzerocoin::CoinSpend& spend, ProofCacheMode cacheMode)
+{
+    // The spend commits to its accumulator checkpoint, whose value is fixed by its checksum
+    const uint256 hashProof = (CHashWriter(SER_GETHASH, 0) << std::string("zerocoinspend") << spend).GetHash();
+    if (GetCachedProof(hashProof, cacheMode))
+        return true;
+
+    CBigNum bnAccumulatorValue;
+    if (!pzerocoinDB->ReadAccumulatorValue(spend.getAccumulatorChecksum(), bnAccumulatorValue))
+        return error("%s: Cannot find accumulator checkpoint in zerocoinDB\n", __func__);
+    libzerocoin::Accumulator accumulator(Params().Zerocoin_Params(), spend.getDenomination(), bnAccumulatorValue);
+
+    //Check that the coin has been accumulated
+    std::string strError;
+    if (!spend.Verify(accumulator, strError, true))
+        return error("CheckZerocoinSpend(): zerocoin spend did not verify");
+
+    AddCachedProof(hashProof, cacheMode);
+    return true;
+}
+
 bool ContextualCheckZerocoinSpend(const CTransaction& tx, const libzerocoin::CoinSpend& spend, const uint256& hashBlock,
         CBlockIndex* pindex, bool fSkipSignatureVerify)
 {
@@ -3958,17 +4320,8 @@ bool ContextualCheckZerocoinSpend(const CTransaction& tx, const libzerocoin::Coi
 
     //Check the signature of the spend
     // Skip signature verification during initial block download
-    if (!fSkipSignatureVerify) {
-        CBigNum bnAccumulatorValue;
-        if (!pzerocoinDB->ReadAccumulatorValue(spend.getAccumulatorChecksum(), bnAccumulatorValue))
-            return error("%s: Cannot find accumulator checkpoint in zerocoinDB\n", __func__);
-        libzerocoin::Accumulator accumulator(Params().Zerocoin_Params(), spend.getDenomination(), bnAccumulatorValue);
-
-        //Check that the coin has been accumulated
-        std::string strError;
-        if (!spend.Verify(accumulator, strError, true))
-            return error("CheckZerocoinSpend(): zerocoin spend did not verify");
-    }
+    if (!fSkipSignatureVerify && !VerifyZerocoinSpendProof(spend, ProofCacheMode::BLOCK))
+        return false;
 
     return true;
 }
@@ -4132,13 +4485,14 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake, bool fProofOfFullNode)
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake, bool fProofOfFullNode, bool fPoWVerified)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
+    bool fPoWChecked = false;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
         if (miSelf != mapBlockIndex.end()) {
             // Block header is already known.
@@ -4151,8 +4505,9 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
         }
 
         bool fCheckPoW = !block.fProofOfStake;
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPoW, fProofOfFullNode))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPoW, fProofOfFullNode, fPoWVerified))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
+        fPoWChecked = fCheckPoW;
 
         // Get prev block index
         CBlockIndex* pindexPrev = nullptr;
@@ -4183,8 +4538,12 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             }
         }
     }
-    if (pindex == nullptr)
+    if (pindex == nullptr) {
         pindex = AddToBlockIndex(block, fProofOfStake, fProofOfFullNode);
+        // Remembered in the block index, so the x16r hash is not computed again for this block
+        if (fPoWChecked)
+            pindex->nStatus |= BLOCK_POW_VERIFIED;
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -4195,16 +4554,43 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
 }
 
 // Exposed wrapper for AcceptBlockHeader
+/**
+ * Check the PoW of all new PoW headers of a headers message on the validation check queue, without holding cs_main.
+ * Returns true only if every one of them is valid; otherwise AcceptBlockHeader checks them one by one again,
+ * which finds the invalid header.
+ */
+static bool CheckHeadersPoW(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
+{
+    if (!nScriptCheckThreads)
+        return false;
+
+    std::vector<CHeaderPoWCheck> vChecks;
+    {
+        LOCK(cs_main);
+        for (const CBlockHeader& header : headers) {
+            if (!header.fProofOfStake && !mapBlockIndex.count(header.GetHash()))
+                vChecks.emplace_back(header, consensusParams);
+        }
+    }
+    if (vChecks.size() < 2)
+        return false;
+
+    CCheckQueueControl<CValidationCheck> control(&validationcheckqueue);
+    AddValidationChecks(control, vChecks);
+    return control.Wait();
+}
+
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+    bool fPoWVerified = CheckHeadersPoW(headers, chainparams.GetConsensus());
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
             bool fProofOfStake = header.fProofOfStake;// todo, no easy way to know if this is PoS block - maybe look at hash value?
             bool fProofOfFullNode = header.fProofOfFullNode;
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex, fProofOfStake, fProofOfFullNode)) {
+            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex, fProofOfStake, fProofOfFullNode, fPoWVerified)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -4270,11 +4656,15 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
 
     if (fNewBlock) *fNewBlock = false;
     AssertLockHeld(cs_main);
+    // Only takes effect for blocks loaded from files, ProcessNewBlock has a scope already
+    CBlockPerfScope perfScope(block.GetHash());
 
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!AcceptBlockHeader(block, state, chainparams, &pindex, block.fProofOfStake, block.fProofOfFullNode))
+    // A PoW block that already passed CheckBlock() had its PoW checked there
+    bool fPoWVerified = block.fChecked && block.IsProofOfWork();
+    if (!AcceptBlockHeader(block, state, chainparams, &pindex, block.fProofOfStake, block.fProofOfFullNode, fPoWVerified))
         return error("%s: AcceptBlockHeader failed for block %s", __func__, block.GetHash().GetHex());
 
     //! Validate Proof of Stake (skip if a reindex is in progress)
@@ -4282,6 +4672,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
         if (!block.IsProofOfStake())
             return state.DoS(100, error("%s: Blockheader marked as PoS but block is not PoS", __func__));
         
+        CBlockPerfSpan perfSpan(BlockPerfPhase::STAKE);
         uint256 hashProofOfStake = uint256();
         unique_ptr<CStakeInput> stake;
 
@@ -4327,7 +4718,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
         if (pindex->nChainWork < nMinimumChainWork) return true;
     }
 
-    if (!CheckBlock(block, state, chainparams.GetConsensus()) ||
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), true, true, pindex->nStatus & BLOCK_POW_VERIFIED) ||
         !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -4366,12 +4757,21 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
     AssertLockNotHeld(cs_main);
 
     {
+        CBlockPerfScope perfScope(pblock->GetHash());
         CBlockIndex *pindex = nullptr;
         if (fNewBlock) *fNewBlock = false;
         CValidationState state;
+        bool fPoWVerified = false;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(pblock->GetHash());
+            if (mi != mapBlockIndex.end())
+                fPoWVerified = mi->second->nStatus & BLOCK_POW_VERIFIED;
+        }
+
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
-        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus(), true, true, fPoWVerified);
 
         LOCK(cs_main);
 
@@ -4750,6 +5150,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     if (fHavePruned)
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
 
+    pblocktree->ReadFlag("chainstatesnapshot", fHaveSnapshotChainstate);
+    if (fHaveSnapshotChainstate)
+        LogPrintf("LoadBlockIndexDB(): Chainstate was loaded from a snapshot\n");
+
     // Check whether we need to continue reindexing
     bool fReindexing = false;
     pblocktree->ReadReindexing(fReindexing);
@@ -4832,8 +5236,8 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone, false);
         if (pindex->nHeight <= chainActive.Height()-nCheckDepth)
             break;
-        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
-            // If pruning, only go back as far as we have data.
+        if ((fPruneMode || fHaveSnapshotChainstate) && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // If pruning or started from a snapshot, only go back as far as we have data.
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
         }
@@ -4842,7 +5246,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
             return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus()))
+        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus(), true, true, pindex->nStatus & BLOCK_POW_VERIFIED))
             return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
                          pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
         // check level 2: verify undo validity
@@ -5036,8 +5440,8 @@ bool CChainState::RewindBlockIndex(const CChainParams& params)
     CValidationState state;
     CBlockIndex* pindex = chainActive.Tip();
     while (chainActive.Height() >= nHeight) {
-        if (fPruneMode && !(chainActive.Tip()->nStatus & BLOCK_HAVE_DATA)) {
-            // If pruning, don't try rewinding past the HAVE_DATA point;
+        if ((fPruneMode || fHaveSnapshotChainstate) && !(chainActive.Tip()->nStatus & BLOCK_HAVE_DATA)) {
+            // If pruning or started from a snapshot, don't try rewinding past the HAVE_DATA point;
             // since older blocks can't be served anyway, there's
             // no need to walk further, and trying to DisconnectTip()
             // will fail (and require a needless reindex/redownload
@@ -5142,6 +5546,7 @@ void UnloadBlockIndex()
     pindexBestHeader = nullptr;
     mempool.clear();
     mapBlocksUnlinked.clear();
+    mapBlocksPreVerified.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
@@ -5156,6 +5561,7 @@ void UnloadBlockIndex()
     }
     mapBlockIndex.clear();
     fHavePruned = false;
+    fHaveSnapshotChainstate = false;
 
     g_chainstate.UnloadBlockIndex();
 }
@@ -5190,7 +5596,10 @@ bool CChainState::LoadGenesisBlock(const CChainParams& chainparams)
     // mapBlockIndex. Note that we can't use chainActive here, since it is
     // set based on the coins db, not the block index db, which is the only
     // thing loaded at this point.
-    if (mapBlockIndex.count(chainparams.GenesisBlock().GetHash()))
+    // A node started from a chainstate snapshot has the genesis entry, but
+    // not the block itself yet.
+    BlockMap::iterator mi = mapBlockIndex.find(chainparams.GenesisBlock().GetHash());
+    if (mi != mapBlockIndex.end() && (!fHaveSnapshotChainstate || (mi->second->nStatus & BLOCK_HAVE_DATA)))
         return true;
 
     try {
@@ -5198,7 +5607,7 @@ bool CChainState::LoadGenesisBlock(const CChainParams& chainparams)
         CDiskBlockPos blockPos = SaveBlockToDisk(block, 0, chainparams, nullptr);
         if (blockPos.IsNull())
             return error("%s: writing genesis block to disk failed", __func__);
-        CBlockIndex *pindex = AddToBlockIndex(block);
+        CBlockIndex *pindex = mi != mapBlockIndex.end() ? mi->second : AddToBlockIndex(block);
         ReceivedBlockTransactions(block, pindex, blockPos, chainparams.GetConsensus());
     } catch (const std::runtime_error& e) {
         return error("%s: failed to write genesis block: %s", __func__, e.what());
@@ -5223,107 +5632,144 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        bool fEnd = false;
+        bool fAbort = false;
+        while (!fEnd && !fAbort && !blkdat.eof()) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+            // Read ahead a batch of blocks so that their context-free checks can run in parallel, AcceptBlock then
+            // finds them checked already
+            std::vector<CBlockPreVerifyEntry> vEntries;
+            while (vEntries.size() < MAX_BLOCKS_PREVERIFY && !blkdat.eof()) {
+                blkdat.SetPos(nRewind);
+                nRewind++; // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(chainparams.MessageStart()[0]);
+                    nRewind = blkdat.GetPos()+1;
+                    blkdat >> buf;
+                    if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fEnd = true;
+                    break;
+                }
+                try {
+                    // read block
+                    uint64_t nBlockPos = blkdat.GetPos();
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                    blkdat >> *pblock;
+                    nRewind = blkdat.GetPos();
+
+                    vEntries.emplace_back();
+                    vEntries.back().pblock = pblock;
+                    vEntries.back().hash = pblock->GetHash();
+                    if (dbp)
+                        vEntries.back().pos = CDiskBlockPos(dbp->nFile, nBlockPos);
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                }
             }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
+
+            {
+                // Blocks that are already stored do not need checking again
+                std::vector<CBlockPreVerifyEntry> vCheck;
                 {
                     LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
+                    for (const CBlockPreVerifyEntry& entry : vEntries) {
+                        CBlockIndex* pindex = LookupBlockIndex(entry.hash);
+                        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0)
+                            vCheck.push_back(entry);
                     }
+                }
+                PreVerifyBlocks(vCheck, chainparams.GetConsensus(), false);
+            }
+
+            for (CBlockPreVerifyEntry& entry : vEntries) {
+                try {
+                    if (dbp)
+                        *dbp = entry.pos;
+                    std::shared_ptr<CBlock> pblock = entry.pblock;
+                    const CBlock& block = *pblock;
+                    const uint256& hash = entry.hash;
+                    {
+                        LOCK(cs_main);
+                        // detect out of order blocks, and store them for later
+                        if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
+                            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                                    block.hashPrevBlock.ToString());
+                            if (dbp)
+                                mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                            continue;
+                        }
 
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      CValidationState state;
-                      if (g_chainstate.AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                      LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+                        // process in case the block isn't known yet
+                        CBlockIndex* pindex = LookupBlockIndex(hash);
+                        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+                          CValidationState state;
+                          if (g_chainstate.AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
+                              nLoaded++;
+                          }
+                          if (state.IsError()) {
+                              fAbort = true;
+                              break;
+                          }
+                        } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+                          LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+                        }
                     }
-                }
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
+                    // Activate the genesis block so normal node progress can continue
+                    if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+                        CValidationState state;
+                        if (!ActivateBestChain(state, chainparams)) {
+                            fAbort = true;
+                            break;
+                        }
                     }
-                }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (g_chainstate.AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                    NotifyHeaderTip();
+
+                    // Recursively process earlier encountered successors of this block
+                    std::deque<uint256> queue;
+                    queue.push_back(hash);
+                    while (!queue.empty()) {
+                        uint256 head = queue.front();
+                        queue.pop_front();
+                        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                        while (range.first != range.second) {
+                            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
                             {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
+                                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                                        head.ToString());
+                                LOCK(cs_main);
+                                CValidationState dummy;
+                                if (g_chainstate.AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                                {
+                                    nLoaded++;
+                                    queue.push_back(pblockrecursive->GetHash());
+                                }
                             }
+                            range.first++;
+                            mapBlocksUnknownParent.erase(it);
+                            NotifyHeaderTip();
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
                     }
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
     } catch (const std::runtime_error& e) {
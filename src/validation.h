@@ -191,6 +191,8 @@ static const uint64_t nMinDiskSpace = 52428800;
 /** Pruning-related variables and constants */
 /** True if any block files have ever been pruned. */
 extern bool fHavePruned;
+/** True if the chainstate was loaded from a snapshot, so blocks before it are missing like pruned ones. */
+extern bool fHaveSnapshotChainstate;
 /** True if we're running in -prune mode. */
 extern bool fPruneMode;
 /** Number of MiB of block files that we're trying to stay below. */
@@ -266,7 +268,7 @@ bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs
 bool LoadChainTip(const CChainParams& chainparams);
 /** Unload database information */
 void UnloadBlockIndex();
-/** Run an instance of the script checking thread */
+/** Run an instance of the validation checking thread: scripts, header PoW and blocks checked ahead while importing */
 void ThreadScriptCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
@@ -315,6 +317,16 @@ void PruneBlockFilesManual(int nManualPruneHeight);
 
 bool FlushView(CCoinsViewCache *view, CValidationState& state, bool fDisconnecting);
 
+/**
+ * Verify the proofs of a transaction: its rangeproofs, MLSAG signatures and zerocoin spends. Needs no lock,
+ * so that it can run on another thread before AcceptToMemoryPool; the proofs that verify are cached in the
+ * pre-verification caches, which leaves only the contextual checks to AcceptToMemoryPool under cs_main while
+ * the proofs of a relayed transaction never evict the ones of the mempool. AcceptToMemoryPool does not check
+ * zerocoin spend proofs, their cache entries save the work in ConnectBlock. Spends of serials that are known
+ * to be spent are refused before their proofs are verified.
+ */
+bool VerifyTxProofs(const CTransaction& tx, CValidationState& state);
+
 /** (try to) add transaction to memory pool
  * plTxnReplaced will be appended to with all transactions replaced from mempool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
@@ -421,8 +433,9 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
 
 /** Functions for validating blocks and updating the block tree */
 
-/** Context-independent validity checks */
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
+/** Context-independent validity checks. fPoWVerified skips recomputing the x16r hash of a header that is known to
+ *  satisfy its PoW (BLOCK_POW_VERIFIED), while still counting the PoW as checked. */
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fPoWVerified = false);
 
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -171,6 +171,8 @@ public:
     void FlushBackgroundCallbacks();
 
     size_t CallbacksPending();
+    /** Whether a CScheduler is registered, so that CallFunctionInValidationInterfaceQueue() can be used */
+    bool HasBackgroundScheduler() const { return m_internals != nullptr; }
 
     /** Register with mempool to call TransactionRemovedFromMempool callbacks */
     void RegisterWithMempoolSignals(CTxMemPool& pool);
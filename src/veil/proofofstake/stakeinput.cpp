@@ -32,7 +32,7 @@ int ZerocoinStake::GetChecksumHeightFromMint()
     //Need to return the first occurance of this checksum in order for the validation process to identify a specific
     //block height
     uint256 nChecksum;
-    nChecksum = chainActive[nHeightChecksum]->mapAccumulatorHashes[denom];
+    nChecksum = chainActive[nHeightChecksum]->GetAccumulatorHash(denom);
     return GetChecksumHeight(nChecksum, denom);
 }
 
@@ -103,7 +103,7 @@ bool ZerocoinStake::GetModifier(uint64_t& nStakeModifier)
         pindex = pindex->pprev;
     }
 
-    nStakeModifier = UintToArith256(pindex->mapAccumulatorHashes[denom]).GetLow64();
+    nStakeModifier = UintToArith256(pindex->GetAccumulatorHash(denom)).GetLow64();
     return true;
 }
 
@@ -14,12 +14,14 @@
 #include <util.h>
 #include <validation.h>
 #include <validationinterface.h>
+#include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/sha256.h>
 #include <chainparams.h>
 #include <txmempool.h>
 
 
-bool VerifyMLSAG(const CTransaction &tx, CValidationState &state)
+bool VerifyMLSAG(const CTransaction &tx, CValidationState &state, ProofCacheMode cacheMode)
 {
     int rv;
     std::set<int64_t> setHaveI; // Anon prev-outputs can only be used once per transaction.
@@ -149,9 +151,18 @@ bool VerifyMLSAG(const CTransaction &tx, CValidationState &state)
                 &vpInCommits[0], &vpOutCommits[0], nullptr)))
             return state.DoS(100, error("%s: prepare-mlsag-failed %d", __func__, rv), REJECT_INVALID, "prepare-mlsag-failed");
 
+        // The ring members are resolved into vM, so the hash covers everything the signature is verified against
+        uint256 hashProof;
+        CSHA256().Write((const uint8_t*)"mlsag", 5).Write(hashOutputs.begin(), 32).Write(vM.data(), vM.size())
+            .Write(vKeyImages.data(), vKeyImages.size()).Write(vDL.data(), vDL.size()).Finalize(hashProof.begin());
+        if (GetCachedProof(hashProof, cacheMode))
+            continue;
+
         if (0 != (rv = secp256k1_verify_mlsag(secp256k1_ctx_blind, hashOutputs.begin(), nCols, nRows, &vM[0], &vKeyImages[0],
                 &vDL[0], &vDL[32])))
             return state.DoS(100, error("%s: verify-mlsag-failed %d", __func__, rv), REJECT_INVALID, "verify-mlsag-failed");
+
+        AddCachedProof(hashProof, cacheMode);
     }
 
     // Verify commitment sums match
@@ -223,6 +234,33 @@ bool RemoveKeyImagesFromMempool(const uint256 &hash, const CTxIn &txin, CTxMemPo
 }
 
 
+bool GetMaxAnonInputIndex(const CTransaction &tx, int64_t &nMaxIndex)
+{
+    nMaxIndex = -1;
+    for (const auto &txin : tx.vin) {
+        if (!txin.IsAnonInput())
+            continue;
+        if (txin.scriptWitness.stack.empty())
+            return false;
+
+        uint32_t nInputs, nRingSize;
+        txin.GetAnonInfo(nInputs, nRingSize);
+        if (nInputs < 1 || nInputs > MAX_ANON_INPUTS || nRingSize < MIN_RINGSIZE || nRingSize > MAX_RINGSIZE)
+            return false;
+
+        const std::vector<uint8_t> &vMI = txin.scriptWitness.stack[0];
+        size_t ofs = 0, nB = 0;
+        for (size_t i = 0; i < nInputs * nRingSize; ++i) {
+            int64_t nIndex;
+            if (ofs >= vMI.size() || 0 != GetVarInt(vMI, ofs, (uint64_t &) nIndex, nB))
+                return false;
+            ofs += nB;
+            nMaxIndex = std::max(nMaxIndex, nIndex);
+        }
+    }
+    return nMaxIndex >= 0;
+}
+
 bool AllAnonOutputsUnknown(const CTransaction &tx, CValidationState &state)
 {
     state.fHasAnonOutput = false;
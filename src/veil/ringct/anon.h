@@ -5,6 +5,7 @@
 #define VEIL_ANON_H
 
 #include <inttypes.h>
+#include <consensus/tx_verify.h>
 #include <primitives/transaction.h>
 
 class CTxMemPool;
@@ -18,11 +19,18 @@ const size_t MAX_ANON_INPUTS = 32; // To raise see MLSAG_MAX_ROWS also
 const size_t ANON_FEE_MULTIPLIER = 2;
 
 
-bool VerifyMLSAG(const CTransaction &tx, CValidationState &state);
+/**
+ * Verify the MLSAG signatures of the anon inputs of a transaction. Signatures found in the proof cache are not
+ * verified again; cacheMode tells whether hits are evicted or where the ones that were verified are added.
+ */
+bool VerifyMLSAG(const CTransaction &tx, CValidationState &state, ProofCacheMode cacheMode = ProofCacheMode::BLOCK);
 
 bool AddKeyImagesToMempool(const CTransaction &tx, CTxMemPool &pool);
 bool RemoveKeyImagesFromMempool(const uint256 &hash, const CTxIn &txin, CTxMemPool &pool);
 
+/** Get the highest ring member index of the anon inputs of a transaction; false if it has none or they are malformed */
+bool GetMaxAnonInputIndex(const CTransaction &tx, int64_t &nMaxIndex);
+
 bool AllAnonOutputsUnknown(const CTransaction &tx, CValidationState &state);
 
 bool RollBackRCTIndex(int64_t nLastValidRCTOutput, int64_t nExpectErase, std::set<CCmpPubKey> &setKi);
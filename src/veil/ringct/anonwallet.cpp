@@ -174,6 +174,7 @@ bool AnonWallet::Initialise(CExtKey* pExtMaster)
 void AnonWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
+    pwalletParent->MarkAnonBalanceDirty();
 
 //    setLockedCoins.erase(outpoint);
 
@@ -188,6 +189,7 @@ void AnonWallet::LoadToWallet(const uint256 &hash, const CTransactionRecord &rtx
 
     MapRecords_t::iterator mri = ret.first;
     rtxOrdered.insert(std::make_pair(rtx.GetTxTime(), mri));
+    UpdateUnspentIndex(hash);
 
     // TODO: Spend only owned inputs?
 
@@ -199,7 +201,7 @@ bool AnonWallet::LoadTxRecords()
     LOCK(pwalletParent->cs_wallet);
 
     AnonWalletDB pwdb(*walletDatabase);
-    Dbc *pcursor;
+    std::unique_ptr<DatabaseCursor> pcursor;
     if (!(pcursor = pwdb.GetCursor())) {
         throw std::runtime_error(strprintf("%s: cannot create DB cursor", __func__).c_str());
     }
@@ -214,7 +216,7 @@ bool AnonWallet::LoadTxRecords()
     size_t nCount = 0;
     unsigned int fFlags = DB_SET_RANGE;
     ssKey << sPrefix;
-    while (pwdb.ReadAtCursor(pcursor, ssKey, ssValue, fFlags) == 0) {
+    while (pwdb.ReadAtCursor(pcursor.get(), ssKey, ssValue, fFlags) == 0) {
         fFlags = DB_NEXT;
         ssKey >> strType;
         if (strType != sPrefix) {
@@ -229,6 +231,13 @@ bool AnonWallet::LoadTxRecords()
         nCount++;
     }
 
+    // Spends by archived records of outputs that are still loaded
+    if (pwdb.ReadArchiveSummary(archiveSummary)) {
+        for (const auto &spend : archiveSummary.vSpends)
+            AddToSpends(spend.first, spend.second);
+        LogPrintf("%s: %u transaction records are archived\n", __func__, archiveSummary.nRecords);
+    }
+
     // Must load all records before marking spent.
 
     {
@@ -528,10 +537,11 @@ CAmount AnonWallet::GetDebit(const CTxIn &txin, const isminefilter &filter) cons
 {
     {
         LOCK(pwalletParent->cs_wallet);
+        CTransactionRecord rtxArchived;
         MapRecords_t::const_iterator mri = mapRecords.find(txin.prevout.hash);
-        if (mri != mapRecords.end())
+        if (mri != mapRecords.end() || GetArchivedRecord(txin.prevout.hash, rtxArchived))
         {
-            const COutputRecord *oR = mri->second.GetOutput(txin.prevout.n);
+            const COutputRecord *oR = (mri != mapRecords.end() ? mri->second : rtxArchived).GetOutput(txin.prevout.n);
 
             if (oR)
             {
@@ -581,10 +591,11 @@ CAmount AnonWallet::GetDebit(AnonWalletDB *pwdb, const CTransactionRecord &rtx,
                 continue;
             pPrevout = &kiPrevout;
         };
+        CTransactionRecord rtxArchived;
         auto mri = mapRecords.find(pPrevout->hash);
-        if (mri != mapRecords.end())
+        if (mri != mapRecords.end() || GetArchivedRecord(pPrevout->hash, rtxArchived))
         {
-            const COutputRecord *oR = mri->second.GetOutput(pPrevout->n);
+            const COutputRecord *oR = (mri != mapRecords.end() ? mri->second : rtxArchived).GetOutput(pPrevout->n);
 
             if (oR
                 && (filter & ISMINE_SPENDABLE)
@@ -692,9 +703,10 @@ void AnonWallet::GetCredit(const CTransaction &tx, CAmount &nSpendable, CAmount
 
 bool AnonWallet::GetOutputRecord(const COutPoint& outpoint, COutputRecord& record) const
 {
-    if (!mapRecords.count(outpoint.hash))
+    CTransactionRecord rArchived;
+    if (!mapRecords.count(outpoint.hash) && !GetArchivedRecord(outpoint.hash, rArchived))
         return false;
-    auto& r = mapRecords.at(outpoint.hash);
+    auto& r = mapRecords.count(outpoint.hash) ? mapRecords.at(outpoint.hash) : rArchived;
     auto precord = r.GetOutput(outpoint.n);
     if (!precord)
         return error("%s: Could no locate output record. FIXME", __func__);
@@ -921,10 +933,10 @@ CAmount AnonWallet::GetBlindBalance()
 
     LOCK2(cs_main, pwalletParent->cs_wallet);
 
-    for (const auto &ri : mapRecords)
+    for (MapRecords_t::const_iterator ri : GetUnspentRecords({OUTPUT_CT}, true))
     {
-        const auto &txhash = ri.first;
-        const auto &rtx = ri.second;
+        const auto &txhash = ri->first;
+        const auto &rtx = ri->second;
 
         if (!IsTrusted(txhash, rtx.blockHash))
             continue;
@@ -947,10 +959,10 @@ CAmount AnonWallet::GetAnonBalance()
     CAmount nBalance = 0;
 
     LOCK2(cs_main, pwalletParent->cs_wallet);
-    for (const auto &ri : mapRecords)
+    for (MapRecords_t::const_iterator ri : GetUnspentRecords({OUTPUT_RINGCT}, true))
     {
-        const auto &txhash = ri.first;
-        const auto &rtx = ri.second;
+        const auto &txhash = ri->first;
+        const auto &rtx = ri->second;
 
         if (!IsTrusted(txhash, rtx.blockHash))
             continue;
@@ -973,9 +985,10 @@ bool AnonWallet::GetBalances(BalanceList &bal)
     assert(pwalletParent);
     LOCK2(cs_main, pwalletParent->cs_wallet);
 
-    for (const auto &ri : mapRecords) {
-        const auto &txhash = ri.first;
-        const auto &rtx = ri.second;
+    // Standard outputs are not counted here, only records with CT and RingCT coins can contribute
+    for (MapRecords_t::const_iterator ri : GetUnspentRecords({OUTPUT_CT, OUTPUT_RINGCT}, true)) {
+        const auto &txhash = ri->first;
+        const auto &rtx = ri->second;
 
         bool fTrusted = IsTrusted(txhash, rtx.blockHash);
         bool fInMempool = false;
@@ -1686,6 +1699,191 @@ bool AnonWallet::SaveRecord(const uint256& txid, const CTransactionRecord& rtx)
     if (!wdb.WriteTxRecord(txid, rtx))
         return error("%s: failed to write tx record\n", __func__);
     mapRecords[txid] = rtx;
+    UpdateUnspentIndex(txid);
+    pwalletParent->MarkAnonBalanceDirty();
+    return true;
+}
+
+bool AnonWallet::GetRecord(const uint256& txid, CTransactionRecord& rtx) const
+{
+    auto mi = mapRecords.find(txid);
+    if (mi != mapRecords.end()) {
+        rtx = mi->second;
+        return true;
+    }
+    return GetArchivedRecord(txid, rtx);
+}
+
+bool AnonWallet::GetArchivedRecord(const uint256& txid, CTransactionRecord& rtx) const
+{
+    if (archiveSummary.nRecords == 0)
+        return false;
+
+    auto mi = mapArchivedCache.find(txid);
+    if (mi != mapArchivedCache.end()) {
+        rtx = mi->second;
+        return true;
+    }
+
+    if (!AnonWalletDB(*walletDatabase, "r").ReadArchivedTxRecord(txid, rtx))
+        return false;
+
+    if (mapArchivedCache.size() >= MAX_ARCHIVED_RECORD_CACHE)
+        mapArchivedCache.clear();
+    mapArchivedCache.emplace(txid, rtx);
+    return true;
+}
+
+bool AnonWallet::IsSpentBeforeDepth(const COutPoint& outpoint, int nMinDepth) const
+{
+    auto range = mapTxSpends.equal_range(outpoint);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto mi = mapRecords.find(it->second);
+        // Spenders that are not loaded have been archived, so they are deep enough
+        if (mi == mapRecords.end())
+            return true;
+        const CTransactionRecord &rtxSpend = mi->second;
+        if (rtxSpend.nIndex >= 0 && GetDepthInMainChain(rtxSpend.blockHash, rtxSpend.nIndex) >= nMinDepth)
+            return true;
+    }
+    return false;
+}
+
+bool AnonWallet::CompactRecords(int nMinDepth, size_t& nArchived, std::string& sError)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(pwalletParent->cs_wallet);
+
+    nArchived = 0;
+    if (nMinDepth < MIN_ANON_COMPACT_DEPTH) {
+        sError = strprintf("Records must be at least %d blocks deep to be archived", MIN_ANON_COMPACT_DEPTH);
+        return false;
+    }
+
+    std::set<uint256> setArchive;
+    for (const auto &ri : mapRecords) {
+        const uint256 &txhash = ri.first;
+        const CTransactionRecord &rtx = ri.second;
+        if (rtx.nIndex < 0 || GetDepthInMainChain(rtx.blockHash, rtx.nIndex) < nMinDepth)
+            continue;
+
+        bool fArchive = true;
+        for (const auto &r : rtx.vout) {
+            if (r.nFlags & ORF_LOCKED) {
+                fArchive = false;
+                break;
+            }
+            if ((r.nFlags & ORF_OWN_ANY) && !IsSpentBeforeDepth(COutPoint(txhash, r.n), nMinDepth)) {
+                fArchive = false;
+                break;
+            }
+        }
+        if (fArchive)
+            setArchive.insert(txhash);
+    }
+
+    if (setArchive.empty())
+        return true;
+
+    CAnonArchiveSummary summary = archiveSummary;
+    summary.nHeight = chainActive.Height();
+    summary.vSpends.clear();
+    for (const auto &spend : mapTxSpends) {
+        if (!mapRecords.count(spend.first.hash) || setArchive.count(spend.first.hash))
+            continue;
+        if (!mapRecords.count(spend.second) || setArchive.count(spend.second))
+            summary.vSpends.emplace_back(spend.first, spend.second);
+    }
+
+    AnonWalletDB wdb(*walletDatabase);
+    if (!wdb.TxnBegin()) {
+        sError = "TxnBegin failed";
+        return false;
+    }
+    for (const uint256 &txhash : setArchive) {
+        const CTransactionRecord &rtx = mapRecords.at(txhash);
+        if (!wdb.WriteArchivedTxRecord(txhash, rtx) || !wdb.EraseTxRecord(txhash)) {
+            wdb.TxnAbort();
+            sError = "Failed to move record " + txhash.ToString() + " to the archive";
+            return false;
+        }
+
+        int64_t nTime = rtx.GetTxTime();
+        if (summary.nRecords == 0 || nTime < summary.nTimeFirst)
+            summary.nTimeFirst = nTime;
+        if (summary.nRecords == 0 || nTime > summary.nTimeLast)
+            summary.nTimeLast = nTime;
+        summary.nRecords++;
+        for (const auto &r : rtx.vout) {
+            if (r.nFlags & ORF_OWN_ANY)
+                summary.nReceived += r.GetAmount();
+        }
+    }
+    if (!wdb.WriteArchiveSummary(summary) || !wdb.TxnCommit()) {
+        wdb.TxnAbort();
+        sError = "Failed to write the archive summary";
+        return false;
+    }
+
+    // The database is updated, drop the records from memory
+    for (auto it = rtxOrdered.begin(); it != rtxOrdered.end();) {
+        if (setArchive.count(it->second->first))
+            it = rtxOrdered.erase(it);
+        else
+            ++it;
+    }
+    for (const uint256 &txhash : setArchive) {
+        mapRecords.erase(txhash);
+        UpdateUnspentIndex(txhash);
+    }
+
+    // Like after a restart, keep the spends of loaded records and the spends by archived records of loaded outputs
+    for (auto it = mapTxSpends.begin(); it != mapTxSpends.end();) {
+        if (setArchive.count(it->second) && !mapRecords.count(it->first.hash))
+            it = mapTxSpends.erase(it);
+        else
+            ++it;
+    }
+    archiveSummary = summary;
+    nArchived = setArchive.size();
+    pwalletParent->MarkAnonBalanceDirty();
+
+    LogPrintf("%s: archived %u transaction records, %u records remain loaded\n", __func__, nArchived, mapRecords.size());
+    return true;
+}
+
+bool AnonWallet::RestoreArchivedRecord(AnonWalletDB& wdb, const CTransaction& tx)
+{
+    AssertLockHeld(pwalletParent->cs_wallet);
+
+    const uint256 txhash = tx.GetHash();
+    CTransactionRecord rtx;
+    if (!wdb.ReadArchivedTxRecord(txhash, rtx))
+        return false;
+
+    if (!wdb.WriteTxRecord(txhash, rtx) || !wdb.EraseArchivedTxRecord(txhash))
+        return error("%s: failed to restore archived record %s", __func__, txhash.ToString());
+
+    archiveSummary.nRecords--;
+    for (const auto &r : rtx.vout) {
+        if (r.nFlags & ORF_OWN_ANY)
+            archiveSummary.nReceived -= r.GetAmount();
+    }
+    for (auto it = archiveSummary.vSpends.begin(); it != archiveSummary.vSpends.end();) {
+        if (it->second == txhash)
+            it = archiveSummary.vSpends.erase(it);
+        else
+            ++it;
+    }
+    if (!wdb.WriteArchiveSummary(archiveSummary))
+        return error("%s: failed to write archive summary", __func__);
+    mapArchivedCache.erase(txhash);
+
+    LoadToWallet(txhash, rtx);
+    for (const auto &txin : tx.vin)
+        AddTxinToSpends(txin, txhash);
+
+    LogPrintf("%s: restored archived record %s\n", __func__, txhash.ToString());
     return true;
 }
 
@@ -3500,7 +3698,7 @@ bool AnonWallet::LoadKeys()
 
     AnonWalletDB wdb(*walletDatabase);
 
-    Dbc *pcursor;
+    std::unique_ptr<DatabaseCursor> pcursor;
     if (!(pcursor = wdb.GetCursor()))
         return error("%s: cannot create DB cursor", __func__);
 
@@ -3509,7 +3707,7 @@ bool AnonWallet::LoadKeys()
 
     unsigned int fFlags = DB_SET_RANGE;
     ssKey << std::string("ek32_n");
-    while (wdb.ReadAtCursor(pcursor, ssKey, ssValue, fFlags) == 0) {
+    while (wdb.ReadAtCursor(pcursor.get(), ssKey, ssValue, fFlags) == 0) {
         fFlags = DB_NEXT;
 
         std::string strType;
@@ -3540,7 +3738,7 @@ bool AnonWallet::LoadAccountCounters()
 
     AnonWalletDB wdb(*walletDatabase);
 
-    Dbc *pcursor;
+    std::unique_ptr<DatabaseCursor> pcursor;
     if (!(pcursor = wdb.GetCursor()))
         return error("%s: cannot create DB cursor", __func__);
 
@@ -3549,7 +3747,7 @@ bool AnonWallet::LoadAccountCounters()
 
     unsigned int fFlags = DB_SET_RANGE;
     ssKey << std::string("acct_c");
-    while (wdb.ReadAtCursor(pcursor, ssKey, ssValue, fFlags) == 0) {
+    while (wdb.ReadAtCursor(pcursor.get(), ssKey, ssValue, fFlags) == 0) {
         fFlags = DB_NEXT;
 
         std::string strType;
@@ -3745,7 +3943,7 @@ int AnonWallet::LoadStealthAddresses()
 
     AnonWalletDB wdb(*walletDatabase);
 
-    Dbc *pcursor;
+    std::unique_ptr<DatabaseCursor> pcursor;
     if (!(pcursor = wdb.GetCursor())) {
         return werrorN(1, "%s: cannot create DB cursor", __func__);
     }
@@ -3758,7 +3956,7 @@ int AnonWallet::LoadStealthAddresses()
 
     unsigned int fFlags = DB_SET_RANGE;
     ssKey << std::string("sxad");
-    while (wdb.ReadAtCursor(pcursor, ssKey, ssValue, fFlags) == 0) {
+    while (wdb.ReadAtCursor(pcursor.get(), ssKey, ssValue, fFlags) == 0) {
         fFlags = DB_NEXT;
 
         ssKey >> strType;
@@ -3818,7 +4016,7 @@ bool AnonWallet::ProcessLockedStealthOutputs()
         return werror("%s: TxnBegin failed.", __func__);
     }
 
-    Dbc *pcursor;
+    std::unique_ptr<DatabaseCursor> pcursor;
     if (!(pcursor = wdb.GetTxnCursor())) {
         return werror("%s: Cannot create DB cursor.", __func__);
     }
@@ -3836,7 +4034,7 @@ bool AnonWallet::ProcessLockedStealthOutputs()
     size_t nExpanded = 0;
     unsigned int fFlags = DB_SET_RANGE;
     ssKey << std::string("sxkm");
-    while (wdb.ReadAtCursor(pcursor, ssKey, ssValue, fFlags) == 0) {
+    while (wdb.ReadAtCursor(pcursor.get(), ssKey, ssValue, fFlags) == 0) {
         fFlags = DB_NEXT;
         ssKey >> strType;
         if (strType != "sxkm") {
@@ -3936,7 +4134,7 @@ bool AnonWallet::ProcessLockedBlindedOutputs()
         return werror("%s: TxnBegin failed.", __func__);
     }
 
-    Dbc *pcursor;
+    std::unique_ptr<DatabaseCursor> pcursor;
     if (!(pcursor = wdb.GetTxnCursor())) {
         return werror("%s: Cannot create DB cursor.", __func__);
     }
@@ -3949,7 +4147,7 @@ bool AnonWallet::ProcessLockedBlindedOutputs()
     CStoredTransaction stx;
     unsigned int fFlags = DB_SET_RANGE;
     ssKey << std::string("lao");
-    while (wdb.ReadKeyAtCursor(pcursor, ssKey, fFlags) == 0) {
+    while (wdb.ReadKeyAtCursor(pcursor.get(), ssKey, fFlags) == 0) {
         fFlags = DB_NEXT;
         ssKey >> strType;
         if (strType != "lao") {
@@ -4025,6 +4223,9 @@ bool AnonWallet::ProcessLockedBlindedOutputs()
                 return false;
             }
 
+            // The amount is known now, as if AddToRecord had seen the output unlocked
+            UpdateUnspentIndex(op.hash);
+            pwalletParent->MarkAnonBalanceDirty();
             setChanged.insert(op.hash);
         }
 
@@ -4044,6 +4245,19 @@ bool AnonWallet::ProcessLockedBlindedOutputs()
     return true;
 }
 
+bool AnonWallet::ProcessLockedOutputs()
+{
+    LOCK(pwalletParent->cs_wallet);
+    if (!m_locked_outputs_pending)
+        return true;
+
+    // The keys of stealth outputs are needed to recover the amounts of blinded ones
+    if (!ProcessLockedStealthOutputs() || !ProcessLockedBlindedOutputs())
+        return false;
+    m_locked_outputs_pending = false;
+    return true;
+}
+
 inline bool MatchPrefix(uint32_t nAddrBits, uint32_t addrPrefix, uint32_t outputPrefix, bool fHavePrefix)
 {
     if (nAddrBits < 1) { // addresses without prefixes scan all incoming stealth outputs
@@ -4152,6 +4366,7 @@ bool AnonWallet::ProcessStealthOutput(const CTxDestination &address, std::vector
             if (!AnonWalletDB(*walletDatabase).WriteStealthKeyMeta(idExtracted, lockedSkMeta)) {
                 LogPrintf("WriteStealthKeyMeta failed for %s.\n", coinAddress.ToString());
             }
+            m_locked_outputs_pending = true;
 
             nFoundStealth++;
             return true;
@@ -4399,6 +4614,54 @@ void AnonWallet::MarkOutputSpent(const COutPoint& outpoint, bool isSpent)
     SaveRecord(outpoint.hash, record);
 }
 
+void AnonWallet::UpdateUnspentIndex(const uint256& txid)
+{
+    for (auto& bucket : mapUnspent) {
+        std::set<COutPoint>& setOutpoints = bucket.second;
+        auto it = setOutpoints.lower_bound(COutPoint(txid, 0));
+        while (it != setOutpoints.end() && it->hash == txid)
+            it = setOutpoints.erase(it);
+    }
+
+    auto mi = mapRecords.find(txid);
+    if (mi == mapRecords.end())
+        return;
+
+    const CTransactionRecord& rtx = mi->second;
+    for (const auto& r : rtx.vout) {
+        if (r.nType != OUTPUT_CT && r.nType != OUTPUT_RINGCT)
+            continue;
+        if (!(r.nFlags & ORF_OWN_ANY) || r.IsSpent())
+            continue;
+        mapUnspent[UnspentBucket(r.nType, !rtx.HashUnset())].insert(COutPoint(txid, r.n));
+    }
+}
+
+std::vector<MapRecords_t::const_iterator> AnonWallet::GetUnspentRecords(const std::vector<uint8_t>& vTypes, bool fIncludeUnconfirmed) const
+{
+    std::set<uint256> setTxid;
+    for (uint8_t nType : vTypes) {
+        for (bool fConfirmed : {true, false}) {
+            if (!fConfirmed && !fIncludeUnconfirmed)
+                continue;
+            auto mi = mapUnspent.find(UnspentBucket(nType, fConfirmed));
+            if (mi == mapUnspent.end())
+                continue;
+            for (const COutPoint& outpoint : mi->second)
+                setTxid.insert(outpoint.hash);
+        }
+    }
+
+    std::vector<MapRecords_t::const_iterator> vRecords;
+    vRecords.reserve(setTxid.size());
+    for (const uint256& txid : setTxid) {
+        auto it = mapRecords.find(txid);
+        if (it != mapRecords.end())
+            vRecords.emplace_back(it);
+    }
+    return vRecords;
+}
+
 bool AnonWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate)
 {
     const CTransaction& tx = *ptx;
@@ -4534,6 +4797,7 @@ bool AnonWallet::OwnBlindOut(AnonWalletDB *pwdb, const uint256 &txhash, const CT
             if (!pwdb->WriteLockedAnonOut(op)) {
                 LogPrintf("Error: %s - WriteLockedAnonOut failed.\n", __func__);
             }
+            m_locked_outputs_pending = true;
         }
         return true;
     }
@@ -4801,9 +5065,14 @@ bool AnonWallet::AddToRecord(CTransactionRecord &rtxIn, const CTransaction &tx,
 
     uint256 txhash = tx.GetHash();
 
+    // An archived transaction is seen again by a rescan or a deep reorg, load it back before updating it
+    if (archiveSummary.nRecords > 0 && !mapRecords.count(txhash))
+        RestoreArchivedRecord(wdb, tx);
+
     // Inserts only if not exists, returns tx inserted or tx found
     std::pair<MapRecords_t::iterator, bool> ret = mapRecords.insert(std::make_pair(txhash, rtxIn));
     CTransactionRecord &rtx = ret.first->second;
+    pwalletParent->MarkAnonBalanceDirty();
 
     bool fUpdated = false;
     if (pIndex) {
@@ -4935,6 +5204,8 @@ bool AnonWallet::AddToRecord(CTransactionRecord &rtxIn, const CTransaction &tx,
         fUpdated = true;
     }
 
+    UpdateUnspentIndex(txhash);
+
     if (fInsertedNew || fUpdated) {
         // Plain to plain will always be a wtx, revisit if adding p2p to rtx
         if (!tx.GetCTFee(rtx.nFee))
@@ -5038,7 +5309,7 @@ void AnonWallet::AvailableBlindedCoins(std::vector<COutputR>& vCoins, bool fOnly
 
     CAmount nTotal = 0;
 
-    for (MapRecords_t::const_iterator it = mapRecords.begin(); it != mapRecords.end(); ++it) {
+    for (MapRecords_t::const_iterator it : GetUnspentRecords({OUTPUT_CT}, nMinDepth <= 0)) {
         const uint256 &txid = it->first;
         const CTransactionRecord &rtx = it->second;
 
@@ -5211,7 +5482,8 @@ void AnonWallet::AvailableAnonCoins(std::vector<COutputR> &vCoins, bool fOnlySaf
     CAmount nTotal = 0;
 
     const Consensus::Params& consensusParams = Params().GetConsensus();
-    for (MapRecords_t::const_iterator it = mapRecords.begin(); it != mapRecords.end(); ++it) {
+    bool fIncludeUnconfirmed = nMinDepth <= 0 && (fIncludeImmature || consensusParams.nMinRCTOutputDepth <= 0);
+    for (MapRecords_t::const_iterator it : GetUnspentRecords({OUTPUT_RINGCT}, fIncludeUnconfirmed)) {
         const uint256 &txid = it->first;
         const CTransactionRecord &rtx = it->second;
 
@@ -5566,6 +5838,7 @@ void AnonWallet::MarkConflicted(const uint256 &hashBlock, const uint256 &hashTx)
                 rtx.nIndex = -1;
                 rtx.blockHash = hashBlock;
                 walletdb.WriteTxRecord(now, rtx);
+                UpdateUnspentIndex(now);
 
                 // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
                 TxSpends::const_iterator iter = mapTxSpends.lower_bound(COutPoint(now, 0));
@@ -31,6 +31,10 @@ class UniValue;
 
 const uint16_t OR_PLACEHOLDER_N = 0xFFFF; // index of a fake output to contain reconstructed amounts for txns with undecodeable outputs
 
+static const int DEFAULT_ANON_COMPACT_DEPTH = 1440; // default depth for compactanonwallet
+static const int MIN_ANON_COMPACT_DEPTH = 100; // records and their spends must be at least this deep to be archived
+static const size_t MAX_ARCHIVED_RECORD_CACHE = 1000; // archived records kept in memory after being looked up
+
 class COutputR
 {
 public:
@@ -116,6 +120,17 @@ class AnonWallet
     typedef std::multimap<COutPoint, uint256> TxSpends;
     TxSpends mapTxSpends;
 
+    // Owned CT and RingCT outputs that are not marked spent, keyed by output type and whether the record has a block
+    typedef std::pair<uint8_t, bool> UnspentBucket;
+    std::map<UnspentBucket, std::set<COutPoint>> mapUnspent;
+
+    // Records moved to the archive by CompactRecords(), these are read from the database when looked up
+    CAnonArchiveSummary archiveSummary;
+    mutable std::map<uint256, CTransactionRecord> mapArchivedCache;
+
+    bool IsSpentBeforeDepth(const COutPoint& outpoint, int nMinDepth) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool RestoreArchivedRecord(AnonWalletDB& wdb, const CTransaction& tx);
+
 public:
     AnonWallet(std::shared_ptr<CWallet> pwallet, std::string name, std::shared_ptr<WalletDatabase> dbw_in)
     {
@@ -217,6 +232,16 @@ public:
 
     /** Update wallet after successful transaction */
     bool SaveRecord(const uint256& txid, const CTransactionRecord& rtx);
+
+    /** Look up a record, falling back to the archive for records removed by CompactRecords() */
+    bool GetRecord(const uint256& txid, CTransactionRecord& rtx) const;
+    bool GetArchivedRecord(const uint256& txid, CTransactionRecord& rtx) const;
+    /**
+     * Move records that are at least nMinDepth deep and whose owned outputs are all spent by transactions at least
+     * nMinDepth deep from memory to the archive, so that they are no longer loaded on startup.
+     */
+    bool CompactRecords(int nMinDepth, size_t& nArchived, std::string& sError) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    const CAnonArchiveSummary& GetArchiveSummary() const { return archiveSummary; }
     int AddStandardInputs(CWalletTx &wtx, CTransactionRecord &rtx, std::vector<CTempRecipient> &vecSend, bool sign,
             CAmount &nFeeRet, const CCoinControl *coinControl, std::string &sError, bool fZerocoinInputs, CAmount nInputValue);
     int AddStandardInputs_Inner(CWalletTx &wtx, CTransactionRecord &rtx, std::vector<CTempRecipient> &vecSend, bool sign,
@@ -275,6 +300,8 @@ public:
     bool GetStealthAddress(const CKeyID& idStealth, CStealthAddress& stealthAddress);
     bool ProcessLockedStealthOutputs();
     bool ProcessLockedBlindedOutputs();
+    /** Recover the keys and amounts of outputs received while locked, if any were recorded since the last time */
+    bool ProcessLockedOutputs();
     bool ProcessStealthOutput(const CTxDestination &address,
         std::vector<uint8_t> &vchEphemPK, uint32_t prefix, bool fHavePrefix, CKey &sShared, bool fNeedShared=false);
 
@@ -285,6 +312,11 @@ public:
     bool AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
     void MarkOutputSpent(const COutPoint& outpoint, bool isSpent);
 
+    /** Refresh the unspent output index for a record that was added, changed or erased */
+    void UpdateUnspentIndex(const uint256& txid);
+    /** Records with unspent owned outputs of the given types, in txid order */
+    std::vector<MapRecords_t::const_iterator> GetUnspentRecords(const std::vector<uint8_t>& vTypes, bool fIncludeUnconfirmed) const;
+
     int InsertTempTxn(const uint256 &txid, const CTransactionRecord *rtx) const;
 
     bool GetCTBlindsFromOutput(const CTxOutCT *pout, uint256& blind) const;
@@ -344,6 +376,10 @@ public:
     int64_t nRCTOutSelectionGroup2 = 24000;
 
 private:
+    //! Outputs were recorded while locked and are still to be recovered, guarded by cs_wallet. Starts set so that
+    //! the first unlock recovers the ones recorded in an earlier session.
+    bool m_locked_outputs_pending = true;
+
     std::string GetDisplayName() const { return "ringctwallet"; }
     void ParseAddressForMetaData(const CTxDestination &addr, COutputRecord &rec);
 
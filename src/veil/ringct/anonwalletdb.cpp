@@ -177,6 +177,32 @@ bool AnonWalletDB::EraseTxRecord(const uint256 &hash)
 }
 
 
+bool AnonWalletDB::ReadArchivedTxRecord(const uint256 &hash, CTransactionRecord &rtx, uint32_t nFlags)
+{
+    return m_batch.Read(std::make_pair(std::string("artx"), hash), rtx);
+}
+
+bool AnonWalletDB::WriteArchivedTxRecord(const uint256 &hash, const CTransactionRecord &rtx)
+{
+    return WriteIC(std::make_pair(std::string("artx"), hash), rtx, true);
+}
+
+bool AnonWalletDB::EraseArchivedTxRecord(const uint256 &hash)
+{
+    return EraseIC(std::make_pair(std::string("artx"), hash));
+}
+
+bool AnonWalletDB::ReadArchiveSummary(CAnonArchiveSummary &summary, uint32_t nFlags)
+{
+    return m_batch.Read(std::string("arsum"), summary);
+}
+
+bool AnonWalletDB::WriteArchiveSummary(const CAnonArchiveSummary &summary)
+{
+    return WriteIC(std::string("arsum"), summary, true);
+}
+
+
 bool AnonWalletDB::ReadStoredTx(const uint256 &hash, CStoredTransaction &stx, uint32_t nFlags)
 {
     return m_batch.Read(std::make_pair(std::string("stx"), hash), stx);
@@ -28,6 +28,8 @@ prefixes
     abe                 - address book entry
     acc
     acentry
+    arsum               - CAnonArchiveSummary
+    artx                - archived CTransactionRecord, moved from rtx by AnonWallet::CompactRecords()
 
     aki                 - anon key image: CPubKey - COutpoint
 
@@ -211,6 +213,33 @@ public:
     }
 };
 
+/** Checkpoint of the transaction records that were moved to the archive */
+class CAnonArchiveSummary
+{
+public:
+    int nHeight = 0;            // chain height of the last compaction
+    uint32_t nRecords = 0;      // number of archived records
+    int64_t nTimeFirst = 0;
+    int64_t nTimeLast = 0;
+    CAmount nReceived = 0;      // sum of the owned outputs of archived records, all of them are spent
+
+    // Outputs of loaded records that are spent by archived records
+    std::vector<std::pair<COutPoint, uint256> > vSpends;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream &s, Operation ser_action)
+    {
+        READWRITE(nHeight);
+        READWRITE(nRecords);
+        READWRITE(nTimeFirst);
+        READWRITE(nTimeLast);
+        READWRITE(nReceived);
+        READWRITE(vSpends);
+    }
+};
+
 /** Access to the wallet database */
 class AnonWalletDB : public WalletBatch
 {
@@ -221,30 +250,21 @@ public:
 
     bool InTxn()
     {
-        return m_batch.pdb && m_batch.activeTxn;
+        return m_batch.InTxn();
     }
 
-    Dbc *GetTxnCursor()
+    std::unique_ptr<DatabaseCursor> GetTxnCursor()
     {
-        if (!m_batch.pdb || !m_batch.activeTxn)
-            return nullptr;
-
-        DbTxn *ptxnid = m_batch.activeTxn; // call TxnBegin first
-
-        Dbc *pcursor = nullptr;
-        int ret = m_batch.pdb->cursor(ptxnid, &pcursor, 0);
-        if (ret != 0)
-            return nullptr;
-        return pcursor;
+        return m_batch.GetTxnCursor(); // call TxnBegin first
     }
 
-    Dbc *GetCursor()
+    std::unique_ptr<DatabaseCursor> GetCursor()
     {
         return m_batch.GetCursor();
     }
 
     template< typename T>
-    bool Replace(Dbc *pcursor, const T &value)
+    bool Replace(DatabaseCursor *pcursor, const T &value)
     {
         if (!pcursor)
             return false;
@@ -256,90 +276,27 @@ public:
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
         ssValue.reserve(10000);
         ssValue << value;
-        Dbt datValue(&ssValue[0], ssValue.size());
 
         // Write
-        int ret = pcursor->put(nullptr, &datValue, DB_CURRENT);
+        int ret = pcursor->Replace(ssValue);
 
         if (ret != 0) {
             LogPrintf("CursorPut ret %d - %s\n", ret, DbEnv::strerror(ret));
         }
         // Clear memory in case it was a private key
-        memset(datValue.get_data(), 0, datValue.get_size());
+        memory_cleanse(ssValue.data(), ssValue.size());
 
         return (ret == 0);
     }
 
-    int ReadAtCursor(Dbc *pcursor, CDataStream &ssKey, CDataStream &ssValue, unsigned int fFlags=DB_NEXT)
+    int ReadAtCursor(DatabaseCursor *pcursor, CDataStream &ssKey, CDataStream &ssValue, unsigned int fFlags=DB_NEXT)
     {
-        // Read at cursor
-        Dbt datKey;
-        if (fFlags == DB_SET || fFlags == DB_SET_RANGE || fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
-            datKey.set_data(&ssKey[0]);
-            datKey.set_size(ssKey.size());
-        }
-
-        Dbt datValue;
-        if (fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
-            datValue.set_data(&ssValue[0]);
-            datValue.set_size(ssValue.size());
-        }
-
-        datKey.set_flags(DB_DBT_MALLOC);
-        datValue.set_flags(DB_DBT_MALLOC);
-        int ret = pcursor->get(&datKey, &datValue, fFlags);
-        if (ret != 0)
-            return ret;
-        else if (datKey.get_data() == nullptr || datValue.get_data() == nullptr)
-            return 99999;
-
-        // Convert to streams
-        ssKey.SetType(SER_DISK);
-        ssKey.clear();
-        ssKey.write((char*)datKey.get_data(), datKey.get_size());
-
-        ssValue.SetType(SER_DISK);
-        ssValue.clear();
-        ssValue.write((char*)datValue.get_data(), datValue.get_size());
-
-        // Clear and free memory
-        memset(datKey.get_data(), 0, datKey.get_size());
-        memset(datValue.get_data(), 0, datValue.get_size());
-        free(datKey.get_data());
-        free(datValue.get_data());
-
-        return 0;
+        return pcursor->Read(ssKey, &ssValue, fFlags);
     }
 
-    int ReadKeyAtCursor(Dbc *pcursor, CDataStream &ssKey, unsigned int fFlags=DB_NEXT)
+    int ReadKeyAtCursor(DatabaseCursor *pcursor, CDataStream &ssKey, unsigned int fFlags=DB_NEXT)
     {
-        // Read key at cursor
-        Dbt datKey;
-        if (fFlags == DB_SET || fFlags == DB_SET_RANGE) {
-            datKey.set_data(&ssKey[0]);
-            datKey.set_size(ssKey.size());
-        }
-
-        datKey.set_flags(DB_DBT_MALLOC);
-
-        Dbt datValue;
-        datValue.set_flags(DB_DBT_PARTIAL); // don't read data, dlen and doff are 0 after memset
-
-        int ret = pcursor->get(&datKey, &datValue, fFlags);
-        if (ret != 0)
-            return ret;
-        if (datKey.get_data() == nullptr)
-            return 99999;
-
-        // Convert to streams
-        ssKey.SetType(SER_DISK);
-        ssKey.clear();
-        ssKey.write((char*)datKey.get_data(), datKey.get_size());
-
-        // Clear and free memory
-        memset(datKey.get_data(), 0, datKey.get_size());
-        free(datKey.get_data());
-        return 0;
+        return pcursor->Read(ssKey, nullptr, fFlags);
     }
 
 
@@ -386,6 +343,13 @@ public:
     bool WriteTxRecord(const uint256 &hash, const CTransactionRecord &rtx);
     bool EraseTxRecord(const uint256 &hash);
 
+    bool ReadArchivedTxRecord(const uint256 &hash, CTransactionRecord &rtx, uint32_t nFlags=DB_READ_UNCOMMITTED);
+    bool WriteArchivedTxRecord(const uint256 &hash, const CTransactionRecord &rtx);
+    bool EraseArchivedTxRecord(const uint256 &hash);
+
+    bool ReadArchiveSummary(CAnonArchiveSummary &summary, uint32_t nFlags=DB_READ_UNCOMMITTED);
+    bool WriteArchiveSummary(const CAnonArchiveSummary &summary);
+
 
     bool ReadStoredTx(const uint256 &hash, CStoredTransaction &stx, uint32_t nFlags=DB_READ_UNCOMMITTED);
     bool WriteStoredTx(const uint256 &hash, const CStoredTransaction &stx);
@@ -1563,6 +1563,66 @@ static UniValue fundrawtransactionfrom(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue compactanonwallet(const JSONRPCRequest &request)
+{
+    std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
+    if (!EnsureWalletIsAvailable(wallet.get(), request.fHelp))
+        return NullUniValue;
+
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+                "compactanonwallet ( mindepth )\n"
+                "\nMove stealth and RingCT transaction records that are fully spent and deeply confirmed to an archive.\n"
+                "Archived records are no longer loaded on startup, they are read from the wallet file when needed.\n"
+
+                "\nArguments:\n"
+                "1. mindepth                         (numeric, optional, default=" + std::to_string(DEFAULT_ANON_COMPACT_DEPTH) + ") Depth the records and the\n"
+                "                                      transactions spending their outputs must have, at least " + std::to_string(MIN_ANON_COMPACT_DEPTH) + ".\n"
+                "\nResult:\n"
+                "{\n"
+                "  \"archived\": n,                     (numeric) Number of records archived by this call\n"
+                "  \"loaded\": n,                       (numeric) Number of records still loaded\n"
+                "  \"archive\": {                       (object) Summary of all archived records\n"
+                "    \"records\": n,                    (numeric) Number of archived records\n"
+                "    \"height\": n,                     (numeric) Chain height of the last compaction\n"
+                "    \"time_first\": n,                 (numeric) Time of the oldest archived record\n"
+                "    \"time_last\": n,                  (numeric) Time of the newest archived record\n"
+                "    \"received\": x.xxx,               (numeric) Total of the owned outputs of archived records\n"
+                "  }\n"
+                "}\n"
+                "\nExamples:\n"
+                + HelpExampleCli("compactanonwallet", "")
+                + HelpExampleRpc("compactanonwallet", "10000")
+        );
+
+    int nMinDepth = DEFAULT_ANON_COMPACT_DEPTH;
+    if (!request.params[0].isNull())
+        nMinDepth = request.params[0].get_int();
+
+    auto pAnonWallet = wallet->GetAnonWallet();
+
+    LOCK2(cs_main, wallet->cs_wallet);
+
+    size_t nArchived = 0;
+    std::string sError;
+    if (!pAnonWallet->CompactRecords(nMinDepth, nArchived, sError))
+        throw JSONRPCError(RPC_WALLET_ERROR, sError);
+
+    const CAnonArchiveSummary& summary = pAnonWallet->GetArchiveSummary();
+    UniValue archive(UniValue::VOBJ);
+    archive.pushKV("records", (int64_t)summary.nRecords);
+    archive.pushKV("height", summary.nHeight);
+    archive.pushKV("time_first", summary.nTimeFirst);
+    archive.pushKV("time_last", summary.nTimeLast);
+    archive.pushKV("received", ValueFromAmount(summary.nReceived));
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("archived", (int64_t)nArchived);
+    result.pushKV("loaded", (int64_t)pAnonWallet->mapRecords.size());
+    result.pushKV("archive", archive);
+    return result;
+}
+
 static UniValue verifycommitment(const JSONRPCRequest &request)
 {
     if (request.fHelp || request.params.size() != 3)
@@ -1843,6 +1903,7 @@ static const CRPCCommand commands[] =
                 { "wallet",             "sendringcttoringct", &sendringcttoringct,                {"address","amount","comment","comment_to","subtractfeefromamount","narration","ringsize","inputs_per_sig"} },
 
                 { "wallet",             "sendtypeto",                       &sendtypeto,                    {"typein","typeout","outputs","comment","comment_to","ringsize","inputs_per_sig","test_fee","coincontrol"} },
+                { "wallet",             "compactanonwallet",                &compactanonwallet,             {"mindepth"} },
 
                 { "rawtransactions",    "createrawbasecointransaction", &createrawbasecointransaction,      {"inputs","outputs","locktime","replaceable"} },
                 { "rawtransactions",    "fundrawtransactionfrom",           &fundrawtransactionfrom,        {"input_type","hexstring","input_amounts","output_amounts","options"} },
@@ -83,6 +83,16 @@ CBigNum AccumulatorMap::GetValue(CoinDenomination denom)
     return mapAccumulators.at(denom)->getValue();
 }
 
+//Set the value of a specific accumulator, marking whether it has had a mint accumulated
+void AccumulatorMap::SetValue(CoinDenomination denom, const CBigNum& bnValue, bool fUsed)
+{
+    mapAccumulators.at(denom)->setValue(bnValue);
+    if (fUsed)
+        setUnusedDenominations.erase(denom);
+    else
+        setUnusedDenominations.emplace(denom);
+}
+
 //Calculate a 32bit checksum of each accumulator value. Concatenate checksums into arith_unit256
 std::map<libzerocoin::CoinDenomination, uint256> AccumulatorMap::GetCheckpoints(bool fShowZeroIfEmpty)
 {
@@ -21,6 +21,8 @@ public:
     bool Load(const std::map<libzerocoin::CoinDenomination, uint256>& mapCheckpoints);
     bool Accumulate(const libzerocoin::PublicCoin& pubCoin, bool fSkipValidation = false);
     CBigNum GetValue(libzerocoin::CoinDenomination denom);
+    void SetValue(libzerocoin::CoinDenomination denom, const CBigNum& bnValue, bool fUsed);
+    std::set<libzerocoin::CoinDenomination> GetUnusedDenominations() const { return setUnusedDenominations; }
     std::map<libzerocoin::CoinDenomination, uint256> GetCheckpoints(bool fShowZeroIfEmpty = false);
     void Reset();
     void Reset(libzerocoin::ZerocoinParams* params2);
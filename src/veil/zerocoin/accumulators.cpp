@@ -4,6 +4,7 @@
 
 #include "accumulators.h"
 #include "accumulatormap.h"
+#include "accumulatorstate.h"
 #include "chainparams.h"
 #include "txdb.h"
 #include "validation.h"
@@ -13,11 +14,18 @@
 #include "primitives/zerocoin.h"
 #include "shutdown.h"
 
+#include <deque>
+
 using namespace libzerocoin;
 
 std::map<uint256, CBigNum> mapAccumulatorValues;
 std::list<uint256> listAccCheckpointsNoDB;
 
+//Rolling accumulator state of the active chain, with the states before the most recently connected blocks
+AccumulatorState accumulatorState;
+std::deque<AccumulatorState> dequeAccumulatorStateHistory;
+bool fAccumulatorStateDirty = false;
+
 uint256 GetChecksum(const CBigNum &bnValue)
 {
     CDataStream ss(SER_GETHASH, 0);
@@ -133,7 +141,7 @@ bool EraseCheckpoints(int nStartHeight, int nEndHeight)
 
     CBlockIndex* pindex = chainActive[nStartHeight];
 
-    auto mapCheckpointsPrev = pindex->pprev->mapAccumulatorHashes;
+    auto mapCheckpointsPrev = pindex->pprev->GetAccumulatorHashes();
     while (pindex) {
         //Do not erase the hash if it is the same as the previous block
         for (auto pairPrevious : mapCheckpointsPrev) {
@@ -162,7 +170,7 @@ bool InitializeAccumulators(const int nHeight, int& nHeightCheckpoint, Accumulat
     mapAccumulators.Reset(Params().Zerocoin_Params());
 
     //Use the previous block's checkpoint to initialize the accumulator's state
-    auto mapCheckpointPrev = chainActive[nHeight - 1]->mapAccumulatorHashes;
+    auto mapCheckpointPrev = chainActive[nHeight - 1]->GetAccumulatorHashes();
     bool fLoad = false;
     for (auto accPair: mapCheckpointPrev) {
         if (accPair.second != uint256()) {
@@ -181,16 +189,9 @@ bool InitializeAccumulators(const int nHeight, int& nHeightCheckpoint, Accumulat
     return true;
 }
 
-//Get checkpoint value for a specific block height
-bool CalculateAccumulatorCheckpoint(int nHeight, std::map<libzerocoin::CoinDenomination, uint256>& mapCheckpoints, AccumulatorMap& mapAccumulators)
+//Get checkpoint value for a specific block height by re-accumulating the mints of its window from disk
+bool CalculateAccumulatorCheckpointFromDisk(int nHeight, std::map<libzerocoin::CoinDenomination, uint256>& mapCheckpoints, AccumulatorMap& mapAccumulators)
 {
-
-    //the checkpoint is updated every ten blocks, return current active checkpoint if not update block
-    if (nHeight % 10 != 0 || nHeight == 10) {
-        mapCheckpoints = chainActive[nHeight - 1]->mapAccumulatorHashes;
-        return true;
-    }
-
     //set the accumulators to last checkpoint value
     int nHeightCheckpoint;
     mapAccumulators.Reset();
@@ -231,7 +232,7 @@ bool CalculateAccumulatorCheckpoint(int nHeight, std::map<libzerocoin::CoinDenom
 
     // if there were no new mints found, the accumulator checkpoint will be the same as the last checkpoint
     if (nTotalMintsFound == 0) {
-        mapCheckpoints = chainActive[nHeight - 1]->mapAccumulatorHashes;
+        mapCheckpoints = chainActive[nHeight - 1]->GetAccumulatorHashes();
     }
     else
         mapCheckpoints = mapAccumulators.GetCheckpoints();
@@ -240,6 +241,158 @@ bool CalculateAccumulatorCheckpoint(int nHeight, std::map<libzerocoin::CoinDenom
     return true;
 }
 
+//Rebuild the rolling accumulator state from the last checkpoint recorded in the chain
+bool RebuildAccumulatorState(const CBlockIndex* pindexTip)
+{
+    AccumulatorState stateNew;
+    int nHeightStart = 0;
+    int nHeightCheckpoint = pindexTip->nHeight - (pindexTip->nHeight % 10);
+    if (nHeightCheckpoint >= 20) {
+        //The checkpoint's value is the base of the window that ends ten blocks after it
+        const CBlockIndex* pindexCheckpoint = pindexTip->GetAncestor(nHeightCheckpoint);
+        AccumulatorMap mapAccumulators(Params().Zerocoin_Params());
+        if (!mapAccumulators.Load(pindexCheckpoint->GetAccumulatorHashes()))
+            return error("%s: failed to load checkpoint at height %d", __func__, nHeightCheckpoint);
+
+        stateNew.window.Save(mapAccumulators);
+        nHeightStart = nHeightCheckpoint - 10;
+        stateNew.nHeight = nHeightStart - 1;
+        stateNew.hashBlock = pindexTip->GetAncestor(stateNew.nHeight)->GetBlockHash();
+    }
+
+    for (int nHeight = nHeightStart; nHeight <= pindexTip->nHeight; nHeight++) {
+        if (ShutdownRequested())
+            return false;
+
+        const CBlockIndex* pindex = pindexTip->GetAncestor(nHeight);
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+            return error("%s: failed to read block from disk", __func__);
+
+        std::list<PublicCoin> listPubcoins;
+        if (!BlockToPubcoinList(block, listPubcoins))
+            return error("%s: failed to get zerocoin mintlist from block %d", __func__, nHeight);
+
+        if (!stateNew.ConnectMints(listPubcoins, pindex->GetBlockHash(), nHeight))
+            return false;
+    }
+
+    LogPrint(BCLog::ZEROCOINDB, "%s: rebuilt accumulator state at height %d\n", __func__, pindexTip->nHeight);
+    accumulatorState = stateNew;
+    dequeAccumulatorStateHistory.clear();
+    fAccumulatorStateDirty = true;
+    return true;
+}
+
+//Make sure the rolling accumulator state is at a specific block, loading or rebuilding it if needed
+bool SyncAccumulatorState(const CBlockIndex* pindexTip)
+{
+    if (accumulatorState.hashBlock == pindexTip->GetBlockHash())
+        return true;
+
+    //The state that was written with the last chainstate flush is usually the one needed after a restart
+    AccumulatorState stateDB;
+    if (pzerocoinDB->ReadAccumulatorState(stateDB) && stateDB.hashBlock == pindexTip->GetBlockHash()) {
+        accumulatorState = stateDB;
+        dequeAccumulatorStateHistory.clear();
+        fAccumulatorStateDirty = false;
+        return true;
+    }
+
+    return RebuildAccumulatorState(pindexTip);
+}
+
+bool ConnectAccumulatorState(const CBlock& block, const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+
+    if (!pindex->pprev) {
+        accumulatorState.SetNull();
+        dequeAccumulatorStateHistory.clear();
+    } else if (!SyncAccumulatorState(pindex->pprev)) {
+        accumulatorState.SetNull();
+        return error("%s: failed to sync accumulator state to block %s", __func__, pindex->pprev->GetBlockHash().GetHex());
+    }
+
+    std::list<PublicCoin> listPubcoins;
+    if (!BlockToPubcoinList(block, listPubcoins)) {
+        accumulatorState.SetNull();
+        return error("%s: failed to get zerocoin mintlist from block %d", __func__, pindex->nHeight);
+    }
+
+    dequeAccumulatorStateHistory.emplace_back(accumulatorState);
+    if (dequeAccumulatorStateHistory.size() > ACCUMULATOR_STATE_HISTORY)
+        dequeAccumulatorStateHistory.pop_front();
+
+    fAccumulatorStateDirty = true;
+    if (!accumulatorState.ConnectMints(listPubcoins, pindex->GetBlockHash(), pindex->nHeight)) {
+        accumulatorState.SetNull();
+        dequeAccumulatorStateHistory.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void DisconnectAccumulatorState(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+
+    //The state is not following this block, it will be synced on the next use
+    if (accumulatorState.hashBlock != pindex->GetBlockHash())
+        return;
+
+    fAccumulatorStateDirty = true;
+    if (!dequeAccumulatorStateHistory.empty() && dequeAccumulatorStateHistory.back().hashBlock == pindex->pprev->GetBlockHash()) {
+        accumulatorState = dequeAccumulatorStateHistory.back();
+        dequeAccumulatorStateHistory.pop_back();
+        return;
+    }
+
+    accumulatorState.SetNull();
+    dequeAccumulatorStateHistory.clear();
+}
+
+bool FlushAccumulatorState()
+{
+    AssertLockHeld(cs_main);
+
+    if (!fAccumulatorStateDirty || accumulatorState.IsNull())
+        return true;
+
+    if (!pzerocoinDB->WriteAccumulatorState(accumulatorState))
+        return error("%s: failed to write accumulator state", __func__);
+
+    fAccumulatorStateDirty = false;
+    return true;
+}
+
+//Get checkpoint value for a specific block height
+bool CalculateAccumulatorCheckpoint(int nHeight, std::map<libzerocoin::CoinDenomination, uint256>& mapCheckpoints, AccumulatorMap& mapAccumulators)
+{
+
+    //the checkpoint is updated every ten blocks, return current active checkpoint if not update block
+    if (nHeight % 10 != 0 || nHeight == 10) {
+        mapCheckpoints = chainActive[nHeight - 1]->GetAccumulatorHashes();
+        return true;
+    }
+
+    //Building on the tip, the checkpoint was taken by the rolling state when its window of blocks was connected
+    CBlockIndex* pindexPrev = chainActive[nHeight - 1];
+    int nMints = 0;
+    if (pindexPrev && pindexPrev == chainActive.Tip() && SyncAccumulatorState(pindexPrev) &&
+            accumulatorState.GetCheckpoint(nHeight, mapAccumulators, nMints)) {
+        // if there were no new mints found, the accumulator checkpoint will be the same as the last checkpoint
+        if (nMints == 0)
+            mapCheckpoints = pindexPrev->GetAccumulatorHashes();
+        else
+            mapCheckpoints = mapAccumulators.GetCheckpoints();
+        return true;
+    }
+
+    return CalculateAccumulatorCheckpointFromDisk(nHeight, mapCheckpoints, mapAccumulators);
+}
+
 std::string PrintAccumulatorCheckpoints(std::map<libzerocoin::CoinDenomination ,uint256> mapAccumulatorHashes)
 {
     std::string strRet;
@@ -259,13 +412,13 @@ bool ValidateAccumulatorCheckpoint(const CBlock& block, CBlockIndex* pindex, Acc
 
         for (auto checkpointPair: mapAccumulators.GetCheckpoints(true)) {
             if (checkpointPair.second != block.mapAccumulatorHashes.at(checkpointPair.first))
-                return error("%s : accumulator does not match calculated value. block=%s calculated=%s", __func__, pindex->mapAccumulatorHashes.at(checkpointPair.first).GetHex(), checkpointPair.second.GetHex());
+                return error("%s : accumulator does not match calculated value. block=%s calculated=%s", __func__, pindex->GetAccumulatorHash(checkpointPair.first).GetHex(), checkpointPair.second.GetHex());
         }
 
         return true;
     }
 
-    if (block.mapAccumulatorHashes != pindex->pprev->mapAccumulatorHashes)
+    if (block.mapAccumulatorHashes != pindex->pprev->GetAccumulatorHashes())
         return error("%s : new accumulator checkpoint generated on a block that is not multiple of 10", __func__);
 
     return true;
@@ -293,7 +446,7 @@ int ComputeAccumulatedCoins(int nHeightEnd, libzerocoin::CoinDenomination denom)
     CBlockIndex* pindex = chainActive[GetZerocoinStartHeight()];
     int n = 0;
     while (pindex->nHeight < nHeightEnd) {
-        n += count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), denom);
+        n += pindex->GetMintCount(denom);
         pindex = chainActive.Next(pindex);
     }
 
@@ -403,7 +556,7 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
         {
             LOCK(cs_main);
             if (pindex->nHeight != nAccStartHeight &&
-                pindex->pprev->mapAccumulatorHashes != pindex->mapAccumulatorHashes)
+                !pindex->HasSameAccumulatorHashes(*pindex->pprev))
                 ++nCheckpointsAdded;
 
             //If the security level is satisfied, or the stop height is reached, then initialize the accumulator from here
@@ -460,8 +613,7 @@ map<CoinDenomination, int> GetMintMaturityHeight()
         for (auto denom : libzerocoin::zerocoinDenomList) {
             //If the denom has not already had a mint added to it, then see if it has a mint added on this block
             if (mapDenomMaturity.at(denom).first < Params().Zerocoin_RequiredAccumulation()) {
-                mapDenomMaturity.at(denom).first += count(pindex->vMintDenominationsInBlock.begin(),
-                                                          pindex->vMintDenominationsInBlock.end(), denom);
+                mapDenomMaturity.at(denom).first += pindex->GetMintCount(denom);
 
                 //if mint was found then record this block as the first block that maturity occurs.
                 if (mapDenomMaturity.at(denom).first >= Params().Zerocoin_RequiredAccumulation())
@@ -28,4 +28,9 @@ uint256 GetChecksum(const CBigNum &bnValue);
 int GetChecksumHeight(uint256 nChecksum, libzerocoin::CoinDenomination denomination);
 bool ValidateAccumulatorCheckpoint(const CBlock& block, CBlockIndex* pindex, AccumulatorMap& mapAccumulators);
 
+/** Rolling accumulator state of the active chain, see accumulatorstate.h */
+bool ConnectAccumulatorState(const CBlock& block, const CBlockIndex* pindex);
+void DisconnectAccumulatorState(const CBlockIndex* pindex);
+bool FlushAccumulatorState();
+
 #endif //PIVX_ACCUMULATORS_H
@@ -0,0 +1,87 @@
+// Copyright (c) 2019 The Veil developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "accumulatorstate.h"
+#include "accumulatormap.h"
+#include "chainparams.h"
+#include "util.h"
+
+using namespace libzerocoin;
+
+void AccumulatorWindow::SetNull()
+{
+    mapValues.clear();
+    setUnused.clear();
+    for (auto denom : zerocoinDenomList)
+        setUnused.emplace(denom);
+    nMints = 0;
+}
+
+//Set the accumulators to the values held by this window
+void AccumulatorWindow::Load(AccumulatorMap& mapAccumulators) const
+{
+    mapAccumulators.Reset();
+    for (auto& mi : mapValues)
+        mapAccumulators.SetValue(mi.first, mi.second, !setUnused.count(mi.first));
+}
+
+//Record the current values of the accumulators in this window
+void AccumulatorWindow::Save(AccumulatorMap& mapAccumulators)
+{
+    mapValues.clear();
+    for (auto denom : zerocoinDenomList)
+        mapValues.emplace(denom, mapAccumulators.GetValue(denom));
+    setUnused = mapAccumulators.GetUnusedDenominations();
+}
+
+void AccumulatorState::SetNull()
+{
+    hashBlock = uint256();
+    nHeight = -1;
+    window.SetNull();
+    mapPending.clear();
+}
+
+//Accumulate the mints of the block that is being connected on top of this state
+bool AccumulatorState::ConnectMints(const std::list<PublicCoin>& listPubcoins, const uint256& hashBlockIn, int nHeightIn)
+{
+    if (nHeightIn != nHeight + 1)
+        return error("%s: state is at height %d, cannot connect height %d", __func__, nHeight, nHeightIn);
+
+    if (!listPubcoins.empty()) {
+        AccumulatorMap mapAccumulators(Params().Zerocoin_Params());
+        window.Load(mapAccumulators);
+        for (const PublicCoin& pubcoin : listPubcoins) {
+            if (!mapAccumulators.Accumulate(pubcoin, true))
+                return error("%s: failed to add pubcoin to accumulator at height %d", __func__, nHeightIn);
+        }
+        window.Save(mapAccumulators);
+        window.nMints += listPubcoins.size();
+    }
+
+    //The window of the checkpoint at height + 11 (height - 20 through height - 11 from its view) is now complete
+    if (nHeightIn % 10 == 9) {
+        mapPending[nHeightIn + 11] = window;
+        window.nMints = 0;
+    }
+
+    //Checkpoints at or below this height have been used by their block
+    mapPending.erase(mapPending.begin(), mapPending.upper_bound(nHeightIn));
+
+    hashBlock = hashBlockIn;
+    nHeight = nHeightIn;
+    return true;
+}
+
+//Load the accumulators with the checkpoint that will be used at a specific height
+bool AccumulatorState::GetCheckpoint(int nHeightCheckpoint, AccumulatorMap& mapAccumulators, int& nMints) const
+{
+    auto it = mapPending.find(nHeightCheckpoint);
+    if (it == mapPending.end())
+        return false;
+
+    it->second.Load(mapAccumulators);
+    nMints = it->second.nMints;
+    return true;
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2019 The Veil developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VEIL_ACCUMULATORSTATE_H
+#define VEIL_ACCUMULATORSTATE_H
+
+#include "libzerocoin/Coin.h"
+#include "libzerocoin/Denominations.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <set>
+
+class AccumulatorMap;
+
+//! Number of previous states kept in memory so that disconnecting blocks does not require a rebuild
+static const unsigned int ACCUMULATOR_STATE_HISTORY = 100;
+
+/**
+ * The value of each denomination's accumulator, which denominations have never had a mint accumulated and how many
+ * mints were added since the current ten block window started.
+ */
+class AccumulatorWindow
+{
+public:
+    std::map<libzerocoin::CoinDenomination, CBigNum> mapValues;
+    std::set<libzerocoin::CoinDenomination> setUnused;
+    int nMints;
+
+    AccumulatorWindow() { SetNull(); }
+
+    void SetNull();
+    void Load(AccumulatorMap& mapAccumulators) const;
+    void Save(AccumulatorMap& mapAccumulators);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(mapValues);
+        READWRITE(setUnused);
+        READWRITE(nMints);
+    }
+};
+
+/**
+ * Rolling accumulator state that follows the active chain. Mints are accumulated once, as their block is connected,
+ * and the checkpoint for a height that is a multiple of ten is taken as soon as its window (height - 20 through
+ * height - 11) is complete. Calculating or validating a checkpoint is then a lookup instead of re-reading ten blocks.
+ */
+class AccumulatorState
+{
+public:
+    uint256 hashBlock;
+    int nHeight;
+    AccumulatorWindow window;
+    std::map<int, AccumulatorWindow> mapPending;
+
+    AccumulatorState() { SetNull(); }
+
+    void SetNull();
+    bool IsNull() const { return hashBlock.IsNull(); }
+    bool ConnectMints(const std::list<libzerocoin::PublicCoin>& listPubcoins, const uint256& hashBlockIn, int nHeightIn);
+    bool GetCheckpoint(int nHeightCheckpoint, AccumulatorMap& mapAccumulators, int& nMints) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(window);
+        READWRITE(mapPending);
+    }
+};
+
+#endif //VEIL_ACCUMULATORSTATE_H
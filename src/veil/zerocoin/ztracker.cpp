@@ -21,6 +21,7 @@ using namespace std;
 
 CzTracker::CzTracker(CWallet* wallet)
 {
+    this->pwallet = wallet;
     this->walletDatabase = wallet->database;
     WalletBatch walletdb(*walletDatabase);
 
@@ -44,10 +45,18 @@ void CzTracker::Init()
     }
 }
 
+void CzTracker::MarkBalanceDirty() const
+{
+    if (pwallet)
+        pwallet->MarkZerocoinBalanceDirty();
+}
+
 bool CzTracker::Archive(CMintMeta& meta)
 {
-    if (mapSerialHashes.count(meta.hashSerial))
+    if (mapSerialHashes.count(meta.hashSerial)) {
         mapSerialHashes.at(meta.hashSerial).isArchived = true;
+        MarkBalanceDirty();
+    }
 
     WalletBatch walletdb(*walletDatabase);
     CZerocoinMint mint;
@@ -277,6 +286,7 @@ bool CzTracker::UpdateState(const CMintMeta& meta)
     }
 
     mapSerialHashes[meta.hashSerial] = meta;
+    MarkBalanceDirty();
 
     return true;
 }
@@ -296,6 +306,7 @@ void CzTracker::Add(const CDeterministicMint& dMint, bool isNew, bool isArchived
     meta.isDeterministic = true;
     mapSerialHashes[meta.hashSerial] = meta;
     mapHashPubCoin[meta.hashPubcoin] = meta.hashSerial;
+    MarkBalanceDirty();
 
     if (isNew)
         WalletBatch(*walletDatabase).WriteDeterministicMint(dMint);
@@ -317,6 +328,7 @@ void CzTracker::Add(const CZerocoinMint& mint, bool isNew, bool isArchived)
     meta.isDeterministic = false;
     mapSerialHashes[meta.hashSerial] = meta;
     mapHashPubCoin[meta.hashPubcoin] = meta.hashSerial;
+    MarkBalanceDirty();
 
     if (isNew)
         WalletBatch(*walletDatabase).WriteZerocoinMint(mint);
@@ -521,4 +533,5 @@ void CzTracker::Clear()
 {
     mapSerialHashes.clear();
     mapHashPubCoin.clear();
+    MarkBalanceDirty();
 }
@@ -20,11 +20,14 @@ class CzTracker
 {
 private:
     bool fInitialized;
+    CWallet* pwallet;
     std::shared_ptr<WalletDatabase> walletDatabase;
     std::map<SerialHash, CMintMeta> mapSerialHashes;
     std::map<SerialHash, uint256> mapPendingSpends; //serialhash, txid of spend
     std::map<PubCoinHash, SerialHash> mapHashPubCoin;
     bool UpdateStatusInternal(const std::set<uint256>& setMempool, CMintMeta& mint);
+    //! Tell the wallet's balance ledger that the zerocoin balance has to be recalculated
+    void MarkBalanceDirty() const;
 public:
     CzTracker(CWallet* wallet);
     ~CzTracker();
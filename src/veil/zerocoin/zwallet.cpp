@@ -386,9 +386,8 @@ void CzWallet::SeedToZerocoin(const uint512& seedZerocoin, CBigNum& bnValue, CBi
 
     //See if serial and randomness make a valid commitment
     // Generate a Pedersen commitment to the serial number
-    CBigNum commitmentValue = zerocoinParams->coinCommitmentGroup.g.pow_mod(bnSerial, zerocoinParams->coinCommitmentGroup.modulus).mul_mod(
-            zerocoinParams->coinCommitmentGroup.h.pow_mod(bnRandomness, zerocoinParams->coinCommitmentGroup.modulus),
-            zerocoinParams->coinCommitmentGroup.modulus);
+    CBigNum commitmentValue = zerocoinParams->coinCommitmentGroup.pow_g(bnSerial).mul_mod(
+            zerocoinParams->coinCommitmentGroup.pow_h(bnRandomness), zerocoinParams->coinCommitmentGroup.modulus);
 
     CBigNum random;
     arith_uint256 attempts256;
@@ -410,8 +409,8 @@ void CzWallet::SeedToZerocoin(const uint512& seedZerocoin, CBigNum& bnValue, CBi
                               hashAttempts.begin(), hashAttempts.end());
         random.setuint256(hashRandomness);
         bnRandomness = (bnRandomness + random) % zerocoinParams->coinCommitmentGroup.groupOrder;
-        commitmentValue = commitmentValue.mul_mod(zerocoinParams->coinCommitmentGroup.h.pow_mod(random,
-                zerocoinParams->coinCommitmentGroup.modulus), zerocoinParams->coinCommitmentGroup.modulus);
+        commitmentValue = commitmentValue.mul_mod(zerocoinParams->coinCommitmentGroup.pow_h(random),
+                zerocoinParams->coinCommitmentGroup.modulus);
     }
 }
 
@@ -6,11 +6,13 @@
 #include <wallet/db.h>
 
 #include <addrman.h>
+#include <dbwrapper.h>
 #include <hash.h>
 #include <protocol.h>
 #include <utilstrencodings.h>
 #include <wallet/walletutil.h>
 
+#include <errno.h>
 #include <stdint.h>
 
 #ifndef WIN32
@@ -54,8 +56,38 @@ void CheckUniqueFileid(const BerkeleyEnvironment& env, const std::string& filena
 
 CCriticalSection cs_db;
 std::map<std::string, BerkeleyEnvironment> g_dbenvs GUARDED_BY(cs_db); //!< Map from directory name to open db environment.
+
+/** Wallet record bytes written to and read from a CDBWrapper as they are, without a length prefix, so that
+ * LevelDB holds the same keys and values as the BerkeleyDB file. */
+typedef RawBytesRef<WalletDBBytes> RawRecord;
+
+WalletDBBytes ToBytes(const CDataStream& ss)
+{
+    return WalletDBBytes(ss.begin(), ss.end());
+}
+
+void ToStream(const WalletDBBytes& vch, CDataStream& ss)
+{
+    ss.SetType(SER_DISK);
+    ss.clear();
+    ss.write((const char*)vch.data(), vch.size());
+}
+
+//! Use LevelDB for new wallet directories when -walletbackend=leveldb, BerkeleyDB files are migrated by Verify
+bool UseLevelDB(const fs::path& wallet_path)
+{
+    if (IsLevelDBWallet(wallet_path))
+        return true;
+    return gArgs.GetArg("-walletbackend", DEFAULT_WALLET_BACKEND) == "leveldb" &&
+           !fs::is_regular_file(wallet_path) && !fs::exists(wallet_path / "wallet.dat");
+}
 } // namespace
 
+bool IsLevelDBWallet(const fs::path& wallet_path)
+{
+    return !fs::is_regular_file(wallet_path) && fs::is_directory(wallet_path / WALLET_LEVELDB_DIRNAME);
+}
+
 BerkeleyEnvironment* GetWalletEnv(const fs::path& wallet_path, std::string& database_filename)
 {
     fs::path env_directory;
@@ -79,6 +111,114 @@ BerkeleyEnvironment* GetWalletEnv(const fs::path& wallet_path, std::string& data
     return &g_dbenvs.emplace(std::piecewise_construct, std::forward_as_tuple(env_directory.string()), std::forward_as_tuple(env_directory)).first->second;
 }
 
+BerkeleyDatabase::BerkeleyDatabase() : nUpdateCounter(0), nLastSeen(0), nLastFlushed(0), nLastWalletUpdate(0), env(nullptr),
+    fSharedTxn(false), pSharedTxn(nullptr)
+{
+}
+
+BerkeleyDatabase::BerkeleyDatabase(const fs::path& wallet_path, bool mock) :
+    nUpdateCounter(0), nLastSeen(0), nLastFlushed(0), nLastWalletUpdate(0), env(nullptr), fSharedTxn(false), pSharedTxn(nullptr)
+{
+    if (!mock && UseLevelDB(wallet_path)) {
+        strFile = WALLET_LEVELDB_DIRNAME;
+        m_leveldb_path = wallet_path / WALLET_LEVELDB_DIRNAME;
+        m_leveldb = MakeUnique<CDBWrapper>(m_leveldb_path, WALLET_LEVELDB_CACHE);
+        return;
+    }
+    env = GetWalletEnv(wallet_path, strFile);
+    if (mock) {
+        env->Close();
+        env->Reset();
+        env->MakeMock();
+    }
+}
+
+BerkeleyDatabase::~BerkeleyDatabase()
+{
+    if (fSharedTxn)
+        TxnAbort();
+}
+
+bool BerkeleyDatabase::TxnBegin()
+{
+    if (IsDummy())
+        return false;
+    LOCK(cs_db);
+    if (fSharedTxn)
+        return false;
+    if (!m_leveldb) {
+        if (!env->Open(false /* retry */))
+            return false;
+        pSharedTxn = env->TxnBegin();
+        if (!pSharedTxn)
+            return false;
+    }
+    // The owner is set first, so that a thread that sees the transaction also sees whose it is
+    shared_txn_thread = std::this_thread::get_id();
+    fSharedTxn = true;
+    return true;
+}
+
+bool BerkeleyDatabase::TxnCommit()
+{
+    LOCK(cs_db);
+    if (!fSharedTxn)
+        return false;
+    fSharedTxn = false;
+    shared_txn_thread = std::thread::id();
+    if (!m_leveldb) {
+        int ret = pSharedTxn->commit(0);
+        pSharedTxn = nullptr;
+        return ret == 0;
+    }
+
+    // All writes of the transaction go to disk atomically in one batch
+    CDBBatch batch(*m_leveldb);
+    for (auto& write : mapSharedWrites) {
+        WalletDBBytes& vchKey = const_cast<WalletDBBytes&>(write.first);
+        if (write.second)
+            batch.Write(RawRecord(vchKey), RawRecord(*write.second));
+        else
+            batch.Erase(RawRecord(vchKey));
+    }
+    mapSharedWrites.clear();
+    try {
+        return m_leveldb->WriteBatch(batch);
+    } catch (const dbwrapper_error& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+        return false;
+    }
+}
+
+bool BerkeleyDatabase::TxnAbort()
+{
+    LOCK(cs_db);
+    if (!fSharedTxn)
+        return false;
+    fSharedTxn = false;
+    shared_txn_thread = std::thread::id();
+    mapSharedWrites.clear();
+    if (pSharedTxn) {
+        int ret = pSharedTxn->abort();
+        pSharedTxn = nullptr;
+        return ret == 0;
+    }
+    return true;
+}
+
+bool BerkeleyDatabase::InTxn() const
+{
+    return fSharedTxn && shared_txn_thread == std::this_thread::get_id();
+}
+
+std::unique_ptr<BerkeleyDatabase> BerkeleyDatabase::CreateMockLevelDB()
+{
+    std::unique_ptr<BerkeleyDatabase> database = MakeUnique<BerkeleyDatabase>();
+    database->strFile = WALLET_LEVELDB_DIRNAME;
+    database->m_leveldb = MakeUnique<CDBWrapper>(WALLET_LEVELDB_DIRNAME, WALLET_LEVELDB_CACHE, true /* fMemory */);
+    return database;
+}
+
 //
 // BerkeleyBatch
 //
@@ -368,6 +508,71 @@ bool BerkeleyBatch::VerifyDatabaseFile(const fs::path& file_path, std::string& w
     return true;
 }
 
+bool BerkeleyBatch::MigrateToLevelDB(const fs::path& file_path, std::string& errorStr)
+{
+    if (IsLevelDBWallet(file_path))
+        return true;
+    if (fs::is_regular_file(file_path)) {
+        LogPrintf("Wallet %s is a data file outside of a wallet directory, keeping BerkeleyDB\n", file_path.string());
+        return true;
+    }
+    fs::path pathDat = file_path / "wallet.dat";
+    if (!fs::exists(pathDat))
+        return true;
+
+    fs::path pathLevelDB = file_path / WALLET_LEVELDB_DIRNAME;
+    fs::path pathTmp = file_path / (std::string(WALLET_LEVELDB_DIRNAME) + ".tmp");
+    LogPrintf("Migrating wallet %s to LevelDB...\n", pathDat.string());
+    int64_t nStart = GetTimeMillis();
+    size_t nRecords = 0;
+    try {
+        BerkeleyDatabase database(file_path);
+        {
+            BerkeleyBatch db(database, "r");
+            std::unique_ptr<DatabaseCursor> pcursor = db.GetCursor();
+            if (!pcursor) {
+                errorStr = strprintf(_("Error reading %s for the migration to LevelDB"), pathDat.string());
+                return false;
+            }
+
+            CDBWrapper dbDest(pathTmp, WALLET_LEVELDB_CACHE, false, true /* fWipe */);
+            CDBBatch batch(dbDest);
+            while (true) {
+                CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+                CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+                int ret = db.ReadAtCursor(pcursor.get(), ssKey, ssValue);
+                if (ret == DB_NOTFOUND)
+                    break;
+                if (ret != 0) {
+                    errorStr = strprintf(_("Error reading %s for the migration to LevelDB"), pathDat.string());
+                    return false;
+                }
+                WalletDBBytes vchKey = ToBytes(ssKey), vchValue = ToBytes(ssValue);
+                batch.Write(RawRecord(vchKey), RawRecord(vchValue));
+                if (batch.SizeEstimate() > WALLET_LEVELDB_CACHE) {
+                    dbDest.WriteBatch(batch);
+                    batch.Clear();
+                }
+                nRecords++;
+            }
+            dbDest.WriteBatch(batch, true);
+        }
+        // Detach wallet.dat from the environment so it can be moved
+        database.Flush(true);
+
+        // The migration is complete once wallet.ldb exists, wallet.dat only stays as a backup
+        fs::rename(pathTmp, pathLevelDB);
+        fs::path pathBackup = file_path / strprintf("wallet.dat.%d.bak", GetTime());
+        fs::rename(pathDat, pathBackup);
+        LogPrintf("Migrated %u wallet records to %s in %dms, the BerkeleyDB wallet was kept as %s\n", nRecords,
+            pathLevelDB.string(), GetTimeMillis() - nStart, pathBackup.string());
+    } catch (const std::exception& e) {
+        errorStr = strprintf(_("Error migrating wallet %s to LevelDB: %s"), pathDat.string(), e.what());
+        return false;
+    }
+    return true;
+}
+
 /* End of headers, beginning of key/value data */
 static const char *HEADER_END = "HEADER=END";
 /* End of key/value data */
@@ -443,7 +648,8 @@ void BerkeleyEnvironment::CheckpointLSN(const std::string& strFile)
 }
 
 
-BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bool fFlushOnCloseIn) : pdb(nullptr), activeTxn(nullptr)
+BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bool fFlushOnCloseIn) : pdb(nullptr), activeTxn(nullptr),
+    pdatabase(&database), pldb(nullptr), fLevelDBTxn(false), fNestedTxn(false)
 {
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
     fFlushOnClose = fFlushOnCloseIn;
@@ -454,6 +660,17 @@ BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bo
     const std::string &strFilename = database.strFile;
 
     bool fCreate = strchr(pszMode, 'c') != nullptr;
+    if (database.m_leveldb) {
+        pldb = database.m_leveldb.get();
+        strFile = strFilename;
+        if (fCreate && !Exists(std::string("version"))) {
+            bool fTmp = fReadOnly;
+            fReadOnly = false;
+            WriteVersion(CLIENT_VERSION);
+            fReadOnly = fTmp;
+        }
+        return;
+    }
     unsigned int nFlags = DB_THREAD;
     if (fCreate)
         nFlags |= DB_CREATE;
@@ -522,9 +739,350 @@ BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bo
     }
 }
 
+BerkeleyBatch::~BerkeleyBatch()
+{
+    Close();
+}
+
+WalletDBWrites* BerkeleyBatch::TxnWrites()
+{
+    if (fLevelDBTxn && !fNestedTxn)
+        return &mapTxnWrites;
+    if (pdatabase->InTxn())
+        return &pdatabase->mapSharedWrites;
+    return nullptr;
+}
+
+bool BerkeleyBatch::ReadLevelDB(const CDataStream& ssKey, CDataStream& ssValue)
+{
+    WalletDBBytes vchKey = ToBytes(ssKey);
+    if (WalletDBWrites* pwrites = TxnWrites()) {
+        auto mi = pwrites->find(vchKey);
+        if (mi != pwrites->end()) {
+            if (!mi->second)
+                return false;
+            ToStream(*mi->second, ssValue);
+            return true;
+        }
+    }
+
+    WalletDBBytes vchValue;
+    RawRecord value(vchValue);
+    try {
+        if (!pldb->Read(RawRecord(vchKey), value))
+            return false;
+    } catch (const dbwrapper_error& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+        return false;
+    }
+    ToStream(vchValue, ssValue);
+    return true;
+}
+
+bool BerkeleyBatch::WriteLevelDB(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite)
+{
+    if (!fOverwrite) {
+        CDataStream ssExisting(SER_DISK, CLIENT_VERSION);
+        if (ReadLevelDB(ssKey, ssExisting))
+            return false;
+    }
+
+    WalletDBBytes vchKey = ToBytes(ssKey);
+    if (WalletDBWrites* pwrites = TxnWrites()) {
+        (*pwrites)[vchKey] = ToBytes(ssValue);
+        return true;
+    }
+
+    WalletDBBytes vchValue = ToBytes(ssValue);
+    try {
+        return pldb->Write(RawRecord(vchKey), RawRecord(vchValue));
+    } catch (const dbwrapper_error& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+        return false;
+    }
+}
+
+bool BerkeleyBatch::EraseLevelDB(const CDataStream& ssKey)
+{
+    WalletDBBytes vchKey = ToBytes(ssKey);
+    if (WalletDBWrites* pwrites = TxnWrites()) {
+        (*pwrites)[vchKey] = boost::none;
+        return true;
+    }
+
+    try {
+        return pldb->Erase(RawRecord(vchKey));
+    } catch (const dbwrapper_error& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+        return false;
+    }
+}
+
+bool BerkeleyBatch::TxnBegin()
+{
+    if (pldb) {
+        if (fLevelDBTxn)
+            return false;
+        fLevelDBTxn = true;
+        // Nested in the shared transaction, its writes go there directly and are undone on abort
+        fNestedTxn = pdatabase->InTxn();
+        if (fNestedTxn)
+            mapSharedSaved = pdatabase->mapSharedWrites;
+        return true;
+    }
+    if (!pdb || activeTxn)
+        return false;
+    DbTxn* ptxn = env->TxnBegin(DB_TXN_WRITE_NOSYNC, CurrentTxn());
+    if (!ptxn)
+        return false;
+    activeTxn = ptxn;
+    return true;
+}
+
+bool BerkeleyBatch::TxnCommit()
+{
+    if (pldb) {
+        if (!fLevelDBTxn)
+            return false;
+        fLevelDBTxn = false;
+        if (fNestedTxn) {
+            fNestedTxn = false;
+            mapSharedSaved.clear();
+            return true;
+        }
+
+        // All writes of the transaction go to disk atomically in one batch
+        CDBBatch batch(*pldb);
+        for (auto& write : mapTxnWrites) {
+            WalletDBBytes& vchKey = const_cast<WalletDBBytes&>(write.first);
+            if (write.second)
+                batch.Write(RawRecord(vchKey), RawRecord(*write.second));
+            else
+                batch.Erase(RawRecord(vchKey));
+        }
+        mapTxnWrites.clear();
+        try {
+            return pldb->WriteBatch(batch);
+        } catch (const dbwrapper_error& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            return false;
+        }
+    }
+    if (!pdb || !activeTxn)
+        return false;
+    int ret = activeTxn->commit(0);
+    activeTxn = nullptr;
+    return (ret == 0);
+}
+
+bool BerkeleyBatch::TxnAbort()
+{
+    if (pldb) {
+        if (!fLevelDBTxn)
+            return false;
+        if (fNestedTxn && pdatabase->InTxn())
+            pdatabase->mapSharedWrites.swap(mapSharedSaved);
+        mapSharedSaved.clear();
+        mapTxnWrites.clear();
+        fLevelDBTxn = false;
+        fNestedTxn = false;
+        return true;
+    }
+    if (!pdb || !activeTxn)
+        return false;
+    int ret = activeTxn->abort();
+    activeTxn = nullptr;
+    return (ret == 0);
+}
+
+std::unique_ptr<DatabaseCursor> BerkeleyBatch::GetCursor()
+{
+    if (pldb)
+        return MakeUnique<DatabaseCursor>(*this, pldb->NewIterator());
+    if (!pdb)
+        return nullptr;
+    Dbc* pcursor = nullptr;
+    int ret = pdb->cursor(CurrentTxn(), &pcursor, 0);
+    if (ret != 0)
+        return nullptr;
+    return MakeUnique<DatabaseCursor>(pcursor);
+}
+
+std::unique_ptr<DatabaseCursor> BerkeleyBatch::GetTxnCursor()
+{
+    if (!InTxn())
+        return nullptr;
+    if (pldb)
+        return MakeUnique<DatabaseCursor>(*this, pldb->NewIterator());
+    Dbc* pcursor = nullptr;
+    int ret = pdb->cursor(activeTxn, &pcursor, 0);
+    if (ret != 0)
+        return nullptr;
+    return MakeUnique<DatabaseCursor>(pcursor);
+}
+
+//
+// DatabaseCursor
+//
+
+DatabaseCursor::DatabaseCursor(Dbc* pcursorIn) : pcursor(pcursorIn), pbatch(nullptr), fPositioned(false)
+{
+}
+
+DatabaseCursor::DatabaseCursor(BerkeleyBatch& batchIn, CDBIterator* piterIn) : pcursor(nullptr), pbatch(&batchIn), piter(piterIn), fPositioned(false)
+{
+}
+
+DatabaseCursor::~DatabaseCursor()
+{
+    close();
+}
+
+void DatabaseCursor::close()
+{
+    if (pcursor) {
+        pcursor->close();
+        pcursor = nullptr;
+    }
+    piter.reset();
+    pbatch = nullptr;
+}
+
+int DatabaseCursor::Read(CDataStream& ssKey, CDataStream* pssValue, unsigned int fFlags)
+{
+    if (pcursor) {
+        // Read at cursor
+        Dbt datKey;
+        if (fFlags == DB_SET || fFlags == DB_SET_RANGE || fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
+            datKey.set_data(ssKey.data());
+            datKey.set_size(ssKey.size());
+        }
+        Dbt datValue;
+        if (pssValue && (fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE)) {
+            datValue.set_data(pssValue->data());
+            datValue.set_size(pssValue->size());
+        }
+        datKey.set_flags(DB_DBT_MALLOC);
+        datValue.set_flags(pssValue ? DB_DBT_MALLOC : DB_DBT_PARTIAL); // partial with length 0 skips the data
+        int ret = pcursor->get(&datKey, &datValue, fFlags);
+        if (ret != 0)
+            return ret;
+        else if (datKey.get_data() == nullptr || (pssValue && datValue.get_data() == nullptr))
+            return 99999;
+
+        // Convert to streams
+        ssKey.SetType(SER_DISK);
+        ssKey.clear();
+        ssKey.write((char*)datKey.get_data(), datKey.get_size());
+        memory_cleanse(datKey.get_data(), datKey.get_size());
+        free(datKey.get_data());
+        if (pssValue) {
+            pssValue->SetType(SER_DISK);
+            pssValue->clear();
+            pssValue->write((char*)datValue.get_data(), datValue.get_size());
+            memory_cleanse(datValue.get_data(), datValue.get_size());
+            free(datValue.get_data());
+        }
+        return 0;
+    }
+
+    if (!piter)
+        return EINVAL;
+
+    // Position the database iterator at the first key >= vchTarget, or > vchTarget if !fInclusive
+    WalletDBBytes vchTarget;
+    bool fInclusive = true;
+    if (fFlags == DB_SET || fFlags == DB_SET_RANGE) {
+        vchTarget = ToBytes(ssKey);
+        piter->Seek(RawRecord(vchTarget));
+    } else if (fFlags == DB_FIRST || (fFlags == DB_NEXT && !fPositioned)) {
+        piter->SeekToFirst();
+    } else if (fFlags == DB_NEXT) {
+        vchTarget = vchKey;
+        fInclusive = false;
+    } else {
+        return EINVAL;
+    }
+
+    WalletDBBytes vchDbKey;
+    static const WalletDBWrites mapNoWrites;
+    const WalletDBWrites* pwrites = pbatch->TxnWrites();
+    const WalletDBWrites& mapWrites = pwrites ? *pwrites : mapNoWrites;
+    while (true) {
+        bool fDbValid = false;
+        while (piter->Valid()) {
+            RawRecord key(vchDbKey);
+            if (!piter->GetKey(key))
+                return 99999;
+            if (fInclusive ? vchDbKey >= vchTarget : vchDbKey > vchTarget) {
+                fDbValid = true;
+                break;
+            }
+            piter->Next();
+        }
+        auto mi = fInclusive ? mapWrites.lower_bound(vchTarget) : mapWrites.upper_bound(vchTarget);
+        bool fTxnValid = mi != mapWrites.end();
+        if (!fDbValid && !fTxnValid)
+            return DB_NOTFOUND;
+
+        // Writes of the open transaction take precedence over the same key in the database
+        bool fFromTxn = fTxnValid && (!fDbValid || mi->first <= vchDbKey);
+        const WalletDBBytes& vchFound = fFromTxn ? mi->first : vchDbKey;
+        if (fFlags == DB_SET && vchFound != vchTarget)
+            return DB_NOTFOUND;
+        if (fFromTxn && !mi->second) {
+            // Erased in the transaction, keep looking after it
+            vchTarget = vchFound;
+            fInclusive = false;
+            continue;
+        }
+
+        vchKey = vchFound;
+        fPositioned = true;
+        ToStream(vchKey, ssKey);
+        if (pssValue) {
+            if (fFromTxn) {
+                ToStream(*mi->second, *pssValue);
+            } else {
+                WalletDBBytes vchValue;
+                RawRecord value(vchValue);
+                if (!piter->GetValue(value))
+                    return 99999;
+                ToStream(vchValue, *pssValue);
+            }
+        }
+        return 0;
+    }
+}
+
+int DatabaseCursor::Replace(const CDataStream& ssValue)
+{
+    if (pcursor) {
+        Dbt datValue((void*)ssValue.data(), ssValue.size());
+        return pcursor->put(nullptr, &datValue, DB_CURRENT);
+    }
+    if (!pbatch || !fPositioned)
+        return EINVAL;
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ToStream(vchKey, ssKey);
+    return pbatch->WriteLevelDB(ssKey, ssValue, true) ? 0 : EIO;
+}
+
+int DatabaseCursor::del(uint32_t flags)
+{
+    if (pcursor)
+        return pcursor->del(flags);
+    if (!pbatch || !fPositioned)
+        return EINVAL;
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ToStream(vchKey, ssKey);
+    return pbatch->EraseLevelDB(ssKey) ? 0 : EIO;
+}
+
 void BerkeleyBatch::Flush()
 {
-    if (activeTxn)
+    // LevelDB writes are in its log already, BerkeleyDatabase::Flush syncs it
+    if (activeTxn || pldb)
         return;
 
     // Flush database activity from memory pool to disk log
@@ -542,6 +1100,13 @@ void BerkeleyDatabase::IncrementUpdateCounter()
 
 void BerkeleyBatch::Close()
 {
+    if (pldb) {
+        // Like an open BerkeleyDB transaction, uncommitted writes are dropped
+        if (fLevelDBTxn)
+            TxnAbort();
+        pldb = nullptr;
+        return;
+    }
     if (!pdb)
         return;
     if (activeTxn)
@@ -577,6 +1142,30 @@ bool BerkeleyBatch::Rewrite(BerkeleyDatabase& database, const char* pszSkip)
     if (database.IsDummy()) {
         return true;
     }
+    if (database.m_leveldb) {
+        LogPrintf("BerkeleyBatch::Rewrite: Compacting %s...\n", database.strFile);
+        CDBWrapper& db = *database.m_leveldb;
+        try {
+            if (pszSkip) {
+                WalletDBBytes vchSkip(pszSkip, pszSkip + strlen(pszSkip)), vchKey;
+                CDBBatch batch(db);
+                std::unique_ptr<CDBIterator> piter(db.NewIterator());
+                for (piter->Seek(RawRecord(vchSkip)); piter->Valid(); piter->Next()) {
+                    RawRecord key(vchKey);
+                    if (!piter->GetKey(key) || vchKey.size() < vchSkip.size() || !std::equal(vchSkip.begin(), vchSkip.end(), vchKey.begin()))
+                        break;
+                    batch.Erase(key);
+                }
+                db.WriteBatch(batch, true);
+            }
+            WalletDBBytes vchBegin, vchEnd(1, 0xff);
+            db.CompactRange(RawRecord(vchBegin), RawRecord(vchEnd));
+        } catch (const dbwrapper_error& e) {
+            LogPrintf("BerkeleyBatch::Rewrite: Failed to rewrite database %s: %s\n", database.strFile, e.what());
+            return false;
+        }
+        return true;
+    }
     BerkeleyEnvironment *env = database.env;
     const std::string& strFile = database.strFile;
     while (true) {
@@ -606,12 +1195,12 @@ bool BerkeleyBatch::Rewrite(BerkeleyDatabase& database, const char* pszSkip)
                         fSuccess = false;
                     }
 
-                    Dbc* pcursor = db.GetCursor();
+                    std::unique_ptr<DatabaseCursor> pcursor = db.GetCursor();
                     if (pcursor)
                         while (fSuccess) {
                             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
                             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-                            int ret1 = db.ReadAtCursor(pcursor, ssKey, ssValue);
+                            int ret1 = db.ReadAtCursor(pcursor.get(), ssKey, ssValue);
                             if (ret1 == DB_NOTFOUND) {
                                 pcursor->close();
                                 break;
@@ -708,11 +1297,19 @@ bool BerkeleyBatch::PeriodicFlush(BerkeleyDatabase& database)
     if (database.IsDummy()) {
         return true;
     }
+    if (database.m_leveldb) {
+        try {
+            return database.m_leveldb->Sync();
+        } catch (const dbwrapper_error& e) {
+            LogPrintf("Error flushing %s: %s\n", database.strFile, e.what());
+            return false;
+        }
+    }
     bool ret = false;
     BerkeleyEnvironment *env = database.env;
     const std::string& strFile = database.strFile;
     TRY_LOCK(cs_db, lockDb);
-    if (lockDb)
+    if (lockDb && !database.fSharedTxn)
     {
         // Don't do this if any databases are in use
         int nRefCount = 0;
@@ -756,6 +1353,38 @@ bool BerkeleyDatabase::Backup(const std::string& strDest)
     if (IsDummy()) {
         return false;
     }
+    if (m_leveldb) {
+        // LevelDB iterators read a consistent snapshot, so the wallet can stay in use while it is copied
+        fs::path pathDest(strDest);
+        if (fs::is_directory(pathDest) && !fs::exists(pathDest / "CURRENT"))
+            pathDest /= strFile;
+        try {
+            if (m_leveldb_path.empty() || (fs::exists(pathDest) && fs::equivalent(m_leveldb_path, pathDest))) {
+                LogPrintf("cannot backup to wallet source directory %s\n", pathDest.string());
+                return false;
+            }
+            CDBWrapper dbDest(pathDest, WALLET_LEVELDB_CACHE, false, true /* fWipe */);
+            CDBBatch batch(dbDest);
+            WalletDBBytes vchKey, vchValue;
+            std::unique_ptr<CDBIterator> piter(m_leveldb->NewIterator());
+            for (piter->SeekToFirst(); piter->Valid(); piter->Next()) {
+                RawRecord key(vchKey), value(vchValue);
+                if (!piter->GetKey(key) || !piter->GetValue(value))
+                    throw dbwrapper_error("Unreadable record");
+                batch.Write(key, value);
+                if (batch.SizeEstimate() > WALLET_LEVELDB_CACHE) {
+                    dbDest.WriteBatch(batch);
+                    batch.Clear();
+                }
+            }
+            dbDest.WriteBatch(batch, true);
+            LogPrintf("copied %s to %s\n", strFile, pathDest.string());
+            return true;
+        } catch (const std::exception& e) {
+            LogPrintf("error copying %s to %s - %s\n", strFile, pathDest.string(), e.what());
+            return false;
+        }
+    }
     while (true)
     {
         {
@@ -794,6 +1423,15 @@ bool BerkeleyDatabase::Backup(const std::string& strDest)
 
 void BerkeleyDatabase::Flush(bool shutdown)
 {
+    if (m_leveldb) {
+        try {
+            m_leveldb->Sync();
+        } catch (const dbwrapper_error& e) {
+            LogPrintf("Error flushing %s: %s\n", strFile, e.what());
+        }
+        if (shutdown) m_leveldb.reset();
+        return;
+    }
     if (!IsDummy()) {
         env->Flush(shutdown);
         if (shutdown) env = nullptr;
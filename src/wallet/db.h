@@ -18,12 +18,30 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <boost/optional.hpp>
+
 #include <db_cxx.h>
 
 static const unsigned int DEFAULT_WALLET_DBLOGSIZE = 100;
 static const bool DEFAULT_WALLET_PRIVDB = true;
+//! -walletbackend default, "bdb" or "leveldb"
+static const char* const DEFAULT_WALLET_BACKEND = "bdb";
+//! Directory inside a wallet directory that holds a LevelDB wallet instead of wallet.dat
+static const char* const WALLET_LEVELDB_DIRNAME = "wallet.ldb";
+//! Cache size of a LevelDB wallet
+static const size_t WALLET_LEVELDB_CACHE = 8 << 20;
+
+class BerkeleyBatch;
+class CDBIterator;
+class CDBWrapper;
+
+/** Serialized key or value of a wallet record, ordered like the keys in both backends */
+typedef std::vector<unsigned char, zero_after_free_allocator<unsigned char> > WalletDBBytes;
+/** Writes of an open LevelDB transaction, erased records have no value */
+typedef std::map<WalletDBBytes, boost::optional<WalletDBBytes> > WalletDBWrites;
 
 class BerkeleyEnvironment
 {
@@ -76,10 +94,10 @@ public:
 
     void CloseDb(const std::string& strFile);
 
-    DbTxn* TxnBegin(int flags = DB_TXN_WRITE_NOSYNC)
+    DbTxn* TxnBegin(int flags = DB_TXN_WRITE_NOSYNC, DbTxn* parent = nullptr)
     {
         DbTxn* ptxn = nullptr;
-        int ret = dbenv->txn_begin(nullptr, &ptxn, flags);
+        int ret = dbenv->txn_begin(parent, &ptxn, flags);
         if (!ptxn || ret != 0)
             return nullptr;
         return ptxn;
@@ -89,29 +107,25 @@ public:
 /** Get BerkeleyEnvironment and database filename given a wallet path. */
 BerkeleyEnvironment* GetWalletEnv(const fs::path& wallet_path, std::string& database_filename);
 
+/** Return whether the wallet at wallet_path is stored in LevelDB instead of a BerkeleyDB file. */
+bool IsLevelDBWallet(const fs::path& wallet_path);
+
 /** An instance of this class represents one database.
  * For BerkeleyDB this is just a (env, strFile) tuple.
+ * With -walletbackend=leveldb the records are kept in a CDBWrapper in the wallet directory instead. The keys and
+ * values are stored with exactly the bytes BerkeleyDB would store, so both backends iterate in the same order.
  **/
 class BerkeleyDatabase
 {
     friend class BerkeleyBatch;
 public:
     /** Create dummy DB handle */
-    BerkeleyDatabase() : nUpdateCounter(0), nLastSeen(0), nLastFlushed(0), nLastWalletUpdate(0), env(nullptr)
-    {
-    }
+    BerkeleyDatabase();
 
     /** Create DB handle to real database */
-    BerkeleyDatabase(const fs::path& wallet_path, bool mock = false) :
-        nUpdateCounter(0), nLastSeen(0), nLastFlushed(0), nLastWalletUpdate(0)
-    {
-        env = GetWalletEnv(wallet_path, strFile);
-        if (mock) {
-            env->Close();
-            env->Reset();
-            env->MakeMock();
-        }
-    }
+    BerkeleyDatabase(const fs::path& wallet_path, bool mock = false);
+
+    ~BerkeleyDatabase();
 
     /** Return object for accessing database at specified path. */
     static std::unique_ptr<BerkeleyDatabase> Create(const fs::path& path)
@@ -131,11 +145,15 @@ public:
         return MakeUnique<BerkeleyDatabase>("", true /* mock */);
     }
 
+    /** Return object for accessing temporary in-memory LevelDB database. */
+    static std::unique_ptr<BerkeleyDatabase> CreateMockLevelDB();
+
     /** Rewrite the entire database on disk, with the exception of key pszSkip if non-zero
+     * (LevelDB: erase the skipped keys and compact)
      */
     bool Rewrite(const char* pszSkip=nullptr);
 
-    /** Back up the entire database to a file.
+    /** Back up the entire database to a file (LevelDB: to a directory).
      */
     bool Backup(const std::string& strDest);
 
@@ -145,6 +163,14 @@ public:
 
     void IncrementUpdateCounter();
 
+    /** Start a transaction that every batch of this database opened by the calling thread joins, until it is
+     * committed or aborted. Batches that begin their own transaction meanwhile nest it in the shared one.
+     */
+    bool TxnBegin();
+    bool TxnCommit();
+    bool TxnAbort();
+    bool InTxn() const;
+
     std::atomic<unsigned int> nUpdateCounter;
     unsigned int nLastSeen;
     unsigned int nLastFlushed;
@@ -155,11 +181,54 @@ private:
     BerkeleyEnvironment *env;
     std::string strFile;
 
+    /** LevelDB specific */
+    std::unique_ptr<CDBWrapper> m_leveldb;
+    fs::path m_leveldb_path;
+
+    /** Shared transaction, see TxnBegin(). Changed under cs_db, and read without it by InTxn() */
+    std::atomic<bool> fSharedTxn;
+    std::atomic<std::thread::id> shared_txn_thread;
+    DbTxn* pSharedTxn;
+    WalletDBWrites mapSharedWrites;
+
     /** Return whether this database handle is a dummy for testing.
      * Only to be used at a low level, application should ideally not care
      * about this.
      */
-    bool IsDummy() { return env == nullptr; }
+    bool IsDummy() { return env == nullptr && !m_leveldb; }
+};
+
+/** Cursor over the records of a wallet database. It wraps a BerkeleyDB cursor or, for LevelDB wallets, walks the
+ * database and the uncommitted writes of the batch's transaction together in key order. The del() and close()
+ * calls are named like their Dbc counterparts.
+ */
+class DatabaseCursor
+{
+public:
+    explicit DatabaseCursor(Dbc* pcursorIn);
+    DatabaseCursor(BerkeleyBatch& batchIn, CDBIterator* piterIn);
+    ~DatabaseCursor();
+
+    DatabaseCursor(const DatabaseCursor&) = delete;
+    DatabaseCursor& operator=(const DatabaseCursor&) = delete;
+
+    /** Move the cursor and read the record there. fFlags is DB_NEXT, DB_FIRST, DB_SET or DB_SET_RANGE (which
+     * read the search key from ssKey), BerkeleyDB cursors also take DB_GET_BOTH(_RANGE). The value is not read
+     * if pssValue is null. Returns 0, DB_NOTFOUND at the end or another error code.
+     */
+    int Read(CDataStream& ssKey, CDataStream* pssValue, unsigned int fFlags);
+    /** Replace the value of the record at the cursor */
+    int Replace(const CDataStream& ssValue);
+    /** Erase the record at the cursor */
+    int del(uint32_t flags = 0);
+    void close();
+
+private:
+    Dbc* pcursor;
+    BerkeleyBatch* pbatch;
+    std::unique_ptr<CDBIterator> piter;
+    WalletDBBytes vchKey;
+    bool fPositioned;
 };
 
 
@@ -174,9 +243,19 @@ public:
     bool fFlushOnClose;
     BerkeleyEnvironment *env;
 
+    BerkeleyDatabase* pdatabase;
+
+    /** LevelDB backend: the database, the writes of the batch's own transaction, and the shared writes from
+     * before a nested transaction began, to restore them on abort */
+    CDBWrapper* pldb;
+    bool fLevelDBTxn;
+    bool fNestedTxn;
+    WalletDBWrites mapTxnWrites;
+    WalletDBWrites mapSharedSaved;
+
 public:
     explicit BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode = "r+", bool fFlushOnCloseIn=true);
-    ~BerkeleyBatch() { Close(); }
+    ~BerkeleyBatch();
 
     BerkeleyBatch(const BerkeleyBatch&) = delete;
     BerkeleyBatch& operator=(const BerkeleyBatch&) = delete;
@@ -192,24 +271,49 @@ public:
     static bool VerifyEnvironment(const fs::path& file_path, std::string& errorStr);
     /* verifies the database file */
     static bool VerifyDatabaseFile(const fs::path& file_path, std::string& warningStr, std::string& errorStr, BerkeleyEnvironment::recoverFunc_type recoverFunc);
+    /* copies a BerkeleyDB wallet into a new LevelDB wallet, keeping the old file as a backup */
+    static bool MigrateToLevelDB(const fs::path& file_path, std::string& errorStr);
+
+private:
+    /* LevelDB backend, reading through the writes of an open transaction */
+    bool ReadLevelDB(const CDataStream& ssKey, CDataStream& ssValue);
+    bool WriteLevelDB(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite);
+    bool EraseLevelDB(const CDataStream& ssKey);
+    /* LevelDB writes go to the batch's transaction, the shared transaction, or straight to disk if null */
+    WalletDBWrites* TxnWrites();
+
+    friend class DatabaseCursor;
 
 public:
     template <typename K, typename T>
     bool Read(const K& key, T& value)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+
+        if (pldb) {
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            if (!ReadLevelDB(ssKey, ssValue))
+                return false;
+            try {
+                ssValue >> value;
+            } catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        }
+
         Dbt datKey(ssKey.data(), ssKey.size());
 
         // Read
         Dbt datValue;
         datValue.set_flags(DB_DBT_MALLOC);
-        int ret = pdb->get(activeTxn, &datKey, &datValue, 0);
+        int ret = pdb->get(CurrentTxn(), &datKey, &datValue, 0);
         memory_cleanse(datKey.get_data(), datKey.get_size());
         bool success = false;
         if (datValue.get_data() != nullptr) {
@@ -232,7 +336,7 @@ public:
     template <typename K, typename T>
     bool Write(const K& key, const T& value, bool fOverwrite = true)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return true;
         if (fReadOnly)
             assert(!"Write called on database in read-only mode");
@@ -241,16 +345,20 @@ public:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
-        Dbt datKey(ssKey.data(), ssKey.size());
 
         // Value
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
         ssValue.reserve(10000);
         ssValue << value;
+
+        if (pldb)
+            return WriteLevelDB(ssKey, ssValue, fOverwrite);
+
+        Dbt datKey(ssKey.data(), ssKey.size());
         Dbt datValue(ssValue.data(), ssValue.size());
 
         // Write
-        int ret = pdb->put(activeTxn, &datKey, &datValue, (fOverwrite ? 0 : DB_NOOVERWRITE));
+        int ret = pdb->put(CurrentTxn(), &datKey, &datValue, (fOverwrite ? 0 : DB_NOOVERWRITE));
 
         // Clear memory in case it was a private key
         memory_cleanse(datKey.get_data(), datKey.get_size());
@@ -261,7 +369,7 @@ public:
     template <typename K>
     bool Erase(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return false;
         if (fReadOnly)
             assert(!"Erase called on database in read-only mode");
@@ -270,10 +378,13 @@ public:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+
+        if (pldb)
+            return EraseLevelDB(ssKey);
         Dbt datKey(ssKey.data(), ssKey.size());
 
         // Erase
-        int ret = pdb->del(activeTxn, &datKey, 0);
+        int ret = pdb->del(CurrentTxn(), &datKey, 0);
 
         // Clear memory
         memory_cleanse(datKey.get_data(), datKey.get_size());
@@ -283,97 +394,53 @@ public:
     template <typename K>
     bool Exists(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+
+        if (pldb) {
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            return ReadLevelDB(ssKey, ssValue);
+        }
         Dbt datKey(ssKey.data(), ssKey.size());
 
         // Exists
-        int ret = pdb->exists(activeTxn, &datKey, 0);
+        int ret = pdb->exists(CurrentTxn(), &datKey, 0);
 
         // Clear memory
         memory_cleanse(datKey.get_data(), datKey.get_size());
         return (ret == 0);
     }
 
-    Dbc* GetCursor()
-    {
-        if (!pdb)
-            return nullptr;
-        Dbc* pcursor = nullptr;
-        int ret = pdb->cursor(nullptr, &pcursor, 0);
-        if (ret != 0)
-            return nullptr;
-        return pcursor;
-    }
+    std::unique_ptr<DatabaseCursor> GetCursor();
+    /** Cursor that sees the writes of the open transaction */
+    std::unique_ptr<DatabaseCursor> GetTxnCursor();
 
-    int ReadAtCursor(Dbc* pcursor, CDataStream& ssKey, CDataStream& ssValue, bool setRange = false)
+    int ReadAtCursor(DatabaseCursor* pcursor, CDataStream& ssKey, CDataStream& ssValue, bool setRange = false)
     {
-        // Read at cursor
-        Dbt datKey;
-        unsigned int fFlags = DB_NEXT;
-        if (setRange) {
-            datKey.set_data(ssKey.data());
-            datKey.set_size(ssKey.size());
-            fFlags = DB_SET_RANGE;
-        }
-        Dbt datValue;
-        datKey.set_flags(DB_DBT_MALLOC);
-        datValue.set_flags(DB_DBT_MALLOC);
-        int ret = pcursor->get(&datKey, &datValue, fFlags);
-        if (ret != 0)
-            return ret;
-        else if (datKey.get_data() == nullptr || datValue.get_data() == nullptr)
-            return 99999;
-
-        // Convert to streams
-        ssKey.SetType(SER_DISK);
-        ssKey.clear();
-        ssKey.write((char*)datKey.get_data(), datKey.get_size());
-        ssValue.SetType(SER_DISK);
-        ssValue.clear();
-        ssValue.write((char*)datValue.get_data(), datValue.get_size());
-
-        // Clear and free memory
-        memory_cleanse(datKey.get_data(), datKey.get_size());
-        memory_cleanse(datValue.get_data(), datValue.get_size());
-        free(datKey.get_data());
-        free(datValue.get_data());
-        return 0;
+        return pcursor->Read(ssKey, &ssValue, setRange ? DB_SET_RANGE : DB_NEXT);
     }
 
 public:
-    bool TxnBegin()
-    {
-        if (!pdb || activeTxn)
-            return false;
-        DbTxn* ptxn = env->TxnBegin();
-        if (!ptxn)
-            return false;
-        activeTxn = ptxn;
-        return true;
-    }
+    bool TxnBegin();
+    bool TxnCommit();
+    bool TxnAbort();
 
-    bool TxnCommit()
+    bool InTxn() const
     {
-        if (!pdb || !activeTxn)
-            return false;
-        int ret = activeTxn->commit(0);
-        activeTxn = nullptr;
-        return (ret == 0);
+        return (pdb && activeTxn) || (pldb && fLevelDBTxn);
     }
 
-    bool TxnAbort()
+    /** BerkeleyDB transaction for reads and writes: the batch's own or the shared one of the database */
+    DbTxn* CurrentTxn() const
     {
-        if (!pdb || !activeTxn)
-            return false;
-        int ret = activeTxn->abort();
-        activeTxn = nullptr;
-        return (ret == 0);
+        if (activeTxn)
+            return activeTxn;
+        return pdatabase && pdatabase->InTxn() ? pdatabase->pSharedTxn : nullptr;
     }
 
     bool ReadVersion(int& nVersion)
@@ -932,6 +932,8 @@ static UniValue getbalances(const JSONRPCRequest& request)
     // Make sure the results are valid at least up to the most recent block
     // the user could have gotten from another RPC command prior to now
     pwallet->BlockUntilSyncedToCurrentChain();
+    // and include the wallet changes of earlier RPC commands
+    pwallet->BlockUntilBalancesUpdated();
     LOCK2(cs_main, pwallet->cs_wallet);
 
     /*
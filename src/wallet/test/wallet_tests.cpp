@@ -7,6 +7,7 @@
 #include <memory>
 #include <set>
 #include <stdint.h>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -14,6 +15,9 @@
 #include <rpc/server.h>
 #include <test/test_veil.h>
 #include <validation.h>
+#include <veil/ringct/anonwallet.h>
+#include <veil/ringct/blind.h>
+#include <veil/ringct/temprecipient.h>
 #include <wallet/coincontrol.h>
 #include <wallet/test/wallet_test_fixture.h>
 
@@ -267,6 +271,170 @@ BOOST_AUTO_TEST_CASE(LoadReceiveRequests)
     BOOST_CHECK_EQUAL(values[1], "val_rr1");
 }
 
+BOOST_AUTO_TEST_CASE(BalanceLedger)
+{
+    CBalanceLedger ledger;
+    BOOST_CHECK(ledger.IsDirty());
+    BOOST_CHECK(ledger.TakePending().fAll);
+    BOOST_CHECK(!ledger.IsDirty());
+
+    uint256 txid1 = uint256S("01");
+    uint256 txid2 = uint256S("02");
+    BalanceList bal1, bal2, balAnon;
+    bal1.nVeil = 10 * COIN;
+    bal2.nVeilImmature = 5 * COIN;
+    balAnon.nRingCT = 3 * COIN;
+    ledger.SetTx(txid1, bal1, false);
+    ledger.SetTx(txid2, bal2, true);
+    ledger.SetAnon(balAnon);
+    BOOST_CHECK_EQUAL(ledger.Get().nVeil, 10 * COIN);
+    BOOST_CHECK_EQUAL(ledger.Get().nVeilImmature, 5 * COIN);
+    BOOST_CHECK_EQUAL(ledger.Get().nRingCT, 3 * COIN);
+    BOOST_CHECK(ledger.GetDepthSensitive() == std::set<uint256>{txid2});
+
+    // A matured transaction replaces its old contribution
+    bal2.nVeilImmature = 0;
+    bal2.nVeil = 5 * COIN;
+    ledger.SetTx(txid2, bal2, false);
+    BOOST_CHECK_EQUAL(ledger.Get().nVeil, 15 * COIN);
+    BOOST_CHECK_EQUAL(ledger.Get().nVeilImmature, 0);
+    BOOST_CHECK(ledger.GetDepthSensitive().empty());
+
+    // Events queue work until it is taken, a basecoin transaction leaves the settled anon bucket alone
+    ledger.MarkTxDirty(txid1, false, false);
+    ledger.MarkBlockDirty();
+    BOOST_CHECK(ledger.IsDirty());
+    CBalanceLedger::Pending pending = ledger.TakePending();
+    BOOST_CHECK(!pending.fAll);
+    BOOST_CHECK(pending.fBlock && !pending.fAnon && !pending.fZerocoin);
+    BOOST_CHECK(pending.setTx == std::set<uint256>{txid1});
+
+    // Buckets are only recalculated on a block while they hold depth dependent amounts
+    ledger.MarkTxDirty(txid2, false, true);
+    pending = ledger.TakePending();
+    BOOST_CHECK(!pending.fAnon && pending.fZerocoin);
+    balAnon.nRingCTImmature = 2 * COIN;
+    ledger.SetAnon(balAnon);
+    ledger.MarkBlockDirty();
+    pending = ledger.TakePending();
+    BOOST_CHECK(pending.fBlock && pending.fAnon && !pending.fZerocoin);
+    balAnon.nRingCTImmature = 0;
+    ledger.SetAnon(balAnon);
+
+    // Removing all transactions keeps the anon bucket
+    ledger.ClearTxs();
+    BOOST_CHECK_EQUAL(ledger.Get().nVeil, 0);
+    BOOST_CHECK_EQUAL(ledger.Get().nRingCT, 3 * COIN);
+}
+
+BOOST_AUTO_TEST_CASE(LevelDBWalletBatch)
+{
+    std::unique_ptr<WalletDatabase> database = WalletDatabase::CreateMockLevelDB();
+    BerkeleyBatch batch(*database, "cr+");
+    int nVersion = 0;
+    BOOST_CHECK(batch.ReadVersion(nVersion));
+    BOOST_CHECK_EQUAL(nVersion, CLIENT_VERSION);
+
+    for (int i = 0; i < 4; i++)
+        BOOST_CHECK(batch.Write(std::make_pair(std::string("rec"), i), i));
+    BOOST_CHECK(!batch.Write(std::make_pair(std::string("rec"), 0), 10, false));
+
+    // Writes of a transaction are visible to the batch and its cursors, but only stored on commit
+    BOOST_CHECK(batch.TxnBegin());
+    BOOST_CHECK(batch.Write(std::make_pair(std::string("rec"), 1), 11));
+    BOOST_CHECK(batch.Erase(std::make_pair(std::string("rec"), 2)));
+    BOOST_CHECK(batch.Write(std::make_pair(std::string("rec"), 5), 5));
+    int nValue = 0;
+    BOOST_CHECK(batch.Read(std::make_pair(std::string("rec"), 1), nValue));
+    BOOST_CHECK_EQUAL(nValue, 11);
+    BOOST_CHECK(!batch.Exists(std::make_pair(std::string("rec"), 2)));
+    {
+        BerkeleyBatch other(*database, "r");
+        BOOST_CHECK(other.Read(std::make_pair(std::string("rec"), 1), nValue));
+        BOOST_CHECK_EQUAL(nValue, 1);
+    }
+
+    auto ReadRange = [](BerkeleyBatch& db) -> std::vector<std::pair<int, int>> {
+        std::vector<std::pair<int, int>> vRecords;
+        std::unique_ptr<DatabaseCursor> pcursor = db.GetCursor();
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION);
+        ssKey << std::string("rec");
+        bool fSetRange = true;
+        while (db.ReadAtCursor(pcursor.get(), ssKey, ssValue, fSetRange) == 0) {
+            fSetRange = false;
+            std::string strType;
+            ssKey >> strType;
+            if (strType != "rec")
+                break;
+            int nKey, nRecordValue;
+            ssKey >> nKey;
+            ssValue >> nRecordValue;
+            vRecords.emplace_back(nKey, nRecordValue);
+        }
+        return vRecords;
+    };
+    std::vector<std::pair<int, int>> vExpected{{0, 0}, {1, 11}, {3, 3}, {5, 5}};
+    BOOST_CHECK(ReadRange(batch) == vExpected);
+    BOOST_CHECK(batch.TxnCommit());
+    BerkeleyBatch reader(*database, "r");
+    BOOST_CHECK(ReadRange(reader) == vExpected);
+
+    BOOST_CHECK(batch.TxnBegin());
+    BOOST_CHECK(batch.Erase(std::make_pair(std::string("rec"), 0)));
+    BOOST_CHECK(batch.TxnAbort());
+    BOOST_CHECK(reader.Exists(std::make_pair(std::string("rec"), 0)));
+}
+
+BOOST_AUTO_TEST_CASE(WalletBlockTxnLevelDB)
+{
+    std::unique_ptr<WalletDatabase> database = WalletDatabase::CreateMockLevelDB();
+    auto ReadFromOtherThread = [&database](int nKey) {
+        bool fFound = false;
+        std::thread reader([&]() {
+            BerkeleyBatch batch(*database, "r");
+            fFound = batch.Exists(std::make_pair(std::string("rec"), nKey));
+        });
+        reader.join();
+        return fFound;
+    };
+
+    {
+        WalletBlockTxn block_txn(*database);
+        BOOST_CHECK(database->InTxn());
+        BOOST_CHECK(BerkeleyBatch(*database).Write(std::make_pair(std::string("rec"), 1), 1));
+        BOOST_CHECK(BerkeleyBatch(*database, "r").Exists(std::make_pair(std::string("rec"), 1)));
+
+        // Nested transactions of a batch are undone on abort without touching the shared writes
+        BerkeleyBatch batch(*database);
+        BOOST_CHECK(batch.TxnBegin());
+        BOOST_CHECK(batch.Write(std::make_pair(std::string("rec"), 2), 2));
+        BOOST_CHECK(batch.Erase(std::make_pair(std::string("rec"), 1)));
+        BOOST_CHECK(batch.TxnAbort());
+        BOOST_CHECK(!batch.Exists(std::make_pair(std::string("rec"), 2)));
+        BOOST_CHECK(batch.Exists(std::make_pair(std::string("rec"), 1)));
+        BOOST_CHECK(batch.TxnBegin());
+        BOOST_CHECK(batch.Write(std::make_pair(std::string("rec"), 3), 3));
+        BOOST_CHECK(batch.TxnCommit());
+
+        // Scopes nest, and other threads only see the writes once the outermost scope commits
+        {
+            WalletBlockTxn inner_txn(*database);
+            BOOST_CHECK(inner_txn.Commit());
+        }
+        BOOST_CHECK(database->InTxn());
+        BOOST_CHECK(!ReadFromOtherThread(1));
+
+        // The outermost scope reports whether its writes made it to disk
+        BOOST_CHECK(block_txn.Commit());
+        BOOST_CHECK(!database->InTxn());
+        BOOST_CHECK(block_txn.Commit());
+    }
+    BOOST_CHECK(!database->InTxn());
+    BOOST_CHECK(ReadFromOtherThread(1));
+    BOOST_CHECK(!ReadFromOtherThread(2));
+    BOOST_CHECK(ReadFromOtherThread(3));
+}
+
 class ListCoinsTestingSetup : public TestChain100Setup
 {
 public:
@@ -365,6 +533,82 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+BOOST_FIXTURE_TEST_CASE(anon_locked_blinded_output, TestChain100Setup)
+{
+    ECC_Start_Blinding();
+    std::shared_ptr<CWallet> wallet = std::make_shared<CWallet>("mock", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    wallet->LoadWallet(fFirstRun);
+    uint512 seed;
+    GetStrongRandBytes(seed.begin(), seed.size());
+    wallet->SetHDSeed_512(seed);
+    CExtKey extMasterAnon;
+    BOOST_REQUIRE(wallet->GetAnonWalletSeed(extMasterAnon));
+    // Shares the database the wallet owns
+    std::shared_ptr<WalletDatabase> database(std::shared_ptr<WalletDatabase>(), &wallet->GetDBHandle());
+    AnonWallet* panon = new AnonWallet(wallet, "anonwallet", database);
+    BOOST_REQUIRE(panon->Initialise(&extMasterAnon));
+    wallet->SetAnonWallet(panon);
+
+    // A blinded output to a key of the anon wallet
+    const CAmount nValue = 3 * COIN;
+    CKey keyTo;
+    BOOST_REQUIRE(panon->NewKeyFromAccount(panon->GetDefaultAccount(), keyTo));
+    AddKey(*wallet, keyTo);
+    CTempRecipient r;
+    r.nType = OUTPUT_CT;
+    r.SetAmount(nValue);
+    r.sEphem.MakeNewKey(true);
+    r.pkTo = keyTo.GetPubKey();
+    r.vBlind.resize(32);
+    GetStrongRandBytes(r.vBlind.data(), 32);
+    auto txout = MAKE_OUTPUT<CTxOutCT>();
+    CPubKey pkEphem = r.sEphem.GetPubKey();
+    txout->vData.assign(pkEphem.begin(), pkEphem.end());
+    txout->scriptPubKey = GetScriptForDestination(keyTo.GetPubKey().GetID());
+    std::string sError;
+    BOOST_REQUIRE_EQUAL(panon->AddCTData(txout.get(), r, sError), 0);
+
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+    mtx.vpout.push_back(txout);
+    CTransactionRef ptx = MakeTransactionRef(mtx);
+    const COutPoint outpoint(ptx->GetHash(), 0);
+
+    LOCK2(cs_main, wallet->cs_wallet);
+    AddCoins(*pcoinsTip, *ptx, chainActive.Height());
+    CCoinControl coinControl;
+    std::vector<COutputR> vCoins;
+
+    // Received while locked, the amount cannot be read yet
+    panon->Lock();
+    BOOST_CHECK(panon->AddToWalletIfInvolvingMe(ptx, chainActive.Tip(), 0, true));
+    BalanceList bal;
+    wallet->UpdateBalances();
+    BOOST_CHECK(wallet->GetBalances(bal));
+    BOOST_CHECK_EQUAL(bal.nCT, 0);
+    BOOST_CHECK_EQUAL(panon->GetBlindBalance(), 0);
+    panon->AvailableBlindedCoins(vCoins, true, &coinControl);
+    BOOST_CHECK(vCoins.empty());
+
+    // Unlocking recovers it, and it counts without any other wallet change
+    BOOST_CHECK(wallet->UnlockAnonWallet());
+    COutputRecord record;
+    BOOST_CHECK(panon->GetOutputRecord(outpoint, record));
+    BOOST_CHECK_EQUAL(record.GetAmount(), nValue);
+    wallet->UpdateBalances();
+    BOOST_CHECK(wallet->GetBalances(bal));
+    BOOST_CHECK_EQUAL(bal.nCT, nValue);
+    BOOST_CHECK_EQUAL(panon->GetBlindBalance(), nValue);
+    panon->AvailableBlindedCoins(vCoins, true, &coinControl);
+    BOOST_REQUIRE_EQUAL(vCoins.size(), 1U);
+    BOOST_CHECK(vCoins[0].txhash == outpoint.hash && vCoins[0].i == 0);
+
+    wallet->SetAnonWallet(nullptr);
+    delete panon;
+    ECC_Stop_Blinding();
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     std::shared_ptr<CWallet> wallet = std::make_shared<CWallet>("dummy", WalletDatabase::CreateDummy());
@@ -516,6 +516,9 @@ bool CWallet::UnlockAnonWallet()
         return error("%s: derived anon wallet key %s does not match expected key %s", __func__, idDerived.GetHex(), idSeedDB.GetHex());
 
     pAnonWalletMain->SetMasterKey(keyAnonMaster);
+
+    // Keys and amounts of outputs that were received while locked can be recovered now
+    pAnonWalletMain->ProcessLockedOutputs();
     return true;
 }
 
@@ -601,6 +604,10 @@ bool CWallet::ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase,
 
 void CWallet::ChainStateFlushed(const CBlockLocator& loc)
 {
+    if (m_block_commit_failed) {
+        WalletLogPrintf("%s: Not writing the best block, the records of a block were not committed\n", __func__);
+        return;
+    }
     WalletBatch batch(*database);
     batch.WriteBestBlock(loc);
 }
@@ -924,6 +931,23 @@ int64_t CWallet::IncOrderPosNext(WalletBatch *batch)
     return nRet;
 }
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fImmatureCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+    setImmatureTypeCreditCached.clear();
+
+    if (pwallet)
+        pwallet->MarkBalanceDirty(*tx);
+}
+
 void CWallet::MarkDirty()
 {
     {
@@ -1312,7 +1336,9 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
+        MarkBalanceDirty(*ptx);
     }
+    UpdateBalances();
 }
 
 void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
@@ -1320,11 +1346,16 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = false;
+        MarkBalanceDirty(*ptx);
     }
+    if (pAnonWalletMain && pAnonWalletMain->mapRecords.count(ptx->GetHash()))
+        MarkAnonBalanceDirty();
 }
 
 void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) {
     LOCK2(cs_main, cs_wallet);
+    // Everything the block changes in the wallet database is committed in one transaction
+    WalletBlockTxn block_txn(*database);
     // TODO: Temporarily ensure that mempool removals are notified before
     // connected transactions.  This shouldn't matter, but the abandoned
     // state of transactions in our wallet is currently cleared when we
@@ -1343,14 +1374,32 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
     }
 
     m_last_block_processed = pindex;
+
+    m_balance_ledger.MarkBlockDirty();
+    UpdateBalances();
+
+    if (!block_txn.Commit()) {
+        m_block_commit_failed = true;
+        WalletLogPrintf("%s: Failed to commit the wallet records of block %s\n", __func__, pindex->GetBlockHash().ToString());
+    }
 }
 
 void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) {
     LOCK2(cs_main, cs_wallet);
+    WalletBlockTxn block_txn(*database);
 
     for (const CTransactionRef& ptx : pblock->vtx) {
         SyncTransaction(ptx);
     }
+
+    // A disconnected block can make deeper transactions immature again, re-evaluate everything
+    m_balance_ledger.MarkAllDirty();
+    UpdateBalances();
+
+    if (!block_txn.Commit()) {
+        m_block_commit_failed = true;
+        WalletLogPrintf("%s: Failed to commit the wallet records of disconnected block %s\n", __func__, pblock->GetHash().ToString());
+    }
 }
 
 
@@ -2017,6 +2066,37 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             }
         }
         double progress_current = progress_begin;
+
+        // Blocks are read ahead and then scanned together, so that their wallet records are written in one
+        // transaction. Returns false if a block is no longer active or the records could not be written.
+        std::vector<std::pair<CBlockIndex*, std::shared_ptr<CBlock>>> vBlocks;
+        auto ScanBlocks = [&]() -> bool {
+            LOCK2(cs_main, cs_wallet);
+            WalletBlockTxn block_txn(*database);
+            for (const auto& scan : vBlocks) {
+                if (!chainActive.Contains(scan.first)) {
+                    // Abort scan if current block is no longer active, to prevent
+                    // marking transactions as coming from the wrong block.
+                    ret = scan.first;
+                    vBlocks.clear();
+                    return false;
+                }
+                const CBlock& block = *scan.second;
+                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                    SyncTransaction(block.vtx[posInBlock], scan.first, posInBlock, fUpdate);
+                }
+            }
+            if (!block_txn.Commit()) {
+                WalletLogPrintf("Rescan failed to commit the wallet records of blocks %d to %d\n",
+                                vBlocks.front().first->nHeight, vBlocks.back().first->nHeight);
+                ret = vBlocks.back().first;
+                vBlocks.clear();
+                return false;
+            }
+            vBlocks.clear();
+            return true;
+        };
+
         while (pindex && !fAbortRescan && !ShutdownRequested())
         {
             if (pindex->nHeight % 100 == 0 && progress_end - progress_begin > 0.0) {
@@ -2027,24 +2107,18 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, progress_current);
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                LOCK2(cs_main, cs_wallet);
-                if (pindex && !chainActive.Contains(pindex)) {
-                    // Abort scan if current block is no longer active, to prevent
-                    // marking transactions as coming from the wrong block.
-                    ret = pindex;
-                    break;
-                }
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    SyncTransaction(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
-                }
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            if (ReadBlockFromDisk(*pblock, pindex, Params().GetConsensus())) {
+                vBlocks.emplace_back(pindex, pblock);
             } else {
                 ret = pindex;
             }
             if (pindex == pindexStop) {
                 break;
             }
+            if (vBlocks.size() >= WALLET_RESCAN_BATCH_BLOCKS && !ScanBlocks()) {
+                break;
+            }
             {
                 LOCK(cs_main);
                 pindex = chainActive.Next(pindex);
@@ -2056,6 +2130,9 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 }
             }
         }
+        if (!vBlocks.empty()) {
+            ScanBlocks();
+        }
         if (pindex && fAbortRescan) {
             WalletLogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, progress_current);
         } else if (pindex && ShutdownRequested()) {
@@ -2411,33 +2488,109 @@ CAmount CWallet::GetBalance(const isminefilter& filter, const int min_depth) con
 
 bool CWallet::GetBalances(BalanceList& bal)
 {
+    bal = m_balance_ledger.Get();
+    return true;
+}
+
+void CWallet::MarkBalanceDirty(const CTransaction& tx) const
+{
+    bool fAnon = tx.HasBlindedValues();
+    for (const CTxIn& txin : tx.vin)
+        fAnon |= txin.IsAnonInput();
+    m_balance_ledger.MarkTxDirty(tx.GetHash(), fAnon, tx.IsZerocoinSpend() || tx.IsZerocoinMint());
+    ScheduleBalanceUpdate();
+}
+
+void CWallet::ScheduleBalanceUpdate() const
+{
+    // One queued update covers all the events marked before it runs
+    if (!GetMainSignals().HasBackgroundScheduler() || m_balance_update_queued.exchange(true))
+        return;
+    std::shared_ptr<BalanceUpdateGuard> guard = m_balance_update_guard;
+    CallFunctionInValidationInterfaceQueue([guard] {
+        LOCK(guard->cs);
+        if (guard->pwallet)
+            guard->pwallet->ApplyQueuedBalanceUpdate();
+    });
+}
+
+void CWallet::ApplyQueuedBalanceUpdate()
+{
+    m_balance_update_queued = false;
+    // The notification handlers usually applied the work already
+    if (!m_balance_ledger.IsDirty())
+        return;
     LOCK2(cs_main, cs_wallet);
-    for (const auto &item : mapWallet) {
-        const CWalletTx &wtx = item.second;
-        //Blinded values will come from anonwallet
-        if (wtx.tx->HasBlindedValues())
-            continue;
-        bal.nVeilImmature += wtx.GetImmatureCredit();
+    UpdateBalances();
+}
 
-        if (wtx.IsTrusted()) {
-            bal.nVeil += wtx.GetAvailableCredit();
-            bal.nVeilWatchOnly += wtx.GetAvailableCredit(true, ISMINE_WATCH_ONLY);
-        } else {
-            if (wtx.GetDepthInMainChain() == 0 && wtx.InMempool()) {
-                bal.nVeilUnconf += wtx.GetAvailableCredit();
-                bal.nVeilWatchOnlyUnconf += wtx.GetAvailableCredit(true, ISMINE_WATCH_ONLY);
-            }
+void CWallet::BlockUntilBalancesUpdated() const
+{
+    AssertLockNotHeld(cs_main);
+    AssertLockNotHeld(cs_wallet);
+    if (m_balance_update_queued)
+        SyncWithValidationInterfaceQueue();
+}
+
+void CWallet::UpdateBalances()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    CBalanceLedger::Pending pending = m_balance_ledger.TakePending();
+
+    std::set<uint256> setTx;
+    if (pending.fAll) {
+        m_balance_ledger.ClearTxs();
+        for (const auto& item : mapWallet)
+            setTx.insert(item.first);
+    } else {
+        setTx.swap(pending.setTx);
+        if (pending.fBlock) {
+            for (const uint256& txid : m_balance_ledger.GetDepthSensitive())
+                setTx.insert(txid);
         }
     }
 
-    pAnonWalletMain->GetBalances(bal);
+    for (const uint256& txid : setTx) {
+        BalanceList bal;
+        bool fDepthSensitive = false;
+        auto it = mapWallet.find(txid);
+        //Blinded values will come from anonwallet
+        if (it != mapWallet.end() && !it->second.tx->HasBlindedValues()) {
+            const CWalletTx& wtx = it->second;
+            bal.nVeilImmature = wtx.GetImmatureCredit();
+            bal.nVeilWatchOnlyImmature = wtx.GetImmatureWatchOnlyCredit();
+
+            int nDepth = wtx.GetDepthInMainChain();
+            if (wtx.IsTrusted()) {
+                bal.nVeil = wtx.GetAvailableCredit();
+                bal.nVeilWatchOnly = wtx.GetAvailableCredit(true, ISMINE_WATCH_ONLY);
+            } else if (nDepth == 0 && wtx.InMempool()) {
+                bal.nVeilUnconf = wtx.GetAvailableCredit();
+                bal.nVeilWatchOnlyUnconf = wtx.GetAvailableCredit(true, ISMINE_WATCH_ONLY);
+            }
+
+            // Unconfirmed and immature transactions change with the next block
+            fDepthSensitive = nDepth == 0 || (nDepth > 0 && wtx.GetBlocksToMaturity() > 0);
+        }
+        m_balance_ledger.SetTx(txid, bal, fDepthSensitive);
+    }
 
-    //todo: this creates more iteration than is needed calling three different times
-    bal.nZerocoin = GetZerocoinBalance(true);
-    bal.nZerocoinUnconf = GetUnconfirmedZerocoinBalance();
-    bal.nZerocoinImmature = GetImmatureZerocoinBalance();
+    if (pending.fAll || pending.fAnon) {
+        BalanceList bal;
+        if (pAnonWalletMain)
+            pAnonWalletMain->GetBalances(bal);
+        m_balance_ledger.SetAnon(bal);
+    }
 
-    return true;
+    if ((pending.fAll || pending.fZerocoin) && zTracker) {
+        BalanceList bal;
+        bal.nZerocoin = GetZerocoinBalance(true);
+        bal.nZerocoinUnconf = GetUnconfirmedZerocoinBalance();
+        bal.nZerocoinImmature = GetImmatureZerocoinBalance();
+        m_balance_ledger.SetZerocoin(bal);
+    }
 }
 
 // Get a Map pairing the Denominations with the amount of Zerocoin for each Denomination
@@ -3831,6 +3984,7 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
         const auto& it = mapWallet.find(hash);
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
         mapWallet.erase(it);
+        MarkBalanceDirty(hash);
     }
 
     if (nZapSelectTxRet == DBErrors::NEED_REWRITE)
@@ -4764,6 +4918,11 @@ bool CWallet::Verify(std::string wallet_file, bool salvage_wallet, std::string&
         }
     }
 
+    // LevelDB wallets have no BerkeleyDB environment or data file to verify and salvage
+    if (IsLevelDBWallet(wallet_path)) {
+        return true;
+    }
+
     try {
         if (!WalletBatch::VerifyEnvironment(wallet_path, error_string)) {
             return false;
@@ -4782,7 +4941,14 @@ bool CWallet::Verify(std::string wallet_file, bool salvage_wallet, std::string&
         }
     }
 
-    return WalletBatch::VerifyDatabaseFile(wallet_path, warning_string, error_string);
+    if (!WalletBatch::VerifyDatabaseFile(wallet_path, warning_string, error_string)) {
+        return false;
+    }
+
+    if (gArgs.GetArg("-walletbackend", DEFAULT_WALLET_BACKEND) == "leveldb") {
+        return WalletBatch::MigrateToLevelDB(wallet_path, error_string);
+    }
+    return true;
 }
 
 std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(const std::string& name, const fs::path& path, uint64_t wallet_creation_flags, uint512* pseed)
@@ -5168,6 +5334,9 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(const std::string& name,
         assert(anonwallet->SetMasterKey(extMasterAnon));
     }
 
+    // Compute the initial balances
+    walletInstance->ScheduleBalanceUpdate();
+
     return walletInstance;
 }
 
@@ -6256,6 +6425,7 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
             uint256 txidOld = rtx.GetPartialTxid();
             if (!txidOld.IsNull() && pAnonWalletMain->mapRecords.count(txidOld)) {
                 pAnonWalletMain->mapRecords.erase(txidOld);
+                pAnonWalletMain->UpdateUnspentIndex(txidOld);
                 rtx.RemovePartialTxid();
                 pAnonWalletMain->SaveRecord(txHash, rtx);
             }
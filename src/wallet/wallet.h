@@ -73,6 +73,8 @@ static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const bool DEFAULT_WALLET_RBF = false;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
+//! Number of blocks a rescan reads ahead and writes to the wallet database in one transaction
+static const unsigned int WALLET_RESCAN_BATCH_BLOCKS = 100;
 
 typedef std::vector<std::pair<uint32_t, bool> > BIP32Path;
 typedef std::map<libzerocoin::CoinDenomination, CAmount> ZerocoinSpread;
@@ -496,19 +498,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-        setImmatureTypeCreditCached.clear();
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -771,6 +761,25 @@ protected:
      */
     const CBlockIndex* m_last_block_processed = nullptr;
 
+    //! Running balances, see CBalanceLedger
+    mutable CBalanceLedger m_balance_ledger;
+
+    //! Lets a balance update queued on the validation interface thread skip a wallet that was released meanwhile
+    struct BalanceUpdateGuard
+    {
+        CCriticalSection cs;
+        CWallet* pwallet;
+    };
+    std::shared_ptr<BalanceUpdateGuard> m_balance_update_guard;
+    //! Set while a balance update is queued on the validation interface thread
+    mutable std::atomic<bool> m_balance_update_queued{false};
+
+    void ApplyQueuedBalanceUpdate();
+
+    //! Set when the records of a block could not be committed. The best block is no longer written from then on,
+    //! so that the next start rescans from before the lost records.
+    std::atomic<bool> m_block_commit_failed{false};
+
 public:
     /*
      * Main wallet lock.
@@ -886,10 +895,16 @@ public:
     /** Construct wallet with specified name and database implementation. */
     CWallet(std::string name, std::unique_ptr<WalletDatabase> database) : m_name(std::move(name)), database(std::move(database))
     {
+        m_balance_update_guard = std::make_shared<BalanceUpdateGuard>();
+        m_balance_update_guard->pwallet = this;
     }
 
     ~CWallet()
     {
+        {
+            LOCK(m_balance_update_guard->cs);
+            m_balance_update_guard->pwallet = nullptr;
+        }
         delete encrypted_batch;
         encrypted_batch = nullptr;
     }
@@ -1034,7 +1049,20 @@ public:
     // ResendWalletTransactionsBefore may only be called if fBroadcastTransactions!
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime, CConnman* connman);
     CAmount GetBalance(const isminefilter& filter=ISMINE_SPENDABLE, const int min_depth=0) const;
+    //! Balances of all types as last applied to the balance ledger, takes no lock but the ledger's
     bool GetBalances(BalanceList& bal);
+    //! Apply the wallet events queued in the balance ledger. Done by the wallet's notification handlers, or on the
+    //! validation interface thread for events from elsewhere.
+    void UpdateBalances() EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    //! Apply the queued balance ledger work on the validation interface thread
+    void ScheduleBalanceUpdate() const;
+    //! Wait until the balance ledger work queued so far is applied, for callers that need to see their own changes
+    void BlockUntilBalancesUpdated() const;
+    void MarkBalanceDirty(const uint256& txid) const { m_balance_ledger.MarkTxDirty(txid, false, false); ScheduleBalanceUpdate(); }
+    //! Queue a wallet transaction, along with the anon or zerocoin balances if it touches them
+    void MarkBalanceDirty(const CTransaction& tx) const;
+    void MarkAnonBalanceDirty() const { m_balance_ledger.MarkAnonDirty(); ScheduleBalanceUpdate(); }
+    void MarkZerocoinBalanceDirty() const { m_balance_ledger.MarkZerocoinDirty(); ScheduleBalanceUpdate(); }
     std::pair<ZerocoinSpread, ZerocoinSpread> GetMyZerocoinDistribution() const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
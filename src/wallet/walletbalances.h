@@ -7,6 +7,12 @@
 #define VEIL_WALLETBALANCES_H
 
 #include <amount.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <atomic>
+#include <map>
+#include <set>
 
 class BalanceList
 {
@@ -18,6 +24,7 @@ public:
         nVeilImmature = 0;
         nVeilWatchOnly = 0;
         nVeilWatchOnlyUnconf = 0;
+        nVeilWatchOnlyImmature = 0;
 
         nCT = 0;
         nCTUnconf = 0;
@@ -37,6 +44,7 @@ public:
     CAmount nVeilImmature = 0;
     CAmount nVeilWatchOnly = 0;
     CAmount nVeilWatchOnlyUnconf = 0;
+    CAmount nVeilWatchOnlyImmature = 0;
 
     CAmount nCT = 0;
     CAmount nCTUnconf = 0;
@@ -49,6 +57,193 @@ public:
     CAmount nZerocoin = 0;
     CAmount nZerocoinUnconf = 0;
     CAmount nZerocoinImmature = 0;
+
+    BalanceList& operator+=(const BalanceList& b)
+    {
+        nVeil += b.nVeil;
+        nVeilUnconf += b.nVeilUnconf;
+        nVeilImmature += b.nVeilImmature;
+        nVeilWatchOnly += b.nVeilWatchOnly;
+        nVeilWatchOnlyUnconf += b.nVeilWatchOnlyUnconf;
+        nVeilWatchOnlyImmature += b.nVeilWatchOnlyImmature;
+        nCT += b.nCT;
+        nCTUnconf += b.nCTUnconf;
+        nCTImmature += b.nCTImmature;
+        nRingCT += b.nRingCT;
+        nRingCTUnconf += b.nRingCTUnconf;
+        nRingCTImmature += b.nRingCTImmature;
+        nZerocoin += b.nZerocoin;
+        nZerocoinUnconf += b.nZerocoinUnconf;
+        nZerocoinImmature += b.nZerocoinImmature;
+        return *this;
+    }
+
+    BalanceList& operator-=(const BalanceList& b)
+    {
+        nVeil -= b.nVeil;
+        nVeilUnconf -= b.nVeilUnconf;
+        nVeilImmature -= b.nVeilImmature;
+        nVeilWatchOnly -= b.nVeilWatchOnly;
+        nVeilWatchOnlyUnconf -= b.nVeilWatchOnlyUnconf;
+        nVeilWatchOnlyImmature -= b.nVeilWatchOnlyImmature;
+        nCT -= b.nCT;
+        nCTUnconf -= b.nCTUnconf;
+        nCTImmature -= b.nCTImmature;
+        nRingCT -= b.nRingCT;
+        nRingCTUnconf -= b.nRingCTUnconf;
+        nRingCTImmature -= b.nRingCTImmature;
+        nZerocoin -= b.nZerocoin;
+        nZerocoinUnconf -= b.nZerocoinUnconf;
+        nZerocoinImmature -= b.nZerocoinImmature;
+        return *this;
+    }
+};
+
+/**
+ * Wallet balances kept up to date from wallet events, so that reading them is O(1) and does not need cs_main.
+ *
+ * Basecoin balances are kept per wallet transaction. A transaction is queued for re-evaluation whenever its credit
+ * caches are invalidated (CWalletTx::MarkDirty()), and transactions that are unconfirmed or immature are queued again
+ * on every new block. The anon (CT/RingCT) and zerocoin balances are kept per bucket and recalculated only when a
+ * transaction touches them, or on a new block while they hold unconfirmed or immature amounts. The queued work is
+ * applied by CWallet::UpdateBalances() on the wallet's notification thread, readers only copy the totals.
+ */
+class CBalanceLedger
+{
+public:
+    //! Work queued since the last update
+    struct Pending
+    {
+        std::set<uint256> setTx;
+        bool fAll = true;
+        bool fBlock = false;
+        bool fAnon = false;
+        bool fZerocoin = false;
+    };
+
+    void MarkTxDirty(const uint256& txid, bool fAnon, bool fZerocoin)
+    {
+        LOCK(cs);
+        pending.setTx.insert(txid);
+        pending.fAnon |= fAnon;
+        pending.fZerocoin |= fZerocoin;
+        fDirty = true;
+    }
+
+    //! Depth dependent balances (unconfirmed, immature, zerocoin maturity) have to be re-evaluated
+    void MarkBlockDirty()
+    {
+        LOCK(cs);
+        pending.fBlock = true;
+        pending.fAnon |= balAnon.nCTUnconf || balAnon.nCTImmature || balAnon.nRingCTUnconf || balAnon.nRingCTImmature;
+        pending.fZerocoin |= balZerocoin.nZerocoinUnconf || balZerocoin.nZerocoinImmature;
+        fDirty = true;
+    }
+
+    void MarkAnonDirty()
+    {
+        LOCK(cs);
+        pending.fAnon = true;
+        fDirty = true;
+    }
+
+    void MarkZerocoinDirty()
+    {
+        LOCK(cs);
+        pending.fZerocoin = true;
+        fDirty = true;
+    }
+
+    void MarkAllDirty()
+    {
+        LOCK(cs);
+        pending.fAll = true;
+        fDirty = true;
+    }
+
+    bool IsDirty() const { return fDirty; }
+
+    Pending TakePending()
+    {
+        LOCK(cs);
+        Pending ret = pending;
+        pending = Pending();
+        pending.fAll = false;
+        fDirty = false;
+        return ret;
+    }
+
+    //! Replace the contribution of one transaction, a zero balance removes it
+    void SetTx(const uint256& txid, const BalanceList& bal, bool fDepthSensitive)
+    {
+        LOCK(cs);
+        auto it = mapTx.find(txid);
+        if (it != mapTx.end()) {
+            balTotal -= it->second;
+            mapTx.erase(it);
+        }
+        if (!IsZero(bal)) {
+            balTotal += bal;
+            mapTx.emplace(txid, bal);
+        }
+        if (fDepthSensitive)
+            setDepthSensitive.insert(txid);
+        else
+            setDepthSensitive.erase(txid);
+    }
+
+    void ClearTxs()
+    {
+        LOCK(cs);
+        for (const auto& it : mapTx)
+            balTotal -= it.second;
+        mapTx.clear();
+        setDepthSensitive.clear();
+    }
+
+    std::set<uint256> GetDepthSensitive() const
+    {
+        LOCK(cs);
+        return setDepthSensitive;
+    }
+
+    void SetAnon(const BalanceList& bal)
+    {
+        LOCK(cs);
+        balTotal -= balAnon;
+        balAnon = bal;
+        balTotal += balAnon;
+    }
+
+    void SetZerocoin(const BalanceList& bal)
+    {
+        LOCK(cs);
+        balTotal -= balZerocoin;
+        balZerocoin = bal;
+        balTotal += balZerocoin;
+    }
+
+    BalanceList Get() const
+    {
+        LOCK(cs);
+        return balTotal;
+    }
+
+private:
+    static bool IsZero(const BalanceList& bal)
+    {
+        return !bal.nVeil && !bal.nVeilUnconf && !bal.nVeilImmature && !bal.nVeilWatchOnly &&
+                !bal.nVeilWatchOnlyUnconf && !bal.nVeilWatchOnlyImmature;
+    }
+
+    mutable CCriticalSection cs;
+    std::atomic<bool> fDirty{true};
+    Pending pending;
+    std::map<uint256, BalanceList> mapTx;
+    std::set<uint256> setDepthSensitive;
+    BalanceList balAnon;
+    BalanceList balZerocoin;
+    BalanceList balTotal;
 };
 
 #endif //VEIL_WALLETBALANCES_H
@@ -18,6 +18,7 @@
 #include <wallet/deterministicmint.h>
 
 #include <atomic>
+#include <set>
 #include <string>
 
 #include <boost/thread.hpp>
@@ -435,6 +436,29 @@ bool WalletBatch::IsKeyType(const std::string& strType)
             strType == "mkey" || strType == "ckey");
 }
 
+//! Record types that grow with the number of transactions and are loaded by the AnonWallet itself
+static const std::set<std::string> setSkippedByLoadWallet = {"rtx", "stx", "artx", "lao", "sxkm"};
+
+/** If ssKey is a record LoadWallet does not read, return the first key after all records of its type */
+static bool SkipRecordType(const CDataStream& ssKey, CDataStream& ssNext)
+{
+    std::string strType;
+    try {
+        CDataStream ssType(ssKey);
+        ssType >> strType;
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (!setSkippedByLoadWallet.count(strType))
+        return false;
+
+    // Keys start with the serialized type, so the range ends where the last byte of that prefix is incremented
+    ssNext.clear();
+    ssNext << strType;
+    ssNext[ssNext.size() - 1]++;
+    return true;
+}
+
 DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
 {
     CWalletScanState wss;
@@ -452,19 +476,21 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             pwallet->WalletLogPrintf("Error getting wallet database cursor\n");
             return DBErrors::CORRUPT;
         }
 
+        CDataStream ssSkipTo(SER_DISK, CLIENT_VERSION);
         while (true)
         {
-            // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            // Read next record, or seek past a range of records that are loaded elsewhere
+            CDataStream ssKey(ssSkipTo);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue, !ssSkipTo.empty());
+            ssSkipTo.clear();
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0)
@@ -472,6 +498,8 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
                 pwallet->WalletLogPrintf("Error reading next record from wallet database\n");
                 return DBErrors::CORRUPT;
             }
+            if (SkipRecordType(ssKey, ssSkipTo))
+                continue;
 
             // Try to be tolerant of single corrupt records:
             std::string strType, strErr;
@@ -553,7 +581,7 @@ DBErrors WalletBatch::FindWalletTx(std::vector<uint256>& vTxHash, std::vector<CW
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             LogPrintf("Error getting wallet database cursor\n");
@@ -565,7 +593,7 @@ DBErrors WalletBatch::FindWalletTx(std::vector<uint256>& vTxHash, std::vector<CW
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0)
@@ -732,6 +760,11 @@ bool WalletBatch::VerifyDatabaseFile(const fs::path& wallet_path, std::string& w
     return BerkeleyBatch::VerifyDatabaseFile(wallet_path, warningStr, errorStr, WalletBatch::Recover);
 }
 
+bool WalletBatch::MigrateToLevelDB(const fs::path& wallet_path, std::string& errorStr)
+{
+    return BerkeleyBatch::MigrateToLevelDB(wallet_path, errorStr);
+}
+
 bool WalletBatch::WriteDestData(const std::string &address, const std::string &key, const std::string &value)
 {
     return WriteIC(std::make_pair(std::string("destdata"), std::make_pair(address, key)), value);
@@ -758,6 +791,26 @@ bool WalletBatch::WriteWalletFlags(const uint64_t flags)
     return WriteIC(std::string("flags"), flags);
 }
 
+WalletBlockTxn::WalletBlockTxn(WalletDatabase& database) : m_database(database), m_active(false)
+{
+    if (!m_database.InTxn())
+        m_active = m_database.TxnBegin();
+}
+
+WalletBlockTxn::~WalletBlockTxn()
+{
+    if (!Commit())
+        LogPrintf("%s: Failed to commit the wallet database transaction\n", __func__);
+}
+
+bool WalletBlockTxn::Commit()
+{
+    if (!m_active)
+        return true;
+    m_active = false;
+    return m_database.TxnCommit();
+}
+
 bool WalletBatch::TxnBegin()
 {
     return m_batch.TxnBegin();
@@ -946,7 +999,7 @@ std::map<CKeyID, std::vector<std::pair<uint256, uint32_t> > > WalletBatch::MapMi
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             return mapPool;
@@ -957,7 +1010,7 @@ std::map<CKeyID, std::vector<std::pair<uint256, uint32_t> > > WalletBatch::MapMi
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0) {
@@ -1011,7 +1064,7 @@ std::list<CDeterministicMint> WalletBatch::ListDeterministicMints()
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             return listMints;
@@ -1022,7 +1075,7 @@ std::list<CDeterministicMint> WalletBatch::ListDeterministicMints()
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0)
@@ -1065,7 +1118,7 @@ std::list<CZerocoinMint> WalletBatch::ListMintedCoins()
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             return listPubCoin;
@@ -1076,7 +1129,7 @@ std::list<CZerocoinMint> WalletBatch::ListMintedCoins()
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0)
@@ -1119,7 +1172,7 @@ std::list<CZerocoinSpend> WalletBatch::ListSpentCoins()
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             return listCoinSpend;
@@ -1130,7 +1183,7 @@ std::list<CZerocoinSpend> WalletBatch::ListSpentCoins()
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0) {
@@ -1184,7 +1237,7 @@ std::list<CZerocoinMint> WalletBatch::ListArchivedZerocoins()
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             return listMints;
@@ -1195,7 +1248,7 @@ std::list<CZerocoinMint> WalletBatch::ListArchivedZerocoins()
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0) {
@@ -1237,7 +1290,7 @@ std::list<CDeterministicMint> WalletBatch::ListArchivedDeterministicMints()
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
+        std::unique_ptr<DatabaseCursor> pcursor = m_batch.GetCursor();
         if (!pcursor)
         {
             return listMints;
@@ -1248,7 +1301,7 @@ std::list<CDeterministicMint> WalletBatch::ListArchivedDeterministicMints()
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = m_batch.ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0) {
@@ -235,6 +235,8 @@ public:
     static bool VerifyEnvironment(const fs::path& wallet_path, std::string& errorStr);
     /* verifies the database file */
     static bool VerifyDatabaseFile(const fs::path& wallet_path, std::string& warningStr, std::string& errorStr);
+    /* moves a BerkeleyDB wallet to LevelDB (-walletbackend=leveldb) */
+    static bool MigrateToLevelDB(const fs::path& wallet_path, std::string& errorStr);
 
     //! write the hdchain model (external chain child index counter)
     bool WriteHDChain(const CHDChain& chain);
@@ -285,6 +287,28 @@ protected:
     WalletDatabase& m_database;
 };
 
+/** Collects all writes to a wallet database made by this thread while it is in scope, including the records of
+ * the AnonWallet and the zerocoin tracker, and commits them together in one transaction on Commit(), or when it
+ * goes out of scope. Used for each connected block and for each range of blocks during a rescan. Nested scopes
+ * join the outermost one.
+ */
+class WalletBlockTxn
+{
+public:
+    explicit WalletBlockTxn(WalletDatabase& database);
+    ~WalletBlockTxn();
+
+    //! Commit the writes so far if this is the outermost scope, returns false if they could not be written
+    bool Commit();
+
+    WalletBlockTxn(const WalletBlockTxn&) = delete;
+    WalletBlockTxn& operator=(const WalletBlockTxn&) = delete;
+
+private:
+    WalletDatabase& m_database;
+    bool m_active;
+};
+
 //! Compacts BDB state so that wallet.dat is self-contained (if there are changes)
 void MaybeCompactWalletDB();
 
@@ -20,3 +20,13 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyBlockConnected(const std::shared_ptr<const CBlock>& /*pblock*/, const CBlockIndex * /*pindex*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBlockDisconnected(const std::shared_ptr<const CBlock>& /*pblock*/, const CBlockIndex * /*pindex*/)
+{
+    return true;
+}
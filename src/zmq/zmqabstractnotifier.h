@@ -7,6 +7,8 @@
 
 #include <zmq/zmqconfig.h>
 
+#include <memory>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
@@ -34,6 +36,10 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    //! Called with every block connected to the active chain, before NotifyBlock for the new tip
+    virtual bool NotifyBlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex);
+    //! Called with every block disconnected from the active chain, tip first
+    virtual bool NotifyBlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex);
 
 protected:
     void *psocket;
@@ -48,6 +48,11 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubanonoutputs"] = CZMQAbstractNotifier::Create<CZMQPublishAnonOutputsNotifier>;
+    factories["pubkeyimages"] = CZMQAbstractNotifier::Create<CZMQPublishKeyImagesNotifier>;
+    factories["pubzerocoinmints"] = CZMQAbstractNotifier::Create<CZMQPublishZerocoinMintsNotifier>;
+    factories["pubzerocoinspends"] = CZMQAbstractNotifier::Create<CZMQPublishZerocoinSpendsNotifier>;
+    factories["pubaccumulators"] = CZMQAbstractNotifier::Create<CZMQPublishAccumulatorsNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -180,6 +185,20 @@ void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBloc
         // Do a normal notify for each transaction added in the block
         TransactionAddedToMempool(ptx);
     }
+
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyBlockConnected(pblock, pindexConnected))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock)
@@ -188,6 +207,29 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
         // Do a normal notify for each transaction removed in block disconnection
         TransactionAddedToMempool(ptx);
     }
+
+    // Block indexes are never deleted, and the height and chain state counts of one do not change
+    const CBlockIndex* pindexDisconnected;
+    {
+        LOCK(cs_main);
+        pindexDisconnected = LookupBlockIndex(pblock->GetHash());
+    }
+    if (!pindexDisconnected)
+        return;
+
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyBlockDisconnected(pblock, pindexDisconnected))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
 }
 
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
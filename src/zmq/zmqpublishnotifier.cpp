@@ -9,6 +9,9 @@
 #include <validation.h>
 #include <util.h>
 #include <rpc/server.h>
+#include <libzerocoin/CoinSpend.h>
+#include <veil/ringct/rctindex.h>
+#include <veil/zerocoin/zchain.h>
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
@@ -16,6 +19,11 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_ANONOUTPUTS    = "anonoutputs";
+static const char *MSG_KEYIMAGES      = "keyimages";
+static const char *MSG_ZEROCOINMINTS  = "zerocoinmints";
+static const char *MSG_ZEROCOINSPENDS = "zerocoinspends";
+static const char *MSG_ACCUMULATORS   = "accumulators";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -172,7 +180,9 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 
     const Consensus::Params& consensusParams = Params().GetConsensus();
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    {
+    if (pblockConnected && pblockConnected->GetHash() == pindex->GetBlockHash()) {
+        ss << *pblockConnected;
+    } else {
         LOCK(cs_main);
         CBlock block;
         if(!ReadBlockFromDisk(block, pindex, consensusParams))
@@ -183,10 +193,17 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 
         ss << block;
     }
+    pblockConnected.reset();
 
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
 }
 
+bool CZMQPublishRawBlockNotifier::NotifyBlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex * /*pindex*/)
+{
+    pblockConnected = pblock;
+    return true;
+}
+
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
@@ -195,3 +212,144 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishBlockDataNotifier::NotifyBlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex)
+{
+    return PublishBlockData(pblock, pindex, false);
+}
+
+bool CZMQPublishBlockDataNotifier::NotifyBlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex)
+{
+    return PublishBlockData(pblock, pindex, true);
+}
+
+/* The block notifications below are only sent for blocks that have something to report. Their body is the
+   height and hash of the block, followed by a vector of what the block added. */
+template <typename T>
+static bool SendBlockData(CZMQAbstractPublishNotifier* notifier, const char *command, const CBlockIndex *pindex, const T& data, bool fDisconnected)
+{
+    const std::string strCommand = fDisconnected ? std::string(command) + "disconnected" : std::string(command);
+    LogPrint(BCLog::ZMQ, "zmq: Publish %s %s\n", strCommand, pindex->GetBlockHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << pindex->nHeight << pindex->GetBlockHash() << data;
+    return notifier->SendMessage(strCommand.c_str(), &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishAnonOutputsNotifier::PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected)
+{
+    // Indexes are handed out in block order, the same way ConnectBlock does
+    std::vector<std::pair<int64_t, CAnonOutput>> vOutputs;
+    int64_t nIndex = pindex->pprev ? pindex->pprev->nAnonOutputs : 0;
+    for (const auto& tx : pblock->vtx) {
+        COutPoint op(tx->GetHash(), 0);
+        for (unsigned int k = 0; k < tx->vpout.size(); k++) {
+            if (!tx->vpout[k]->IsType(OUTPUT_RINGCT))
+                continue;
+            const CTxOutRingCT *txout = (CTxOutRingCT*)tx->vpout[k].get();
+            op.n = k;
+            vOutputs.emplace_back(++nIndex, CAnonOutput(txout->pk, txout->commitment, op, pindex->nHeight, 0));
+        }
+    }
+    if (nIndex != pindex->nAnonOutputs) {
+        LogPrint(BCLog::ZMQ, "zmq: Anon outputs of block %s do not match its index, not published\n", pindex->GetBlockHash().GetHex());
+        return true;
+    }
+
+    if (vOutputs.empty())
+        return true;
+    return SendBlockData(this, MSG_ANONOUTPUTS, pindex, vOutputs, fDisconnected);
+}
+
+bool CZMQPublishKeyImagesNotifier::PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected)
+{
+    std::vector<std::pair<CCmpPubKey, uint256>> vKeyImages;
+    for (const auto& tx : pblock->vtx) {
+        for (const auto& txin : tx->vin) {
+            if (!txin.IsAnonInput())
+                continue;
+            uint32_t nAnonInputs, nRingSize;
+            txin.GetAnonInfo(nAnonInputs, nRingSize);
+            if (txin.scriptData.stack.size() != 1 || txin.scriptData.stack[0].size() != 33 * nAnonInputs)
+                continue;
+
+            const std::vector<uint8_t>& vKeyImageData = txin.scriptData.stack[0];
+            for (size_t k = 0; k < nAnonInputs; ++k)
+                vKeyImages.emplace_back(CCmpPubKey(vKeyImageData.begin() + k * 33, vKeyImageData.begin() + (k + 1) * 33), tx->GetHash());
+        }
+    }
+
+    if (vKeyImages.empty())
+        return true;
+    return SendBlockData(this, MSG_KEYIMAGES, pindex, vKeyImages, fDisconnected);
+}
+
+//! A zerocoin mint or spend: denomination, pubcoin value or serial and the hash of its transaction
+struct CZerocoinRecord
+{
+    int32_t nDenomination;
+    CBigNum bnValue;
+    uint256 txid;
+
+    CZerocoinRecord() : nDenomination(0) {}
+    CZerocoinRecord(int32_t nDenominationIn, const CBigNum& bnValueIn, const uint256& txidIn) :
+        nDenomination(nDenominationIn), bnValue(bnValueIn), txid(txidIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nDenomination);
+        READWRITE(bnValue);
+        READWRITE(txid);
+    }
+};
+
+bool CZMQPublishZerocoinMintsNotifier::PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected)
+{
+    std::vector<CZerocoinRecord> vMints;
+    for (const auto& tx : pblock->vtx) {
+        if (!tx->IsZerocoinMint())
+            continue;
+        for (const auto& pout : tx->vpout) {
+            if (!pout->IsZerocoinMint())
+                continue;
+            libzerocoin::PublicCoin coin(Params().Zerocoin_Params());
+            if (!OutputToPublicCoin(pout.get(), coin))
+                continue;
+            vMints.emplace_back((int32_t)coin.getDenomination(), coin.getValue(), tx->GetHash());
+        }
+    }
+
+    if (vMints.empty())
+        return true;
+    return SendBlockData(this, MSG_ZEROCOINMINTS, pindex, vMints, fDisconnected);
+}
+
+bool CZMQPublishZerocoinSpendsNotifier::PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected)
+{
+    std::vector<CZerocoinRecord> vSpends;
+    for (const auto& tx : pblock->vtx) {
+        if (!tx->IsZerocoinSpend())
+            continue;
+        for (const auto& txin : tx->vin) {
+            if (!txin.scriptSig.IsZerocoinSpend())
+                continue;
+            auto spend = TxInToZerocoinSpend(txin);
+            if (!spend)
+                continue;
+            vSpends.emplace_back((int32_t)spend->getDenomination(), spend->getCoinSerialNumber(), tx->GetHash());
+        }
+    }
+
+    if (vSpends.empty())
+        return true;
+    return SendBlockData(this, MSG_ZEROCOINSPENDS, pindex, vSpends, fDisconnected);
+}
+
+bool CZMQPublishAccumulatorsNotifier::PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected)
+{
+    // Only blocks that move the accumulators are checkpoints
+    if (pindex->pprev && pindex->pprev->GetAccumulatorHashes() == pblock->mapAccumulatorHashes)
+        return true;
+    return SendBlockData(this, MSG_ACCUMULATORS, pindex, pblock->mapAccumulatorHashes, fDisconnected);
+}
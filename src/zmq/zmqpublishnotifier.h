@@ -42,8 +42,13 @@ public:
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
+private:
+    //! The last connected block, so that the new tip does not have to be read from disk
+    std::shared_ptr<const CBlock> pblockConnected;
+
 public:
     bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex) override;
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -52,4 +57,48 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+/**
+ * Publishes what a block added to the chain when it is connected, and the same body again under the topic with
+ * "disconnected" appended when it is disconnected, so that subscribers can roll it back.
+ */
+class CZMQPublishBlockDataNotifier : public CZMQAbstractPublishNotifier
+{
+protected:
+    virtual bool PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected) = 0;
+
+public:
+    bool NotifyBlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex) override;
+    bool NotifyBlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex) override;
+};
+
+class CZMQPublishAnonOutputsNotifier : public CZMQPublishBlockDataNotifier
+{
+protected:
+    bool PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected) override;
+};
+
+class CZMQPublishKeyImagesNotifier : public CZMQPublishBlockDataNotifier
+{
+protected:
+    bool PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected) override;
+};
+
+class CZMQPublishZerocoinMintsNotifier : public CZMQPublishBlockDataNotifier
+{
+protected:
+    bool PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected) override;
+};
+
+class CZMQPublishZerocoinSpendsNotifier : public CZMQPublishBlockDataNotifier
+{
+protected:
+    bool PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected) override;
+};
+
+class CZMQPublishAccumulatorsNotifier : public CZMQPublishBlockDataNotifier
+{
+protected:
+    bool PublishBlockData(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, bool fDisconnected) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H